@@ -5,14 +5,45 @@
 # include "pf.h"
 
 
-/* splits a leaf node */
+/* Splits a copy of the leaf after key number half into half1 and half2,
+   and inserts the key into the first half if first is set, else into the
+   second - returns TRUE if it fits there, FALSE if not */
+static int
+AM_TrySplit(
+    char *pageBuf, /* leaf to split */
+    AM_LEAFHEADER *header, /* its header */
+    int half, /* number of keys of the first half */
+    int first, /* whether the key goes to the first half */
+    int attrLength,
+    AM_RecId recId,
+    char *value,
+    int status,
+    int index,
+    char *half1, /* gets the first half */
+    char *half2 /* gets the second half */
+)
+{
+    AM_Compact(1,half,pageBuf,half1,header);
+    AM_Compact(half + 1,header->numKeys,pageBuf,half2,header);
+    if (first) {
+        return(AM_InsertintoLeaf(half1,attrLength,value,recId,
+                                 index,status));
+    }
+    return(AM_InsertintoLeaf(half2,attrLength,value,recId,
+                             index - half,status));
+}
+
+
+/* splits a leaf node - returns TRUE if the key for the new leaf has to be
+   added to the parent, FALSE if not, AME_KEYFULL if the key to be
+   inserted cannot get the room it needs, or an error */
 
 int
 AM_SplitLeaf(int fileDesc, /* file descriptor */
              char *pageBuf, /* pointer to buffer */
              int *pageNum, /* pagenumber of new leaf created */
              int attrLength,
-             int recId,
+             AM_RecId recId,
              char *value, /* attribute value for insert */
 
              int status, /* Whether key was found or not in the tree */
@@ -25,10 +56,15 @@ AM_SplitLeaf(int fileDesc, /* file descriptor */
     AM_LEAFHEADER *header,*tempheader;
     char tempPage[PF_PAGE_SIZE]; /* temporary page for manipulation on the
 								         page */
+    char tempPage2[PF_PAGE_SIZE]; /* the other half, until it has a page */
     char *tempPageBuf,*tempPageBuf1;/* buffers for new pages to be
 								    allocated */
     int errVal;
     int tempPageNum,tempPageNum1;/* pagenumbers for pages to be allocated */
+    int splits[3]; /* keys in the first half, for the splits to try */
+    int firsts[3]; /* whether the key goes to the first half of each */
+    int i;
+    int fits; /* whether the key fits in its half */
 
     /* initialise pointers to headers */
     header = &head;
@@ -37,28 +73,37 @@ AM_SplitLeaf(int fileDesc, /* file descriptor */
     /* copy header from buffer */
     bcopy(pageBuf,header,AM_sl);
 
-    /* compact half the keys into temporary page */
-    AM_Compact(1,(header->numKeys)/2,pageBuf,tempPage,header);
+    /* split the keys in half, or else just before or after the key, so
+       that it gets the room its recId list needs - a new key may start
+       a half on its own, other halves keep a key at least */
+    splits[0] = (header->numKeys)/2;
+    firsts[0] = (index <= splits[0]);
+    splits[1] = index - 1;
+    firsts[1] = FALSE;
+    splits[2] = (status == AM_FOUND) ? index : index - 1;
+    firsts[2] = TRUE;
+    fits = FALSE;
+    for (i = 0; i < 3 && fits != TRUE; i++) {
+        if (splits[i] + (firsts[i] && status != AM_FOUND) >= 1 &&
+                header->numKeys - splits[i] +
+                (!firsts[i] && status != AM_FOUND) >= 1) {
+            fits = AM_TrySplit(pageBuf,header,splits[i],firsts[i],attrLength,
+                               recId,value,status,index,tempPage,tempPage2);
+        }
+    }
+    if (fits != TRUE) {
+        /* one key fills the leaf: its recIds cannot be split */
+        PF_UnfixPage(fileDesc,*pageNum,FALSE);
+        return(AME_KEYFULL);
+    }
 
     /* Allocate a new page for the other half of the leaf*/
     errVal = PF_AllocPage(fileDesc,&tempPageNum,&tempPageBuf);
-    AM_Check;
-
-    /* compact the other half keys */
-    AM_Compact((header->numKeys)/2 + 1,header->numKeys
-               ,pageBuf,tempPageBuf,header);
-
-    /*check where key has to be inserted */
-    if (index <= ((header->numKeys)/2)) {
-        /*value to be inserted is in first half */
-        errVal = AM_InsertintoLeaf(tempPage,attrLength,value,recId,
-                                   index,status);
-    } else {
-        /* value to be inserted in second half */
-        index = index - ((header->numKeys)/2);
-        errVal = AM_InsertintoLeaf(tempPageBuf,attrLength,value,
-                                   recId,index,status);
+    if (errVal != PFE_OK) {
+        PF_UnfixPage(fileDesc,*pageNum,FALSE);
     }
+    AM_Check;
+    bcopy(tempPage2,tempPageBuf,PF_PAGE_SIZE);
 
     /* change the next leafpage of first half of leaf to second half */
     bcopy(tempPage,tempheader,AM_sl);
@@ -88,6 +133,7 @@ AM_SplitLeaf(int fileDesc, /* file descriptor */
 
         AM_FillRootPage(pageBuf,tempPageNum1,tempPageNum,key,
                         header->attrLength,header->maxKeys);
+        AM_InvalidateRoot(fileDesc);
         errVal = PF_UnfixPage(fileDesc,tempPageNum1,TRUE);
         AM_Check;
     }
@@ -132,7 +178,10 @@ AM_AddtoParent(
     header = &head;
     /* Get the top of stack values for the page number of the parent
     					 and offset of the key */
-    AM_topofStack(&pageNumber,&offset);
+    if (!AM_topofStack(&pageNumber,&offset)) {
+        /* the path to the leaf was not recorded */
+        return(AME_INTERROR);
+    }
     AM_PopStack();
 
     /* Get the parent node */
@@ -175,6 +224,7 @@ AM_AddtoParent(
             attribute value */
             AM_FillRootPage(pageBuf,pageNum2,pageNum1,value,
                             header->attrLength, header->maxKeys);
+            AM_InvalidateRoot(fileDesc);
 
             errVal = PF_UnfixPage(fileDesc,pageNumber,TRUE);
             AM_Check;
@@ -17,12 +17,16 @@ typedef struct am_intheader {
     short attrLength;
 }	AM_INTHEADER ; /* Header for an internal node */
 
+typedef long long AM_RecId; /* record id stored in leaves: 48 bit page, 16 bit slot */
+
 extern int AM_RootPageNum; /* The page number of the root */
 extern int AM_LeftPageNum; /* The page Number of the leftmost leaf */
 extern int AM_Errno; /* last error in AM layer */
+extern int AM_Swizzle; /* TRUE if searches follow swizzled child references */
 
 # define AM_Check if (errVal != PFE_OK) {AM_Errno = AME_PF; return(AME_PF) ;}
 # define AM_si sizeof(int)
+# define AM_sr sizeof(AM_RecId) /* size of a recId in a leaf's recId list */
 # define AM_ss sizeof(short)
 # define AM_sl sizeof(AM_LEAFHEADER)
 # define AM_sint sizeof(AM_INTHEADER)
@@ -47,6 +51,7 @@ extern int AM_Errno; /* last error in AM layer */
 # define GREATER_THAN_EQUAL 5
 # define NOT_EQUAL 6
 # define MAXSCANS 20
+# define AM_MAXFILES 64 /* size of the PF open file table */
 # define AM_MAXATTRLENGTH 256
 
 
@@ -62,6 +67,7 @@ extern int AM_Errno; /* last error in AM layer */
 # define AME_INVALIDATTRTYPE -9
 # define AME_FD -10
 # define AME_INVALIDVALUE -11
+# define AME_KEYFULL -12 /* a key has more entries than a leaf page holds */
 
 int
 AM_CreateIndex(
@@ -82,7 +88,7 @@ AM_DeleteEntry(
     char attrType, /* 'c' , 'i' or 'f' */
     int attrLength, /* 4 for 'i' or 'f' , 1-255 for 'c' */
     char *value,/* Value of key whose corr recId is to be deleted */
-    int recId /* id of the record to delete */
+    AM_RecId recId /* id of the record to delete */
 );
 int
 AM_InsertEntry(
@@ -90,7 +96,17 @@ AM_InsertEntry(
     char attrType, /* 'i' or 'c' or 'f' */
     int attrLength, /* 4 for 'i' or 'f', 1-255 for 'c' */
     char *value, /* value to be inserted */
-    int recId /* recId to be inserted */
+    AM_RecId recId /* recId to be inserted */
+);
+
+int
+AM_InsertEntries(
+    int fileDesc, /* file Descriptor */
+    char attrType, /* 'i' or 'c' or 'f' */
+    int attrLength, /* 4 for 'i' or 'f', 1-255 for 'c' */
+    char *values, /* n values of attrLength bytes, in ascending order */
+    AM_RecId *recIds, /* recIds to be inserted, one per value */
+    int n /* number of entries */
 );
 
 void
@@ -106,7 +122,23 @@ AM_OpenIndexScan(
 );
 
 int
+AM_FindNextRecId(
+    int scanDesc, /* index scan descriptor */
+    AM_RecId *pRecId /* record id returned */
+);
+
+AM_RecId
 AM_FindNextEntry(int scanDesc/* index scan descriptor */);
 
 int
 AM_CloseIndexScan(int scanDesc /* scan Descriptor*/);
+
+int
+AM_RemapRecIds(
+    int fileDesc, /* file Descriptor */
+    AM_RecId (*remap)(void *obj, AM_RecId recId), /* new recId of a recId */
+    void *obj /* passed on to remap */
+);
+
+void
+AM_SetSwizzle(int on /* TRUE to turn swizzling on */);
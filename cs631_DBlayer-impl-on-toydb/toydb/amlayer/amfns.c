@@ -116,7 +116,7 @@ AM_DeleteEntry(
     char attrType, /* 'c' , 'i' or 'f' */
     int attrLength, /* 4 for 'i' or 'f' , 1-255 for 'c' */
     char *value,/* Value of key whose corr recId is to be deleted */
-    int recId /* id of the record to delete */
+    AM_RecId recId /* id of the record to delete */
 )
 {
     char *pageBuf;/* buffer to hold the page */
@@ -129,7 +129,7 @@ AM_DeleteEntry(
     char *currRecPtr;/* pointer to the current record in the list */
     AM_LEAFHEADER head,*header;/* header of the page */
     int recSize; /* length of key,ptr pair for a leaf */
-    int tempRec; /* holds the recId of the current record */
+    AM_RecId tempRec; /* holds the recId of the current record */
     int errVal; /* holds the return value of functions called within
 		   this function */
     int i; /* loop index */
@@ -161,12 +161,15 @@ AM_DeleteEntry(
 
     /* check if return value is an error */
     if (status < 0) {
+        AM_EmptyStack();
         AM_Errno = status;
         return(status);
     }
 
     /* The key is not in the tree */
     if (status == AM_NOT_FOUND) {
+        PF_UnfixPage(fileDesc,pageNum,FALSE);
+        AM_EmptyStack();
         AM_Errno = AME_NOTFOUND;
         return(AME_NOTFOUND);
     }
@@ -178,26 +181,28 @@ AM_DeleteEntry(
 
     /* search the list for recId */
     while(nextRec != 0) {
-        bcopy(pageBuf + nextRec,&tempRec,AM_si);
+        bcopy(pageBuf + nextRec,&tempRec,AM_sr);
 
         /* found the recId to be deleted */
         if (recId == tempRec) {
             /* Delete recId */
-            bcopy(pageBuf + nextRec + AM_si,currRecPtr,AM_ss);
+            bcopy(pageBuf + nextRec + AM_sr,currRecPtr,AM_ss);
             header->numinfreeList++;
             oldhead = header->freeListPtr;
             header->freeListPtr = nextRec;
-            bcopy(&oldhead,pageBuf + nextRec + AM_si,AM_ss);
+            bcopy(&oldhead,pageBuf + nextRec + AM_sr,AM_ss);
             break;
         } else {
             /* go over to the next item on the list */
-            currRecPtr = pageBuf + nextRec + AM_si;
+            currRecPtr = pageBuf + nextRec + AM_sr;
             bcopy(currRecPtr,&nextRec,AM_ss);
         }
     }
 
     /* if end of list reached then key not in tree */
     if (nextRec == AM_NULL) {
+        PF_UnfixPage(fileDesc,pageNum,FALSE);
+        AM_EmptyStack();
         AM_Errno = AME_NOTFOUND;
         return(AME_NOTFOUND);
     }
@@ -226,14 +231,15 @@ AM_DeleteEntry(
     }
 }
 
-/* Inserts a value,recId pair into the tree */
+/* Inserts a value,recId pair into the tree - returns AME_OK, AME_KEYFULL
+   if the value already has as many recIds as a leaf holds, or an error */
 int
 AM_InsertEntry(
     int fileDesc, /* file Descriptor */
     char attrType, /* 'i' or 'c' or 'f' */
     int attrLength, /* 4 for 'i' or 'f', 1-255 for 'c' */
     char *value, /* value to be inserted */
-    int recId /* recId to be inserted */
+    AM_RecId recId /* recId to be inserted */
 )
 {
     char *pageBuf; /* buffer to hold page */
@@ -327,6 +333,168 @@ AM_InsertEntry(
 }
 
 
+
+/* Finds the smallest key, among the internal nodes on the stack, that bounds
+   from above the keys routed to the leaf found by the last AM_Search - returns
+   TRUE with it in bound, FALSE if the leaf is the rightmost one, or an error */
+static int
+AM_LeafBound(
+    int fileDesc,
+    char attrType,
+    int attrLength,
+    char *bound
+)
+{
+    char *pageBuf; /* buffer holding an internal node */
+    int pageNum; /* page number of the node */
+    int offset; /* child of the node that was followed */
+    int depth; /* level above the leaf */
+    int found; /* whether a bound has been found */
+    int errVal;
+    AM_INTHEADER head,*header;
+
+    header = &head;
+    found = FALSE;
+    for (depth = 0; AM_StackEntry(depth,&pageNum,&offset); depth++) {
+        errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+        AM_Check;
+        bcopy(pageBuf,header,AM_sint);
+
+        /* the key after the child followed, if any, bounds it */
+        if (offset < header->numKeys) {
+            char *key = pageBuf + AM_sint + AM_si + offset*(attrLength + AM_si);
+            if (!found || AM_Compare(bound,attrType,attrLength,key) < 0) {
+                bcopy(key,bound,attrLength);
+                found = TRUE;
+            }
+        }
+        errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+        AM_Check;
+    }
+    return(found);
+}
+
+
+/* Inserts n (key, recId) pairs, sorted by key, into the B+ tree. The keys
+   that go to the same leaf are put in with one search and one fix of the
+   leaf, until it fills up and has to be split as in AM_InsertEntry. On an
+   error (AME_KEYFULL too) the entries before the failing one stay in */
+int
+AM_InsertEntries(
+    int fileDesc, /* file Descriptor */
+    char attrType, /* 'i' or 'c' or 'f' */
+    int attrLength, /* 4 for 'i' or 'f', 1-255 for 'c' */
+    char *values, /* n values of attrLength bytes, in ascending order */
+    AM_RecId *recIds, /* recIds to be inserted, one per value */
+    int n /* number of entries */
+)
+{
+    char *pageBuf; /* buffer to hold page */
+    int pageNum; /* page number of the page in buffer */
+    int index; /* index where key can be found or can be inserted */
+    int status; /* whether key is old or new */
+    int inserted; /* Whether key has been inserted into the leaf or
+		     splitting is needed */
+    int addtoparent; /* Whether key has to be added to the parent */
+    int bounded; /* whether the leaf has a key bounding it from above */
+    int errVal; /* return value of functions within this function */
+    int i; /* entry being inserted */
+    char *value; /* its key */
+    char key[AM_MAXATTRLENGTH]; /* holds the attribute to be passed
+				   back to the parent */
+    char bound[AM_MAXATTRLENGTH]; /* keys from bound on go to other leaves */
+    AM_LEAFHEADER head,*header;
+
+    /* check the parameters */
+    if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i')) {
+        AM_Errno = AME_INVALIDATTRTYPE;
+        return(AME_INVALIDATTRTYPE);
+    }
+
+    if ((values == NULL && n > 0) || (recIds == NULL && n > 0)) {
+        AM_Errno = AME_INVALIDVALUE;
+        return(AME_INVALIDVALUE);
+    }
+
+    if (fileDesc < 0) {
+        AM_Errno = AME_FD;
+        return(AME_FD);
+    }
+
+    header = &head;
+    i = 0;
+    while (i < n) {
+        value = values + i*attrLength;
+
+        /* Search the leaf for the first key left */
+        status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,
+                           &pageBuf,&index);
+        if (status < 0) {
+            AM_EmptyStack();
+            AM_Errno = status;
+            return(status);
+        }
+        bounded = AM_LeafBound(fileDesc,attrType,attrLength,bound);
+        if (bounded < 0) {
+            PF_UnfixPage(fileDesc,pageNum,FALSE);
+            AM_EmptyStack();
+            AM_Errno = bounded;
+            return(bounded);
+        }
+
+        /* Insert the keys that belong to this leaf while it has room */
+        inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recIds[i],
+                                     index,status);
+        while (inserted == TRUE && ++i < n) {
+            value = values + i*attrLength;
+            if (bounded && AM_Compare(bound,attrType,attrLength,value) >= 0) {
+                break;
+            }
+            bcopy(pageBuf,header,AM_sl);
+            status = AM_SearchLeaf(pageBuf,attrType,attrLength,value,
+                                   &index,header);
+            inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,
+                                         recIds[i],index,status);
+        }
+
+        if (inserted == TRUE) {
+            errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+            AM_EmptyStack();
+            AM_Check;
+            continue;
+        }
+
+        /* check if there is any error */
+        if (inserted < 0) {
+            PF_UnfixPage(fileDesc,pageNum,TRUE);
+            AM_EmptyStack();
+            AM_Errno = inserted;
+            return(inserted);
+        }
+
+        /* the leaf is full: split it with the key in hand */
+        addtoparent = AM_SplitLeaf(fileDesc,pageBuf,&pageNum,
+                                   attrLength,recIds[i],value,status,index,key);
+        if (addtoparent < 0) {
+            AM_EmptyStack();
+            AM_Errno = addtoparent;
+            return(addtoparent);
+        }
+        if (addtoparent == TRUE) {
+            errVal = AM_AddtoParent(fileDesc,pageNum,key,attrLength);
+            if (errVal < 0) {
+                AM_EmptyStack();
+                AM_Errno = errVal;
+                return(errVal);
+            }
+        }
+        AM_EmptyStack();
+        i++;
+    }
+    return(AME_OK);
+}
+
+
 /* error messages */
 static char *AMerrormsg[] = {
     "No error",
@@ -340,7 +508,8 @@ static char *AMerrormsg[] = {
     "Scan Table is full",
     "Invalid Attribute Type",
     "Invalid file Descriptor",
-    "Invalid value to Delete or Insert Entry"
+    "Invalid value to Delete or Insert Entry",
+    "Too many entries with the same key for a leaf page"
 };
 
 
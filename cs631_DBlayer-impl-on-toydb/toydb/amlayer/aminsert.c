@@ -11,7 +11,7 @@ AM_InsertintoLeaf(
     char *pageBuf,/* buffer where the leaf page resides */
     int attrLength,
     char *value,/* attribute value to be inserted*/
-    int recId,/* recid of the attribute to be inserted */
+    AM_RecId recId,/* recid of the attribute to be inserted */
     int index,/* index where key is to be inserted */
     int status/* Whether key is a new key or an old key */
 )
@@ -31,7 +31,7 @@ AM_InsertintoLeaf(
         /* key is already present */
     {
         if (header->freeListPtr == 0)
-            if ((header->recIdPtr - header->keyPtr) <(AM_si + AM_ss)) {
+            if ((header->recIdPtr - header->keyPtr) <(AM_sr + AM_ss)) {
                 /* no room for one more record */
                 return(FALSE);
             }
@@ -44,7 +44,7 @@ AM_InsertintoLeaf(
     /* status == AM_NOTFOUND and so key is a new key */
     if ((header->freeListPtr) == 0)
         /* freelist empty */
-        if ((header->recIdPtr - header->keyPtr) < (AM_si + AM_ss
+        if ((header->recIdPtr - header->keyPtr) < (AM_sr + AM_ss
                 + recSize)) {
             return(FALSE);
         } else {
@@ -60,8 +60,8 @@ AM_InsertintoLeaf(
             bcopy(header,pageBuf,AM_sl);
             return(TRUE);
         } else /* no place in the middle */
-            if (((header->numinfreeList)*(AM_si + AM_ss) + header->recIdPtr -
-                    header->keyPtr) > (recSize + AM_si + AM_ss))
+            if (((header->numinfreeList)*(AM_sr + AM_ss) + header->recIdPtr -
+                    header->keyPtr) > (recSize + AM_sr + AM_ss))
                 /*there is enough space in the freelist and in the middle put together */
             {
                 /* Compact the freelist so that we get enough space in the middle                   so that the new key can be inserted */
@@ -84,7 +84,7 @@ AM_InsertintoLeaf(
 void
 AM_InsertToLeafFound(
     char *pageBuf,
-    int recId,
+    AM_RecId recId,
     int index,
     AM_LEAFHEADER *header)
 
@@ -95,12 +95,12 @@ AM_InsertToLeafFound(
 
     recSize = header->attrLength + AM_ss;
     if ((header->freeListPtr) == 0) {
-        header->recIdPtr = header->recIdPtr - AM_si - AM_ss;
+        header->recIdPtr = header->recIdPtr - AM_sr - AM_ss;
         tempPtr = header->recIdPtr;
     } else {
         tempPtr = header->freeListPtr;
         header->numinfreeList--;
-        bcopy(pageBuf + tempPtr + AM_si,(char *)&(header->freeListPtr)
+        bcopy(pageBuf + tempPtr + AM_sr,(char *)&(header->freeListPtr)
               ,AM_ss);
     }
 
@@ -113,10 +113,10 @@ AM_InsertToLeafFound(
           header->attrLength,AM_ss);
 
     /* Copy the recId*/
-    bcopy((char *)&recId,pageBuf + tempPtr,AM_si);
+    bcopy((char *)&recId,pageBuf + tempPtr,AM_sr);
 
     /* make the old head of list the second on list */
-    bcopy((char *)&oldhead,pageBuf + tempPtr+AM_si,AM_ss);
+    bcopy((char *)&oldhead,pageBuf + tempPtr+AM_sr,AM_ss);
 }
 
 
@@ -125,7 +125,7 @@ void
 AM_InsertToLeafNotFound(
     char *pageBuf,
     char *value,
-    int recId,
+    AM_RecId recId,
     int index,
     AM_LEAFHEADER *header)
 {
@@ -178,7 +178,8 @@ AM_Compact(
     bcopy(header,tempheader,AM_sl);
 
     recSize = header->attrLength + AM_ss;
-    recIdPtr = PF_PAGE_SIZE - AM_si - AM_ss ;
+    recIdPtr = PF_PAGE_SIZE - AM_sr - AM_ss ;
+    offset2 = AM_sl - recSize; /* an empty range leaves an empty leaf */
 
     for (i = low, j = 1; i <= high; i++,j++) {
         offset1 = (i - 1) * recSize + AM_sl;
@@ -189,21 +190,21 @@ AM_Compact(
         bcopy((char *)&recIdPtr,tempPage + offset2 + header->attrLength,
               AM_ss);
         while (nextRec != 0) {
-            bcopy(pageBuf + nextRec,tempPage + recIdPtr,AM_si);
-            recIdPtr = recIdPtr - AM_si - AM_ss;
-            bcopy((char *)&recIdPtr,tempPage + recIdPtr + 2 * AM_si
+            bcopy(pageBuf + nextRec,tempPage + recIdPtr,AM_sr);
+            recIdPtr = recIdPtr - AM_sr - AM_ss;
+            bcopy((char *)&recIdPtr,tempPage + recIdPtr + 2 * AM_sr
                   + AM_ss,
                   AM_ss);
-            bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+            bcopy(pageBuf + nextRec + AM_sr,(char *)&nextRec,AM_ss);
         }
-        bcopy((char *)&nextRec,tempPage + recIdPtr + 2 * AM_si + AM_ss,
+        bcopy((char *)&nextRec,tempPage + recIdPtr + 2 * AM_sr + AM_ss,
               AM_ss);
     }
 
     /* Initialise the header appropriately */
     tempheader->pageType = header->pageType;
     tempheader->nextLeafPage = header->nextLeafPage;
-    tempheader->recIdPtr = recIdPtr + AM_si + AM_ss;
+    tempheader->recIdPtr = recIdPtr + AM_sr + AM_ss;
     tempheader->keyPtr = offset2 + recSize;
     tempheader->freeListPtr = 0;
     tempheader->numinfreeList = 0;
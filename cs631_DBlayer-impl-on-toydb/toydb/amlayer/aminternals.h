@@ -18,7 +18,7 @@ int AM_DeleteEntry(
     char attrType, /* 'c' , 'i' or 'f' */
     int attrLength, /* 4 for 'i' or 'f' , 1-255 for 'c' */
     char *value,/* Value of key whose corr recId is to be deleted */
-    int recId /* id of the record to delete */
+    AM_RecId recId /* id of the record to delete */
 );
 
 int AM_InsertEntry(
@@ -26,7 +26,7 @@ int AM_InsertEntry(
     char attrType, /* 'i' or 'c' or 'f' */
     int attrLength, /* 4 for 'i' or 'f', 1-255 for 'c' */
     char *value, /* value to be inserted */
-    int recId /* recId to be inserted */
+    AM_RecId recId /* recId to be inserted */
 );
 
 void AM_PrintError(char *s);
@@ -36,14 +36,14 @@ AM_InsertintoLeaf(
     char *pageBuf,/* buffer where the leaf page resides */
     int attrLength,
     char *value,/* attribute value to be inserted*/
-    int recId,/* recid of the attribute to be inserted */
+    AM_RecId recId,/* recid of the attribute to be inserted */
     int index,/* index where key is to be inserted */
     int status/* Whether key is a new key or an old key */
 );
 void
 AM_InsertToLeafFound(
     char *pageBuf,
-    int recId,
+    AM_RecId recId,
     int index,
     AM_LEAFHEADER *header);
 
@@ -51,7 +51,7 @@ void
 AM_InsertToLeafNotFound(
     char *pageBuf,
     char *value,
-    int recId,
+    AM_RecId recId,
     int index,
     AM_LEAFHEADER *header);
 
@@ -70,7 +70,7 @@ AM_SplitLeaf(int fileDesc, /* file descriptor */
              char *pageBuf, /* pointer to buffer */
              int *pageNum, /* pagenumber of new leaf created */
              int attrLength,
-             int recId,
+             AM_RecId recId,
              char *value, /* attribute value for insert */
 
              int status, /* Whether key was found or not in the tree */
@@ -117,18 +117,27 @@ AM_SplitIntNode(
 );
 
 void
+AM_InvalidateRoot(int fileDesc);
+
+int
 AM_PushStack(int pageNum, int offset);
 
 void
 AM_PopStack();
 
-void
+int
 AM_topofStack(int *pageNum,
               int *offset
              );
 void
 AM_EmptyStack();
 
+int
+AM_StackEntry(int depth,
+              int *pageNum,
+              int *offset
+             );
+
 int
 AM_Search(
     int fileDesc,
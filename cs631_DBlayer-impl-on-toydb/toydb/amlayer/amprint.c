@@ -44,7 +44,7 @@ AM_PrintLeafNode(
     short nextRec;
     int i;
     int recSize;
-    int recId;
+    AM_RecId recId;
     int offset1;
     AM_LEAFHEADER *header;
 
@@ -65,9 +65,9 @@ AM_PrintLeafNode(
         AM_PrintAttr(pageBuf + AM_sl + (i-1)*recSize,attrType,header->attrLength);
         bcopy(pageBuf + offset1 + header->attrLength,(char *)&nextRec,AM_ss);
         while (nextRec != 0) {
-            bcopy(pageBuf + nextRec,(char *)&recId,AM_si);
-            printf("RECID is %d\n",recId);
-            bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+            bcopy(pageBuf + nextRec,(char *)&recId,AM_sr);
+            printf("RECID is %lld\n",recId);
+            bcopy(pageBuf + nextRec + AM_sr,(char *)&nextRec,AM_ss);
         }
         printf("\n");
         printf("\n");
@@ -123,7 +123,7 @@ AM_PrintLeafKeys(
     short nextRec;
     int i;
     int recSize;
-    int recId;
+    AM_RecId recId;
     int offset1;
     AM_LEAFHEADER *header;
 
@@ -135,9 +135,9 @@ AM_PrintLeafKeys(
         AM_PrintAttr(pageBuf + AM_sl + (i-1)*recSize,attrType,header->attrLength);
         bcopy(pageBuf + offset1 + header->attrLength,(char *)&nextRec,AM_ss);
         while (nextRec != 0) {
-            bcopy(pageBuf + nextRec,(char *)&recId,AM_si);
-            printf("RECID is %d\n",recId);
-            bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+            bcopy(pageBuf + nextRec,(char *)&recId,AM_sr);
+            printf("RECID is %lld\n",recId);
+            bcopy(pageBuf + nextRec + AM_sr,(char *)&nextRec,AM_ss);
         }
     }
 }
@@ -5,6 +5,7 @@
 # include "pf.h"
 
 int GetLeftPageNum(int fileDesc);
+static int AM_EndBefore(int fileDesc, int scanDesc, int pageNum);
 
 /* The structure of the scan Table */
 struct {
@@ -43,6 +44,8 @@ AM_OpenIndexScan(
     int errVal; /* return value of functions */
     AM_LEAFHEADER head,*header; /* local header */
     int searchpageNum;
+    int endBefore; /* TRUE if a < or <= scan ends in an earlier leaf */
+    char *searchBuf; /* buffer of the leaf searched, still fixed */
 
 
 
@@ -95,9 +98,13 @@ AM_OpenIndexScan(
         return(scanDesc);
     }
 
-    /* search for the pagenumber and index of value */
+    /* search for the pagenumber and index of value. The path pushed
+       by AM_Search is not needed, so drop it or repeated scans overflow
+       the stack */
     status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,&pageBuf,&index);
+    AM_EmptyStack();
     searchpageNum = pageNum;
+    searchBuf = pageBuf;
     /* check for errors */
     if (status < 0) {
         AM_scanTable[scanDesc].status = FREE;
@@ -114,12 +121,13 @@ AM_OpenIndexScan(
        key */
     if (index > header->numKeys) {
         if (header->nextLeafPage != AM_NULL_PAGE) {
-            errVal = PF_GetThisPage(fileDesc,header->nextLeafPage,&pageBuf);
+            /* the header is overwritten by the next leaf's */
+            pageNum = header->nextLeafPage;
+            errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
             AM_Check;
             bcopy(pageBuf,header,AM_sl);
-            errVal = PF_UnfixPage(fileDesc,header->nextLeafPage,FALSE);
+            errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
             AM_Check;
-            pageNum = header->nextLeafPage;
             index = 1;
         } else {
             pageNum = AM_NULL_PAGE;
@@ -127,6 +135,7 @@ AM_OpenIndexScan(
     }
     AM_scanTable[scanDesc].pageNum = pageNum;
     AM_scanTable[scanDesc].index = index;
+    endBefore = FALSE;
 
     /* case on op */
 
@@ -153,6 +162,8 @@ AM_OpenIndexScan(
         if (searchpageNum != AM_LeftPageNum) {
             errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
             AM_Check;
+        } else {
+            pageBuf = searchBuf;
         }
         bcopy(pageBuf + AM_sl + attrLength,
               &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
@@ -162,6 +173,8 @@ AM_OpenIndexScan(
         }
         AM_scanTable[scanDesc].lastpageNum  = pageNum;
         AM_scanTable[scanDesc].lastIndex  = index - 1 ;
+        /* value is the first key of its leaf */
+        endBefore = (index == 1);
         break;
     }
     case GREATER_THAN : {
@@ -204,6 +217,8 @@ AM_OpenIndexScan(
         if (searchpageNum != AM_LeftPageNum) {
             errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
             AM_Check;
+        } else {
+            pageBuf = searchBuf;
         }
         bcopy(pageBuf + AM_sl + attrLength,
               &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
@@ -216,6 +231,8 @@ AM_OpenIndexScan(
             AM_scanTable[scanDesc].lastIndex  = index ;
         } else {
             AM_scanTable[scanDesc].lastIndex  = index - 1;
+            /* value goes before the first key of its leaf */
+            endBefore = (index == 1);
         }
         break;
     }
@@ -235,6 +252,8 @@ AM_OpenIndexScan(
             if (searchpageNum != AM_LeftPageNum) {
                 errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
                 AM_Check;
+            } else {
+                pageBuf = searchBuf;
             }
             bcopy(pageBuf + AM_sl + attrLength,
                   &AM_scanTable[scanDesc].nextRecIdPtr,   AM_ss);
@@ -256,15 +275,25 @@ AM_OpenIndexScan(
     }
     errVal = PF_UnfixPage(fileDesc,searchpageNum,FALSE);
     AM_Check;
+    if (endBefore) {
+        errVal = AM_EndBefore(fileDesc,scanDesc,pageNum);
+        if (errVal != AME_OK) {
+            AM_scanTable[scanDesc].status = FREE;
+            return(errVal);
+        }
+    }
     return(scanDesc);
 }
 
-/* returns the record id of the next record that satisfies the conditions
-   specified for index scan associated with scanDesc */
+/* puts in *pRecId the record id of the next record that satisfies the
+   conditions specified for index scan associated with scanDesc; returns
+   AME_OK, AME_EOF at the end of the scan, or an error code. Unlike
+   AM_FindNextEntry, every record id can be told from the end of the scan */
 int
-AM_FindNextEntry(int scanDesc/* index scan descriptor */)
+AM_FindNextRecId(int scanDesc,/* index scan descriptor */
+                 AM_RecId *pRecId/* record id returned */)
 {
-    int recId; /* recordId to be returned */
+    AM_RecId recId; /* recordId to be returned */
     char *pageBuf;/* buffer for page */
     int errVal;/* return value for functions */
     AM_LEAFHEADER head,*header; /* local header */
@@ -318,16 +347,8 @@ AM_FindNextEntry(int scanDesc/* index scan descriptor */)
             AM_scanTable[scanDesc].status = FIRST;
         }
 
-    /* if op is < or <= check if you are done - might have overshot while scanning
-       empty pages*/
-    if ((AM_scanTable[scanDesc].op == LESS_THAN) ||
-            (AM_scanTable[scanDesc].op == LESS_THAN_EQUAL)) {
-        if ((AM_scanTable[scanDesc].lastpageNum <= AM_scanTable[scanDesc].nextpageNum)
-                && (AM_scanTable[scanDesc].lastIndex == 0)) {
-            AM_scanTable[scanDesc].status = OVER;
-            return(AME_EOF);
-        }
-    }
+    /* a < or <= scan ends at a key of a non empty leaf (see AM_EndBefore),
+       so skipping empty pages cannot overshoot it */
     /* if op is not equal then check if we have to skip this value */
     if (AM_scanTable[scanDesc].op == NOT_EQUAL) {
         if ((AM_scanTable[scanDesc].pageNum == AM_scanTable[scanDesc].nextpageNum)
@@ -379,10 +400,10 @@ AM_FindNextEntry(int scanDesc/* index scan descriptor */)
     }
 
     /* copy the recId to be returned */
-    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recId,AM_si);
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recId,AM_sr);
 
     /* copy the place for next recId */
-    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si,
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_sr,
           &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
 
 
@@ -440,6 +461,22 @@ AM_FindNextEntry(int scanDesc/* index scan descriptor */)
             }
         }
     }
+    *pRecId = recId;
+    return(AME_OK);
+}
+
+/* returns the record id of the next record that satisfies the conditions
+   specified for index scan associated with scanDesc, or an error code
+   (AME_EOF at the end of the scan) */
+AM_RecId
+AM_FindNextEntry(int scanDesc/* index scan descriptor */)
+{
+    AM_RecId recId; /* recordId to be returned */
+    int errVal;/* return value for functions */
+
+    errVal = AM_FindNextRecId(scanDesc,&recId);
+    if (errVal != AME_OK)
+        return(errVal);
     return(recId);
 }
 
@@ -458,6 +495,88 @@ AM_CloseIndexScan(int scanDesc /* scan Descriptor*/)
 }
 
 
+/* rewrites every recId in the leaves of an index as remap(obj,recId),
+   keeping the keys, for records of the indexed file that have moved */
+int
+AM_RemapRecIds(
+    int fileDesc, /* file Descriptor */
+    AM_RecId (*remap)(void *obj, AM_RecId recId), /* new recId of a recId */
+    void *obj /* passed on to remap */
+)
+{
+    char *pageBuf; /* buffer for page */
+    int pageNum; /* leaf being rewritten */
+    int errVal; /* return value for functions */
+    int i;
+    int recSize; /* size of key,ptr pair for leaf */
+    short nextRec; /* offset of the next recId of a key's list */
+    AM_RecId recId;
+    AM_LEAFHEADER head,*header; /* local header */
+
+    if (fileDesc < 0) {
+        AM_Errno = AME_FD;
+        return(AME_FD);
+    }
+
+    header = &head;
+    pageNum = GetLeftPageNum(fileDesc);
+    if (pageNum < 0) {
+        return(pageNum);
+    }
+    while (pageNum != AM_NULL_PAGE) {
+        errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+        AM_Check;
+        bcopy(pageBuf,header,AM_sl);
+        recSize = header->attrLength + AM_ss;
+        for (i = 1; i <= header->numKeys; i++) {
+            bcopy(pageBuf + AM_sl + (i - 1)*recSize + header->attrLength,
+                  &nextRec,AM_ss);
+            while (nextRec != 0) {
+                bcopy(pageBuf + nextRec,&recId,AM_sr);
+                recId = (*remap)(obj,recId);
+                bcopy(&recId,pageBuf + nextRec,AM_sr);
+                bcopy(pageBuf + nextRec + AM_sr,&nextRec,AM_ss);
+            }
+        }
+        errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+        AM_Check;
+        pageNum = header->nextLeafPage;
+    }
+    return(AME_OK);
+}
+
+
+/* ends a < or <= scan at the last key of the last non empty leaf before
+   leaf pageNum, following the leaf chain from the leftmost leaf. Leaves
+   are not in page number order. With no such leaf the scan is over */
+static int
+AM_EndBefore(int fileDesc, int scanDesc, int pageNum)
+{
+    char *pageBuf; /* buffer for page */
+    int leafNum; /* leaf being looked at */
+    int errVal; /* return value for functions */
+    AM_LEAFHEADER head,*header; /* local header */
+
+    header = &head;
+    AM_scanTable[scanDesc].status = OVER;
+    leafNum = AM_LeftPageNum;
+    while (leafNum != pageNum && leafNum != AM_NULL_PAGE) {
+        errVal = PF_GetThisPage(fileDesc,leafNum,&pageBuf);
+        AM_Check;
+        bcopy(pageBuf,header,AM_sl);
+        errVal = PF_UnfixPage(fileDesc,leafNum,FALSE);
+        AM_Check;
+        if (header->numKeys > 0) {
+            AM_scanTable[scanDesc].status = FIRST;
+            AM_scanTable[scanDesc].lastpageNum = leafNum;
+            AM_scanTable[scanDesc].lastIndex = header->numKeys;
+        }
+        leafNum = header->nextLeafPage;
+    }
+    return(AME_OK);
+}
+
+
 int
 GetLeftPageNum(int fileDesc)
 {
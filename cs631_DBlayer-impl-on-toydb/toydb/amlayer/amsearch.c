@@ -4,6 +4,134 @@
 # include "aminternals.h"
 # include "pf.h"
 
+/* cached reference to the root of each open index, for swizzled search */
+static struct {
+    int valid; /* TRUE once pageNum is known */
+    int stamp; /* PF_FileStamp() of the file pageNum was found in */
+    int pageNum; /* page number of the root */
+    PF_PageRef ref; /* buffer holding the root */
+} AM_RootRef[AM_MAXFILES];
+
+/* turns swizzled search on or off. While on, AM_Search keeps a direct
+   reference to the buffer of each child next to every resident internal
+   node, so that a descent through cached nodes needs no buffer hash
+   lookups. The references are dropped by the PF layer when a node is
+   modified or evicted. */
+void
+AM_SetSwizzle(int on /* TRUE to turn swizzling on */)
+{
+    AM_Swizzle = on;
+    bzero((char *)AM_RootRef,sizeof(AM_RootRef));
+}
+
+/* forgets the root cached for fileDesc; called when the root is split.
+   A cached entry is also dropped once its file is closed, since the
+   file next opened under the same descriptor has another stamp. */
+void
+AM_InvalidateRoot(int fileDesc)
+{
+    if (fileDesc >= 0 && fileDesc < AM_MAXFILES)
+        AM_RootRef[fileDesc].valid = FALSE;
+}
+
+
+/* swizzled version of AM_Search; same arguments and return values */
+static int
+AM_SwizzledSearch(
+    int fileDesc,
+    char attrType,
+    int attrLength,
+    char *value,
+    int *pageNum,
+    char **pageBuf,
+    int *indexPtr
+)
+{
+    int errVal;
+    int stamp; /* PF_FileStamp() of fileDesc */
+    int nextPage; /* next page to be followed on the path from root to leaf*/
+    PF_PageRef ref; /* buffer holding the current node */
+    PF_PageRef childRef; /* buffer holding the next node */
+    PF_PageRef *childRefs; /* child references kept with the current node*/
+    AM_LEAFHEADER lhead,*lheader; /* local pointer to leaf header */
+    AM_INTHEADER ihead,*iheader; /* local pointer to internal node header */
+
+    /* initialise the headeers */
+    lheader = &lhead;
+    iheader = &ihead;
+
+    /* find the root page number once per opened index */
+    stamp = PF_FileStamp(fileDesc);
+    if (stamp < 0)
+        return(stamp);
+    if (!AM_RootRef[fileDesc].valid || AM_RootRef[fileDesc].stamp != stamp) {
+        errVal = PF_GetFirstPage(fileDesc,pageNum,pageBuf);
+        AM_Check;
+        errVal = PF_UnfixPage(fileDesc,*pageNum,FALSE);
+        AM_Check;
+        AM_RootRef[fileDesc].pageNum = *pageNum;
+        AM_RootRef[fileDesc].ref.frame = NULL;
+        AM_RootRef[fileDesc].stamp = stamp;
+        AM_RootRef[fileDesc].valid = TRUE;
+    }
+
+    /* get the root of the B+ tree */
+    *pageNum = AM_RootRef[fileDesc].pageNum;
+    ref = AM_RootRef[fileDesc].ref;
+    errVal = PF_GetRefPage(fileDesc,*pageNum,&ref,pageBuf);
+    AM_Check;
+    AM_RootRef[fileDesc].ref = ref;
+
+    while (1) {
+        if (**pageBuf == 'l' ) {
+            bcopy(*pageBuf,lheader,AM_sl);
+            if (lheader->attrLength != attrLength) {
+                return(AME_INVALIDATTRLENGTH);
+            }
+            break;
+        }
+        bcopy(*pageBuf,iheader,AM_sint);
+        if (iheader->attrLength != attrLength) {
+            return(AME_INVALIDATTRLENGTH);
+        }
+
+        /* find the next page to be followed */
+        nextPage = AM_BinSearch(*pageBuf,attrType,attrLength,value,
+                                indexPtr,iheader);
+
+        /* push onto stack for backtracking and splitting nodes if
+           needed later */
+        if (AM_PushStack(*pageNum,*indexPtr) != AME_OK) {
+            PF_UnfixRefPage(fileDesc,*pageNum,&ref,FALSE);
+            return(AME_INTERROR);
+        }
+
+        /* follow the child reference kept with this node, if any,
+           while the node is still fixed */
+        childRefs = (PF_PageRef *)PF_RefExt(&ref,
+                                            (iheader->maxKeys + 2)*sizeof(PF_PageRef));
+        if (childRefs != NULL) {
+            childRef = childRefs[*indexPtr];
+        } else {
+            childRef.frame = NULL;
+        }
+        errVal = PF_GetRefPage(fileDesc,nextPage,&childRef,pageBuf);
+        AM_Check;
+        if (childRefs != NULL) {
+            childRefs[*indexPtr] = childRef;
+        }
+
+        errVal = PF_UnfixRefPage(fileDesc,*pageNum,&ref,FALSE);
+        AM_Check;
+
+        *pageNum = nextPage;
+        ref = childRef;
+    }
+    /* find whether key is in leaf or not */
+    return(AM_SearchLeaf(*pageBuf,attrType,attrLength,value,indexPtr,lheader));
+}
+
+
 /* searches for a key in a binary tree - returns FOUND or NOTFOUND and
    returns the pagenumber and the offset where key is present or could
    be inserted */
@@ -25,6 +153,11 @@ AM_Search(
     AM_LEAFHEADER lhead,*lheader; /* local pointer to leaf header */
     AM_INTHEADER ihead,*iheader; /* local pointer to internal node header */
 
+    if (AM_Swizzle && fileDesc >= 0 && fileDesc < AM_MAXFILES) {
+        return(AM_SwizzledSearch(fileDesc,attrType,attrLength,value,
+                                 pageNum,pageBuf,indexPtr));
+    }
+
     /* initialise the headeers */
     lheader = &lhead;
     iheader = &ihead;
@@ -55,7 +188,10 @@ AM_Search(
 
         /* push onto stack for backtracking and splitting nodes if
            needed later */
-        AM_PushStack(*pageNum,*indexPtr);
+        if (AM_PushStack(*pageNum,*indexPtr) != AME_OK) {
+            PF_UnfixPage(fileDesc,*pageNum,FALSE);
+            return(AME_INTERROR);
+        }
 
         errVal = PF_UnfixPage(fileDesc,*pageNum,FALSE);
         AM_Check;
@@ -11,12 +11,18 @@ struct {
 
 int AM_topofStackPtr = -1;
 
-void
+/* pushes a node of the path from the root - returns AME_OK, or
+   AME_INTERROR if the path is deeper than the stack */
+int
 AM_PushStack(int pageNum, int offset)
 {
+    if (AM_topofStackPtr == AM_MAXSTACK - 1) {
+        return(AME_INTERROR);
+    }
     AM_topofStackPtr++;
     AM_Stack[AM_topofStackPtr].pageNumber  = pageNum;
     AM_Stack[AM_topofStackPtr].offset  = offset;
+    return(AME_OK);
 }
 
 void
@@ -25,13 +31,18 @@ AM_PopStack()
     AM_topofStackPtr--;
 }
 
-void
+/* gets the top of the stack - returns FALSE if the stack is empty */
+int
 AM_topofStack(int *pageNum,
               int *offset
              )
 {
+    if (AM_topofStackPtr < 0) {
+        return(FALSE);
+    }
     *pageNum = AM_Stack[AM_topofStackPtr].pageNumber ;
     *offset = AM_Stack[AM_topofStackPtr].offset ;
+    return(TRUE);
 }
 
 void
@@ -40,3 +51,19 @@ AM_EmptyStack()
     AM_topofStackPtr = -1;
 }
 
+
+/* gets the entry depth levels below the top of the stack (0 is the top) -
+   returns FALSE if the stack is not that deep */
+int
+AM_StackEntry(int depth,
+              int *pageNum,
+              int *offset
+             )
+{
+    if (depth > AM_topofStackPtr) {
+        return(FALSE);
+    }
+    *pageNum = AM_Stack[AM_topofStackPtr - depth].pageNumber ;
+    *offset = AM_Stack[AM_topofStackPtr - depth].offset ;
+    return(TRUE);
+}
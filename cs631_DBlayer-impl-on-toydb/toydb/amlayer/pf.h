@@ -34,8 +34,15 @@
 /* page size */
 #define PF_PAGE_SIZE	4096
 
+/* direct reference to the buffer holding a page (see PF_GetRefPage()).
+Zero it before first use. */
+typedef struct PF_PageRef {
+    void *frame;	/* buffer, or NULL if not known yet */
+    int gen;		/* generation of the buffer when referenced */
+} PF_PageRef;
+
 /* externs from the PF layer */
-extern int PFerrno;		/* error number of last error */
+extern _Thread_local int PFerrno;	/* error number of last error, per thread */
 extern void PF_Init();
 extern void PF_PrintError(char *);
 
@@ -43,6 +50,7 @@ int PF_CreateFile(char *fname /* name of file to create */);
 int PF_DestroyFile(char *fname /* file name to destroy */);
 int PF_OpenFile(char *fname		/* name of the file to open */);
 int PF_CloseFile(int fd /* file descriptor to close */);
+int PF_ReopenFile(int fd /* file descriptor to open again */);
 int PF_GetFirstPage(
     int fd,	/* file descriptor */
     int *pagenum,	/* page number of first page */
@@ -71,3 +79,18 @@ int PF_UnfixPage(int fd,	/* file descriptor */
                  int pagenum,	/* page number */
                  int dirty	/* true if file is dirty */
                 );
+int PF_GetNumPages(int fd, int *numpages);
+int PF_GetRefPage(int fd,	/* file descriptor */
+                  int pagenum,	/* page number to read */
+                  PF_PageRef *ref,	/* reference to the buffer, updated */
+                  char **pagebuf	/* pointer to pointer to page data */
+                 );
+int PF_UnfixRefPage(int fd,	/* file descriptor */
+                    int pagenum,	/* page number */
+                    PF_PageRef *ref,	/* reference set by PF_GetRefPage() */
+                    int dirty	/* true if page is dirty */
+                   );
+char *PF_RefExt(PF_PageRef *ref,	/* reference to the buffer of a fixed page */
+                int size	/* # of bytes wanted */
+               );
+int PF_FileStamp(int fd /* file descriptor */);
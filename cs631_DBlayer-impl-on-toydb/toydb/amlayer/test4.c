@@ -0,0 +1,181 @@
+/**********************************************************************
+test4.c: tests insertion of many entries with few keys. A key holds at
+most as many recIds as fit in a leaf page; past that, insertions of the
+key fail with AME_KEYFULL and leave the index as it was. Also tests
+< and <= scans bounded by the first key of a leaf.
+************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "am.h"
+#include "pf.h"
+#include "testam.h"
+
+#define MAXRECS	50000	/* max # of entries to insert */
+#define MAXKEYS	100	/* max # of keys */
+#define NUMBOUNDS 4000	/* # of keys bounding < and <= scans */
+#define FNAME_LENGTH 80	/* file name size */
+
+static int values[MAXRECS];	/* keys of the entries */
+static RecIdType recIds[MAXRECS];	/* their record ids */
+
+/* counts the entries of the index that a scan with op and value
+returns */
+static int
+countScan(int fd, int op, char *value)
+{
+    int sd;	/* scan descriptor */
+    int numrec;	/* # of records retrieved */
+
+    numrec = 0;
+    sd = AM_OpenIndexScan(fd,INT_TYPE,sizeof(int),op,value);
+    while (AM_FindNextEntry(sd) >= 0)
+        numrec++;
+    AM_CloseIndexScan(sd);
+    return(numrec);
+}
+
+/* counts the entries of the index with key value (all of them if value
+is NULL) */
+static int
+countEntries(int fd, char *value)
+{
+    return(countScan(fd,(value == NULL) ? ALL : EQUAL,value));
+}
+
+/* inserts numrecs entries over numkeys keys, in key order, with one
+AM_InsertEntries, or one AM_InsertEntry each if single is set - returns
+the error of the first insertion that failed, or AME_OK */
+static int
+insertEntries(int fd, int numrecs, int numkeys, int single)
+{
+    int i, error;
+
+    for (i = 0; i < numrecs; i++) {
+        values[i] = (int)((long long)i * numkeys / numrecs);
+        recIds[i] = IntToRecId(i);
+    }
+    if (!single)
+        return(AM_InsertEntries(fd,INT_TYPE,sizeof(int),(char *)values,
+                                recIds,numrecs));
+    for (i = 0; i < numrecs; i++) {
+        error = AM_InsertEntry(fd,INT_TYPE,sizeof(int),(char *)&values[i],
+                               recIds[i]);
+        if (error != AME_OK)
+            return(error);
+    }
+    return(AME_OK);
+}
+
+int
+main()
+{
+    int fd;	/* file descriptor for the index */
+    char fname[FNAME_LENGTH];	/* file name */
+    int single;	/* one entry per call, or all at once */
+    int key, error, numrec, perkey, failed;
+
+    /* init */
+    printf("initializing\n");
+    PF_Init();
+    sprintf(fname,"%s.0",RELNAME);
+    failed = 0;
+
+    for (single = 0; single <= 1; single++) {
+        printf("%s\n",single ? "one entry at a time" : "all entries at once");
+
+        /* 5000 entries over 3 keys: a key's recIds overflow its leaf */
+        AM_CreateIndex(RELNAME,0,INT_TYPE,sizeof(int));
+        fd = PF_OpenFile(fname);
+        error = insertEntries(fd,5000,3,single);
+        numrec = countEntries(fd,NULL);
+        key = 0;
+        perkey = countEntries(fd,(char *)&key);
+        printf("5000 entries over 3 keys: error %d, %d entries of key 0\n",
+               error,perkey);
+        if (error != AME_KEYFULL || numrec != perkey) {
+            printf("expected AME_KEYFULL, and no entries past it\n");
+            failed++;
+        }
+        /* other keys still go in */
+        key = 1;
+        error = AM_InsertEntry(fd,INT_TYPE,sizeof(int),(char *)&key,
+                               IntToRecId(0));
+        if (error != AME_OK || countEntries(fd,(char *)&key) != 1) {
+            printf("insertion after AME_KEYFULL failed: %d\n",error);
+            failed++;
+        }
+        PF_CloseFile(fd);
+        AM_DestroyIndex(RELNAME,0);
+
+        /* as many entries per key as a leaf holds: every key splits off
+        a leaf of its own */
+        AM_CreateIndex(RELNAME,0,INT_TYPE,sizeof(int));
+        fd = PF_OpenFile(fname);
+        error = insertEntries(fd,MAXKEYS * perkey,MAXKEYS,single);
+        numrec = countEntries(fd,NULL);
+        printf("%d entries over %d keys: error %d, %d entries\n",
+               MAXKEYS * perkey,MAXKEYS,error,numrec);
+        if (error != AME_OK || numrec != MAXKEYS * perkey) {
+            printf("expected all entries\n");
+            failed++;
+        }
+        for (key = 0; key < MAXKEYS; key++) {
+            if (countEntries(fd,(char *)&key) != perkey) {
+                printf("key %d does not have %d entries\n",key,perkey);
+                failed++;
+            }
+        }
+        /* each key starts a leaf, so every bound is the first key of
+        one: the range ends at the end of the leaf before */
+        for (key = 0; key <= MAXKEYS; key++) {
+            numrec = countScan(fd,LESS_THAN,(char *)&key);
+            if (numrec != key * perkey) {
+                printf("< %d: %d entries, expected %d\n",key,numrec,
+                       key * perkey);
+                failed++;
+            }
+            numrec = countScan(fd,LESS_THAN_EQUAL,(char *)&key);
+            if (numrec != ((key < MAXKEYS) ? key + 1 : key) * perkey) {
+                printf("<= %d: %d entries\n",key,numrec);
+                failed++;
+            }
+        }
+        PF_CloseFile(fd);
+        AM_DestroyIndex(RELNAME,0);
+    }
+
+    /* distinct even keys, one entry each, bounded by every key and every
+    value between two keys */
+    printf("< and <= scans over %d keys\n",NUMBOUNDS / 2);
+    AM_CreateIndex(RELNAME,0,INT_TYPE,sizeof(int));
+    fd = PF_OpenFile(fname);
+    for (key = 0; key < NUMBOUNDS / 2; key++) {
+        values[key] = 2 * key;
+        recIds[key] = IntToRecId(key);
+    }
+    error = AM_InsertEntries(fd,INT_TYPE,sizeof(int),(char *)values,recIds,
+                             NUMBOUNDS / 2);
+    if (error != AME_OK) {
+        printf("insertion failed: %d\n",error);
+        failed++;
+    }
+    for (key = -1; key <= NUMBOUNDS; key++) {
+        numrec = countScan(fd,LESS_THAN,(char *)&key);
+        perkey = (key < 0) ? 0 : (key + 1) / 2;
+        if (numrec != perkey) {
+            printf("< %d: %d entries, expected %d\n",key,numrec,perkey);
+            failed++;
+        }
+        numrec = countScan(fd,LESS_THAN_EQUAL,(char *)&key);
+        perkey = (key < 0) ? 0 : (key < NUMBOUNDS) ? key / 2 + 1 : NUMBOUNDS / 2;
+        if (numrec != perkey) {
+            printf("<= %d: %d entries, expected %d\n",key,numrec,perkey);
+            failed++;
+        }
+    }
+    PF_CloseFile(fd);
+    AM_DestroyIndex(RELNAME,0);
+
+    printf("test4 done: %s\n",failed ? "FAILED" : "OK");
+    return(failed != 0);
+}
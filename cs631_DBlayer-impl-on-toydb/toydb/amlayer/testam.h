@@ -5,10 +5,10 @@ integers for recid's. Otherwise, you should typedef
 RecIdType to the appropriate type, and also
 redefine RecIdToInt() and IntToRecId() */
 
-typedef int RecIdType;		/* type for recid */
+typedef long long RecIdType;	/* type for recid, as AM_RecId */
 
-#define RecIdToInt(recid)	(recid)	/* converts record id to int */
-#define IntToRecId(intval)	(intval) /* converts int to record id */
+#define RecIdToInt(recid)	((int)(recid))	/* converts record id to int */
+#define IntToRecId(intval)	((RecIdType)(intval)) /* converts int to record id */
 
 /*
  *  Attribute types
@@ -0,0 +1,270 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "batch.h"
+#include "codec.h"
+#include "record.h"
+#include "pax.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Allocates a batch of up to capacity rows (BATCH_DEFAULT_SIZE if capacity <= 0)
+ with one column vector per column of the schema.
+ Returns NULL if out of memory.
+ */
+RecordBatch *Batch_Create(Schema *schema, int capacity)
+{
+    if (capacity <= 0)
+    {
+        capacity = BATCH_DEFAULT_SIZE;
+    }
+    RecordBatch *batch = (RecordBatch *)calloc(1, sizeof(RecordBatch));
+    if (batch == NULL)
+    {
+        return NULL;
+    }
+    batch->schema = schema;
+    batch->capacity = capacity;
+    batch->rids = (RecId *)malloc(capacity * sizeof(RecId));
+    batch->columns = (ColumnVector *)calloc(schema->numColumns, sizeof(ColumnVector));
+    if (batch->rids == NULL || batch->columns == NULL)
+    {
+        Batch_Free(batch);
+        return NULL;
+    }
+
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        ColumnVector *col = &batch->columns[c];
+        bool allocated = false;
+        col->type = schema->columns[c]->type;
+        switch (col->type)
+        {
+        case INT:
+            col->ints = (int *)malloc(capacity * sizeof(int));
+            allocated = (col->ints != NULL);
+            break;
+        case LONG:
+            col->longs = (long long *)malloc(capacity * sizeof(long long));
+            allocated = (col->longs != NULL);
+            break;
+        case VARCHAR:
+            col->offsets = (int *)malloc((capacity + 1) * sizeof(int));
+            col->charsCapacity = capacity * 16; // Grown on demand
+            col->chars = (char *)malloc(col->charsCapacity);
+            allocated = (col->offsets != NULL && col->chars != NULL);
+            break;
+        }
+        if (!allocated)
+        {
+            Batch_Free(batch);
+            return NULL;
+        }
+    }
+    return batch;
+}
+
+void Batch_Free(RecordBatch *batch)
+{
+    if (batch == NULL)
+    {
+        return;
+    }
+    if (batch->columns != NULL)
+    {
+        for (int c = 0; c < batch->schema->numColumns; c++)
+        {
+            free(batch->columns[c].ints);
+            free(batch->columns[c].longs);
+            free(batch->columns[c].offsets);
+            free(batch->columns[c].chars);
+        }
+        free(batch->columns);
+    }
+    free(batch->rids);
+    free(batch);
+}
+
+/*
+ Appends the string bytes of the current row to a VARCHAR vector, growing it if needed
+ Returns 0, or PFE_NOMEM
+ */
+static int Batch_AppendChars(ColumnVector *col, int row, byte *str, int length)
+{
+    int start = col->offsets[row];
+    if (start + length > col->charsCapacity)
+    {
+        int newCapacity = 2 * (start + length);
+        char *chars = (char *)realloc(col->chars, newCapacity);
+        if (chars == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        col->chars = chars;
+        col->charsCapacity = newCapacity;
+    }
+    memcpy(col->chars + start, str, length);
+    col->offsets[row + 1] = start + length;
+    return 0;
+}
+
+/*
+ Decodes one encoded record of len bytes into row numRows of the batch
+ */
+static int Batch_AppendRecord(RecordBatch *batch, RecId rid, byte *record, int len)
+{
+    int row = batch->numRows;
+    int fieldLen, ret_val;
+
+    for (int c = 0; c < batch->schema->numColumns; c++)
+    {
+        ColumnVector *col = &batch->columns[c];
+        byte *field = Record_Field(batch->schema, record, len, c, &fieldLen);
+        if (field == NULL)
+        {
+            return PFE_INVALIDPAGE; // Not a record of this table
+        }
+        switch (col->type)
+        {
+        case VARCHAR:
+            ret_val = Batch_AppendChars(col, row, field, fieldLen);
+            if (ret_val < 0)
+            {
+                return ret_val;
+            }
+            break;
+        case INT:
+            col->ints[row] = DecodeInt(field);
+            break;
+        case LONG:
+            col->longs[row] = DecodeLong(field);
+            break;
+        }
+    }
+    batch->rids[row] = rid;
+    batch->numRows++;
+    return 0;
+}
+
+/*
+ Copies the next live rows of the scan's PAX page into the batch, column by
+ column: a run of INT or LONG values is one copy from its minipage. Columns
+ left out of the scan's projection are skipped (VARCHARs read as empty).
+ Advances the scan past the rows copied.
+ Returns 0, or PFE_NOMEM
+ */
+static int Batch_AppendPax(RecordBatch *batch, TableScan *scan)
+{
+    PaxHeader *header = (PaxHeader *)scan->pagebuf;
+    byte *flags = PAX_ROW_FLAGS(header);
+    int rows[batch->capacity];
+    int n = 0, ret_val;
+    bool contiguous = true;
+
+    // Live rows that fit in the batch
+    for (; scan->slot < header->numRows && batch->numRows + n < batch->capacity; scan->slot++)
+    {
+        if (flags[scan->slot] != PAX_ROW_LIVE)
+        {
+            contiguous = false;
+            continue;
+        }
+        rows[n++] = scan->slot;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    contiguous = contiguous && (rows[n - 1] - rows[0] == n - 1);
+
+    for (int c = 0; c < batch->schema->numColumns; c++)
+    {
+        ColumnVector *col = &batch->columns[c];
+        byte *minipage = scan->pagebuf + header->minipages[c];
+        bool projected = (scan->projection == 0 || (scan->projection & (1ULL << c)));
+        switch (col->type)
+        {
+        case INT:
+            if (!projected)
+                break;
+            if (contiguous)
+                memcpy(col->ints + batch->numRows, minipage + rows[0] * 4, n * 4);
+            else
+                for (int i = 0; i < n; i++)
+                    col->ints[batch->numRows + i] = DecodeInt(minipage + rows[i] * 4);
+            break;
+        case LONG:
+            if (!projected)
+                break;
+            if (contiguous)
+                memcpy(col->longs + batch->numRows, minipage + rows[0] * 8, n * 8);
+            else
+                for (int i = 0; i < n; i++)
+                    col->longs[batch->numRows + i] = DecodeLong(minipage + rows[i] * 8);
+            break;
+        case VARCHAR:
+            for (int i = 0; i < n; i++)
+            {
+                byte *entry = minipage + rows[i] * PAX_VAR_ENTRY_SIZE;
+                int length = projected ? DecodeShort(entry + sizeof(short)) : 0;
+                ret_val = Batch_AppendChars(col, batch->numRows + i, scan->pagebuf + DecodeShort(entry), length);
+                if (ret_val < 0)
+                    return ret_val;
+            }
+            break;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        batch->rids[batch->numRows + i] = BUILD_RECORD_ID(scan->pagenum, rows[i]);
+    }
+    batch->numRows += n;
+    return 0;
+}
+
+/*
+ Fills the batch with the next (up to capacity) records of the scan, decoded into
+ the column vectors. The values are copies, so they stay valid after the scan moves on.
+ Returns the number of rows, 0 at the end of the scan, or a negative error code
+ */
+int Table_NextColumnBatch(TableScan *scan, RecordBatch *batch)
+{
+    RecId rid;
+    byte *record;
+    int len, ret_val;
+
+    batch->numRows = 0;
+    for (int c = 0; c < batch->schema->numColumns; c++)
+    {
+        if (batch->columns[c].type == VARCHAR)
+            batch->columns[c].offsets[0] = 0;
+    }
+
+    while (batch->numRows < batch->capacity)
+    {
+        // Unfiltered rows of a PAX page are copied straight from its minipages
+        if (scan->filter == NULL && scan->pagebuf != NULL && PAX_IS_PAGE(scan->pagebuf))
+        {
+            ret_val = Batch_AppendPax(batch, scan);
+            if (ret_val < 0)
+                return ret_val;
+            if (batch->numRows == batch->capacity)
+                break;
+        }
+        ret_val = Table_Next(scan, &rid, &record, &len);
+        if (ret_val == PFE_EOF)
+            break;
+        if (ret_val < 0)
+            return ret_val;
+        ret_val = Batch_AppendRecord(batch, rid, record, len);
+        if (ret_val < 0)
+            return ret_val;
+    }
+    return batch->numRows;
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+#define BATCH_DEFAULT_SIZE 1024 // Rows per batch unless asked otherwise
+
+// Decoded values of one column for the rows of a batch
+typedef struct {
+    int type;           // VARCHAR, INT or LONG, from the schema
+    int *ints;          // INT: value of row i
+    long long *longs;   // LONG: value of row i
+    int *offsets;       // VARCHAR: row i is chars[offsets[i] .. offsets[i+1]), numRows+1 entries
+    char *chars;        // VARCHAR: string bytes of all rows, not NUL terminated
+    int charsCapacity;  // Allocated size of chars
+} ColumnVector;
+
+// Up to capacity rows of a table, decoded column by column
+typedef struct {
+    Schema *schema;
+    int capacity;            // Maximum number of rows
+    int numRows;             // Rows currently in the batch
+    RecId *rids;             // Record id of row i
+    ColumnVector *columns;   // One vector per schema column
+} RecordBatch;
+
+// String view of row i of a VARCHAR column vector
+#define BATCH_STR(col, i)    ((col)->chars + (col)->offsets[i])
+#define BATCH_STRLEN(col, i) ((col)->offsets[(i) + 1] - (col)->offsets[i])
+
+RecordBatch *
+Batch_Create(Schema *schema, int capacity);
+
+void
+Batch_Free(RecordBatch *batch);
+
+int
+Table_NextColumnBatch(TableScan *scan, RecordBatch *batch);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
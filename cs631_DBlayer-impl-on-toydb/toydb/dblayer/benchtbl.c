@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "codec.h"
+#include "tbl.h"
+#include "db.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Large-table benchmark: loads a table past the 65,536 pages that 32 bit record
+ ids could address, indexes every record, then times a full scan, parallel
+ scans with 1, 2, 4... workers up to the number of cores, random Table_Get
+ lookups and index lookups (plain, then swizzled), checking every record read.
+
+ usage: benchtbl [numPages [recordSize [numLookups]]]
+ */
+
+#define BENCH_DB "bench.db"
+#define checkerr(err)        \
+    {                        \
+        if (err < 0)         \
+        {                    \
+            printError(err); \
+            exit(1);         \
+        }                    \
+    }
+
+/*
+ Reports error err with the message of the layer it came from, as loaddb does
+ */
+static void printError(int err)
+{
+    if (err == AM_Errno)
+        AM_PrintError("benchtbl: ");
+    else if (err == PFerrno)
+        PF_PrintError("benchtbl");
+    else
+        fprintf(stderr, "benchtbl: error %d\n", err);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Record i: its sequence number, then filler derived from it
+static void makeRecord(byte *record, int recordSize, int i)
+{
+    EncodeInt(i, record);
+    memset(record + 4, 'a' + i % 26, recordSize - 4);
+}
+
+static int checkRecord(byte *record, int len, int recordSize, int i)
+{
+    return len == recordSize && DecodeInt(record) == i && record[recordSize - 1] == 'a' + i % 26;
+}
+
+typedef struct {
+    int recordSize;
+    long long rows;
+    long long bad;
+} ScanState;
+
+static void countRow(void *callbackObj, RecId rid, byte *row, int len)
+{
+    ScanState *state = (ScanState *)callbackObj;
+    if (!checkRecord(row, len, state->recordSize, DecodeInt(row)))
+        state->bad++;
+    state->rows++;
+}
+
+int main(int argc, char **argv)
+{
+    int numPages = (argc > 1) ? atoi(argv[1]) : 70000;
+    int recordSize = (argc > 2) ? atoi(argv[2]) : 1000;
+    int numLookups = (argc > 3) ? atoi(argv[3]) : 100000;
+    Db *db;
+    Table *tbl;
+    int indexFD, ret_val, numRecords = 0;
+    byte *record = malloc(recordSize);
+    RecId rid, *rids;
+    long long bad = 0;
+    double start;
+
+    if (recordSize < 5 || recordSize > INPAGE_MAXPOSS_RECORD_SIZE)
+    {
+        fprintf(stderr, "record size must be between 5 and %d\n", INPAGE_MAXPOSS_RECORD_SIZE);
+        exit(1);
+    }
+    // Records per page, from the page layout
+    int perPage = (PF_PAGE_SIZE - PAGEHEADER_FIXED_ATTR_COUNT * PAGEHEADER_ATTR_SIZE) / (recordSize + PAGEHEADER_SLOT_SIZE);
+    long long capacity = (long long)numPages * perPage;
+    rids = malloc(capacity * sizeof(RecId));
+
+    ret_val = Db_Open(&db);
+    checkerr(ret_val);
+    ret_val = Db_OpenTable(db, BENCH_DB, NULL, true, &tbl);
+    checkerr(ret_val);
+    ret_val = Db_CreateIndex(db, BENCH_DB, 0, 'i', 4, true, &indexFD);
+    checkerr(ret_val);
+
+    // Load
+    start = now();
+    Table_SetBulkAppend(tbl, true);
+    while (numRecords < capacity)
+    {
+        makeRecord(record, recordSize, numRecords);
+        ret_val = Table_Insert(tbl, record, recordSize, &rids[numRecords]);
+        checkerr(ret_val);
+        ret_val = AM_InsertEntry(indexFD, 'i', 4, (char *)&numRecords, rids[numRecords]);
+        checkerr(ret_val);
+        numRecords++;
+    }
+    Table_SetBulkAppend(tbl, false);
+    printf("load:   %d records, last page %d, %.2fs\n", numRecords,
+           RECORD_ID_PAGE(rids[numRecords - 1]), now() - start);
+
+    // Full scan
+    ScanState state = {recordSize, 0, 0};
+    start = now();
+    Table_Scan(tbl, &state, countRow);
+    printf("scan:   %lld records, %lld bad, %.2fs\n", state.rows, state.bad, now() - start);
+    bad += state.bad + (state.rows != numRecords);
+
+    // Parallel scans, one ScanState per worker merged afterwards
+    int numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int numWorkers = 1; numWorkers <= numCores; numWorkers *= 2)
+    {
+        ScanState states[numWorkers];
+        void *objs[numWorkers];
+        for (int w = 0; w < numWorkers; w++)
+        {
+            states[w] = (ScanState){recordSize, 0, 0};
+            objs[w] = &states[w];
+        }
+        start = now();
+        ret_val = Table_ParallelScan(tbl, NULL, numWorkers, objs, countRow);
+        checkerr(ret_val);
+        ScanState total = {recordSize, 0, 0};
+        for (int w = 0; w < numWorkers; w++)
+        {
+            total.rows += states[w].rows;
+            total.bad += states[w].bad;
+        }
+        printf("pscan:  %d workers, %lld records, %lld bad, %.2fs\n", numWorkers,
+               total.rows, total.bad, now() - start);
+        bad += total.bad + (total.rows != numRecords);
+    }
+
+    // Random lookups by record id, half of them past the 16 bit page limit if the table reaches it
+    srand(42);
+    start = now();
+    int high = 0;
+    for (int n = 0; n < numLookups; n++)
+    {
+        int i = rand() % numRecords;
+        if (n % 2 == 0 && RECORD_ID_PAGE(rids[numRecords - 1]) > 0xFFFF)
+        {
+            while (RECORD_ID_PAGE(rids[i]) <= 0xFFFF)
+                i = rand() % numRecords;
+            high++;
+        }
+        int len = Table_Get(tbl, rids[i], record, recordSize);
+        bad += !checkRecord(record, len, recordSize, i);
+    }
+    printf("get:    %d lookups (%d past page 65535), %.2fs\n", numLookups, high, now() - start);
+
+    // Index lookups: key -> 64 bit record id -> record, without and with swizzled
+    // search (see AM_SetSwizzle), over the same keys
+    for (int swizzle = 0; swizzle <= 1; swizzle++)
+    {
+        AM_SetSwizzle(swizzle);
+        srand(1);
+        start = now();
+        for (int n = 0; n < numLookups / 10; n++)
+        {
+            int i = (n % 2 == 0) ? numRecords - 1 - rand() % (numRecords / 10 + 1) : rand() % numRecords;
+            int scanDesc = AM_OpenIndexScan(indexFD, 'i', 4, EQUAL, (char *)&i);
+            bad += (AM_FindNextRecId(scanDesc, &rid) != AME_OK || rid != rids[i]);
+            AM_CloseIndexScan(scanDesc);
+            int len = Table_Get(tbl, rid, record, recordSize);
+            bad += !checkRecord(record, len, recordSize, i);
+        }
+        printf("index:  %d lookups, %.2fs%s\n", numLookups / 10, now() - start, swizzle ? " (swizzled)" : "");
+    }
+    AM_SetSwizzle(0);
+
+    Db_Close(db);
+    free(rids);
+    free(record);
+    printf("%s\n", bad ? "FAILED" : "OK");
+    return bad != 0;
+}
+
+// ---------------------------------------------------------------------------------------
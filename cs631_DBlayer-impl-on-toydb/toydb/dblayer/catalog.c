@@ -0,0 +1,344 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tbl.h"
+#include "catalog.h"
+#include "idx.h"
+#include "stats.h"
+#include "record.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Start of page 0 of "<table>.cat"
+typedef struct {
+    int magic;
+    int size;         // Bytes of the catalog, this header included
+    int layout;
+    int keyColumn;
+    int recordFormat;
+    int numColumns;   // CatalogColumn entries after the header
+    int numIndexes;
+    TableIndex indexes[TABLE_MAX_INDEXES]; // fd not used
+    TableStats stats;
+    bool hasColumnStats; // ColumnStats entries after the columns
+} CatalogHeader;
+
+typedef struct {
+    char name[CAT_NAME_SIZE];
+    int type;
+    bool dictionary;
+} CatalogColumn;
+
+#define CAT_NAME_LEN(fname) (strlen(fname) + sizeof(CAT_TMP_SUFFIX))
+#define CAT_SIZE(numColumns, hasColumnStats) ((int)(sizeof(CatalogHeader) + (numColumns) * \
+        (sizeof(CatalogColumn) + ((hasColumnStats) ? sizeof(ColumnStats) : 0))))
+
+/*
+ Reads the catalog of table file fname. Its schema is allocated for the caller.
+ Returns PFE_OK, CATE_INVALID, or a PF error code (PFE_UNIX if there is no catalog)
+ */
+int Catalog_Read(char *fname, Catalog *cat)
+{
+    char catName[CAT_NAME_LEN(fname)];
+    CatalogHeader header;
+    char *pagebuf;
+
+    sprintf(catName, "%s%s", fname, CAT_SUFFIX);
+    int fd = PF_OpenFile(catName);
+    if (fd < 0)
+    {
+        return fd;
+    }
+    int ret_val = PF_GetThisPage(fd, 0, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        PF_CloseFile(fd);
+        return ret_val;
+    }
+    memcpy(&header, pagebuf, sizeof(CatalogHeader));
+    PF_UnfixPage(fd, 0, FALSE);
+    char *buf = NULL;
+    if (header.magic != CAT_MAGIC || header.numColumns < 0 || header.numIndexes < 0
+            || header.numIndexes > TABLE_MAX_INDEXES
+            || header.size != CAT_SIZE(header.numColumns, header.hasColumnStats))
+        ret_val = CATE_INVALID;
+    else if ((buf = (char *)malloc(header.size)) == NULL)
+        ret_val = PFE_NOMEM;
+    // The catalog's pages one after the other
+    for (int pagenum = 0, off = 0; ret_val == PFE_OK && off < header.size; pagenum++, off += PF_PAGE_SIZE)
+    {
+        ret_val = PF_GetThisPage(fd, pagenum, &pagebuf);
+        if (ret_val == PFE_OK)
+        {
+            memcpy(buf + off, pagebuf, (header.size - off < PF_PAGE_SIZE) ? header.size - off : PF_PAGE_SIZE);
+            ret_val = PF_UnfixPage(fd, pagenum, FALSE);
+        }
+    }
+    PF_CloseFile(fd);
+    if (ret_val != PFE_OK)
+    {
+        free(buf);
+        return ret_val;
+    }
+
+    CatalogColumn *columns = (CatalogColumn *)(buf + sizeof(CatalogHeader));
+    Schema *schema = (Schema *)malloc(sizeof(Schema));
+    if (schema == NULL)
+    {
+        free(buf);
+        return PFE_NOMEM;
+    }
+    schema->numColumns = 0; // Columns built so far, for Catalog_FreeSchema
+    schema->columns = (ColumnDesc **)malloc(((header.numColumns > 0) ? header.numColumns : 1) * sizeof(ColumnDesc *));
+    for (int i = 0; schema->columns != NULL && i < header.numColumns; i++)
+    {
+        ColumnDesc *colDesc = (ColumnDesc *)malloc(sizeof(ColumnDesc));
+        char *name = strndup(columns[i].name, CAT_NAME_SIZE - 1);
+        if (colDesc == NULL || name == NULL)
+        {
+            free(colDesc);
+            free(name);
+            ret_val = PFE_NOMEM;
+            break;
+        }
+        colDesc->name = name;
+        colDesc->type = columns[i].type;
+        colDesc->dictionary = columns[i].dictionary;
+        schema->columns[schema->numColumns++] = colDesc;
+    }
+    cat->columnStats = NULL;
+    if (schema->columns == NULL)
+        ret_val = PFE_NOMEM;
+    else if (ret_val == PFE_OK && header.hasColumnStats)
+    {
+        cat->columnStats = (ColumnStats *)malloc(header.numColumns * sizeof(ColumnStats));
+        if (cat->columnStats == NULL)
+            ret_val = PFE_NOMEM;
+        else
+            memcpy(cat->columnStats, columns + header.numColumns, header.numColumns * sizeof(ColumnStats));
+    }
+    free(buf);
+    if (ret_val != PFE_OK)
+    {
+        if (schema->columns == NULL)
+            free(schema);
+        else
+            Catalog_FreeSchema(schema);
+        return ret_val;
+    }
+    Record_SetFormat(schema, header.recordFormat);
+
+    cat->schema = schema;
+    cat->layout = header.layout;
+    cat->keyColumn = header.keyColumn;
+    cat->numIndexes = header.numIndexes;
+    memcpy(cat->indexes, header.indexes, sizeof(header.indexes));
+    cat->stats = header.stats;
+    return PFE_OK;
+}
+
+/*
+ Flushes file fname to disk
+ */
+static int Catalog_SyncFile(char *fname)
+{
+    int unixfd = open(fname, O_RDONLY);
+    if (unixfd < 0)
+    {
+        return PFE_UNIX;
+    }
+    int ret_val = (fsync(unixfd) == 0) ? PFE_OK : PFE_UNIX;
+    close(unixfd);
+    return ret_val;
+}
+
+/*
+ Records the table's schema, layout, index definitions and statistics in its
+ catalog, replacing what was there. A table without a schema has none.
+ Returns PFE_OK or a PF error code
+ */
+int Catalog_Write(Table *tbl)
+{
+    char catName[CAT_NAME_LEN(tbl->fname)];
+    char tmpName[CAT_NAME_LEN(tbl->fname)];
+    Schema *schema = tbl->schema;
+    char *pagebuf;
+    int pagenum, ret_val = PFE_OK;
+
+    if (schema == NULL)
+    {
+        return PFE_OK;
+    }
+    int size = CAT_SIZE(schema->numColumns, tbl->columnStats != NULL);
+    char *buf = (char *)calloc(1, size);
+    if (buf == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    CatalogHeader *header = (CatalogHeader *)buf;
+    header->magic = CAT_MAGIC;
+    header->size = size;
+    header->layout = tbl->layout;
+    header->keyColumn = tbl->keyColumn;
+    header->recordFormat = schema->recordFormat;
+    header->numColumns = schema->numColumns;
+    header->numIndexes = tbl->numIndexes;
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        header->indexes[i] = tbl->indexes[i];
+        header->indexes[i].fd = -1;
+    }
+    header->stats = tbl->stats;
+    header->hasColumnStats = (tbl->columnStats != NULL);
+    CatalogColumn *columns = (CatalogColumn *)(buf + sizeof(CatalogHeader));
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        strncpy(columns[i].name, schema->columns[i]->name, CAT_NAME_SIZE - 1);
+        columns[i].type = schema->columns[i]->type;
+        columns[i].dictionary = schema->columns[i]->dictionary;
+    }
+    if (tbl->columnStats != NULL)
+    {
+        memcpy(columns + schema->numColumns, tbl->columnStats, schema->numColumns * sizeof(ColumnStats));
+    }
+
+    // Written afresh to a temporary file, so that a shorter catalog leaves no pages
+    // behind, then renamed over the old one: a crash leaves one or the other whole
+    sprintf(catName, "%s%s", tbl->fname, CAT_SUFFIX);
+    sprintf(tmpName, "%s%s", tbl->fname, CAT_TMP_SUFFIX);
+    PF_DestroyFile(tmpName);
+    ret_val = PF_CreateFile(tmpName);
+    int fd = (ret_val == PFE_OK) ? PF_OpenFile(tmpName) : ret_val;
+    if (fd < 0)
+    {
+        free(buf);
+        return fd;
+    }
+    for (int off = 0; ret_val == PFE_OK && off < size; off += PF_PAGE_SIZE)
+    {
+        ret_val = PF_AllocPage(fd, &pagenum, &pagebuf);
+        if (ret_val == PFE_OK)
+        {
+            memset(pagebuf, 0, PF_PAGE_SIZE);
+            memcpy(pagebuf, buf + off, (size - off < PF_PAGE_SIZE) ? size - off : PF_PAGE_SIZE);
+            ret_val = PF_UnfixPage(fd, pagenum, TRUE);
+        }
+    }
+    int close_val = PF_CloseFile(fd);
+    free(buf);
+    if (ret_val == PFE_OK)
+        ret_val = close_val;
+    if (ret_val == PFE_OK)
+        ret_val = Catalog_SyncFile(tmpName);
+    if (ret_val == PFE_OK && rename(tmpName, catName) != 0)
+        ret_val = PFE_UNIX;
+    if (ret_val != PFE_OK)
+    {
+        PF_DestroyFile(tmpName);
+    }
+    return ret_val;
+}
+
+/*
+ Puts the catalog read for a table being opened to use, cat being NULL if there
+ was none. Opened with the catalog's schema, or an equal one, the table gets its
+ recorded indexes and statistics back. Opened with another schema, it gets the
+ recorded indexes that still fit its columns rebuilt, and no statistics, and the
+ catalog is rewritten; so is a missing one. Frees the catalog's schema unless the
+ table took it.
+ Returns 0, or an AM or PF error code
+ */
+int Catalog_Attach(Table *tbl, Catalog *cat)
+{
+    tbl->stats.numRows = -1;
+    tbl->stats.numPages = 0;
+    tbl->columnStats = NULL;
+    if (cat == NULL)
+    {
+        return Catalog_Write(tbl); // New table, or one from before catalogs
+    }
+    bool same = (tbl->schema == cat->schema) || Catalog_SameSchema(tbl->schema, cat->schema);
+    bool changed = !same;
+    if (tbl->schema != cat->schema)
+    {
+        Catalog_FreeSchema(cat->schema);
+    }
+    if (same)
+    {
+        tbl->stats = cat->stats;
+        tbl->columnStats = cat->columnStats;
+    }
+    else
+    {
+        free(cat->columnStats);
+    }
+    int ret_val = 0;
+    for (int i = 0; i < cat->numIndexes && ret_val == 0; i++)
+    {
+        TableIndex *index = &cat->indexes[i];
+        ret_val = Index_Open(tbl, index->indexNo, index->column, index->attrType, index->attrLength, !same, NULL);
+        if (ret_val == TBLE_INDEX) // Its column is gone
+        {
+            changed = true;
+            ret_val = 0;
+        }
+    }
+    if (ret_val == 0 && changed)
+    {
+        ret_val = Catalog_Write(tbl);
+    }
+    return ret_val;
+}
+
+/*
+ Destroys the catalog of table file fname, if it has one, and any temporary one
+ */
+void Catalog_Destroy(char *fname)
+{
+    char catName[CAT_NAME_LEN(fname)];
+
+    sprintf(catName, "%s%s", fname, CAT_SUFFIX);
+    PF_DestroyFile(catName);
+    sprintf(catName, "%s%s", fname, CAT_TMP_SUFFIX);
+    PF_DestroyFile(catName);
+}
+
+/*
+ Whether two schemas have the same columns, as the catalog records them, and record format
+ */
+bool Catalog_SameSchema(Schema *a, Schema *b)
+{
+    if (a == NULL || b == NULL || a->numColumns != b->numColumns || a->recordFormat != b->recordFormat)
+    {
+        return false;
+    }
+    for (int i = 0; i < a->numColumns; i++)
+    {
+        ColumnDesc *x = a->columns[i], *y = b->columns[i];
+        if (x->type != y->type || x->dictionary != y->dictionary
+                || strncmp(x->name, y->name, CAT_NAME_SIZE - 1) != 0)
+            return false;
+    }
+    return true;
+}
+
+void Catalog_FreeSchema(Schema *schema)
+{
+    if (schema == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        free(schema->columns[i]->name);
+        free(schema->columns[i]);
+    }
+    free(schema->columns);
+    free(schema);
+}
+
+// ---------------------------------------------------------------------------------------
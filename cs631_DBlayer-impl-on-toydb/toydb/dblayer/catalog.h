@@ -0,0 +1,60 @@
+#ifndef _CATALOG_H_
+#define _CATALOG_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// System catalog: a paged file "<table>.cat" describing the table, so that it can
+// be opened without its schema. It records the columns (name, type, dictionary
+// flag), the record format, the layout and key column, the definitions of the
+// table's own indexes (see idx.h) and the statistics last collected on it (see stats.h).
+//
+// The catalog is read whole when the table is opened, in one pass over its pages:
+// Table_Open with a NULL schema takes the catalog's, and the recorded indexes are
+// opened again. It is rewritten when the table is created, opened with another
+// schema, given an index or new statistics; it is not kept open in between.
+// Catalog_Write writes "<table>.cat.tmp" and renames it over the catalog, so a
+// crash leaves either the old catalog or the new one.
+//
+// Layout: [CatalogHeader][CatalogColumn per column][ColumnStats per column, once
+// the table is analyzed], over as many pages as it takes.
+
+#define CAT_SUFFIX ".cat"
+#define CAT_TMP_SUFFIX ".cat.tmp"
+#define CAT_MAGIC 0x54414343 // "CCAT"
+#define CAT_NAME_SIZE 32     // Column names are cut to CAT_NAME_SIZE - 1 bytes
+
+#define CATE_INVALID (-45) // No catalog, or one that is not valid
+
+typedef struct {
+    Schema *schema;   // Allocated by Catalog_Read, see Catalog_FreeSchema
+    int layout;       // TABLE_LAYOUT_ROW, TABLE_LAYOUT_PAX or TABLE_LAYOUT_IOT
+    int keyColumn;    // TABLE_LAYOUT_IOT: key column
+    int numIndexes;
+    TableIndex indexes[TABLE_MAX_INDEXES]; // Definitions, fd unused
+    TableStats stats;
+    struct ColumnStats *columnStats; // Allocated by Catalog_Read, NULL if the table was not analyzed
+} Catalog;
+
+int
+Catalog_Read(char *fname, Catalog *cat);
+
+int
+Catalog_Write(Table *tbl);
+
+int
+Catalog_Attach(Table *tbl, Catalog *cat);
+
+void
+Catalog_Destroy(char *fname);
+
+bool
+Catalog_SameSchema(Schema *a, Schema *b);
+
+void
+Catalog_FreeSchema(Schema *schema);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,596 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include "tbl.h"
+#include "cluster.h"
+#include "fsm.h"
+#include "ovf.h"
+#include "zm.h"
+#include "idx.h"
+#include "catalog.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// A table's file and its side files, which move together
+static char *clusterSuffixes[] = {"", FSM_SUFFIX, OVF_SUFFIX, ZM_SUFFIX};
+#define CLUSTER_NUM_FILES ((int)(sizeof(clusterSuffixes) / sizeof(clusterSuffixes[0])))
+
+/*
+ Renames the index files "<from>.indexNo" (see idx.h) of table from over those of
+ table to, or destroys them if to is NULL
+ */
+static int Cluster_MoveIndexes(char *from, char *to)
+{
+    char *slash = strrchr(from, '/');
+    char *base = (slash != NULL) ? slash + 1 : from;
+    char dirName[strlen(from) + 2];
+    int baseLen = strlen(base), ret_val = PFE_OK;
+    struct dirent *entry;
+
+    if (slash != NULL)
+    {
+        memcpy(dirName, from, slash - from + 1);
+        dirName[slash - from + 1] = '\0';
+    }
+    else
+    {
+        strcpy(dirName, ".");
+    }
+    DIR *dir = opendir(dirName);
+    if (dir == NULL)
+    {
+        return PFE_UNIX;
+    }
+    while (ret_val == PFE_OK && (entry = readdir(dir)) != NULL)
+    {
+        char *suffix = entry->d_name + baseLen, *end;
+        if (strncmp(entry->d_name, base, baseLen) != 0 || suffix[0] != '.')
+            continue;
+        strtol(suffix + 1, &end, 10);
+        if (end == suffix + 1 || *end != '\0')
+            continue; // Not an index file, like the commit marker
+        char fromName[strlen(from) + strlen(suffix) + 1];
+        char toName[(to != NULL ? strlen(to) : 0) + strlen(suffix) + 1];
+        sprintf(fromName, "%s%s", from, suffix);
+        if (to == NULL)
+        {
+            PF_DestroyFile(fromName);
+            continue;
+        }
+        sprintf(toName, "%s%s", to, suffix);
+        if (rename(fromName, toName) != 0 && errno != ENOENT)
+        {
+            ret_val = PFE_UNIX;
+        }
+    }
+    closedir(dir);
+    return ret_val;
+}
+
+/*
+ Renames the files of table from, its index files first, over those of table to, or
+ destroys them if to is NULL. Files of from already moved are passed over
+ */
+static int Cluster_MoveFiles(char *from, char *to)
+{
+    char fromName[strlen(from) + 8];
+    char toName[(to != NULL ? strlen(to) : 0) + 8];
+
+    if (Cluster_MoveIndexes(from, to) != PFE_OK)
+    {
+        return PFE_UNIX;
+    }
+    for (int i = 0; i < CLUSTER_NUM_FILES; i++)
+    {
+        sprintf(fromName, "%s%s", from, clusterSuffixes[i]);
+        if (to == NULL)
+        {
+            PF_DestroyFile(fromName);
+            continue;
+        }
+        sprintf(toName, "%s%s", to, clusterSuffixes[i]);
+        if (rename(fromName, toName) != 0 && errno != ENOENT)
+        {
+            return PFE_UNIX;
+        }
+    }
+    return PFE_OK;
+}
+
+/*
+ Flushes a file to disk, and creates it empty first if create is set
+ */
+static int Cluster_SyncFile(char *fname, bool create)
+{
+    int unixfd = open(fname, create ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+    if (unixfd < 0)
+    {
+        return PFE_UNIX;
+    }
+    int ret_val = (fsync(unixfd) == 0) ? PFE_OK : PFE_UNIX;
+    close(unixfd);
+    return ret_val;
+}
+
+/*
+ Commits the swap of the table's files for the new ones of tmpName, with the new
+ files of its n indexes: syncs the new files, then creates the commit marker
+ */
+static int Cluster_Commit(char *fname, char *tmpName, ClusterIndex *indexes, int n)
+{
+    char name[strlen(fname) + sizeof(CLUSTER_COMMIT_SUFFIX)];
+    char tmpFile[strlen(tmpName) + 16];
+
+    for (int i = 0; i < CLUSTER_NUM_FILES; i++)
+    {
+        sprintf(tmpFile, "%s%s", tmpName, clusterSuffixes[i]);
+        if (Cluster_SyncFile(tmpFile, false) != PFE_OK)
+        {
+            return PFE_UNIX;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        sprintf(tmpFile, "%s.%d", tmpName, indexes[i].indexNo);
+        if (Cluster_SyncFile(tmpFile, false) != PFE_OK)
+        {
+            return PFE_UNIX;
+        }
+    }
+    sprintf(name, "%s%s", fname, CLUSTER_COMMIT_SUFFIX);
+    return Cluster_SyncFile(name, true);
+}
+
+/*
+ Locks the clustering of table dbname against other processes, waiting for the lock
+ if wait is set. Returns the descriptor of the locked file, to close to unlock, or -1
+ if it is locked already (errno EWOULDBLOCK) or cannot be locked
+ */
+static int Cluster_Lock(char *dbname, bool wait)
+{
+    char lockName[strlen(dbname) + sizeof(CLUSTER_LOCK_SUFFIX)];
+
+    sprintf(lockName, "%s%s", dbname, CLUSTER_LOCK_SUFFIX);
+    int lockfd = open(lockName, O_RDWR | O_CREAT, 0644);
+    if (lockfd >= 0 && flock(lockfd, wait ? LOCK_EX : (LOCK_EX | LOCK_NB)) != 0)
+    {
+        int err = errno;
+        close(lockfd);
+        errno = err;
+        return -1;
+    }
+    return lockfd;
+}
+
+/*
+ Moves the new files of table dbname over its own if the swap was committed, else
+ destroys those left. The caller holds the clustering lock
+ */
+static int Cluster_Finish(char *dbname)
+{
+    char tmpName[strlen(dbname) + sizeof(CLUSTER_SUFFIX)];
+    char commitName[strlen(dbname) + sizeof(CLUSTER_COMMIT_SUFFIX)];
+
+    sprintf(tmpName, "%s%s", dbname, CLUSTER_SUFFIX);
+    sprintf(commitName, "%s%s", dbname, CLUSTER_COMMIT_SUFFIX);
+    if (access(commitName, F_OK) != 0)
+    {
+        if (access(tmpName, F_OK) == 0)
+            Cluster_MoveFiles(tmpName, NULL); // Not committed
+        return PFE_OK;
+    }
+    int ret_val = Cluster_MoveFiles(tmpName, dbname);
+    if (ret_val == PFE_OK && unlink(commitName) != 0)
+    {
+        ret_val = PFE_UNIX;
+    }
+    return ret_val;
+}
+
+/*
+ Finishes a Table_Cluster of table dbname that stopped partway: moves the new files
+ over the table's if the swap was committed, else destroys those left. Files of a
+ Table_Cluster still running, in this process or another, are left to it. Opening a
+ table calls it first.
+ Returns PFE_OK, or PFE_UNIX if the files could not be moved
+ */
+int Cluster_Recover(char *dbname)
+{
+    char tmpName[strlen(dbname) + sizeof(CLUSTER_SUFFIX)];
+    char commitName[strlen(dbname) + sizeof(CLUSTER_COMMIT_SUFFIX)];
+
+    sprintf(tmpName, "%s%s", dbname, CLUSTER_SUFFIX);
+    sprintf(commitName, "%s%s", dbname, CLUSTER_COMMIT_SUFFIX);
+    if (access(commitName, F_OK) != 0 && access(tmpName, F_OK) != 0)
+    {
+        return PFE_OK; // Nothing left, the usual case
+    }
+    int lockfd = Cluster_Lock(dbname, false);
+    if (lockfd < 0)
+    {
+        return (errno == EWOULDBLOCK) ? PFE_OK : PFE_UNIX;
+    }
+    int ret_val = Cluster_Finish(dbname);
+    close(lockfd);
+    return ret_val;
+}
+
+static int Cluster_CompareMoves(const void *a, const void *b)
+{
+    RecId x = ((ClusterMove *)a)->oldRid, y = ((ClusterMove *)b)->oldRid;
+    return (x > y) - (x < y);
+}
+
+/*
+ Returns the move of oldRid among the first n moves of map, sorted, or NULL
+ */
+static ClusterMove *Cluster_Find(ClusterMap *map, int n, RecId oldRid)
+{
+    ClusterMove key = {oldRid, 0};
+    return (ClusterMove *)bsearch(&key, map->moves, n, sizeof(ClusterMove), Cluster_CompareMoves);
+}
+
+/*
+ Appends a row of the table being clustered to the new table, and records its move
+ */
+static int Cluster_Append(Table *out, ClusterMap *map, int *capacity, RecId oldRid, byte *record, int len)
+{
+    RecId newRid;
+    int ret_val = Table_Insert(out, record, len, &newRid);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    if (map->numMoves == *capacity)
+    {
+        int grown = (*capacity == 0) ? 1024 : 2 * *capacity;
+        ClusterMove *moves = (ClusterMove *)realloc(map->moves, grown * sizeof(ClusterMove));
+        if (moves == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        map->moves = moves;
+        *capacity = grown;
+    }
+    map->moves[map->numMoves].oldRid = oldRid;
+    map->moves[map->numMoves].newRid = newRid;
+    map->numMoves++;
+    return 0;
+}
+
+/*
+ Appends the rows of tbl to out in the key order of the index, then the rows the
+ index does not reach, in page order
+ */
+static int Cluster_CopyRows(Table *tbl, Table *out, int indexFD, char attrType, int attrLength, ClusterMap *map)
+{
+    int capacity = 0, bufSize = PF_PAGE_SIZE, len, ret_val = 0, status = AME_EOF;
+    byte *buf = (byte *)malloc(bufSize);
+    RecId rid;
+
+    if (buf == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    int scanDesc = AM_OpenIndexScan(indexFD, attrType, attrLength, ALL, NULL);
+    if (scanDesc < 0)
+    {
+        free(buf);
+        return scanDesc;
+    }
+    while (ret_val == 0 && (status = AM_FindNextRecId(scanDesc, &rid)) == AME_OK)
+    {
+        len = Table_Get(tbl, rid, buf, bufSize);
+        if (len > bufSize) // Long overflow record, get it whole
+        {
+            byte *grown = (byte *)realloc(buf, len);
+            if (grown == NULL)
+            {
+                ret_val = PFE_NOMEM;
+                break;
+            }
+            buf = grown;
+            bufSize = len;
+            len = Table_Get(tbl, rid, buf, bufSize);
+        }
+        if (len > 0) // Entries of deleted rows are passed over
+            ret_val = Cluster_Append(out, map, &capacity, rid, buf, len);
+    }
+    AM_CloseIndexScan(scanDesc);
+    free(buf);
+    if (ret_val == 0 && status != AME_EOF)
+    {
+        ret_val = status;
+    }
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+
+    // Rows missing from the index keep their page order, after the indexed ones
+    TableScan *scan;
+    byte *record;
+    int indexed = map->numMoves;
+    qsort(map->moves, indexed, sizeof(ClusterMove), Cluster_CompareMoves);
+    ret_val = Table_OpenScan(tbl, -1, -1, &scan);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+    {
+        if (Cluster_Find(map, indexed, rid) == NULL)
+        {
+            ret_val = Cluster_Append(out, map, &capacity, rid, record, len);
+            if (ret_val != 0)
+                break;
+        }
+    }
+    Table_CloseScan(scan);
+    qsort(map->moves, map->numMoves, sizeof(ClusterMove), Cluster_CompareMoves);
+    return (ret_val == PFE_EOF) ? 0 : ret_val;
+}
+
+/*
+ Copies the index of indexFD page by page to a new index file toName, with its record
+ ids remapped by the map
+ */
+static int Cluster_CopyIndex(ClusterMap *map, int indexFD, char *toName)
+{
+    char *from, *to;
+    int pagenum = -1, newPage;
+
+    PF_DestroyFile(toName); // Left by a Table_Cluster that stopped partway
+    int ret_val = PF_CreateFile(toName);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int fd = PF_OpenFile(toName);
+    if (fd < 0)
+    {
+        return fd;
+    }
+    while ((ret_val = PF_GetNextPage(indexFD, &pagenum, &from)) == PFE_OK)
+    {
+        ret_val = PF_AllocPage(fd, &newPage, &to);
+        if (ret_val == PFE_OK)
+        {
+            memcpy(to, from, PF_PAGE_SIZE);
+            PF_UnfixPage(fd, newPage, TRUE);
+        }
+        PF_UnfixPage(indexFD, pagenum, FALSE);
+        if (ret_val == PFE_OK && newPage != pagenum)
+        {
+            ret_val = PFE_INVALIDPAGE; // A page was freed, which the AM layer never does
+        }
+        if (ret_val != PFE_OK)
+            break;
+    }
+    if (ret_val == PFE_EOF)
+    {
+        ret_val = Cluster_RemapIndex(map, fd);
+    }
+    int closed = PF_CloseFile(fd);
+    return (ret_val != 0) ? ret_val : closed;
+}
+
+/*
+ Rewrites a row or PAX table in the key order of one of its indexes (indexFD, opened
+ with attrType and attrLength), which should hold each row once. The rows get new
+ record ids, listed in the map returned in pmap (if not NULL, to be freed with
+ Cluster_FreeMap). The table's own indexes (see idx.h) and the n indexes others of
+ its file are copied with the new record ids and swapped in with the table's files,
+ on the same descriptors; indexFD must be one of them. Other indexes must be
+ remapped with the map, see Cluster_RemapIndex.
+ tbl stays valid, on the new file, or on the old one if the swap fails (but for
+ an error reopening it); no cursor may be open on it or its indexes.
+ Returns 0, TBLE_LAYOUT for an index-organized table, PFE_FD if indexFD is not one of
+ the indexes swapped, or an AM or PF error code
+ */
+int Table_Cluster(Table *tbl, int indexFD, char attrType, int attrLength, ClusterIndex *others, int n,
+                  ClusterMap **pmap)
+{
+    char tmpName[strlen(tbl->fname) + sizeof(CLUSTER_SUFFIX)];
+    char indexName[strlen(tbl->fname) + sizeof(CLUSTER_SUFFIX) + 16];
+    ClusterIndex indexes[TABLE_MAX_INDEXES + n]; // One per index file
+    int fds[TABLE_MAX_INDEXES + n];              // Every descriptor open on them
+    bool wasBulk = tbl->bulkAppend, found = false;
+    int numIndexes = 0, numFDs = 0;
+    Table *out;
+
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return TBLE_LAYOUT; // Rows are in key order already, and their ids are keys
+    }
+    for (int i = 0; i < tbl->numIndexes + n; i++)
+    {
+        ClusterIndex index = (i < tbl->numIndexes)
+                             ? (ClusterIndex){tbl->indexes[i].indexNo, tbl->indexes[i].fd}
+                             : others[i - tbl->numIndexes];
+        bool dup = false;
+        for (int j = 0; j < numIndexes; j++)
+            dup = dup || indexes[j].indexNo == index.indexNo;
+        if (!dup)
+            indexes[numIndexes++] = index;
+        dup = false;
+        for (int j = 0; j < numFDs; j++)
+            dup = dup || fds[j] == index.fd;
+        if (!dup)
+            fds[numFDs++] = index.fd;
+        found = found || index.fd == indexFD;
+    }
+    if (!found)
+    {
+        return PFE_FD;
+    }
+    ClusterMap *map = (ClusterMap *)calloc(1, sizeof(ClusterMap));
+    if (map == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    int lockfd = Cluster_Lock(tbl->fname, true); // Keeps Cluster_Recover off the new files
+    if (lockfd < 0)
+    {
+        free(map);
+        return PFE_UNIX;
+    }
+    Table_SetBulkAppend(tbl, false);
+    sprintf(tmpName, "%s%s", tbl->fname, CLUSTER_SUFFIX);
+    int ret_val = Table_OpenLayout(tmpName, tbl->schema, tbl->layout, true, &out);
+    if (ret_val != 0)
+    {
+        close(lockfd);
+        Cluster_FreeMap(map);
+        return ret_val;
+    }
+    Table_SetBulkAppend(out, true); // Sorted rows fill pages one after the other
+    ret_val = Cluster_CopyRows(tbl, out, indexFD, attrType, attrLength, map);
+    Table_Close(out);
+    Catalog_Destroy(tmpName); // The table's own catalog stays
+    for (int i = 0; i < numIndexes && ret_val == 0; i++)
+    {
+        sprintf(indexName, "%s.%d", tmpName, indexes[i].indexNo);
+        ret_val = Cluster_CopyIndex(map, indexes[i].fd, indexName);
+    }
+    if (ret_val != 0)
+    {
+        Cluster_MoveFiles(tmpName, NULL);
+        close(lockfd);
+        Cluster_FreeMap(map);
+        return ret_val;
+    }
+
+    // Swap the new files in (see cluster.h) and reopen the table on them, or on the old ones
+    FSM_Close(tbl);
+    OVF_Close(tbl);
+    ZM_Close(tbl);
+    ret_val = PF_CloseFile(tbl->file_descriptor);
+    if (ret_val != PFE_OK) // A page is still fixed: the table stays open on the old file
+    {
+        FSM_Open(tbl, tbl->fname, false);
+        OVF_Open(tbl, tbl->fname, false);
+        ZM_Open(tbl, tbl->fname, false);
+        Cluster_MoveFiles(tmpName, NULL);
+        close(lockfd);
+        Cluster_FreeMap(map);
+        return ret_val;
+    }
+    int swapped = Cluster_Commit(tbl->fname, tmpName, indexes, numIndexes);
+    if (swapped == PFE_OK)
+        swapped = Cluster_Finish(tbl->fname);
+    else
+        Cluster_MoveFiles(tmpName, NULL);
+    close(lockfd);
+    Table *fresh;
+    ret_val = Table_OpenLayout(tbl->fname, tbl->schema, tbl->layout, false, &fresh);
+    if (ret_val != 0)
+    {
+        Cluster_FreeMap(map);
+        return ret_val;
+    }
+    fresh->ownsSchema = tbl->ownsSchema;
+    free(tbl->fname);
+    free(tbl->columnStats); // The catalog gave the same to fresh
+    // The table keeps its open indexes: the catalog opened them again, unused so far
+    Index_Close(fresh);
+    fresh->numIndexes = tbl->numIndexes;
+    memcpy(fresh->indexes, tbl->indexes, sizeof(tbl->indexes));
+    *tbl = *fresh;
+    free(fresh);
+    Table_SetBulkAppend(tbl, wasBulk);
+    if (swapped != PFE_OK) // Back on the old rows, whose ids the indexes hold
+    {
+        Cluster_FreeMap(map);
+        return swapped;
+    }
+
+    // The index files were renamed over: open them again on the same descriptors
+    for (int i = 0; i < numFDs && ret_val == 0; i++)
+    {
+        ret_val = PF_ReopenFile(fds[i]);
+    }
+    if (pmap != NULL && ret_val == 0)
+        *pmap = map;
+    else
+        Cluster_FreeMap(map);
+    return ret_val;
+}
+
+/*
+ Computes the clustering factor of an index of the table (see cluster.h) in factor.
+ Returns 0, TBLE_LAYOUT for an index-organized table, or an AM error code
+ */
+int Table_ClusteringFactor(Table *tbl, int indexFD, char attrType, int attrLength, long long *factor)
+{
+    long long count = 0;
+    int lastPage = -1, status;
+    RecId rid;
+
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return TBLE_LAYOUT; // Record ids are keys, not places
+    }
+    int scanDesc = AM_OpenIndexScan(indexFD, attrType, attrLength, ALL, NULL);
+    if (scanDesc < 0)
+    {
+        return scanDesc;
+    }
+    while ((status = AM_FindNextRecId(scanDesc, &rid)) == AME_OK)
+    {
+        if (RECORD_ID_PAGE(rid) != lastPage)
+        {
+            count++;
+            lastPage = RECORD_ID_PAGE(rid);
+        }
+    }
+    AM_CloseIndexScan(scanDesc);
+    if (status != AME_EOF)
+    {
+        return status;
+    }
+    *factor = count;
+    return 0;
+}
+
+/*
+ Returns the record id a row moved to, or oldRid if the map has no such row
+ */
+RecId Cluster_NewRid(ClusterMap *map, RecId oldRid)
+{
+    ClusterMove *move = Cluster_Find(map, map->numMoves, oldRid);
+    return (move != NULL) ? move->newRid : oldRid;
+}
+
+static AM_RecId Cluster_RemapRecId(void *map, AM_RecId recId)
+{
+    return Cluster_NewRid((ClusterMap *)map, recId);
+}
+
+/*
+ Rewrites the record ids of an index of a clustered table to the rows' new ones
+ Returns 0 or an AM error code
+ */
+int Cluster_RemapIndex(ClusterMap *map, int indexFD)
+{
+    return AM_RemapRecIds(indexFD, Cluster_RemapRecId, map);
+}
+
+void Cluster_FreeMap(ClusterMap *map)
+{
+    if (map != NULL)
+    {
+        free(map->moves);
+        free(map);
+    }
+}
+
+// ---------------------------------------------------------------------------------------
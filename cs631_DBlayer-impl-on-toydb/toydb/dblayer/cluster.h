@@ -0,0 +1,69 @@
+#ifndef _CLUSTER_H_
+#define _CLUSTER_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Clustering: Table_Cluster rewrites a heap (or PAX) table in the key order of one
+// of its AM indexes, so that an index range scan reads each page once. The rows are
+// bulk-appended, in index order, to a new file "<table>.clu" (and its side files),
+// which then replaces the table. The table's indexes, and those the caller names,
+// are copied to "<table>.clu.indexNo" with the new record ids and replace theirs
+// with the table's files; the ClusterMap of the moves lets the caller remap others.
+//
+// The new files replace the old ones in one step: once they are synced to disk,
+// the marker file "<table>.clu.commit" is created, and only then are they renamed
+// over the table's and the marker removed. Opening a table finishes a swap that
+// stopped after the marker was made (see Cluster_Recover), and drops new files
+// left without one, so the table is never seen with some files of each. A
+// Table_Cluster holds a lock on "<table>.clu.lock" (kept) while it runs, so that
+// opening the table meanwhile leaves its new files alone.
+//
+// The clustering factor of an index counts the index entries, in key order, whose
+// row is on another page than the row of the entry before: the page count of the
+// table for a clustered index, up to the number of entries for a random one. An
+// index range scan reading k of n entries costs about k/n of it in page fixes.
+
+#define CLUSTER_SUFFIX ".clu"
+#define CLUSTER_COMMIT_SUFFIX ".clu.commit"
+#define CLUSTER_LOCK_SUFFIX ".clu.lock"
+#define TBLE_LAYOUT (-42) // Operation not supported by the table's layout
+
+typedef struct {
+    RecId oldRid;
+    RecId newRid;
+} ClusterMove;
+
+typedef struct {
+    int indexNo; // The index file is "<table>.indexNo", see AM_CreateIndex
+    int fd;      // PF file descriptor it is open on
+} ClusterIndex;
+
+typedef struct {
+    int numMoves;
+    ClusterMove *moves; // By oldRid
+} ClusterMap;
+
+int
+Table_Cluster(Table *tbl, int indexFD, char attrType, int attrLength, ClusterIndex *others, int n,
+              ClusterMap **pmap);
+
+int
+Cluster_Recover(char *dbname);
+
+int
+Table_ClusteringFactor(Table *tbl, int indexFD, char attrType, int attrLength, long long *factor);
+
+RecId
+Cluster_NewRid(ClusterMap *map, RecId oldRid);
+
+int
+Cluster_RemapIndex(ClusterMap *map, int indexFD);
+
+void
+Cluster_FreeMap(ClusterMap *map);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,276 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "db.h"
+#include "cluster.h"
+#include "idx.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+static bool pfInitialized = false; // Set once PF_Init has run in this process
+
+void Db_InitPF()
+{
+    if (!pfInitialized)
+    {
+        PF_Init();
+        pfInitialized = true;
+    }
+}
+
+/*
+ Creates a database handle. All tables and indexes opened through it share
+ the single PF buffer pool, which is initialized here and never reset.
+ Returns 0 on success and a negative error code otherwise.
+ */
+int Db_Open(Db **pdb)
+{
+    Db *db = (Db *)calloc(1, sizeof(Db));
+    if (db == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    Db_InitPF();
+    *pdb = db;
+    return 0;
+}
+
+/*
+ Opens a table as Table_Open does and registers it with the handle, which
+ closes it in Db_Close unless Db_CloseTable is called first.
+ */
+int Db_OpenTable(Db *db, char *fname, Schema *schema, bool overwrite, Table **ptable)
+{
+    return Db_OpenTableLayout(db, fname, schema, TABLE_LAYOUT_ROW, overwrite, ptable);
+}
+
+/*
+ Returns a free table slot of the handle, or -1 if there is none
+ */
+static int Db_FreeTableSlot(Db *db)
+{
+    for (int i = 0; i < DB_MAX_TABLES; i++)
+    {
+        if (db->tables[i] == NULL)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ Like Db_OpenTable, with the page layout of Table_OpenLayout
+ */
+int Db_OpenTableLayout(Db *db, char *fname, Schema *schema, int layout, bool overwrite, Table **ptable)
+{
+    int i = Db_FreeTableSlot(db), ret_val;
+
+    if (i < 0)
+    {
+        return PFE_FTABFULL; // No room for another open table
+    }
+
+    ret_val = Table_OpenLayout(fname, schema, layout, overwrite, ptable);
+    if (ret_val < 0)
+    {
+        return ret_val;
+    }
+    db->tables[i] = *ptable;
+    return 0;
+}
+
+/*
+ Like Db_OpenTable, for the index-organized table of Table_OpenIndexOrganized
+ */
+int Db_OpenIndexOrganized(Db *db, char *fname, Schema *schema, int keyColumn, bool overwrite, Table **ptable)
+{
+    int i = Db_FreeTableSlot(db), ret_val;
+
+    if (i < 0)
+    {
+        return PFE_FTABFULL;
+    }
+    ret_val = Table_OpenIndexOrganized(fname, schema, keyColumn, overwrite, ptable);
+    if (ret_val < 0)
+    {
+        return ret_val;
+    }
+    db->tables[i] = *ptable;
+    return 0;
+}
+
+/*
+ Closes a table opened with Db_OpenTable.
+ Returns PFE_FD if the table does not belong to the handle.
+ */
+int Db_CloseTable(Db *db, Table *tbl)
+{
+    for (int i = 0; i < DB_MAX_TABLES; i++)
+    {
+        if (db->tables[i] == tbl)
+        {
+            db->tables[i] = NULL;
+            Table_Close(tbl);
+            return 0;
+        }
+    }
+    return PFE_FD;
+}
+
+/*
+ Registers an open index file in a free slot of the handle
+ */
+static int Db_AddIndex(Db *db, char *fname, int indexNo, char attrType, int attrLength, int indexFD)
+{
+    for (int i = 0; i < DB_MAX_INDEXES; i++)
+    {
+        if (db->indexes[i].fname == NULL)
+        {
+            db->indexes[i].fname = strdup(fname);
+            db->indexes[i].indexNo = indexNo;
+            db->indexes[i].attrType = attrType;
+            db->indexes[i].attrLength = attrLength;
+            db->indexes[i].fd = indexFD;
+            return 0;
+        }
+    }
+    PF_CloseFile(indexFD);
+    return PFE_FTABFULL;
+}
+
+/*
+ Creates index number indexNo on table file fname and opens it, destroying an
+ existing index of that number first if overwrite is set.
+ The PF file descriptor to pass to the AM functions is returned in pindexFD.
+ */
+int Db_CreateIndex(Db *db, char *fname, int indexNo, char attrType, int attrLength, bool overwrite, int *pindexFD)
+{
+    int ret_val;
+
+    if (overwrite)
+    {
+        AM_DestroyIndex(fname, indexNo); // Fails harmlessly if there is none
+    }
+    ret_val = AM_CreateIndex(fname, indexNo, attrType, attrLength);
+    if (ret_val != AME_OK)
+    {
+        return ret_val;
+    }
+    return Db_OpenIndex(db, fname, indexNo, attrType, attrLength, pindexFD);
+}
+
+/*
+ Opens existing index number indexNo on table file fname.
+ The PF file descriptor to pass to the AM functions is returned in pindexFD.
+ */
+int Db_OpenIndex(Db *db, char *fname, int indexNo, char attrType, int attrLength, int *pindexFD)
+{
+    char indexfName[AM_MAX_FNAME_LENGTH];
+    int indexFD;
+
+    sprintf(indexfName, "%s.%d", fname, indexNo);
+    indexFD = PF_OpenFile(indexfName);
+    if (indexFD < 0)
+    {
+        return indexFD;
+    }
+    *pindexFD = indexFD;
+    return Db_AddIndex(db, fname, indexNo, attrType, attrLength, indexFD);
+}
+
+/*
+ Returns the handle's entry for an open index, or NULL if it has none
+ */
+DbIndex *Db_FindIndex(Db *db, int indexFD)
+{
+    for (int i = 0; i < DB_MAX_INDEXES; i++)
+    {
+        if (db->indexes[i].fname != NULL && db->indexes[i].fd == indexFD)
+        {
+            return &db->indexes[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ Closes an index opened with Db_CreateIndex or Db_OpenIndex
+ */
+int Db_CloseIndex(Db *db, int indexFD)
+{
+    DbIndex *index = Db_FindIndex(db, indexFD);
+    if (index == NULL)
+    {
+        return PFE_FD;
+    }
+    free(index->fname);
+    index->fname = NULL;
+    return PF_CloseFile(indexFD);
+}
+
+/*
+ Clusters a table on an index of it, open through the handle or one of the table's
+ own (see Table_Cluster, Table_AddIndex), and swaps in the other indexes the handle
+ has open on the table's file with it; indexes not open are left stale.
+ The index's clustering factor afterwards is returned in factor (if not NULL).
+ */
+int Db_ClusterTable(Db *db, Table *tbl, int indexFD, long long *factor)
+{
+    DbIndex *index = Db_FindIndex(db, indexFD);
+    TableIndex *own = Index_Find(tbl, indexFD);
+    ClusterIndex others[DB_MAX_INDEXES];
+    int n = 0;
+
+    if (index == NULL && own == NULL)
+    {
+        return PFE_FD;
+    }
+    char attrType = (index != NULL) ? index->attrType : own->attrType;
+    int attrLength = (index != NULL) ? index->attrLength : own->attrLength;
+    for (int i = 0; i < DB_MAX_INDEXES; i++)
+    {
+        if (db->indexes[i].fname != NULL && strcmp(db->indexes[i].fname, tbl->fname) == 0)
+        {
+            others[n].indexNo = db->indexes[i].indexNo;
+            others[n].fd = db->indexes[i].fd;
+            n++;
+        }
+    }
+    int ret_val = Table_Cluster(tbl, indexFD, attrType, attrLength, others, n, NULL);
+    if (ret_val == 0 && factor != NULL)
+    {
+        ret_val = Table_ClusteringFactor(tbl, indexFD, attrType, attrLength, factor);
+    }
+    return ret_val;
+}
+
+/*
+ Closes every table and index still open through the handle and frees it.
+ The PF layer stays initialized for later handles.
+ */
+void Db_Close(Db *db)
+{
+    if (db == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < DB_MAX_INDEXES; i++)
+    {
+        if (db->indexes[i].fname != NULL)
+        {
+            Db_CloseIndex(db, db->indexes[i].fd);
+        }
+    }
+    for (int i = 0; i < DB_MAX_TABLES; i++)
+    {
+        if (db->tables[i] != NULL)
+        {
+            Db_CloseTable(db, db->tables[i]);
+        }
+    }
+    free(db);
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+#ifndef _DB_H_
+#define _DB_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// The PF layer keeps at most PF_FTAB_SIZE (64) files open, a table four of them
+// (with its side files, see fsm.h, ovf.h, zm.h); tables and indexes share them
+#define DB_MAX_TABLES  10
+#define DB_MAX_INDEXES 10
+
+typedef struct {
+    char *fname;     // Name of the indexed table file
+    int indexNo;     // Index number, the index file is "fname.indexNo"
+    char attrType;   // 'i', 'f' or 'c', as for AM_CreateIndex
+    int attrLength;  // Key length in bytes
+    int fd;          // PF file descriptor of the open index
+} DbIndex;
+
+typedef struct {
+    Table *tables[DB_MAX_TABLES];     // Open tables, NULL if slot unused
+    DbIndex indexes[DB_MAX_INDEXES];  // Open indexes, fname NULL if slot unused
+} Db;
+
+/*
+ Initializes the PF layer the first time it is called in a process and does
+ nothing afterwards, so opening further tables or indexes keeps the buffer pool.
+ */
+void
+Db_InitPF();
+
+int
+Db_Open(Db **pdb);
+
+int
+Db_OpenTable(Db *db, char *fname, Schema *schema, bool overwrite, Table **ptable);
+
+int
+Db_OpenTableLayout(Db *db, char *fname, Schema *schema, int layout, bool overwrite, Table **ptable);
+
+int
+Db_OpenIndexOrganized(Db *db, char *fname, Schema *schema, int keyColumn, bool overwrite, Table **ptable);
+
+int
+Db_CloseTable(Db *db, Table *tbl);
+
+int
+Db_CreateIndex(Db *db, char *fname, int indexNo, char attrType, int attrLength, bool overwrite, int *pindexFD);
+
+int
+Db_OpenIndex(Db *db, char *fname, int indexNo, char attrType, int attrLength, int *pindexFD);
+
+int
+Db_CloseIndex(Db *db, int indexFD);
+
+DbIndex *
+Db_FindIndex(Db *db, int indexFD);
+
+int
+Db_ClusterTable(Db *db, Table *tbl, int indexFD, long long *factor);
+
+void
+Db_Close(Db *db);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
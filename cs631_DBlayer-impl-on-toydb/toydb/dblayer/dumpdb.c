@@ -1,8 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
 #include "codec.h"
 #include "tbl.h"
+#include "db.h"
+#include "batch.h"
+#include "pred.h"
 #include "util.h"
+#include "record.h"
+#include "idx.h"
+#include "stats.h"
+#include "sample.h"
+#include "part.h"
 #include "../pflayer/pf.h"
 #include "../amlayer/am.h"
 #define checkerr(ret_val)        \
@@ -17,36 +28,28 @@
 void printRow(void *callbackObj, RecId rid, byte *row, int len)
 {    
     Schema *schema = (Schema *)callbackObj;
-    byte *cursor = row;
     
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    int byteOffset = 0;
+    // Each column is read where it sits in the record, see record.h
     for (int i = 0; i < schema->numColumns; i++)
     {
         ColumnDesc *colDesc = schema->columns[i];
+        int fieldLen;
+        byte *field = Record_FieldOrDefault(schema, row, len, i, &fieldLen);
         // switch corresponding schema type is
         switch (colDesc->type)
         {
-
-        // VARCHAR : DecodeCString
         case VARCHAR:
-            short length = DecodeShort(row + byteOffset);            // Get the string length from the 2 byte short in front of it
-            char *str = (char *)malloc(sizeof(char) * (length + 1)); // +1 accounts for the null byte
-            DecodeCString(row + byteOffset, str, length + 1);
-            printf("%s,", str);
-            free(str);
-            byteOffset += length + 2; // +2 accounts for 2 byte short that stores length of the string
+            printf("%.*s,", fieldLen, field);
             break;
         // INT : DecodeInt
         case INT:
-            printf("%d", DecodeInt(row + byteOffset));
-            byteOffset += 4;
+            printf("%d", DecodeInt(field));
             break;
         // LONG: DecodeLong
         case LONG:
-            printf("%lld", DecodeLong(row + byteOffset));
-            byteOffset += 8;
+            printf("%lld", DecodeLong(field));
             break;
         }
     }
@@ -55,28 +58,101 @@ void printRow(void *callbackObj, RecId rid, byte *row, int len)
 // ---------------------------------------------------------------------------------------
 }
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Prints the table from column vectors filled BATCH_DEFAULT_SIZE rows at a time
+ */
+void batch_scan(Table *tbl, Schema *schema)
+{
+    TableScan *scan;
+    RecordBatch *batch = Batch_Create(schema, BATCH_DEFAULT_SIZE);
+    int ret_val = Table_OpenScan(tbl, -1, -1, &scan);
+    checkerr(ret_val);
+
+    while ((ret_val = Table_NextColumnBatch(scan, batch)) > 0)
+    {
+        for (int row = 0; row < batch->numRows; row++)
+        {
+            for (int i = 0; i < schema->numColumns; i++)
+            {
+                ColumnVector *col = &batch->columns[i];
+                switch (col->type)
+                {
+                case VARCHAR:
+                    printf("%.*s,", BATCH_STRLEN(col, row), BATCH_STR(col, row));
+                    break;
+                case INT:
+                    printf("%d", col->ints[row]);
+                    break;
+                case LONG:
+                    printf("%lld", col->longs[row]);
+                    break;
+                }
+            }
+            printf("\n");
+        }
+    }
+    checkerr(ret_val);
+    Table_CloseScan(scan);
+    Batch_Free(batch);
+}
+
+// ---------------------------------------------------------------------------------------
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Worker callback of the parallel scan: one row at a time on stdout
+void printRowLocked(void *callbackObj, RecId rid, byte *row, int len)
+{
+    flockfile(stdout);
+    printRow(callbackObj, rid, row, len);
+    funlockfile(stdout);
+}
+
+/*
+ Prints the table with a parallel scan, one worker per core; rows come out in no particular order
+ */
+void parallel_scan(Table *tbl, Schema *schema)
+{
+    int numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    void *objs[numWorkers];
+
+    for (int w = 0; w < numWorkers; w++)
+        objs[w] = schema;
+    int ret_val = Table_ParallelScan(tbl, NULL, numWorkers, objs, printRowLocked);
+    checkerr(ret_val);
+}
+
+// ---------------------------------------------------------------------------------------
+
 #define DB_NAME "data.db"
-#define INDEX_NAME "data.db.0"
+#define PART_NAME "data.db.parts" // Partitioned copy that "loaddb range" and "loaddb hash" make
 
-void index_scan(Table *tbl, Schema *schema, int indexFD, int op, int value)
+void index_scan(Table *tbl, Schema *schema, TableIndex *index, int op, int value)
 {   
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
     // Open index ...
-    int scanDesc = AM_OpenIndexScan(indexFD, 'i', 4, op, (char *)&value);
+    int scanDesc = AM_OpenIndexScan(index->fd, index->attrType, index->attrLength, op, (char *)&value);
     RecId rid;
-    byte record[INPAGE_MAXPOSS_RECORD_SIZE];
+    int bufSize = INPAGE_MAXPOSS_RECORD_SIZE;
+    byte *record = (byte*)malloc(bufSize);
     int max_len;
     while (true)
     {
-        // find next entry in index
-        rid = AM_FindNextEntry(scanDesc);
-        
-        if (rid != AME_EOF) // If next entry exists
+        // find next entry in index; every record id is valid (an IOT key may be negative)
+        if (AM_FindNextRecId(scanDesc, &rid) == AME_OK) // If next entry exists
         {
-            byte *record = (byte*)calloc(INPAGE_MAXPOSS_RECORD_SIZE, sizeof(byte));
             // fetch rid from table
-            max_len = Table_Get(tbl, rid, record, INPAGE_MAXPOSS_RECORD_SIZE);
+            max_len = Table_Get(tbl, rid, record, bufSize);
+            if (max_len > bufSize)
+            {
+                // Record stored in overflow pages, larger than the buffer
+                bufSize = max_len;
+                record = (byte*)realloc(record, bufSize);
+                max_len = Table_Get(tbl, rid, record, bufSize);
+            }
             // Dump the row
             printRow(schema, rid, record, max_len);
         }
@@ -85,20 +161,176 @@ void index_scan(Table *tbl, Schema *schema, int indexFD, int op, int value)
     }
     // close index ...
     AM_CloseIndexScan(scanDesc);
+    free(record);
 
 // ---------------------------------------------------------------------------------------
 }
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Record ids of the rows a scan of the partitioned table passed, and of those a filter keeps
+typedef struct {
+    Schema *schema;
+    PredicateList *filter; // Checked here, for the full scans
+    bool print;
+    int numRids, capacity;
+    RecId *rids;
+} PartRows;
+
+void collectRow(void *callbackObj, RecId rid, byte *row, int len)
+{
+    PartRows *rows = (PartRows *)callbackObj;
+
+    if (rows->filter != NULL && !Pred_Eval(rows->filter, row, len))
+    {
+        return;
+    }
+    if (rows->numRids == rows->capacity)
+    {
+        rows->capacity = (rows->capacity == 0) ? 256 : 2 * rows->capacity;
+        rows->rids = (RecId *)realloc(rows->rids, rows->capacity * sizeof(RecId));
+    }
+    rows->rids[rows->numRids++] = rid;
+    if (rows->print)
+        printRow(rows->schema, rid, row, len);
+}
+
+static int compareRids(const void *a, const void *b)
+{
+    RecId x = *(const RecId *)a, y = *(const RecId *)b;
+    return (x > y) - (x < y);
+}
+
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ Checks that the rows a pruned scan (and a local index scan, for a single
+ predicate) of the partitioned table return with population op value, and
+ op2 value2 if op2 is not -1, are those a full scan passes. Prints the rows if
+ print is set. Returns the number of partitions read, or -1 if the rows differ
+ */
+int check_partitions(PartTable *pt, int column, int op, int value, int op2, int value2, bool print)
+{
+    PartRows pruned = {pt->schema, NULL, print, 0, 0, NULL};
+    PartRows full = {pt->schema, NULL, false, 0, 0, NULL};
+    PartRows indexed = {pt->schema, NULL, false, 0, 0, NULL};
+    bool keep[PART_MAX_PARTITIONS];
+    PredicateList *filter = Pred_Create(pt->schema);
+
+    Pred_AddInt(filter, column, op, value);
+    if (op2 != -1)
+        Pred_AddInt(filter, column, op2, value2);
+    full.filter = filter;
+    int ret_val = Part_ScanWhere(pt, filter, &pruned, collectRow);
+    checkerr(ret_val);
+    ret_val = Part_ScanWhere(pt, NULL, &full, collectRow);
+    checkerr(ret_val);
+    qsort(pruned.rids, pruned.numRids, sizeof(RecId), compareRids);
+    qsort(full.rids, full.numRids, sizeof(RecId), compareRids);
+    bool same = pruned.numRids == full.numRids
+                && memcmp(pruned.rids, full.rids, full.numRids * sizeof(RecId)) == 0;
+    if (op2 == -1)
+    {
+        ret_val = Part_IndexScan(pt, 0, op, value, &indexed, collectRow);
+        checkerr(ret_val);
+        qsort(indexed.rids, indexed.numRids, sizeof(RecId), compareRids);
+        same = same && indexed.numRids == full.numRids
+               && memcmp(indexed.rids, full.rids, full.numRids * sizeof(RecId)) == 0;
+    }
+    int kept = Part_Prune(pt, filter, keep);
+    if (!same)
+        fprintf(stderr, "population %d %d, %d %d: %d rows, not the %d of a full scan\n",
+                op, value, op2, value2, pruned.numRids, full.numRids);
+    Pred_Free(filter);
+    free(pruned.rids);
+    free(full.rids);
+    free(indexed.rids);
+    return same ? kept : -1;
+}
+
+/*
+ Prints the partitioned table with pruned scans, split like the index scan, and
+ checks pruned scans against full scans: of each population in the table, of the
+ range from it to the next one, and of the ranges on either side of it
+ */
+void partition_scan(Schema *schema, int column)
+{
+    PartTable *pt;
+    PartRows all = {schema, NULL, false, 0, 0, NULL};
+    int ret_val = Part_Open(PART_NAME, schema, NULL, false, &pt);
+    if (ret_val < 0)
+    {
+        fprintf(stderr, "%s does not exist, run loaddb range or loaddb hash\n", PART_NAME);
+        exit(1);
+    }
+    int results[2 + 4 * 256];
+    int numChecks = 0;
+    results[numChecks++] = check_partitions(pt, column, LESS_THAN_EQUAL, 100000, -1, 0, true);
+    results[numChecks++] = check_partitions(pt, column, GREATER_THAN, 100000, -1, 0, true);
+
+    // The populations, through the local index
+    ret_val = Part_IndexScan(pt, 0, GREATER_THAN_EQUAL, INT_MIN, &all, collectRow);
+    checkerr(ret_val);
+    byte *record = (byte *)malloc(INPAGE_MAXPOSS_RECORD_SIZE);
+    int values[256], numValues = 0;
+    for (int i = 0; i < all.numRids && numValues < 256; i++)
+    {
+        int len = Part_Get(pt, all.rids[i], record, INPAGE_MAXPOSS_RECORD_SIZE);
+        checkerr(len);
+        int fieldLen;
+        values[numValues++] = DecodeInt(Record_FieldOrDefault(schema, record, len, column, &fieldLen));
+    }
+    free(record);
+    free(all.rids);
+    qsort(values, numValues, sizeof(int), compareInts); // Hash partitions come one after the other
+    for (int i = 0; i < numValues; i++)
+    {
+        int next = (i + 1 < numValues) ? values[i + 1] : values[i];
+        results[numChecks++] = check_partitions(pt, column, EQUAL, values[i], -1, 0, false);
+        results[numChecks++] = check_partitions(pt, column, LESS_THAN, values[i], -1, 0, false);
+        results[numChecks++] = check_partitions(pt, column, GREATER_THAN, values[i], -1, 0, false);
+        results[numChecks++] = check_partitions(pt, column, GREATER_THAN_EQUAL, values[i], LESS_THAN_EQUAL, next, false);
+    }
+
+    int read = 0, failed = 0;
+    for (int i = 0; i < numChecks; i++)
+    {
+        failed += (results[i] < 0);
+        read += (results[i] > 0) ? results[i] : 0;
+    }
+    fprintf(stderr, "%d pruned scans read %d of %d partitions, %d with rows unlike a full scan's\n",
+            numChecks, read, numChecks * pt->spec.numPartitions, failed);
+    Part_Close(pt);
+    if (failed > 0)
+        exit(1);
+}
+
+// ---------------------------------------------------------------------------------------
+
 int main(int argc, char **argv)
 {
-    char *schemaTxt = "Country:varchar,Capital:varchar,Population:int";
-    Schema *schema = parseSchema(schemaTxt);
+    Schema *schema;
     Table *tbl;
+    Db *db;
     int ret_val;
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
-    ret_val = Table_Open(DB_NAME, schema, false, &tbl);
+    // The schema and the population index come from the table's catalog, see catalog.h
+    ret_val = Db_Open(&db);
     checkerr(ret_val);
+    ret_val = Db_OpenTable(db, DB_NAME, NULL, false, &tbl);
+    checkerr(ret_val);
+    schema = tbl->schema;
+    TableIndex *index = (tbl->numIndexes > 0) ? &tbl->indexes[0] : NULL;
+    if (schema == NULL || index == NULL || index->attrType != 'i')
+    {
+        fprintf(stderr, "%s has no catalog with an INT index, run loaddb\n", DB_NAME);
+        exit(1);
+    }
 // ---------------------------------------------------------------------------------------
 
     if (argc == 2 && *(argv[1]) == 's')
@@ -108,16 +340,66 @@ int main(int argc, char **argv)
         Table_Scan(tbl, schema, printRow);
 // ---------------------------------------------------------------------------------------        
     }
-    else
+    else if (argc == 2 && *(argv[1]) == 'b')
+    {
+// IMPLEMENTED---------------------------------------------------------------------------------------
+        // sequential scan decoded into column vectors
+        batch_scan(tbl, schema);
+// ---------------------------------------------------------------------------------------
+    }
+    else if (argc == 2 && *(argv[1]) == 'P')
     {
-        // index scan by default
-        int indexFD = PF_OpenFile(INDEX_NAME);
-        checkerr(indexFD);
+// IMPLEMENTED---------------------------------------------------------------------------------------
+        // morsel-driven parallel scan across all cores
+        parallel_scan(tbl, schema);
+// ---------------------------------------------------------------------------------------
+    }
+    else if (argc == 2 && *(argv[1]) == 'p')
+    {
+// IMPLEMENTED---------------------------------------------------------------------------------------
+        // sequential scans with the population test pushed down, same split as the index scan
+        PredicateList *filter = Pred_Create(schema);
+        Pred_AddInt(filter, index->column, LESS_THAN_EQUAL, 100000);
+        fprintf(stderr, "estimated rows: %.0f\n", tbl->stats.numRows * Stats_FilterSelectivity(tbl, filter));
+        Table_ScanWhere(tbl, filter, schema, printRow);
+        Pred_Free(filter);
 
+        filter = Pred_Create(schema);
+        Pred_AddInt(filter, index->column, GREATER_THAN, 100000);
+        fprintf(stderr, "estimated rows: %.0f\n", tbl->stats.numRows * Stats_FilterSelectivity(tbl, filter));
+        Table_ScanWhere(tbl, filter, schema, printRow);
+        Pred_Free(filter);
+// ---------------------------------------------------------------------------------------
+    }
+    else if (argc == 2 && *(argv[1]) == 'a')
+    {
+// IMPLEMENTED---------------------------------------------------------------------------------------
+        // approximate COUNT and AVG of the population from a tenth of the pages
+        SampleEstimate est;
+        ret_val = Sample_Aggregate(tbl, SAMPLE_COUNT, -1, NULL, 0.1, 1, &est);
+        checkerr(ret_val);
+        printf("COUNT ~ %.0f [%.0f, %.0f] from %d of %d pages\n", est.estimate, est.low, est.high,
+               est.pagesRead, est.numPages);
+        ret_val = Sample_Aggregate(tbl, SAMPLE_AVG, index->column, NULL, 0.1, 1, &est);
+        checkerr(ret_val);
+        printf("AVG(%s) ~ %.0f [%.0f, %.0f] from %lld rows\n", schema->columns[index->column]->name,
+               est.estimate, est.low, est.high, est.rowsRead);
+// ---------------------------------------------------------------------------------------
+    }
+    else if (argc == 2 && *(argv[1]) == 'r')
+    {
+// IMPLEMENTED---------------------------------------------------------------------------------------
+        // the partitioned copy, whose pruned scans must return what full scans do
+        partition_scan(schema, index->column);
+// ---------------------------------------------------------------------------------------
+    }
+    else
+    {
+        // index scan by default, on the table's index
         // Ask for populations less than 100000, then more than 100000. Together they should
         // yield the complete database.
-        index_scan(tbl, schema, indexFD, LESS_THAN_EQUAL, 100000);
-        index_scan(tbl, schema, indexFD, GREATER_THAN, 100000);
+        index_scan(tbl, schema, index, LESS_THAN_EQUAL, 100000);
+        index_scan(tbl, schema, index, GREATER_THAN, 100000);
     }
-    Table_Close(tbl);
+    Db_Close(db);
 }
@@ -0,0 +1,258 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "fsm.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+#define FSM_GET_CATEGORY(leafbuf, i) ((unsigned char)(leafbuf)[i])
+
+/*
+ Allocates a zeroed page in the FSM file, page is fixed on exit
+ */
+static int FSM_AllocZeroPage(int fsmFD, int *pagenum, char **pagebuf)
+{
+    int ret_val = PF_AllocPage(fsmFD, pagenum, pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    memset(*pagebuf, 0, PF_PAGE_SIZE); // PF_AllocPage does not clear the page
+    return PFE_OK;
+}
+
+/*
+ Fixes leaf number leafNo of the FSM. If create is set, missing leaves are
+ allocated (zeroed, meaning no free space recorded), otherwise PFE_INVALIDPAGE
+ is returned for them.
+ */
+static int FSM_GetLeaf(Table *tbl, int leafNo, bool create, char **leafbuf)
+{
+    int pagenum;
+    int ret_val = PF_GetThisPage(tbl->fsmFD, leafNo + 1, leafbuf);
+    if (ret_val != PFE_INVALIDPAGE || !create)
+    {
+        return ret_val;
+    }
+
+    // FSM pages are never disposed, so they are allocated in order
+    while (1)
+    {
+        ret_val = FSM_AllocZeroPage(tbl->fsmFD, &pagenum, leafbuf);
+        if (ret_val != PFE_OK || pagenum == leafNo + 1)
+        {
+            return ret_val;
+        }
+        ret_val = PF_UnfixPage(tbl->fsmFD, pagenum, TRUE);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+    }
+}
+
+/*
+ Opens the free-space map "<dbname>.fsm" of a table, creating it if it does not
+ exist. A map created for a table that already has pages is rebuilt from them.
+ Must be called once firstPageNum of the table is known.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int FSM_Open(Table *tbl, char *dbname, bool overwrite)
+{
+    char fsmName[strlen(dbname) + sizeof(FSM_SUFFIX)];
+    char *pagebuf;
+    int pagenum, ret_val;
+
+    sprintf(fsmName, "%s%s", dbname, FSM_SUFFIX);
+    if (overwrite)
+    {
+        PF_DestroyFile(fsmName);
+    }
+
+    tbl->fsmFD = PF_OpenFile(fsmName);
+    if (tbl->fsmFD >= 0)
+    {
+        return 0;
+    }
+
+    // No map yet: create one with an empty root
+    ret_val = PF_CreateFile(fsmName);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    tbl->fsmFD = PF_OpenFile(fsmName);
+    if (tbl->fsmFD < 0)
+    {
+        return tbl->fsmFD;
+    }
+    ret_val = FSM_AllocZeroPage(tbl->fsmFD, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ret_val = PF_UnfixPage(tbl->fsmFD, pagenum, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+
+    if (tbl->firstPageNum != -1)
+    {
+        return FSM_Rebuild(tbl); // Table predates its map
+    }
+    return 0;
+}
+
+void FSM_Close(Table *tbl)
+{
+    if (tbl->fsmFD >= 0)
+    {
+        PF_CloseFile(tbl->fsmFD);
+        tbl->fsmFD = -1;
+    }
+}
+
+/*
+ Finds a heap page whose recorded free space can hold a record of len bytes
+ plus its slot. Costs two FSM page accesses, the root and one leaf.
+ Returns the page number, or -1 if no page is known to have enough room.
+ */
+int FSM_Search(Table *tbl, int len)
+{
+    char *rootbuf, *leafbuf;
+    int leafNo, i, ret_val;
+    int pagenum = -1;
+    // Smallest category guaranteeing room; categories round free space down
+    int category = (len + PAGEHEADER_SLOT_SIZE + FSM_CATEGORY_SIZE - 1) / FSM_CATEGORY_SIZE;
+
+    if (category > FSM_MAX_CATEGORY)
+    {
+        return -1;
+    }
+
+    ret_val = PF_GetThisPage(tbl->fsmFD, FSM_ROOT_PAGE, &rootbuf);
+    if (ret_val != PFE_OK)
+    {
+        return -1;
+    }
+    for (leafNo = 0; leafNo < FSM_MAX_LEAVES; leafNo++)
+    {
+        if ((unsigned char)rootbuf[leafNo] >= category)
+            break;
+    }
+    PF_UnfixPage(tbl->fsmFD, FSM_ROOT_PAGE, FALSE);
+    if (leafNo == FSM_MAX_LEAVES)
+    {
+        return -1;
+    }
+
+    if (FSM_GetLeaf(tbl, leafNo, false, &leafbuf) != PFE_OK)
+    {
+        return -1;
+    }
+    for (i = 0; i < FSM_PAGES_PER_LEAF; i++)
+    {
+        if (FSM_GET_CATEGORY(leafbuf, i) >= category)
+        {
+            pagenum = leafNo * FSM_PAGES_PER_LEAF + i;
+            break;
+        }
+    }
+    PF_UnfixPage(tbl->fsmFD, leafNo + 1, FALSE);
+    return pagenum;
+}
+
+/*
+ Records that heap page pagenum has freeBytes bytes available for a new record
+ and its slot. Called after every change to the page's free space.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int FSM_Update(Table *tbl, int pagenum, int freeBytes)
+{
+    char *rootbuf, *leafbuf;
+    int leafNo = pagenum / FSM_PAGES_PER_LEAF;
+    int i = pagenum % FSM_PAGES_PER_LEAF;
+    int category, oldCategory, maxCategory, ret_val;
+
+    if (pagenum < 0 || leafNo >= FSM_MAX_LEAVES)
+    {
+        return 0; // Beyond the map; such pages are only found by appending
+    }
+    category = (freeBytes < 0) ? 0 : freeBytes / FSM_CATEGORY_SIZE;
+    if (category > FSM_MAX_CATEGORY)
+    {
+        category = FSM_MAX_CATEGORY;
+    }
+
+    ret_val = FSM_GetLeaf(tbl, leafNo, true, &leafbuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    oldCategory = FSM_GET_CATEGORY(leafbuf, i);
+    if (oldCategory == category)
+    {
+        return PF_UnfixPage(tbl->fsmFD, leafNo + 1, FALSE);
+    }
+    leafbuf[i] = category;
+
+    // Keep the root's per-leaf maximum exact
+    ret_val = PF_GetThisPage(tbl->fsmFD, FSM_ROOT_PAGE, &rootbuf);
+    if (ret_val != PFE_OK)
+    {
+        PF_UnfixPage(tbl->fsmFD, leafNo + 1, TRUE);
+        return ret_val;
+    }
+    maxCategory = (unsigned char)rootbuf[leafNo];
+    if (category > maxCategory)
+    {
+        maxCategory = category;
+    }
+    else if (oldCategory == maxCategory)
+    {
+        // The page may have been the leaf's best one; rescan the leaf
+        maxCategory = 0;
+        for (int j = 0; j < FSM_PAGES_PER_LEAF && maxCategory < FSM_MAX_CATEGORY; j++)
+        {
+            if (FSM_GET_CATEGORY(leafbuf, j) > maxCategory)
+                maxCategory = FSM_GET_CATEGORY(leafbuf, j);
+        }
+    }
+    if ((unsigned char)rootbuf[leafNo] != maxCategory)
+    {
+        rootbuf[leafNo] = maxCategory;
+        PF_UnfixPage(tbl->fsmFD, FSM_ROOT_PAGE, TRUE);
+    }
+    else
+    {
+        PF_UnfixPage(tbl->fsmFD, FSM_ROOT_PAGE, FALSE);
+    }
+    return PF_UnfixPage(tbl->fsmFD, leafNo + 1, TRUE);
+}
+
+/*
+ Recomputes the map from the heap pages of the table
+ */
+int FSM_Rebuild(Table *tbl)
+{
+    int pagenum = -1, ret_val;
+    char *pagebuf;
+
+    while ((ret_val = PF_GetNextPage(tbl->file_descriptor, &pagenum, &pagebuf)) == PFE_OK)
+    {
+        int freeBytes = Page_FreeSpace(pagebuf);
+        PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+        ret_val = FSM_Update(tbl, pagenum, freeBytes);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+    }
+    return (ret_val == PFE_EOF) ? 0 : ret_val;
+}
+
+// ---------------------------------------------------------------------------------------
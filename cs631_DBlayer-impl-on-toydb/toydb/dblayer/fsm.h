@@ -0,0 +1,40 @@
+#ifndef _FSM_H_
+#define _FSM_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Free-space map: a separate paged file "<table>.fsm" holding a one byte free-space
+// category (free bytes / FSM_CATEGORY_SIZE) for every heap page.
+// Page 0 is the root: one byte per leaf page giving the largest category in that leaf.
+// Leaf page i (file page i+1) holds the categories of heap pages
+// [i*FSM_PAGES_PER_LEAF, (i+1)*FSM_PAGES_PER_LEAF), one per byte.
+// Pages past the FSM_MAX_LEAVES leaves are not recorded.
+// A lookup or an update therefore touches the root and one leaf only.
+
+#define FSM_SUFFIX          ".fsm"
+#define FSM_CATEGORY_SIZE   16                 // Bytes of free space per category step
+#define FSM_MAX_CATEGORY    255                // Categories fit in a byte
+#define FSM_PAGES_PER_LEAF  PF_PAGE_SIZE       // Heap pages described by one leaf
+#define FSM_MAX_LEAVES      PF_PAGE_SIZE       // Leaves described by the root
+#define FSM_ROOT_PAGE       0
+
+int
+FSM_Open(Table *tbl, char *dbname, bool overwrite);
+
+void
+FSM_Close(Table *tbl);
+
+int
+FSM_Search(Table *tbl, int len);
+
+int
+FSM_Update(Table *tbl, int pagenum, int freeBytes);
+
+int
+FSM_Rebuild(Table *tbl);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
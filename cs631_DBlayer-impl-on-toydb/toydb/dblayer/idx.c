@@ -0,0 +1,399 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "idx.h"
+#include "catalog.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+#define INDEX_BUILD_BATCH 4096 // Rows whose keys Table_AddIndex sorts and adds at a time
+
+// A record id and its key, attrLength bytes and a terminator, as sorted for AM_InsertEntries
+typedef struct {
+    RecId rid;
+    char key[];
+} IndexEntry;
+
+#define INDEX_ENTRY_SIZE(index) ((sizeof(IndexEntry) + (index)->attrLength + 1 + 7) & ~(size_t)7)
+#define INDEX_ENTRY(entries, index, i) ((IndexEntry *)((char *)(entries) + (size_t)(i) * INDEX_ENTRY_SIZE(index)))
+
+/*
+ Fills key with the index key of record: the INT value, or the VARCHAR value cut
+ to attrLength bytes and padded with zeros, then a terminator.
+ Returns false if the record is not in a known format
+ */
+static bool Index_Key(Table *tbl, TableIndex *index, byte *record, int len, char *key)
+{
+    int fieldLen;
+    byte *field = Record_Field(tbl->schema, record, len, index->column, &fieldLen);
+    if (field == NULL)
+    {
+        return false;
+    }
+    memset(key, 0, index->attrLength + 1);
+    if (index->attrType == 'i')
+    {
+        int value = DecodeInt(field);
+        memcpy(key, &value, sizeof(int));
+    }
+    else
+    {
+        memcpy(key, field, (fieldLen < index->attrLength) ? fieldLen : index->attrLength);
+    }
+    return true;
+}
+
+/*
+ Orders entries as AM_Compare orders their keys, then by record id
+ */
+static int Index_CompareInt(const void *a, const void *b)
+{
+    const IndexEntry *x = (const IndexEntry *)a, *y = (const IndexEntry *)b;
+    int kx, ky;
+    memcpy(&kx, x->key, sizeof(int));
+    memcpy(&ky, y->key, sizeof(int));
+    if (kx != ky)
+        return (kx > ky) - (kx < ky);
+    return (x->rid > y->rid) - (x->rid < y->rid);
+}
+
+static int Index_CompareString(const void *a, const void *b)
+{
+    const IndexEntry *x = (const IndexEntry *)a, *y = (const IndexEntry *)b;
+    int cmp = strcmp(x->key, y->key);
+    if (cmp != 0)
+        return cmp;
+    return (x->rid > y->rid) - (x->rid < y->rid);
+}
+
+/*
+ Sorts n entries of an index and adds them to it, leaf by leaf
+ Returns 0 or an AM error code
+ */
+static int Index_Apply(TableIndex *index, void *entries, int n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    qsort(entries, n, INDEX_ENTRY_SIZE(index),
+          (index->attrType == 'i') ? Index_CompareInt : Index_CompareString);
+    char *values = (char *)malloc((size_t)n * index->attrLength);
+    AM_RecId *recIds = (AM_RecId *)malloc((size_t)n * sizeof(AM_RecId));
+    int ret_val = PFE_NOMEM;
+    if (values != NULL && recIds != NULL)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            IndexEntry *entry = INDEX_ENTRY(entries, index, i);
+            memcpy(values + (size_t)i * index->attrLength, entry->key, index->attrLength);
+            recIds[i] = entry->rid;
+        }
+        ret_val = AM_InsertEntries(index->fd, index->attrType, index->attrLength, values, recIds, n);
+    }
+    free(values);
+    free(recIds);
+    return ret_val;
+}
+
+/*
+ Adds the rows of the table to a new, empty index of it
+ */
+static int Index_Build(Table *tbl, TableIndex *index)
+{
+    void *entries = malloc(INDEX_BUILD_BATCH * INDEX_ENTRY_SIZE(index));
+    TableScan *scan;
+    RecId rid;
+    byte *record;
+    int len, n = 0;
+
+    if (entries == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    int ret_val = Table_OpenScan(tbl, -1, -1, &scan);
+    if (ret_val != 0)
+    {
+        free(entries);
+        return ret_val;
+    }
+    while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+    {
+        IndexEntry *entry = INDEX_ENTRY(entries, index, n);
+        if (!Index_Key(tbl, index, record, len, entry->key))
+            continue;
+        entry->rid = rid;
+        if (++n == INDEX_BUILD_BATCH)
+        {
+            ret_val = Index_Apply(index, entries, n);
+            n = 0;
+            if (ret_val != 0)
+                break;
+        }
+    }
+    Table_CloseScan(scan);
+    if (ret_val == PFE_EOF)
+    {
+        ret_val = Index_Apply(index, entries, n);
+    }
+    free(entries);
+    return ret_val;
+}
+
+/*
+ Makes index number indexNo on a column of the table one of the table's secondary
+ indexes, which its inserts, deletes and updates keep current from then on, and
+ records it in the table's catalog (see catalog.h), which opens it with the table.
+ An INT column is indexed with attrType 'i' and attrLength 4, a VARCHAR column with
+ 'c' and the length of the prefix to index. If the index file exists and overwrite
+ is not set, it is taken to be current and opened; otherwise it is created and
+ filled with the table's rows. The index's PF file descriptor, for AM scans, is
+ returned in pindexFD (if not NULL); Table_Close closes it. Adding an index the
+ table has open already, with the same definition and overwrite not set, returns it.
+ Returns 0, TBLE_INDEX, or an AM or PF error code
+ */
+int Table_AddIndex(Table *tbl, int indexNo, int column, char attrType, int attrLength, bool overwrite, int *pindexFD)
+{
+    for (int i = 0; i < tbl->numIndexes && !overwrite; i++)
+    {
+        TableIndex *index = &tbl->indexes[i];
+        if (index->indexNo == indexNo && index->column == column
+                && index->attrType == attrType && index->attrLength == attrLength)
+        {
+            if (pindexFD != NULL)
+                *pindexFD = index->fd;
+            return 0;
+        }
+    }
+    int ret_val = Index_Open(tbl, indexNo, column, attrType, attrLength, overwrite, pindexFD);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    return Catalog_Write(tbl);
+}
+
+/*
+ Opens or creates an index of the table as Table_AddIndex does, without recording it
+ */
+int Index_Open(Table *tbl, int indexNo, int column, char attrType, int attrLength, bool overwrite, int *pindexFD)
+{
+    char indexName[strlen(tbl->fname) + 16];
+    int ret_val;
+
+    if (tbl->schema == NULL || column < 0 || column >= tbl->schema->numColumns
+            || tbl->numIndexes == TABLE_MAX_INDEXES)
+    {
+        return TBLE_INDEX;
+    }
+    int type = tbl->schema->columns[column]->type;
+    if (!(type == INT && attrType == 'i' && attrLength == 4)
+            && !(type == VARCHAR && attrType == 'c' && attrLength > 0 && attrLength < AM_MAXATTRLENGTH))
+    {
+        return TBLE_INDEX;
+    }
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        if (tbl->indexes[i].indexNo == indexNo)
+            return TBLE_INDEX;
+    }
+
+    TableIndex *index = &tbl->indexes[tbl->numIndexes];
+    index->indexNo = indexNo;
+    index->column = column;
+    index->attrType = attrType;
+    index->attrLength = attrLength;
+    sprintf(indexName, "%s.%d", tbl->fname, indexNo);
+    index->fd = overwrite ? -1 : PF_OpenFile(indexName);
+    if (index->fd < 0)
+    {
+        AM_DestroyIndex(tbl->fname, indexNo); // Fails harmlessly if there is none
+        ret_val = AM_CreateIndex(tbl->fname, indexNo, attrType, attrLength);
+        if (ret_val != AME_OK)
+        {
+            return ret_val;
+        }
+        index->fd = PF_OpenFile(indexName);
+        if (index->fd < 0)
+        {
+            return index->fd;
+        }
+        // The scan must not meet the bulk-append tail fixed
+        bool wasBulk = tbl->bulkAppend;
+        Table_SetBulkAppend(tbl, false);
+        ret_val = Index_Build(tbl, index);
+        Table_SetBulkAppend(tbl, wasBulk);
+        if (ret_val != 0)
+        {
+            PF_CloseFile(index->fd);
+            return ret_val;
+        }
+    }
+    tbl->numIndexes++;
+    if (pindexFD != NULL)
+    {
+        *pindexFD = index->fd;
+    }
+    return 0;
+}
+
+/*
+ Returns the table's index open as indexFD, or NULL if it has none
+ */
+TableIndex *Index_Find(Table *tbl, int indexFD)
+{
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        if (tbl->indexes[i].fd == indexFD)
+            return &tbl->indexes[i];
+    }
+    return NULL;
+}
+
+/*
+ Reads the whole record rid into a buffer allocated for it, returned in record
+ (to be freed by the caller), and its length in len.
+ Returns 0, PFE_INVALIDPAGE if there is no such record, or PFE_NOMEM
+ */
+int Index_GetRow(Table *tbl, RecId rid, byte **record, int *len)
+{
+    int size = PF_PAGE_SIZE;
+    byte *buf = (byte *)malloc(size);
+
+    while (buf != NULL)
+    {
+        *len = Table_Get(tbl, rid, buf, size);
+        if (*len <= 0)
+        {
+            free(buf);
+            return PFE_INVALIDPAGE;
+        }
+        if (*len <= size)
+        {
+            *record = buf;
+            return 0;
+        }
+        size = *len; // Long overflow record, get it whole
+        free(buf);
+        buf = (byte *)malloc(size);
+    }
+    return PFE_NOMEM;
+}
+
+/*
+ Adds the row rid to every index of the table
+ */
+int Index_Insert(Table *tbl, RecId rid, byte *record, int len)
+{
+    char key[AM_MAXATTRLENGTH + 1];
+
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        TableIndex *index = &tbl->indexes[i];
+        if (!Index_Key(tbl, index, record, len, key))
+            continue;
+        int ret_val = AM_InsertEntry(index->fd, index->attrType, index->attrLength, key, rid);
+        if (ret_val != AME_OK)
+            return ret_val;
+    }
+    return 0;
+}
+
+/*
+ Adds n rows to every index of the table, in key order per index
+ */
+int Index_InsertBatch(Table *tbl, RecId *rids, byte **records, int *lens, int n)
+{
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        TableIndex *index = &tbl->indexes[i];
+        void *entries = malloc((size_t)n * INDEX_ENTRY_SIZE(index));
+        int count = 0;
+        if (entries == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        for (int j = 0; j < n; j++)
+        {
+            IndexEntry *entry = INDEX_ENTRY(entries, index, count);
+            if (Index_Key(tbl, index, records[j], lens[j], entry->key))
+            {
+                entry->rid = rids[j];
+                count++;
+            }
+        }
+        int ret_val = Index_Apply(index, entries, count);
+        free(entries);
+        if (ret_val != 0)
+            return ret_val;
+    }
+    return 0;
+}
+
+/*
+ Removes the row rid, record, from every index of the table. Entries already
+ missing are passed over.
+ */
+int Index_Delete(Table *tbl, RecId rid, byte *record, int len)
+{
+    char key[AM_MAXATTRLENGTH + 1];
+
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        TableIndex *index = &tbl->indexes[i];
+        if (!Index_Key(tbl, index, record, len, key))
+            continue;
+        int ret_val = AM_DeleteEntry(index->fd, index->attrType, index->attrLength, key, rid);
+        if (ret_val != AME_OK && ret_val != AME_NOTFOUND)
+            return ret_val;
+    }
+    return 0;
+}
+
+/*
+ Moves the entries of row rid, oldRecord before the update, to the row's new
+ version record and its record id newRid. Indexes whose entry is unchanged are left.
+ */
+int Index_Update(Table *tbl, RecId rid, byte *oldRecord, int oldLen, RecId newRid, byte *record, int len)
+{
+    char oldKey[AM_MAXATTRLENGTH + 1], key[AM_MAXATTRLENGTH + 1];
+
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        TableIndex *index = &tbl->indexes[i];
+        bool hadKey = Index_Key(tbl, index, oldRecord, oldLen, oldKey);
+        bool hasKey = Index_Key(tbl, index, record, len, key);
+        if (hadKey && hasKey && rid == newRid && memcmp(oldKey, key, index->attrLength) == 0)
+            continue;
+        int ret_val = AME_OK;
+        if (hadKey)
+            ret_val = AM_DeleteEntry(index->fd, index->attrType, index->attrLength, oldKey, rid);
+        if (ret_val != AME_OK && ret_val != AME_NOTFOUND)
+            return ret_val;
+        if (hasKey)
+            ret_val = AM_InsertEntry(index->fd, index->attrType, index->attrLength, key, newRid);
+        if (ret_val != AME_OK && ret_val != AME_NOTFOUND)
+            return ret_val;
+    }
+    return 0;
+}
+
+/*
+ Closes the indexes of the table
+ */
+void Index_Close(Table *tbl)
+{
+    for (int i = 0; i < tbl->numIndexes; i++)
+    {
+        PF_CloseFile(tbl->indexes[i].fd);
+    }
+    tbl->numIndexes = 0;
+}
+
+// ---------------------------------------------------------------------------------------
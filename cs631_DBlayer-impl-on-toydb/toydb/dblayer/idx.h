@@ -0,0 +1,50 @@
+#ifndef _IDX_H_
+#define _IDX_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Secondary indexes owned by a table: AM indexes "<table>.indexNo" on an INT column
+// ('i', 4) or on a prefix of a VARCHAR column ('c', 1 to 255 bytes, padded with
+// zeros), holding the record ids of the rows. Table_Insert, Table_Delete and
+// Table_Update keep every index of the table current; Table_InsertBatch sorts the
+// keys of the batch per index and adds them with AM_InsertEntries, which fixes each
+// leaf they go to once. Table_Close closes the indexes; the table's catalog (see
+// catalog.h) records them, and a table opened again gets them back without a rebuild.
+//
+// The AM layer is not thread-safe: tables written from several threads at once,
+// like the partitions in Part_Load, must not have indexes of their own.
+
+#define TBLE_INDEX (-44) // Bad index column or type, index number in use, or too many indexes
+
+int
+Table_AddIndex(Table *tbl, int indexNo, int column, char attrType, int attrLength, bool overwrite, int *pindexFD);
+
+int
+Index_Open(Table *tbl, int indexNo, int column, char attrType, int attrLength, bool overwrite, int *pindexFD);
+
+TableIndex *
+Index_Find(Table *tbl, int indexFD);
+
+int
+Index_GetRow(Table *tbl, RecId rid, byte **record, int *len);
+
+int
+Index_Insert(Table *tbl, RecId rid, byte *record, int len);
+
+int
+Index_InsertBatch(Table *tbl, RecId *rids, byte **records, int *lens, int n);
+
+int
+Index_Delete(Table *tbl, RecId rid, byte *record, int len);
+
+int
+Index_Update(Table *tbl, RecId rid, byte *oldRecord, int oldLen, RecId newRid, byte *record, int len);
+
+void
+Index_Close(Table *tbl);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
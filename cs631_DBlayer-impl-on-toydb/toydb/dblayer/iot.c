@@ -0,0 +1,588 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "iot.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+_Static_assert(sizeof(IotNode) <= PF_PAGE_SIZE, "IOT_FANOUT too large for a page");
+
+// Inner nodes passed on the way down to a leaf, and the child taken in each
+typedef struct {
+    int depth;
+    int pages[IOT_MAX_HEIGHT];
+    int children[IOT_MAX_HEIGHT];
+} IotPath;
+
+#define IOT_SLOTS_END(leaf) ((int)sizeof(IotLeaf) + (leaf)->numRows * (int)sizeof(PageSlot))
+
+/*
+ Returns the key of an encoded row of the table
+ */
+long long IOT_RowKey(Table *tbl, byte *record, int len)
+{
+    int fieldLen;
+    byte *field = Record_FieldOrDefault(tbl->schema, record, len, tbl->keyColumn, &fieldLen);
+    return (tbl->schema->columns[tbl->keyColumn]->type == INT) ? DecodeInt(field) : DecodeLong(field);
+}
+
+static void IOT_InitLeaf(byte *pagebuf, int nextLeaf)
+{
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+    leaf->marker = IOT_LEAF_MARKER;
+    leaf->numRows = 0;
+    leaf->dataOffset = PF_PAGE_SIZE;
+    leaf->deadBytes = 0;
+    leaf->nextLeaf = nextLeaf;
+}
+
+static int IOT_WriteMeta(Table *tbl)
+{
+    char *pagebuf;
+    int ret_val = PF_GetThisPage(tbl->file_descriptor, IOT_META_PAGE, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    IotMeta *meta = (IotMeta *)pagebuf;
+    meta->marker = IOT_META_MARKER;
+    meta->keyColumn = tbl->keyColumn;
+    meta->rootPage = tbl->rootPage;
+    return PF_UnfixPage(tbl->file_descriptor, IOT_META_PAGE, TRUE);
+}
+
+/*
+ Turns an empty table into an index-organized one on keyColumn: writes the meta
+ page and an empty root leaf.
+ Returns 0, IOTE_INVALIDKEY, or a PF error code
+ */
+int IOT_Create(Table *tbl, int keyColumn)
+{
+    char *pagebuf;
+    int metaPage, ret_val;
+
+    if (tbl->schema == NULL || keyColumn < 0 || keyColumn >= tbl->schema->numColumns
+            || tbl->schema->columns[keyColumn]->type == VARCHAR)
+    {
+        return IOTE_INVALIDKEY;
+    }
+    ret_val = PF_AllocPage(tbl->file_descriptor, &metaPage, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    memset(pagebuf, 0, PF_PAGE_SIZE);
+    ret_val = PF_UnfixPage(tbl->file_descriptor, metaPage, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ret_val = PF_AllocPage(tbl->file_descriptor, &tbl->rootPage, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    IOT_InitLeaf(pagebuf, -1);
+    ret_val = PF_UnfixPage(tbl->file_descriptor, tbl->rootPage, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    tbl->keyColumn = keyColumn;
+    tbl->firstPageNum = metaPage;
+    tbl->currentPageNum = metaPage;
+    return IOT_WriteMeta(tbl);
+}
+
+/*
+ Sets up the table from its meta page
+ */
+int IOT_Load(Table *tbl, byte *metabuf)
+{
+    IotMeta *meta = (IotMeta *)metabuf;
+
+    tbl->keyColumn = meta->keyColumn;
+    tbl->rootPage = meta->rootPage;
+    if (tbl->schema == NULL || tbl->keyColumn >= tbl->schema->numColumns
+            || tbl->schema->columns[tbl->keyColumn]->type == VARCHAR)
+    {
+        return IOTE_INVALIDKEY; // Rows cannot be keyed without a matching schema
+    }
+    return 0;
+}
+
+/*
+ Returns the child of an inner node covering key
+ */
+static int IOT_NodeChild(IotNode *node, long long key)
+{
+    int low = 0, high = node->numKeys; // First key greater than key, in [low, high]
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (node->keys[mid] <= key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/*
+ Descends from the root to the leaf covering key and leaves it fixed, recording
+ the inner nodes passed in path (if not NULL)
+ */
+static int IOT_Descend(Table *tbl, long long key, IotPath *path, int *pagenum, char **pagebuf)
+{
+    int page = tbl->rootPage;
+    int ret_val;
+
+    if (path != NULL)
+        path->depth = 0;
+    while (1)
+    {
+        ret_val = PF_GetThisPage(tbl->file_descriptor, page, pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        if (IOT_IS_LEAF(*pagebuf))
+        {
+            *pagenum = page;
+            return PFE_OK;
+        }
+        IotNode *node = (IotNode *)*pagebuf;
+        int child = IOT_NodeChild(node, key);
+        int next = node->children[child];
+        if (path != NULL)
+        {
+            if (path->depth == IOT_MAX_HEIGHT)
+            {
+                PF_UnfixPage(tbl->file_descriptor, page, FALSE);
+                return PFE_INVALIDPAGE;
+            }
+            path->pages[path->depth] = page;
+            path->children[path->depth] = child;
+            path->depth++;
+        }
+        PF_UnfixPage(tbl->file_descriptor, page, FALSE);
+        page = next;
+    }
+}
+
+/*
+ Fixes the leaf covering key, for a scan starting at key
+ */
+int IOT_FixLeaf(Table *tbl, long long key, int *pagenum, char **pagebuf)
+{
+    return IOT_Descend(tbl, key, NULL, pagenum, pagebuf);
+}
+
+/*
+ Returns the row at position pos of a leaf, and its length in len
+ */
+byte *IOT_LeafRow(byte *pagebuf, int pos, int *len)
+{
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+    *len = leaf->slots[pos].length;
+    return pagebuf + leaf->slots[pos].offset;
+}
+
+/*
+ Returns the position of the first row of a leaf whose key is at least key,
+ setting found if its key is key
+ */
+int IOT_LeafSearch(Table *tbl, byte *pagebuf, long long key, bool *found)
+{
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+    int low = 0, high = leaf->numRows, len;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        byte *row = IOT_LeafRow(pagebuf, mid, &len);
+        if (IOT_RowKey(tbl, row, len) < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (found != NULL)
+    {
+        byte *row = (low < leaf->numRows) ? IOT_LeafRow(pagebuf, low, &len) : NULL;
+        *found = (row != NULL && IOT_RowKey(tbl, row, len) == key);
+    }
+    return low;
+}
+
+// Packs the rows of a leaf at the end of the page, reclaiming dead bytes
+static void IOT_CompactLeaf(byte *pagebuf)
+{
+    char copy[PF_PAGE_SIZE];
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+    int end = PF_PAGE_SIZE;
+
+    memcpy(copy, pagebuf, PF_PAGE_SIZE);
+    for (int pos = 0; pos < leaf->numRows; pos++)
+    {
+        end -= leaf->slots[pos].length;
+        memcpy(pagebuf + end, copy + leaf->slots[pos].offset, leaf->slots[pos].length);
+        leaf->slots[pos].offset = end;
+    }
+    leaf->dataOffset = end;
+    leaf->deadBytes = 0;
+}
+
+// Bytes a leaf has left for rows and their slots
+static int IOT_LeafFree(IotLeaf *leaf)
+{
+    return leaf->dataOffset - IOT_SLOTS_END(leaf) + leaf->deadBytes;
+}
+
+/*
+ Inserts a row at position pos of a leaf with room for it (see IOT_LeafFree)
+ */
+static void IOT_LeafInsertAt(byte *pagebuf, int pos, byte *record, int len)
+{
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+
+    if (leaf->dataOffset - IOT_SLOTS_END(leaf) < len + (int)sizeof(PageSlot))
+    {
+        IOT_CompactLeaf(pagebuf);
+    }
+    memmove(&leaf->slots[pos + 1], &leaf->slots[pos], (leaf->numRows - pos) * sizeof(PageSlot));
+    leaf->dataOffset -= len;
+    memcpy(pagebuf + leaf->dataOffset, record, len);
+    leaf->slots[pos].offset = leaf->dataOffset;
+    leaf->slots[pos].length = len;
+    leaf->numRows++;
+}
+
+static void IOT_LeafRemoveAt(byte *pagebuf, int pos)
+{
+    IotLeaf *leaf = (IotLeaf *)pagebuf;
+
+    if (leaf->slots[pos].offset == leaf->dataOffset)
+        leaf->dataOffset += leaf->slots[pos].length; // Borders the free space
+    else
+        leaf->deadBytes += leaf->slots[pos].length;
+    memmove(&leaf->slots[pos], &leaf->slots[pos + 1], (leaf->numRows - pos - 1) * sizeof(PageSlot));
+    leaf->numRows--;
+}
+
+/*
+ Spreads the rows of a full leaf and a new row for position pos over the leaf
+ and an empty page right, which follows it. A row appended past the last one
+ starts the new leaf on its own, so ascending inserts leave full leaves behind.
+ Returns the first key of the new leaf
+ */
+static long long IOT_SplitLeaf(Table *tbl, byte *pagebuf, byte *rightbuf, int rightPage,
+                               int pos, byte *record, int len)
+{
+    char copy[PF_PAGE_SIZE];
+    IotLeaf *old = (IotLeaf *)copy;
+    int n = ((IotLeaf *)pagebuf)->numRows + 1;
+    byte *rows[n];
+    int lens[n];
+    int total = 0, left = 0, split;
+
+    memcpy(copy, pagebuf, PF_PAGE_SIZE);
+    for (int i = 0, from = 0; i < n; i++)
+    {
+        if (i == pos)
+        {
+            rows[i] = record;
+            lens[i] = len;
+        }
+        else
+        {
+            rows[i] = IOT_LeafRow((byte *)copy, from, &lens[i]);
+            from++;
+        }
+        total += lens[i] + sizeof(PageSlot);
+    }
+    if (pos == n - 1)
+    {
+        split = n - 1;
+    }
+    else
+    {
+        for (split = 0; split < n - 1 && left < total / 2; split++)
+            left += lens[split] + sizeof(PageSlot);
+        if (split == 0)
+            split = 1;
+    }
+
+    IOT_InitLeaf(rightbuf, old->nextLeaf);
+    IOT_InitLeaf(pagebuf, rightPage);
+    for (int i = 0; i < split; i++)
+        IOT_LeafInsertAt(pagebuf, i, rows[i], lens[i]);
+    for (int i = split; i < n; i++)
+        IOT_LeafInsertAt(rightbuf, i - split, rows[i], lens[i]);
+    return IOT_RowKey(tbl, rows[split], lens[split]);
+}
+
+/*
+ Adds separator key and the page right after it to the inner nodes of path,
+ bottom up, splitting the full ones, and grows a new root if the root splits
+ */
+static int IOT_InsertIntoParents(Table *tbl, IotPath *path, long long key, int right)
+{
+    char *pagebuf, *newbuf;
+    int newPage, ret_val;
+
+    for (int level = path->depth - 1; level >= 0; level--)
+    {
+        int page = path->pages[level];
+        int child = path->children[level];
+        ret_val = PF_GetThisPage(tbl->file_descriptor, page, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        IotNode *node = (IotNode *)pagebuf;
+        int n = node->numKeys;
+        long long keys[n + 1];
+        int children[n + 2];
+
+        memcpy(keys, node->keys, child * sizeof(long long));
+        keys[child] = key;
+        memcpy(keys + child + 1, node->keys + child, (n - child) * sizeof(long long));
+        memcpy(children, node->children, (child + 1) * sizeof(int));
+        children[child + 1] = right;
+        memcpy(children + child + 2, node->children + child + 1, (n - child) * sizeof(int));
+        if (n < IOT_FANOUT - 1)
+        {
+            node->numKeys = n + 1;
+            memcpy(node->keys, keys, (n + 1) * sizeof(long long));
+            memcpy(node->children, children, (n + 2) * sizeof(int));
+            return PF_UnfixPage(tbl->file_descriptor, page, TRUE);
+        }
+
+        // Split: the middle key moves up, the keys after it go to a new node
+        int mid = (n + 1) / 2;
+        ret_val = PF_AllocPage(tbl->file_descriptor, &newPage, &newbuf);
+        if (ret_val != PFE_OK)
+        {
+            PF_UnfixPage(tbl->file_descriptor, page, FALSE);
+            return ret_val;
+        }
+        IotNode *sibling = (IotNode *)newbuf;
+        sibling->marker = IOT_NODE_MARKER;
+        sibling->numKeys = n - mid;
+        memcpy(sibling->keys, keys + mid + 1, (n - mid) * sizeof(long long));
+        memcpy(sibling->children, children + mid + 1, (n - mid + 1) * sizeof(int));
+        node->numKeys = mid;
+        memcpy(node->keys, keys, mid * sizeof(long long));
+        memcpy(node->children, children, (mid + 1) * sizeof(int));
+        key = keys[mid];
+        right = newPage;
+        PF_UnfixPage(tbl->file_descriptor, newPage, TRUE);
+        ret_val = PF_UnfixPage(tbl->file_descriptor, page, TRUE);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+    }
+
+    // The root split
+    ret_val = PF_AllocPage(tbl->file_descriptor, &newPage, &newbuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    IotNode *root = (IotNode *)newbuf;
+    root->marker = IOT_NODE_MARKER;
+    root->numKeys = 1;
+    root->keys[0] = key;
+    root->children[0] = tbl->rootPage;
+    root->children[1] = right;
+    ret_val = PF_UnfixPage(tbl->file_descriptor, newPage, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    tbl->rootPage = newPage;
+    return IOT_WriteMeta(tbl);
+}
+
+/*
+ Inserts an encoded row in key order. Its record id, returned in rid, is its key.
+ Returns 0, IOTE_DUPLICATEKEY if the key is taken, PFE_NOBUF if the row takes more
+ than IOT_MAX_ROW_SPACE, or a PF error code
+ */
+int IOT_Insert(Table *tbl, byte *record, int len, RecId *rid)
+{
+    IotPath path;
+    char *pagebuf, *rightbuf;
+    int pagenum, rightPage, ret_val;
+    bool found;
+
+    if (len + (int)sizeof(PageSlot) > IOT_MAX_ROW_SPACE)
+    {
+        return PFE_NOBUF;
+    }
+    long long key = IOT_RowKey(tbl, record, len);
+    ret_val = IOT_Descend(tbl, key, &path, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int pos = IOT_LeafSearch(tbl, pagebuf, key, &found);
+    if (found)
+    {
+        PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+        return IOTE_DUPLICATEKEY;
+    }
+    *rid = key;
+    if (IOT_LeafFree((IotLeaf *)pagebuf) >= len + (int)sizeof(PageSlot))
+    {
+        IOT_LeafInsertAt(pagebuf, pos, record, len);
+        return PF_UnfixPage(tbl->file_descriptor, pagenum, TRUE);
+    }
+
+    ret_val = PF_AllocPage(tbl->file_descriptor, &rightPage, &rightbuf);
+    if (ret_val != PFE_OK)
+    {
+        PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+        return ret_val;
+    }
+    long long separator = IOT_SplitLeaf(tbl, pagebuf, rightbuf, rightPage, pos, record, len);
+    PF_UnfixPage(tbl->file_descriptor, rightPage, TRUE);
+    ret_val = PF_UnfixPage(tbl->file_descriptor, pagenum, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    return IOT_InsertIntoParents(tbl, &path, separator, rightPage);
+}
+
+/*
+ Copies the row with key key into record, at most maxlen bytes.
+ Returns the length of the row, or PFE_INVALIDPAGE if there is no such row
+ */
+int IOT_Get(Table *tbl, RecId key, byte *record, int maxlen)
+{
+    char *pagebuf;
+    int pagenum, len;
+    bool found;
+
+    int ret_val = IOT_Descend(tbl, key, NULL, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int pos = IOT_LeafSearch(tbl, pagebuf, key, &found);
+    if (found)
+    {
+        byte *row = IOT_LeafRow(pagebuf, pos, &len);
+        memcpy(record, row, (len < maxlen) ? len : maxlen);
+    }
+    PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+    return found ? len : PFE_INVALIDPAGE;
+}
+
+/*
+ Removes the row with key key.
+ Returns 0, PFE_INVALIDPAGE if there is no such row, or a PF error code
+ */
+int IOT_Delete(Table *tbl, RecId key)
+{
+    char *pagebuf;
+    int pagenum;
+    bool found;
+
+    int ret_val = IOT_Descend(tbl, key, NULL, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int pos = IOT_LeafSearch(tbl, pagebuf, key, &found);
+    if (!found)
+    {
+        PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+        return PFE_INVALIDPAGE;
+    }
+    IOT_LeafRemoveAt(pagebuf, pos);
+    return PF_UnfixPage(tbl->file_descriptor, pagenum, TRUE);
+}
+
+/*
+ Replaces the row with key key by an encoded row, whose key, returned in newKey,
+ may differ: the row then moves to its new place in key order. The old row stays
+ if the new one cannot be stored.
+ Returns 0, PFE_INVALIDPAGE if there is no such row, IOTE_DUPLICATEKEY if the
+ new key belongs to another row, PFE_NOBUF if the row is too long, or a PF error
+ code
+ */
+int IOT_Update(Table *tbl, RecId key, byte *record, int len, RecId *newKey)
+{
+    char *pagebuf;
+    char oldRow[IOT_MAX_ROW_SPACE];
+    int pagenum, oldLen, ret_val;
+    bool found;
+
+    if (len + (int)sizeof(PageSlot) > IOT_MAX_ROW_SPACE)
+    {
+        return PFE_NOBUF;
+    }
+    long long rowKey = IOT_RowKey(tbl, record, len);
+    if (rowKey != key)
+    {
+        oldLen = IOT_Get(tbl, key, (byte *)oldRow, sizeof(oldRow)); // Is there a row to replace?
+        if (oldLen < 0)
+        {
+            return oldLen;
+        }
+        // The row under its new key goes in first, so that a failure leaves the old one
+        ret_val = IOT_Insert(tbl, record, len, newKey);
+        if (ret_val != 0)
+        {
+            return ret_val;
+        }
+        ret_val = IOT_Delete(tbl, key);
+        if (ret_val != PFE_OK)
+        {
+            IOT_Delete(tbl, rowKey);
+        }
+        return ret_val;
+    }
+
+    ret_val = IOT_Descend(tbl, key, NULL, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int pos = IOT_LeafSearch(tbl, pagebuf, key, &found);
+    if (!found)
+    {
+        PF_UnfixPage(tbl->file_descriptor, pagenum, FALSE);
+        return PFE_INVALIDPAGE;
+    }
+    *newKey = key;
+    byte *row = IOT_LeafRow(pagebuf, pos, &oldLen);
+    memcpy(oldRow, row, oldLen);
+    IOT_LeafRemoveAt(pagebuf, pos);
+    if (IOT_LeafFree((IotLeaf *)pagebuf) >= len + (int)sizeof(PageSlot))
+    {
+        IOT_LeafInsertAt(pagebuf, pos, record, len); // In place
+        return PF_UnfixPage(tbl->file_descriptor, pagenum, TRUE);
+    }
+    ret_val = PF_UnfixPage(tbl->file_descriptor, pagenum, TRUE);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ret_val = IOT_Insert(tbl, record, len, newKey); // Splits the leaf
+    if (ret_val != 0)
+    {
+        RecId oldKey;
+        IOT_Insert(tbl, (byte *)oldRow, oldLen, &oldKey); // Fits where it was
+    }
+    return ret_val;
+}
+
+// ---------------------------------------------------------------------------------------
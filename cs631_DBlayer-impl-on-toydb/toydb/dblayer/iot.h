@@ -0,0 +1,94 @@
+#ifndef _IOT_H_
+#define _IOT_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Index-organized tables (TABLE_LAYOUT_IOT, see Table_OpenIndexOrganized): the rows
+// live in the leaves of a B+ tree on an INT or LONG key column, in key order, and
+// there are no heap pages. Keys are unique. A row's record id is its key, so
+// Table_Get is a descent of the tree, a scan to the end of the table walks the
+// leaves in key order (narrowed to the key range its filter allows), and an AM index
+// filled with the record ids Table_Insert returns is a secondary index pointing to
+// the primary key. Every INT or LONG value is a valid key, negative ones included, so
+// such an index is scanned with AM_FindNextRecId, which returns the end of the scan
+// apart from the record id; AM_FindNextEntry could not tell a key of -7 from AME_EOF.
+//
+// Page 0 is an IotMeta page. Inner nodes hold up to IOT_FANOUT children: child i
+// covers the keys in [keys[i-1], keys[i]). Leaves keep their rows packed at the end
+// of the page and a slot per row, in key order, after the header.
+// Rows deleted from a leaf leave it in place, even empty: leaves are never merged.
+
+#define IOT_META_PAGE 0
+#define IOT_LEAF_MARKER (-3) // First short of the pages of an index-organized table
+#define IOT_NODE_MARKER (-4)
+#define IOT_META_MARKER (-5)
+#define IOT_IS_PAGE(pagebuf) (*(short *)(pagebuf) <= IOT_LEAF_MARKER && *(short *)(pagebuf) >= IOT_META_MARKER)
+#define IOT_IS_LEAF(pagebuf) (*(short *)(pagebuf) == IOT_LEAF_MARKER)
+#define IOT_IS_META(pagebuf) (*(short *)(pagebuf) == IOT_META_MARKER)
+
+#define IOTE_DUPLICATEKEY (-40) // Insert or update to a key the table already holds
+#define IOTE_INVALIDKEY   (-41) // Key column missing or not INT or LONG
+
+#define IOT_FANOUT 340
+#define IOT_MAX_HEIGHT 16
+
+typedef struct {
+    short marker;    // IOT_META_MARKER
+    short keyColumn;
+    int rootPage;
+} IotMeta;
+
+typedef struct {
+    short marker;      // IOT_NODE_MARKER
+    short numKeys;     // Children are one more
+    int children[IOT_FANOUT];
+    long long keys[IOT_FANOUT - 1];
+} IotNode;
+
+typedef struct {
+    short marker;      // IOT_LEAF_MARKER
+    short numRows;
+    short dataOffset;  // Start of the row bytes, which grow down from the end of the page
+    short deadBytes;   // Row bytes of removed rows, reclaimed by compacting the leaf
+    int nextLeaf;      // Next leaf in key order, -1 for the last one
+    PageSlot slots[];  // Rows in key order
+} IotLeaf;
+
+// A row and its slot may take a third of a leaf, so that a split always leaves both halves room
+#define IOT_MAX_ROW_SPACE ((PF_PAGE_SIZE - (int)sizeof(IotLeaf)) / 3)
+
+int
+IOT_Create(Table *tbl, int keyColumn);
+
+int
+IOT_Load(Table *tbl, byte *metabuf);
+
+long long
+IOT_RowKey(Table *tbl, byte *record, int len);
+
+int
+IOT_Insert(Table *tbl, byte *record, int len, RecId *rid);
+
+int
+IOT_Get(Table *tbl, RecId key, byte *record, int maxlen);
+
+int
+IOT_Delete(Table *tbl, RecId key);
+
+int
+IOT_Update(Table *tbl, RecId key, byte *record, int len, RecId *newKey);
+
+int
+IOT_FixLeaf(Table *tbl, long long key, int *pagenum, char **pagebuf);
+
+int
+IOT_LeafSearch(Table *tbl, byte *pagebuf, long long key, bool *found);
+
+byte *
+IOT_LeafRow(byte *pagebuf, int pos, int *len);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
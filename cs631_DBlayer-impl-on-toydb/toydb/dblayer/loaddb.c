@@ -7,22 +7,47 @@
 #include "../pflayer/pf.h"
 #include "../amlayer/am.h"
 #include "tbl.h"
+#include "db.h"
 #include "util.h"
+#include "record.h"
+#include "cluster.h"
+#include "idx.h"
+#include "stats.h"
+#include "part.h"
 
 #define checkerr(err)        \
     {                        \
         if (err < 0)         \
         {                    \
-            PF_PrintError(); \
+            printError(err); \
             exit(1);         \
         }                    \
     }
 
-#define MAX_PAGE_SIZE 4000
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Reports error err of a table call with the message of the layer it came from: the
+ AM layer if its last error is err (index inserts and scans), else the PF layer if
+ its last error is; the codes of the two overlap. Other codes are printed as they are
+ */
+static void printError(int err)
+{
+    if (err == AM_Errno)
+        AM_PrintError("loaddb: ");
+    else if (err == PFerrno)
+        PF_PrintError("loaddb");
+    else
+        fprintf(stderr, "loaddb: error %d\n", err);
+}
+// ---------------------------------------------------------------------------------------
+
+#define MAX_RECORD_SIZE (MAX_LINE_LEN + 8 * MAX_TOKENS) // A line's strings plus the largest record header
 
 #define DB_NAME "data.db"
 #define INDEX_NAME "data.db.0"
 #define CSV_NAME "data.csv"
+#define PART_NAME "data.db.parts" // Partitioned copy, see loadPartitions
 
 /*
 Takes a schema, and an array of strings (fields), and uses the functionality
@@ -32,39 +57,36 @@ int encode(Schema *sch, char **fields, byte *record, int spaceLeft)
 {
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    int byteOffset = 0, bytesEncoded = 0, totalBytesEncoded = 0;
-    // for each field
-    for (int i = 0; i < sch->numColumns; i++)
+    // Lays the fields out in the schema's record format (see record.h)
+    return Record_Encode(sch, fields, record, spaceLeft);
+// ---------------------------------------------------------------------------------------
+}
+
+#define POPULATION_COLUMN 2
+#define LOAD_BATCH 256 // Rows passed to Table_InsertBatch at a time
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Inserts the n rows read so far, which the table adds to its population index
+ in key order, prints their record ids and names, and frees them
+ */
+static void flushBatch(Table *tbl, byte **records, int *lens, char **names, int n)
+{
+    RecId rids[LOAD_BATCH];
+    int err = Table_InsertBatch(tbl, records, lens, n, rids);
+    checkerr(err);
+    for (int i = 0; i < n; i++)
     {
-        ColumnDesc *colDesc = sch->columns[i];
-        //    switch corresponding schema type is
-        switch (colDesc->type)
-        {
-        //        VARCHAR : EncodeCString
-        case VARCHAR:
-            bytesEncoded = EncodeCString(fields[i], record + byteOffset, spaceLeft);
-            break;
-        //        INT : EncodeInt
-        case INT:
-            bytesEncoded = EncodeInt(atoi(fields[i]), record + byteOffset);
-            break;
-        //        LONG: EncodeLong
-        case LONG:
-            bytesEncoded = EncodeLong(atoll(fields[i]), record + byteOffset);
-            break;
-        }
-        byteOffset += bytesEncoded;
-        spaceLeft -= bytesEncoded;
-        totalBytesEncoded += bytesEncoded;
+        printf("%lld %s\n", rids[i], names[i]);
+        free(records[i]);
+        free(names[i]);
     }
-
-    // return the total number of bytes encoded into record
-    return totalBytesEncoded;
-// ---------------------------------------------------------------------------------------
 }
+// ---------------------------------------------------------------------------------------
 
 Schema *
-loadCSV()
+loadCSV(int layout, bool cluster)
 {
     int err, indexFD;
     // Open csv file, parse schema
@@ -89,47 +111,145 @@ loadCSV()
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    err = Table_Open(DB_NAME, sch, true, &tbl);
+    Db *db;
+    err = Db_Open(&db);
     checkerr(err);
-    err = AM_CreateIndex(DB_NAME, 0, 'i', 4);
-    indexFD = PF_OpenFile(INDEX_NAME);
+    if (layout == TABLE_LAYOUT_IOT)
+        err = Db_OpenIndexOrganized(db, DB_NAME, sch, POPULATION_COLUMN, true, &tbl);
+    else
+        err = Db_OpenTableLayout(db, DB_NAME, sch, layout, true, &tbl);
+    checkerr(err);
+    Table_SetBulkAppend(tbl, true); // Append rows through a pinned tail page
+    // Index on the population column, kept by the table's inserts; in an
+    // index-organized table the rid is the population itself
+    err = Table_AddIndex(tbl, 0, POPULATION_COLUMN, 'i', 4, true, &indexFD);
+    checkerr(err);
+    byte *records[LOAD_BATCH];
+    int lens[LOAD_BATCH];
+    char *names[LOAD_BATCH];
+    int batched = 0;
 // ---------------------------------------------------------------------------------------
 
     char *tokens[MAX_TOKENS];
-    char record[MAX_PAGE_SIZE];
+    char record[MAX_RECORD_SIZE];
 
     while ((line = fgets(buf, MAX_LINE_LEN, fp)) != NULL)
     {
         int n = split(line, ",", tokens);
         assert(n == sch->numColumns);
         int len = encode(sch, tokens, record, sizeof(record));
-        RecId rid;
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-        err = Table_Insert(tbl, record, len, &rid);
+        records[batched] = (byte *)malloc(len);
+        memcpy(records[batched], record, len);
+        lens[batched] = len;
+        names[batched] = strdup(tokens[0]);
+        if (++batched == LOAD_BATCH)
+        {
+            flushBatch(tbl, records, lens, names, batched);
+            batched = 0;
+        }
 // ---------------------------------------------------------------------------------------
+    }
+    fclose(fp);
+// IMPLEMENTED---------------------------------------------------------------------------------------
+    flushBatch(tbl, records, lens, names, batched);
 
-        printf("%d %s\n", rid, tokens[0]);
-
-        // Indexing on the population column
-        int population = atoi(tokens[2]);
+    // Rewrite the heap in population order, so index range scans read each page once
+    if (cluster)
+    {
+        long long before, after;
+        err = Table_ClusteringFactor(tbl, indexFD, 'i', 4, &before);
+        checkerr(err);
+        err = Db_ClusterTable(db, tbl, indexFD, &after);
+        checkerr(err);
+        fprintf(stderr, "clustering factor %lld -> %lld\n", before, after);
+    }
+    // Column statistics for the catalog, see stats.h
+    err = Table_Analyze(tbl, 0);
+    checkerr(err);
+// ---------------------------------------------------------------------------------------
+    Db_Close(db); // Closes the table and its index
+    return sch;
+}
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-        // Use the population field as the field to index on
-        err = AM_InsertEntry(indexFD, 'i', 4, &population, rid);
-// ---------------------------------------------------------------------------------------
+/*
+ Loads the rows of the csv file again into a table partitioned on the population
+ (see part.h), by range in row pages or by hash in PAX pages, with a local index
+ on the population. "dumpdb r" checks its pruned scans against full ones
+ */
+void loadPartitions(Schema *sch, int method)
+{
+    PartSpec spec = {method, POPULATION_COLUMN, TABLE_LAYOUT_ROW, 4, {1000000, 10000000, 50000000}};
+    PartTable *pt;
+    int err;
 
-        checkerr(err);
+    if (method == PART_HASH)
+        spec.layout = TABLE_LAYOUT_PAX;
+    err = Part_Open(PART_NAME, sch, &spec, true, &pt);
+    checkerr(err);
+    err = Part_CreateIndex(pt, 0, POPULATION_COLUMN);
+    checkerr(err);
+
+    FILE *fp = fopen(CSV_NAME, "r");
+    char buf[MAX_LINE_LEN];
+    char *tokens[MAX_TOKENS];
+    byte *records[LOAD_BATCH];
+    int lens[LOAD_BATCH];
+    int batched = 0;
+    if (fp == NULL || fgets(buf, MAX_LINE_LEN, fp) == NULL) // Past the schema line
+    {
+        perror("data.csv could not be read");
+        exit(EXIT_FAILURE);
+    }
+    while (true)
+    {
+        char *line = fgets(buf, MAX_LINE_LEN, fp);
+        if (line != NULL)
+        {
+            char record[MAX_RECORD_SIZE];
+            split(line, ",", tokens);
+            lens[batched] = encode(sch, tokens, (byte *)record, sizeof(record));
+            records[batched] = (byte *)malloc(lens[batched]);
+            memcpy(records[batched], record, lens[batched]);
+            batched++;
+        }
+        if (batched > 0 && (line == NULL || batched == LOAD_BATCH))
+        {
+            err = Part_Load(pt, records, lens, batched, NULL);
+            checkerr(err);
+            for (int i = 0; i < batched; i++)
+                free(records[i]);
+            batched = 0;
+        }
+        if (line == NULL)
+            break;
     }
     fclose(fp);
-    Table_Close(tbl);
-    err = PF_CloseFile(indexFD);
-    checkerr(err);
-    return sch;
+    Part_Close(pt);
 }
 
-int main()
+// ---------------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
 {
-    loadCSV();
+// IMPLEMENTED---------------------------------------------------------------------------------------
+    // "loaddb pax" stores the table in PAX pages (see pax.h), "loaddb iot"
+    // in the leaves of a B+ tree on the population (see iot.h), "loaddb cluster"
+    // in row pages clustered on the population index (see cluster.h). "loaddb range"
+    // and "loaddb hash" load row pages and a partitioned copy (see loadPartitions)
+    int layout = TABLE_LAYOUT_ROW;
+    bool cluster = (argc == 2 && strcmp(argv[1], "cluster") == 0);
+    if (argc == 2 && strcmp(argv[1], "pax") == 0)
+        layout = TABLE_LAYOUT_PAX;
+    else if (argc == 2 && strcmp(argv[1], "iot") == 0)
+        layout = TABLE_LAYOUT_IOT;
+    Schema *sch = loadCSV(layout, cluster);
+    if (argc == 2 && strcmp(argv[1], "range") == 0)
+        loadPartitions(sch, PART_RANGE);
+    else if (argc == 2 && strcmp(argv[1], "hash") == 0)
+        loadPartitions(sch, PART_HASH);
+// ---------------------------------------------------------------------------------------
 }
@@ -0,0 +1,165 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "ovf.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+#define OVF_NEXT(pagebuf) DecodeInt(pagebuf)
+#define OVF_USED(pagebuf) DecodeShort((pagebuf) + sizeof(int))
+#define OVF_DATA(pagebuf) ((pagebuf) + OVF_PAGE_HEADER_SIZE)
+
+/*
+ Opens the overflow file "<dbname>.ovf" of a table, creating it if it does not exist.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int OVF_Open(Table *tbl, char *dbname, bool overwrite)
+{
+    char ovfName[strlen(dbname) + sizeof(OVF_SUFFIX)];
+    int ret_val;
+
+    sprintf(ovfName, "%s%s", dbname, OVF_SUFFIX);
+    if (overwrite)
+    {
+        PF_DestroyFile(ovfName);
+    }
+    tbl->ovfFD = PF_OpenFile(ovfName);
+    if (tbl->ovfFD >= 0)
+    {
+        return 0;
+    }
+    ret_val = PF_CreateFile(ovfName);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    tbl->ovfFD = PF_OpenFile(ovfName);
+    return (tbl->ovfFD < 0) ? tbl->ovfFD : 0;
+}
+
+void OVF_Close(Table *tbl)
+{
+    if (tbl->ovfFD >= 0)
+    {
+        PF_CloseFile(tbl->ovfFD);
+        tbl->ovfFD = -1;
+    }
+}
+
+/*
+ Disposes the overflow chain starting at pagenum (none if -1), for reuse by later chains.
+ Returns 0 or a negative PF error code
+ */
+static int OVF_FreeChain(Table *tbl, int pagenum)
+{
+    char *pagebuf;
+
+    while (pagenum != -1)
+    {
+        int ret_val = PF_GetThisPage(tbl->ovfFD, pagenum, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        int next = OVF_NEXT(pagebuf);
+        PF_UnfixPage(tbl->ovfFD, pagenum, FALSE);
+        ret_val = PF_DisposePage(tbl->ovfFD, pagenum);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        pagenum = next;
+    }
+    return 0;
+}
+
+/*
+ Writes the bytes of record past its inline prefix to a new chain of overflow
+ pages, and builds the stub to store in the heap (OVF_STUB_SIZE bytes) in stub.
+ Pages are written back to front so that each one is written only once.
+ Returns the stub length, or a negative PF error code
+ */
+int OVF_MakeStub(Table *tbl, byte *record, int len, byte *stub)
+{
+    int rest = len - TABLE_INLINE_PREFIX;
+    int numPages = (rest + OVF_PAGE_DATA_SIZE - 1) / OVF_PAGE_DATA_SIZE;
+    int next = -1, pagenum, ret_val;
+    char *pagebuf;
+
+    for (int i = numPages - 1; i >= 0; i--)
+    {
+        int start = i * OVF_PAGE_DATA_SIZE;
+        int used = (rest - start < OVF_PAGE_DATA_SIZE) ? rest - start : OVF_PAGE_DATA_SIZE;
+
+        ret_val = PF_AllocPage(tbl->ovfFD, &pagenum, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            OVF_FreeChain(tbl, next); // Drop the part of the chain already written
+            return ret_val;
+        }
+        EncodeInt(next, pagebuf);
+        EncodeShort((short)used, pagebuf + sizeof(int));
+        memcpy(OVF_DATA(pagebuf), record + TABLE_INLINE_PREFIX + start, used);
+        ret_val = PF_UnfixPage(tbl->ovfFD, pagenum, TRUE);
+        if (ret_val != PFE_OK)
+        {
+            PF_DisposePage(tbl->ovfFD, pagenum);
+            OVF_FreeChain(tbl, next);
+            return ret_val;
+        }
+        next = pagenum;
+    }
+
+    EncodeInt(len, stub);
+    EncodeInt(next, stub + sizeof(int));
+    memcpy(OVF_STUB_PREFIX(stub), record, TABLE_INLINE_PREFIX);
+    return OVF_STUB_SIZE;
+}
+
+/*
+ Reassembles the record of a stub: its inline prefix and its chain, at most maxlen bytes.
+ Returns the full length of the record, or a negative PF error code
+ */
+int OVF_Read(Table *tbl, byte *stub, byte *record, int maxlen)
+{
+    int len = OVF_STUB_LENGTH(stub);
+    int pagenum = OVF_STUB_FIRSTPAGE(stub);
+    int copied = (maxlen < TABLE_INLINE_PREFIX) ? maxlen : TABLE_INLINE_PREFIX;
+    char *pagebuf;
+
+    memcpy(record, OVF_STUB_PREFIX(stub), copied);
+    while (copied < maxlen && copied < len && pagenum != -1)
+    {
+        int ret_val = PF_GetThisPage(tbl->ovfFD, pagenum, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        int used = OVF_USED(pagebuf);
+        if (used > maxlen - copied)
+        {
+            used = maxlen - copied;
+        }
+        memcpy(record + copied, OVF_DATA(pagebuf), used);
+        copied += used;
+        int next = OVF_NEXT(pagebuf);
+        PF_UnfixPage(tbl->ovfFD, pagenum, FALSE);
+        pagenum = next;
+    }
+    return len;
+}
+
+/*
+ Disposes the overflow chain of a stub, for reuse by later chains.
+ Returns 0 or a negative PF error code
+ */
+int OVF_Free(Table *tbl, byte *stub)
+{
+    return OVF_FreeChain(tbl, OVF_STUB_FIRSTPAGE(stub));
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,47 @@
+#ifndef _OVF_H_
+#define _OVF_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Overflow storage: records longer than TABLE_OVERFLOW_THRESHOLD keep only a stub
+// in the heap page, the rest of their bytes goes to a chain of pages in the
+// separate paged file "<table>.ovf", so that the heap stays dense for scans.
+//
+// Stub, flagged SLOT_OVERFLOW in its slot:
+//   [int total record length][int first chain page][first TABLE_INLINE_PREFIX bytes of the record]
+// Chain page: [int next page or -1][short bytes used][data]
+
+#define OVF_SUFFIX ".ovf"
+#define TABLE_OVERFLOW_THRESHOLD (PF_PAGE_SIZE / 4) // Longer records go out of line
+#define TABLE_INLINE_PREFIX      256                // Record bytes kept in the stub
+
+#define OVF_STUB_HEADER_SIZE (2 * (int)sizeof(int))
+#define OVF_STUB_SIZE (OVF_STUB_HEADER_SIZE + TABLE_INLINE_PREFIX)
+#define OVF_PAGE_HEADER_SIZE ((int)(sizeof(int) + sizeof(short)))
+#define OVF_PAGE_DATA_SIZE (PF_PAGE_SIZE - OVF_PAGE_HEADER_SIZE)
+
+// Fields of a stub
+#define OVF_STUB_LENGTH(stub)     DecodeInt(stub)
+#define OVF_STUB_FIRSTPAGE(stub)  DecodeInt((stub) + sizeof(int))
+#define OVF_STUB_PREFIX(stub)     ((stub) + OVF_STUB_HEADER_SIZE)
+
+int
+OVF_Open(Table *tbl, char *dbname, bool overwrite);
+
+void
+OVF_Close(Table *tbl);
+
+int
+OVF_MakeStub(Table *tbl, byte *record, int len, byte *stub);
+
+int
+OVF_Read(Table *tbl, byte *stub, byte *record, int maxlen);
+
+int
+OVF_Free(Table *tbl, byte *stub);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
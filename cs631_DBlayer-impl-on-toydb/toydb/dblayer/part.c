@@ -0,0 +1,735 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "tbl.h"
+#include "db.h"
+#include "part.h"
+#include "pred.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Page 0 of "<name>.part"
+typedef struct {
+    int magic;
+    PartSpec spec;
+    int numIndexes;
+    int indexNos[PART_MAX_INDEXES];
+    int indexColumns[PART_MAX_INDEXES];
+} PartHeader;
+
+// The AM layer keeps its state in globals: loader threads add index entries one at a time
+static pthread_mutex_t partIndexLatch = PTHREAD_MUTEX_INITIALIZER;
+
+#define PART_NAME_SIZE(name) (strlen(name) + 16) // "<name>.p<i>.<indexNo>" or "<name>.part"
+
+/*
+ Reads the definition of partitioned table name
+ Returns PFE_OK, PARTE_INVALID if the file holds none, or a PF error code
+ */
+static int Part_ReadHeader(char *name, PartHeader *header)
+{
+    char descName[PART_NAME_SIZE(name)];
+    char *pagebuf;
+
+    sprintf(descName, "%s%s", name, PART_SUFFIX);
+    int fd = PF_OpenFile(descName);
+    if (fd < 0)
+    {
+        return fd;
+    }
+    int ret_val = PF_GetThisPage(fd, 0, &pagebuf);
+    if (ret_val == PFE_OK)
+    {
+        memcpy(header, pagebuf, sizeof(PartHeader));
+        PF_UnfixPage(fd, 0, FALSE);
+        if (header->magic != PART_MAGIC)
+            ret_val = PARTE_INVALID;
+    }
+    PF_CloseFile(fd);
+    return ret_val;
+}
+
+/*
+ Records the definition and the local indexes of a partitioned table
+ */
+static int Part_WriteHeader(PartTable *pt)
+{
+    char descName[PART_NAME_SIZE(pt->name)];
+    char *pagebuf;
+    int pagenum, ret_val;
+    PartHeader header = {PART_MAGIC, pt->spec, pt->numIndexes, {0}, {0}};
+
+    for (int k = 0; k < pt->numIndexes; k++)
+    {
+        header.indexNos[k] = pt->indexes[k].indexNo;
+        header.indexColumns[k] = pt->indexes[k].column;
+    }
+    sprintf(descName, "%s%s", pt->name, PART_SUFFIX);
+    int fd = PF_OpenFile(descName);
+    if (fd < 0)
+    {
+        ret_val = PF_CreateFile(descName);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        fd = PF_OpenFile(descName);
+        if (fd < 0)
+        {
+            return fd;
+        }
+        ret_val = PF_AllocPage(fd, &pagenum, &pagebuf);
+    }
+    else
+    {
+        ret_val = PF_GetThisPage(fd, 0, &pagebuf);
+    }
+    if (ret_val == PFE_OK)
+    {
+        memset(pagebuf, 0, PF_PAGE_SIZE);
+        memcpy(pagebuf, &header, sizeof(PartHeader));
+        ret_val = PF_UnfixPage(fd, 0, TRUE);
+    }
+    PF_CloseFile(fd);
+    return ret_val;
+}
+
+static bool Part_ValidSpec(Schema *schema, PartSpec *spec)
+{
+    if (schema == NULL || spec->numPartitions < 1 || spec->numPartitions > PART_MAX_PARTITIONS
+            || spec->column < 0 || spec->column >= schema->numColumns
+            || schema->columns[spec->column]->type == VARCHAR
+            || (spec->method != PART_RANGE && spec->method != PART_HASH)
+            || (spec->layout != TABLE_LAYOUT_ROW && spec->layout != TABLE_LAYOUT_PAX))
+    {
+        return false;
+    }
+    for (int i = 1; spec->method == PART_RANGE && i < spec->numPartitions - 1; i++)
+    {
+        if (spec->bounds[i] <= spec->bounds[i - 1])
+            return false;
+    }
+    return true;
+}
+
+/*
+ Opens the partitioned table name, creating it with spec if it does not exist (or
+ if overwrite is set, which empties the partitions). An existing table keeps its
+ definition, and spec may then be NULL. Every partition and local index is opened.
+ Returns 0, PARTE_INVALID for an invalid spec or schema, or a PF error code
+ */
+int Part_Open(char *name, Schema *schema, PartSpec *spec, bool overwrite, PartTable **ppt)
+{
+    char partName[PART_NAME_SIZE(name)];
+    PartHeader header;
+    int ret_val = 0;
+
+    Db_InitPF();
+    bool exists = !overwrite && Part_ReadHeader(name, &header) == PFE_OK;
+    if (!exists)
+    {
+        if (spec == NULL)
+        {
+            return PARTE_INVALID;
+        }
+        memset(&header, 0, sizeof(header));
+        header.magic = PART_MAGIC;
+        header.spec = *spec;
+    }
+    if (!Part_ValidSpec(schema, &header.spec))
+    {
+        return PARTE_INVALID;
+    }
+
+    PartTable *pt = (PartTable *)calloc(1, sizeof(PartTable));
+    if (pt == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    pt->name = strdup(name);
+    pt->schema = schema;
+    pt->spec = header.spec;
+    for (int p = 0; p < pt->spec.numPartitions && ret_val == 0; p++)
+    {
+        sprintf(partName, "%s.p%d", name, p);
+        ret_val = Table_OpenLayout(partName, schema, pt->spec.layout, !exists, &pt->partitions[p]);
+    }
+    for (int k = 0; k < header.numIndexes && ret_val == 0; k++)
+    {
+        PartIndex *index = &pt->indexes[pt->numIndexes++];
+        index->indexNo = header.indexNos[k];
+        index->column = header.indexColumns[k];
+        for (int p = 0; p < PART_MAX_PARTITIONS; p++)
+            index->fds[p] = -1;
+        for (int p = 0; p < pt->spec.numPartitions && ret_val == 0; p++)
+        {
+            sprintf(partName, "%s.p%d.%d", name, p, index->indexNo);
+            index->fds[p] = PF_OpenFile(partName);
+            if (index->fds[p] < 0)
+                ret_val = index->fds[p];
+        }
+    }
+    if (ret_val == 0 && !exists)
+    {
+        ret_val = Part_WriteHeader(pt);
+    }
+    if (ret_val != 0)
+    {
+        Part_Close(pt);
+        return ret_val;
+    }
+    *ppt = pt;
+    return 0;
+}
+
+void Part_Close(PartTable *pt)
+{
+    if (pt == NULL)
+    {
+        return;
+    }
+    for (int k = 0; k < pt->numIndexes; k++)
+    {
+        for (int p = 0; p < pt->spec.numPartitions; p++)
+        {
+            if (pt->indexes[k].fds[p] >= 0)
+                PF_CloseFile(pt->indexes[k].fds[p]);
+        }
+    }
+    for (int p = 0; p < pt->spec.numPartitions; p++)
+    {
+        if (pt->partitions[p] != NULL)
+            Table_Close(pt->partitions[p]);
+    }
+    free(pt->name);
+    free(pt);
+}
+
+// Value of an INT or LONG column of an encoded row
+static long long Part_Key(PartTable *pt, int column, byte *record, int len)
+{
+    int fieldLen;
+    byte *field = Record_FieldOrDefault(pt->schema, record, len, column, &fieldLen);
+    return (pt->schema->columns[column]->type == INT) ? DecodeInt(field) : DecodeLong(field);
+}
+
+/*
+ Returns the partition of a value of the partitioning column
+ */
+static int Part_ForKey(PartSpec *spec, long long key)
+{
+    if (spec->method == PART_HASH)
+    {
+        unsigned long long hash = (unsigned long long)key; // splitmix64 finalizer
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        hash ^= hash >> 31;
+        return (int)(hash % spec->numPartitions);
+    }
+    int p = 0;
+    while (p < spec->numPartitions - 1 && key >= spec->bounds[p])
+        p++;
+    return p;
+}
+
+static int Part_ForRow(PartTable *pt, byte *record, int len)
+{
+    return Part_ForKey(&pt->spec, Part_Key(pt, pt->spec.column, record, len));
+}
+
+/*
+ Adds (or removes) the entries of a row of partition p to (from) the local indexes
+ */
+static int Part_IndexRow(PartTable *pt, int p, byte *record, int len, RecId localRid, bool insert)
+{
+    int ret_val = 0;
+
+    pthread_mutex_lock(&partIndexLatch);
+    for (int k = 0; k < pt->numIndexes && ret_val == 0; k++)
+    {
+        int value = (int)Part_Key(pt, pt->indexes[k].column, record, len);
+        if (insert)
+            ret_val = AM_InsertEntry(pt->indexes[k].fds[p], 'i', 4, (char *)&value, localRid);
+        else
+            ret_val = AM_DeleteEntry(pt->indexes[k].fds[p], 'i', 4, (char *)&value, localRid);
+    }
+    pthread_mutex_unlock(&partIndexLatch);
+    return ret_val;
+}
+
+/*
+ Gets a whole row of a partition into *buf, growing it as needed
+ Returns the length of the row, or PFE_INVALIDPAGE if there is no such row
+ */
+static int Part_GetWhole(Table *tbl, RecId localRid, byte **buf, int *bufSize)
+{
+    int len = Table_Get(tbl, localRid, *buf, *bufSize);
+    if (len > *bufSize)
+    {
+        byte *grown = (byte *)realloc(*buf, len);
+        if (grown == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        *buf = grown;
+        *bufSize = len;
+        len = Table_Get(tbl, localRid, *buf, *bufSize);
+    }
+    return (len > 0) ? len : PFE_INVALIDPAGE;
+}
+
+/*
+ Creates local index indexNo on INT column in every partition and fills it with
+ the rows already there
+ Returns 0, PARTE_INVALID for an invalid column or a used index number, or an AM or PF error code
+ */
+int Part_CreateIndex(PartTable *pt, int indexNo, int column)
+{
+    char partName[PART_NAME_SIZE(pt->name)];
+    int ret_val = 0;
+
+    if (pt->numIndexes == PART_MAX_INDEXES || column < 0 || column >= pt->schema->numColumns
+            || pt->schema->columns[column]->type != INT)
+    {
+        return PARTE_INVALID;
+    }
+    for (int k = 0; k < pt->numIndexes; k++)
+    {
+        if (pt->indexes[k].indexNo == indexNo)
+            return PARTE_INVALID;
+    }
+    PartIndex *index = &pt->indexes[pt->numIndexes];
+    index->indexNo = indexNo;
+    index->column = column;
+    for (int p = 0; p < PART_MAX_PARTITIONS; p++)
+        index->fds[p] = -1;
+
+    for (int p = 0; p < pt->spec.numPartitions && ret_val == 0; p++)
+    {
+        TableScan *scan;
+        RecId rid;
+        byte *record;
+        int len;
+
+        sprintf(partName, "%s.p%d", pt->name, p);
+        AM_DestroyIndex(partName, indexNo); // Fails harmlessly if there is none
+        ret_val = AM_CreateIndex(partName, indexNo, 'i', 4);
+        if (ret_val != AME_OK)
+            break;
+        sprintf(partName, "%s.p%d.%d", pt->name, p, indexNo);
+        index->fds[p] = PF_OpenFile(partName);
+        if (index->fds[p] < 0)
+        {
+            ret_val = index->fds[p];
+            break;
+        }
+        ret_val = Table_OpenScan(pt->partitions[p], -1, -1, &scan);
+        if (ret_val != 0)
+            break;
+        while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+        {
+            int value = (int)Part_Key(pt, column, record, len);
+            ret_val = AM_InsertEntry(index->fds[p], 'i', 4, (char *)&value, rid);
+            if (ret_val != AME_OK)
+                break;
+        }
+        Table_CloseScan(scan);
+        if (ret_val == PFE_EOF)
+            ret_val = 0;
+    }
+    if (ret_val != 0)
+    {
+        for (int p = 0; p < pt->spec.numPartitions; p++)
+        {
+            if (index->fds[p] >= 0)
+                PF_CloseFile(index->fds[p]);
+        }
+        return ret_val;
+    }
+    pt->numIndexes++;
+    return Part_WriteHeader(pt);
+}
+
+/*
+ Inserts an encoded row into its partition and the local indexes
+ Returns 0 or an error code, see Table_Insert
+ */
+int Part_Insert(PartTable *pt, byte *record, int len, RecId *rid)
+{
+    int p = Part_ForRow(pt, record, len);
+    RecId localRid;
+
+    int ret_val = Table_Insert(pt->partitions[p], record, len, &localRid);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    *rid = PART_RID(p, localRid);
+    return Part_IndexRow(pt, p, record, len, localRid, true);
+}
+
+// Rows of a Part_Load bound for one partition
+typedef struct {
+    PartTable *pt;
+    int part;
+    byte **records;
+    int *lens;
+    int *rows;   // Positions in records
+    int numRows;
+    RecId *rids; // Of all the records, NULL if not wanted
+    int error;
+} PartLoader;
+
+static void *Part_LoadWorker(void *arg)
+{
+    PartLoader *loader = (PartLoader *)arg;
+    Table *tbl = loader->pt->partitions[loader->part];
+    bool wasBulk = tbl->bulkAppend;
+    RecId localRid;
+
+    Table_SetBulkAppend(tbl, true);
+    for (int k = 0; k < loader->numRows && loader->error == 0; k++)
+    {
+        int i = loader->rows[k];
+        loader->error = Table_Insert(tbl, loader->records[i], loader->lens[i], &localRid);
+        if (loader->error == 0)
+            loader->error = Part_IndexRow(loader->pt, loader->part, loader->records[i], loader->lens[i], localRid, true);
+        if (loader->error == 0 && loader->rids != NULL)
+            loader->rids[i] = PART_RID(loader->part, localRid);
+    }
+    Table_SetBulkAppend(tbl, wasBulk);
+    return NULL;
+}
+
+/*
+ Inserts n encoded rows, each partition's share by a thread of its own appending
+ to the partition's tail. The record ids are returned in rids, if not NULL.
+ Returns 0 or the first error of a partition, whose rows may then be partly loaded
+ */
+int Part_Load(PartTable *pt, byte **records, int *lens, int n, RecId *rids)
+{
+    int numPartitions = pt->spec.numPartitions;
+    int counts[PART_MAX_PARTITIONS] = {0}, starts[PART_MAX_PARTITIONS];
+    PartLoader loaders[PART_MAX_PARTITIONS];
+    pthread_t threads[PART_MAX_PARTITIONS];
+    bool started[PART_MAX_PARTITIONS];
+    int *parts = (int *)malloc(n * sizeof(int));
+    int *order = (int *)malloc(n * sizeof(int));
+    int ret_val = 0;
+
+    if (n > 0 && (parts == NULL || order == NULL))
+    {
+        free(parts);
+        free(order);
+        return PFE_NOMEM;
+    }
+    // Group the rows by partition, keeping their order
+    for (int i = 0; i < n; i++)
+    {
+        parts[i] = Part_ForRow(pt, records[i], lens[i]);
+        counts[parts[i]]++;
+    }
+    for (int p = 0, start = 0; p < numPartitions; p++)
+    {
+        starts[p] = start;
+        start += counts[p];
+    }
+    for (int p = 0; p < numPartitions; p++)
+    {
+        loaders[p] = (PartLoader){pt, p, records, lens, order + starts[p], 0, rids, 0};
+    }
+    for (int i = 0; i < n; i++)
+    {
+        PartLoader *loader = &loaders[parts[i]];
+        loader->rows[loader->numRows++] = i;
+    }
+
+    for (int p = 0; p < numPartitions; p++)
+    {
+        started[p] = (counts[p] > 0 && pthread_create(&threads[p], NULL, Part_LoadWorker, &loaders[p]) == 0);
+        if (counts[p] > 0 && !started[p])
+            Part_LoadWorker(&loaders[p]); // No thread to spare, load it here
+    }
+    for (int p = 0; p < numPartitions; p++)
+    {
+        if (started[p])
+            pthread_join(threads[p], NULL);
+        if (ret_val == 0)
+            ret_val = loaders[p].error;
+    }
+    free(parts);
+    free(order);
+    return ret_val;
+}
+
+/*
+ Copies the row rid into record, at most maxlen bytes.
+ Returns the length of the row, PFE_INVALIDPAGE if there is no such row, or
+ PARTE_INVALID if rid names no partition
+ */
+int Part_Get(PartTable *pt, RecId rid, byte *record, int maxlen)
+{
+    int p = PART_RID_PARTITION(rid);
+    if (p < 0 || p >= pt->spec.numPartitions)
+    {
+        return PARTE_INVALID;
+    }
+    return Table_Get(pt->partitions[p], PART_RID_LOCAL(rid), record, maxlen);
+}
+
+/*
+ Deletes the row rid and its local index entries
+ Returns 0, PFE_INVALIDPAGE if there is no such row, PARTE_INVALID, or an AM or PF error code
+ */
+int Part_Delete(PartTable *pt, RecId rid)
+{
+    int p = PART_RID_PARTITION(rid), bufSize = PF_PAGE_SIZE;
+    RecId localRid = PART_RID_LOCAL(rid);
+
+    if (p < 0 || p >= pt->spec.numPartitions)
+    {
+        return PARTE_INVALID;
+    }
+    byte *row = (byte *)malloc(bufSize);
+    if (row == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    int ret_val = Part_GetWhole(pt->partitions[p], localRid, &row, &bufSize);
+    if (ret_val >= 0)
+    {
+        ret_val = Part_IndexRow(pt, p, row, ret_val, localRid, false);
+        if (ret_val == 0)
+            ret_val = Table_Delete(pt->partitions[p], localRid);
+    }
+    free(row);
+    return ret_val;
+}
+
+/*
+ Replaces the row rid by an encoded row, which moves to another partition if its
+ value of the partitioning column calls for it. Its record id is returned in newRid.
+ Returns 0 or an error code, see Part_Delete and Part_Insert
+ */
+int Part_Update(PartTable *pt, RecId rid, byte *record, int len, RecId *newRid)
+{
+    int p = PART_RID_PARTITION(rid), bufSize = PF_PAGE_SIZE;
+    RecId localRid = PART_RID_LOCAL(rid), newLocalRid;
+
+    if (p < 0 || p >= pt->spec.numPartitions)
+    {
+        return PARTE_INVALID;
+    }
+    if (Part_ForRow(pt, record, len) != p)
+    {
+        int ret_val = Part_Delete(pt, rid);
+        return (ret_val != 0) ? ret_val : Part_Insert(pt, record, len, newRid);
+    }
+    byte *old = (byte *)malloc(bufSize);
+    if (old == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    int oldLen = Part_GetWhole(pt->partitions[p], localRid, &old, &bufSize);
+    int ret_val = (oldLen >= 0) ? Table_Update(pt->partitions[p], localRid, record, len, &newLocalRid) : oldLen;
+    if (ret_val == 0)
+    {
+        *newRid = PART_RID(p, newLocalRid);
+        ret_val = Part_IndexRow(pt, p, old, oldLen, localRid, false);
+        if (ret_val == 0)
+            ret_val = Part_IndexRow(pt, p, record, len, newLocalRid, true);
+    }
+    free(old);
+    return ret_val;
+}
+
+/*
+ Sets keep[p] for the partitions p that may hold rows satisfying filter (NULL for
+ all), from its predicates on the partitioning column.
+ Returns the number of partitions kept
+ */
+int Part_Prune(PartTable *pt, PredicateList *filter, bool *keep)
+{
+    PartSpec *spec = &pt->spec;
+    long long low = LLONG_MIN, high = LLONG_MAX;
+    int kept = 0;
+
+    Pred_Range(filter, spec->column, &low, &high);
+    for (int p = 0; p < spec->numPartitions; p++)
+    {
+        if (low > high)
+        {
+            keep[p] = false;
+        }
+        else if (spec->method == PART_HASH)
+        {
+            keep[p] = (low != high || Part_ForKey(spec, low) == p); // Only equality finds the partition
+        }
+        else
+        {
+            long long first = (p == 0) ? LLONG_MIN : spec->bounds[p - 1];
+            long long last = (p == spec->numPartitions - 1) ? LLONG_MAX : spec->bounds[p] - 1;
+            keep[p] = (low <= last && high >= first);
+        }
+        kept += keep[p];
+    }
+    return kept;
+}
+
+/*
+ Calls callbackfn on the rows of partition p satisfying filter
+ */
+static int Part_ScanPartition(PartTable *pt, int p, PredicateList *filter, void *callbackObj, ReadFunc callbackfn)
+{
+    TableScan *scan;
+    RecId rid;
+    byte *record;
+    int len;
+
+    int ret_val = Table_OpenScan(pt->partitions[p], -1, -1, &scan);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    Table_SetScanFilter(scan, filter);
+    while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+    {
+        callbackfn(callbackObj, PART_RID(p, rid), record, len);
+    }
+    Table_CloseScan(scan);
+    return (ret_val == PFE_EOF) ? 0 : ret_val;
+}
+
+/*
+ Like Table_ScanWhere, over the partitions that Part_Prune keeps, one after the other
+ Returns 0 or the error code of a partition's scan
+ */
+int Part_ScanWhere(PartTable *pt, PredicateList *filter, void *callbackObj, ReadFunc callbackfn)
+{
+    bool keep[PART_MAX_PARTITIONS];
+    int ret_val = 0;
+
+    Part_Prune(pt, filter, keep);
+    for (int p = 0; p < pt->spec.numPartitions && ret_val == 0; p++)
+    {
+        if (keep[p])
+            ret_val = Part_ScanPartition(pt, p, filter, callbackObj, callbackfn);
+    }
+    return ret_val;
+}
+
+// One thread of Part_ParallelScan
+typedef struct {
+    PartTable *pt;
+    int part;
+    PredicateList *filter;
+    void *callbackObj;
+    ReadFunc callbackfn;
+    int error;
+} PartScanner;
+
+static void *Part_ScanWorker(void *arg)
+{
+    PartScanner *scanner = (PartScanner *)arg;
+    scanner->error = Part_ScanPartition(scanner->pt, scanner->part, scanner->filter,
+                                        scanner->callbackObj, scanner->callbackfn);
+    return NULL;
+}
+
+/*
+ Like Part_ScanWhere, scanning each partition kept in a thread of its own, which
+ calls callbackfn with callbackObjs[p] for partition p
+ Returns 0 or the first error code of a partition's scan
+ */
+int Part_ParallelScan(PartTable *pt, PredicateList *filter, void **callbackObjs, ReadFunc callbackfn)
+{
+    bool keep[PART_MAX_PARTITIONS], started[PART_MAX_PARTITIONS];
+    PartScanner scanners[PART_MAX_PARTITIONS];
+    pthread_t threads[PART_MAX_PARTITIONS];
+    int ret_val = 0;
+
+    Part_Prune(pt, filter, keep);
+    for (int p = 0; p < pt->spec.numPartitions; p++)
+    {
+        scanners[p] = (PartScanner){pt, p, filter, callbackObjs[p], callbackfn, 0};
+        started[p] = (keep[p] && pthread_create(&threads[p], NULL, Part_ScanWorker, &scanners[p]) == 0);
+        if (keep[p] && !started[p])
+            Part_ScanWorker(&scanners[p]);
+    }
+    for (int p = 0; p < pt->spec.numPartitions; p++)
+    {
+        if (started[p])
+            pthread_join(threads[p], NULL);
+        if (ret_val == 0)
+            ret_val = scanners[p].error;
+    }
+    return ret_val;
+}
+
+/*
+ Calls callbackfn on the rows whose value in the column of local index indexNo
+ satisfies "op value" (op as for AM_OpenIndexScan), partition by partition.
+ Partitions are pruned if the index is on the partitioning column.
+ Returns 0, PARTE_INVALID if there is no such index, or an AM or PF error code
+ */
+int Part_IndexScan(PartTable *pt, int indexNo, int op, int value, void *callbackObj, ReadFunc callbackfn)
+{
+    bool keep[PART_MAX_PARTITIONS];
+    PartIndex *index = NULL;
+    int bufSize = PF_PAGE_SIZE, ret_val = 0;
+
+    for (int k = 0; k < pt->numIndexes; k++)
+    {
+        if (pt->indexes[k].indexNo == indexNo)
+            index = &pt->indexes[k];
+    }
+    if (index == NULL)
+    {
+        return PARTE_INVALID;
+    }
+    PredicateList *filter = Pred_Create(pt->schema);
+    byte *row = (byte *)malloc(bufSize);
+    if (filter == NULL || row == NULL)
+    {
+        Pred_Free(filter);
+        free(row);
+        return PFE_NOMEM;
+    }
+    Pred_AddInt(filter, index->column, op, value);
+    Part_Prune(pt, (index->column == pt->spec.column) ? filter : NULL, keep);
+    Pred_Free(filter);
+
+    for (int p = 0; p < pt->spec.numPartitions && ret_val == 0; p++)
+    {
+        RecId localRid;
+        int status;
+        if (!keep[p])
+            continue;
+        int scanDesc = AM_OpenIndexScan(index->fds[p], 'i', 4, op, (char *)&value);
+        if (scanDesc < 0)
+        {
+            ret_val = scanDesc;
+            break;
+        }
+        while ((status = AM_FindNextRecId(scanDesc, &localRid)) == AME_OK)
+        {
+            int len = Part_GetWhole(pt->partitions[p], localRid, &row, &bufSize);
+            if (len > 0)
+                callbackfn(callbackObj, PART_RID(p, localRid), row, len);
+        }
+        AM_CloseIndexScan(scanDesc);
+        if (status != AME_EOF)
+            ret_val = status;
+    }
+    free(row);
+    return ret_val;
+}
+
+// ---------------------------------------------------------------------------------------
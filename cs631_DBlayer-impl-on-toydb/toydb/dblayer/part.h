@@ -0,0 +1,97 @@
+#ifndef _PART_H_
+#define _PART_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Partitioned tables: one logical table over up to PART_MAX_PARTITIONS row or PAX
+// tables, its partitions, in files "<name>.p<i>". A row goes to the partition its
+// value of an INT or LONG column, the partitioning column, falls in by range or by
+// hash. Scans skip the partitions that the filter's predicates on that column rule
+// out, and loads and parallel scans work on the partitions with a thread each.
+//
+// A local index is an AM index ('i', 4) on an INT column in every partition, file
+// "<name>.p<i>.<indexNo>", holding the local record ids of the partition's rows.
+// Part_Insert, Part_Load, Part_Delete and Part_Update keep the local indexes current.
+//
+// The definition and the local indexes are recorded in page 0 of "<name>.part".
+// The record ids of a partitioned table carry the partition in their top byte.
+
+#define PART_SUFFIX ".part"
+#define PART_MAGIC 0x54524150 // "PART"
+#define PART_MAX_PARTITIONS 8
+#define PART_MAX_INDEXES 2     // 8 partitions of 4 files and 2 indexes take 48 of the PF files
+#define PART_RANGE 0
+#define PART_HASH  1
+
+#define PARTE_INVALID (-43) // Invalid partitioning, index column or partition
+
+#define PART_RID(part, rid) ((RecId)(part) << 56 | (rid))
+#define PART_RID_PARTITION(rid) ((int)((rid) >> 56))
+#define PART_RID_LOCAL(rid) ((rid) & (((RecId)1 << 56) - 1))
+
+typedef struct {
+    int method;        // PART_RANGE or PART_HASH
+    int column;        // Partitioning column, INT or LONG
+    int layout;        // TABLE_LAYOUT_ROW or TABLE_LAYOUT_PAX, for every partition
+    int numPartitions;
+    long long bounds[PART_MAX_PARTITIONS - 1]; // PART_RANGE: partition i holds [bounds[i-1], bounds[i]), ascending
+} PartSpec;
+
+typedef struct {
+    int indexNo;
+    int column;                   // INT column
+    int fds[PART_MAX_PARTITIONS]; // Index of each partition
+} PartIndex;
+
+typedef struct {
+    char *name;
+    Schema *schema;
+    PartSpec spec;
+    Table *partitions[PART_MAX_PARTITIONS];
+    int numIndexes;
+    PartIndex indexes[PART_MAX_INDEXES];
+} PartTable;
+
+struct PredicateList; // see pred.h
+
+int
+Part_Open(char *name, Schema *schema, PartSpec *spec, bool overwrite, PartTable **ppt);
+
+void
+Part_Close(PartTable *pt);
+
+int
+Part_CreateIndex(PartTable *pt, int indexNo, int column);
+
+int
+Part_Insert(PartTable *pt, byte *record, int len, RecId *rid);
+
+int
+Part_Load(PartTable *pt, byte **records, int *lens, int n, RecId *rids);
+
+int
+Part_Get(PartTable *pt, RecId rid, byte *record, int maxlen);
+
+int
+Part_Delete(PartTable *pt, RecId rid);
+
+int
+Part_Update(PartTable *pt, RecId rid, byte *record, int len, RecId *newRid);
+
+int
+Part_Prune(PartTable *pt, struct PredicateList *filter, bool *keep);
+
+int
+Part_ScanWhere(PartTable *pt, struct PredicateList *filter, void *callbackObj, ReadFunc callbackfn);
+
+int
+Part_ParallelScan(PartTable *pt, struct PredicateList *filter, void **callbackObjs, ReadFunc callbackfn);
+
+int
+Part_IndexScan(PartTable *pt, int indexNo, int op, int value, void *callbackObj, ReadFunc callbackfn);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
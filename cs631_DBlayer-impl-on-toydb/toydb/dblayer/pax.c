@@ -0,0 +1,547 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "pax.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Bytes per row in the minipage of a column
+static int Pax_EntrySize(ColumnDesc *colDesc)
+{
+    switch (colDesc->type)
+    {
+    case INT:
+        return 4;
+    case LONG:
+        return 8;
+    default:
+        return PAX_VAR_ENTRY_SIZE;
+    }
+}
+
+// Heap entry of row in the minipage of a VARCHAR column
+static byte *Pax_VarEntry(PaxHeader *header, int column, int row)
+{
+    return (byte *)header + header->minipages[column] + row * PAX_VAR_ENTRY_SIZE;
+}
+
+// Entry i of the dictionary, and its fields past the heap entry it starts with
+static byte *Pax_DictEntry(PaxHeader *header, int i)
+{
+    return PAX_DICT(header) + i * PAX_DICT_ENTRY_SIZE;
+}
+#define PAX_DICT_REFS(entry)   ((entry) + 2 * sizeof(short))
+#define PAX_DICT_COLUMN(entry) ((entry) + 3 * sizeof(short))
+
+// Orders a dictionary entry against value of column: by column, length, then bytes
+static int Pax_DictCompare(PaxHeader *header, byte *entry, int column, byte *value, int len)
+{
+    int entryColumn = DecodeShort(PAX_DICT_COLUMN(entry));
+    int entryLen = DecodeShort(entry + sizeof(short));
+
+    if (entryColumn != column)
+        return entryColumn - column;
+    if (entryLen != len)
+        return entryLen - len;
+    return memcmp((byte *)header + DecodeShort(entry), value, len);
+}
+
+/*
+ Binary searches the dictionary for value of column. Returns the index of its
+ entry, setting found, or the index its entry would be inserted at
+ */
+static int Pax_DictSearch(PaxHeader *header, int column, byte *value, int len, bool *found)
+{
+    int low = 0, high = header->dictSize;
+
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (Pax_DictCompare(header, Pax_DictEntry(header, mid), column, value, len) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    *found = low < header->dictSize && Pax_DictCompare(header, Pax_DictEntry(header, low), column, value, len) == 0;
+    return low;
+}
+
+/*
+ Sets up an empty PAX page for rows of schema. Its capacity is fitted by the first insert.
+ */
+void Pax_InitPage(Schema *schema, byte *pagebuf)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int rowBytes = 1; // Row flag
+
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        rowBytes += Pax_EntrySize(schema->columns[c]);
+    }
+    header->marker = PAX_PAGE_MARKER;
+    header->numColumns = schema->numColumns;
+    header->numRows = 0;
+    header->capacity = 0;
+    header->rowBytes = rowBytes;
+    header->heapOffset = PF_PAGE_SIZE;
+    header->deadBytes = 0;
+    header->dictColumns = 0;
+    header->dictSize = 0;
+    header->dictCapacity = 0;
+    for (int c = 0; c < schema->numColumns && c < PAX_MAX_DICT_COLUMNS; c++)
+    {
+        if (schema->columns[c]->type == VARCHAR && schema->columns[c]->dictionary)
+            header->dictColumns |= 1 << c;
+    }
+    for (int c = 0; c <= schema->numColumns; c++)
+    {
+        header->minipages[c] = PAX_HEADER_SIZE(schema->numColumns);
+    }
+}
+
+/*
+ Returns the number of bytes new rows can take in the page, in the units of Pax_RowSpace
+ */
+int Pax_FreeSpace(byte *pagebuf)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int heapUsed = PF_PAGE_SIZE - header->heapOffset - header->deadBytes;
+    return PF_PAGE_SIZE - PAX_HEADER_SIZE(header->numColumns) - header->numRows * header->rowBytes - heapUsed
+           - header->dictSize * PAX_DICT_ENTRY_SIZE;
+}
+
+/*
+ Returns the bytes an encoded record takes in a PAX page: its minipage entries, its
+ VARCHAR bytes and the dictionary entries of those in dictionary encoded columns
+ */
+int Pax_RowSpace(Schema *schema, byte *record, int len)
+{
+    int space = 1, fieldLen;
+
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        space += Pax_EntrySize(schema->columns[c]);
+        if (schema->columns[c]->type == VARCHAR)
+        {
+            Record_Field(schema, record, len, c, &fieldLen);
+            space += fieldLen;
+            if (fieldLen > 0 && c < PAX_MAX_DICT_COLUMNS && schema->columns[c]->dictionary)
+                space += PAX_DICT_ENTRY_SIZE;
+        }
+    }
+    return space;
+}
+
+/*
+ Returns the dictionary entry of a non-empty value of a dictionary encoded column
+ if a live row other than exceptRow holds it, or NULL. The entry starts with the
+ heap entry of the rows holding the value.
+ */
+static byte *Pax_FindValue(PaxHeader *header, int column, byte *value, int len, int exceptRow)
+{
+    bool found;
+
+    if (!Pax_IsDictColumn((byte *)header, column) || len == 0)
+    {
+        return NULL;
+    }
+    byte *entry = Pax_DictEntry(header, Pax_DictSearch(header, column, value, len, &found));
+    if (!found)
+    {
+        return NULL;
+    }
+    int refs = DecodeShort(PAX_DICT_REFS(entry));
+    if (exceptRow >= 0 && exceptRow < header->numRows && PAX_ROW_FLAGS(header)[exceptRow] == PAX_ROW_LIVE
+            && memcmp(Pax_VarEntry(header, column, exceptRow), entry, PAX_VAR_ENTRY_SIZE) == 0)
+        refs--;
+    return (refs > 0) ? entry : NULL;
+}
+
+/*
+ Returns the heap bytes an encoded record would add to the page as row exceptRow
+ (-1 for a new row): its VARCHAR values, but for those already in a column's dictionary.
+ newEntries is set to the number of dictionary entries it would add.
+ */
+static int Pax_VarBytesIn(Schema *schema, PaxHeader *header, byte *record, int len, int exceptRow, int *newEntries)
+{
+    int bytes = 0, fieldLen;
+
+    *newEntries = 0;
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        if (schema->columns[c]->type != VARCHAR)
+            continue;
+        byte *field = Record_FieldOrDefault(schema, record, len, c, &fieldLen);
+        if (Pax_FindValue(header, c, field, fieldLen, exceptRow) != NULL)
+            continue;
+        bytes += fieldLen;
+        if (fieldLen > 0 && Pax_IsDictColumn((byte *)header, c))
+            (*newEntries)++;
+    }
+    return bytes;
+}
+
+/*
+ Returns the bytes an encoded record takes in a given PAX page: as Pax_RowSpace,
+ less the VARCHAR values the page's dictionaries already hold
+ */
+int Pax_RowSpaceIn(Schema *schema, byte *pagebuf, byte *record, int len)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int newEntries;
+    int varBytes = Pax_VarBytesIn(schema, header, record, len, -1, &newEntries);
+    return header->rowBytes + varBytes + newEntries * PAX_DICT_ENTRY_SIZE;
+}
+
+/*
+ Returns the largest row space an empty page can take
+ */
+int Pax_MaxRowSpace(Schema *schema)
+{
+    return PF_PAGE_SIZE - PAX_HEADER_SIZE(schema->numColumns);
+}
+
+/*
+ Rewrites the page with room for capacity rows (at least numRows) and dictCapacity
+ dictionary entries (at least dictSize): minipages and dictionary are laid out
+ again and the live VARCHAR values packed at the end of the page
+ */
+static void Pax_Reorganize(Schema *schema, byte *pagebuf, int capacity, int dictCapacity)
+{
+    char copy[PF_PAGE_SIZE];
+    short moved[PF_PAGE_SIZE] = {0}; // New offset of the values moved so far, by old offset
+    PaxHeader *old = (PaxHeader *)copy;
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int offset = PAX_HEADER_SIZE(header->numColumns);
+    int heap = PF_PAGE_SIZE;
+
+    memcpy(copy, pagebuf, PF_PAGE_SIZE);
+    for (int c = 0; c <= header->numColumns; c++)
+    {
+        int entrySize = (c < header->numColumns) ? Pax_EntrySize(schema->columns[c]) : 1;
+        header->minipages[c] = offset;
+        memmove(pagebuf + offset, copy + old->minipages[c], old->numRows * entrySize);
+        offset += capacity * entrySize;
+    }
+    byte *flags = PAX_ROW_FLAGS(header);
+    for (int c = 0; c < header->numColumns; c++)
+    {
+        if (schema->columns[c]->type != VARCHAR)
+            continue;
+        for (int row = 0; row < header->numRows; row++)
+        {
+            byte *entry = Pax_VarEntry(header, c, row);
+            int length = (flags[row] == PAX_ROW_LIVE) ? DecodeShort(entry + sizeof(short)) : 0;
+            int from = DecodeShort(entry);
+            if (length > 0 && moved[from] != 0)
+            {
+                EncodeShort(moved[from], entry); // Dictionary value shared with a row moved before
+                continue;
+            }
+            heap -= length;
+            memcpy(pagebuf + heap, copy + from, length);
+            if (length > 0)
+                moved[from] = (short)heap;
+            EncodeShort((short)((length > 0) ? heap : 0), entry); // Empty values keep code 0
+            EncodeShort((short)length, entry + sizeof(short));
+        }
+    }
+    header->capacity = capacity;
+    header->heapOffset = heap;
+    header->deadBytes = 0;
+
+    // The dictionary follows the row flags; every value in it is held by a live row, so moved
+    byte *oldDict = (byte *)PAX_DICT(old);
+    for (int i = 0; i < header->dictSize; i++)
+    {
+        byte *entry = Pax_DictEntry(header, i);
+        memcpy(entry, oldDict + i * PAX_DICT_ENTRY_SIZE, PAX_DICT_ENTRY_SIZE);
+        EncodeShort(moved[DecodeShort(entry)], entry);
+    }
+    header->dictCapacity = dictCapacity;
+}
+
+/*
+ Makes sure the page has a row slot numRows-1, varBytes of contiguous heap and room
+ for newEntries more dictionary entries, reorganizing it if needed with capacities
+ estimated from the average row so far. The page must have room (see Pax_FreeSpace)
+ */
+static void Pax_MakeRoom(Schema *schema, byte *pagebuf, int numRows, int varBytes, int newEntries)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int minipagesEnd = PAX_HEADER_SIZE(header->numColumns) + header->capacity * header->rowBytes
+                       + header->dictCapacity * PAX_DICT_ENTRY_SIZE;
+
+    if (numRows <= header->capacity && header->heapOffset - minipagesEnd >= varBytes
+            && header->dictSize + newEntries <= header->dictCapacity)
+    {
+        return;
+    }
+    int heapUsed = PF_PAGE_SIZE - header->heapOffset - header->deadBytes + varBytes;
+    int entries = header->dictSize + newEntries;
+    int avail = PF_PAGE_SIZE - PAX_HEADER_SIZE(header->numColumns) - heapUsed - entries * PAX_DICT_ENTRY_SIZE;
+    int average = heapUsed / numRows;
+    int dictAverage = entries * PAX_DICT_ENTRY_SIZE / numRows;
+    int spareRows = (avail - numRows * header->rowBytes) / (header->rowBytes + average + dictAverage);
+    Pax_Reorganize(schema, pagebuf, numRows + spareRows, entries + spareRows * dictAverage / PAX_DICT_ENTRY_SIZE);
+}
+
+/*
+ Stores the fields of record in row, its VARCHAR values at the bottom of the heap
+ unless a column's dictionary already holds them
+ */
+static void Pax_WriteRow(Schema *schema, byte *pagebuf, int row, byte *record, int len)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int fieldLen;
+
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        byte *field = Record_FieldOrDefault(schema, record, len, c, &fieldLen);
+        byte *minipage = pagebuf + header->minipages[c];
+        switch (schema->columns[c]->type)
+        {
+        case VARCHAR:
+        {
+            if (Pax_IsDictColumn(pagebuf, c) && fieldLen == 0)
+            {
+                memset(Pax_VarEntry(header, c, row), 0, PAX_VAR_ENTRY_SIZE);
+                break;
+            }
+            if (Pax_IsDictColumn(pagebuf, c))
+            {
+                bool found;
+                int i = Pax_DictSearch(header, c, field, fieldLen, &found);
+                byte *entry = Pax_DictEntry(header, i);
+                if (!found) // A new value: into the heap, and its entry into the dictionary in order
+                {
+                    memmove(entry + PAX_DICT_ENTRY_SIZE, entry, (header->dictSize - i) * PAX_DICT_ENTRY_SIZE);
+                    header->dictSize++;
+                    header->heapOffset -= fieldLen;
+                    memcpy(pagebuf + header->heapOffset, field, fieldLen);
+                    EncodeShort(header->heapOffset, entry);
+                    EncodeShort((short)fieldLen, entry + sizeof(short));
+                    EncodeShort(0, PAX_DICT_REFS(entry));
+                    EncodeShort((short)c, PAX_DICT_COLUMN(entry));
+                }
+                EncodeShort(DecodeShort(PAX_DICT_REFS(entry)) + 1, PAX_DICT_REFS(entry));
+                memcpy(Pax_VarEntry(header, c, row), entry, PAX_VAR_ENTRY_SIZE);
+                break;
+            }
+            header->heapOffset -= fieldLen;
+            memcpy(pagebuf + header->heapOffset, field, fieldLen);
+            EncodeShort(header->heapOffset, Pax_VarEntry(header, c, row));
+            EncodeShort((short)fieldLen, Pax_VarEntry(header, c, row) + sizeof(short));
+            break;
+        }
+        case INT:
+            memcpy(minipage + row * 4, field, 4);
+            break;
+        case LONG:
+            memcpy(minipage + row * 8, field, 8);
+            break;
+        }
+    }
+    PAX_ROW_FLAGS(header)[row] = PAX_ROW_LIVE;
+}
+
+/*
+ Adds an encoded record to a PAX page that has room for it (Pax_FreeSpace at least
+ its Pax_RowSpace). Reuses the first deleted row if there is one.
+ Returns the row number
+ */
+int Pax_AddRow(Schema *schema, byte *pagebuf, byte *record, int len)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    byte *flags = PAX_ROW_FLAGS(header);
+    int row, varBytes, newEntries;
+
+    for (row = 0; row < header->numRows; row++)
+    {
+        if (flags[row] == PAX_ROW_DELETED)
+            break;
+    }
+    varBytes = Pax_VarBytesIn(schema, header, record, len, row, &newEntries);
+    Pax_MakeRoom(schema, pagebuf, (row == header->numRows) ? row + 1 : header->numRows, varBytes, newEntries);
+    if (row == header->numRows)
+        header->numRows++;
+    Pax_WriteRow(schema, pagebuf, row, record, len);
+    return row;
+}
+
+bool Pax_IsLive(byte *pagebuf, int row)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    return row < header->numRows && PAX_ROW_FLAGS(header)[row] == PAX_ROW_LIVE;
+}
+
+/*
+ Rebuilds row of the page as a record in the schema's record format, copying at most maxlen bytes.
+ Returns the full length of the record, or PFE_INVALIDPAGE if the row is deleted
+ */
+int Pax_GetRow(Schema *schema, byte *pagebuf, int row, byte *record, int maxlen)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    byte *values[schema->numColumns];
+    int lens[schema->numColumns];
+    byte built[2 * PF_PAGE_SIZE];
+
+    if (!Pax_IsLive(pagebuf, row))
+    {
+        return PFE_INVALIDPAGE;
+    }
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        byte *minipage = pagebuf + header->minipages[c];
+        switch (schema->columns[c]->type)
+        {
+        case VARCHAR:
+        {
+            byte *entry = Pax_VarEntry(header, c, row);
+            values[c] = pagebuf + DecodeShort(entry);
+            lens[c] = DecodeShort(entry + sizeof(short));
+            break;
+        }
+        case INT:
+            values[c] = minipage + row * 4;
+            lens[c] = 4;
+            break;
+        case LONG:
+            values[c] = minipage + row * 8;
+            lens[c] = 8;
+            break;
+        }
+    }
+    int len = Record_Build(schema, values, lens, built, sizeof(built));
+    memcpy(record, built, (len < maxlen) ? len : maxlen);
+    return len;
+}
+
+// Heap and dictionary bytes of row that no other live row shares
+static int Pax_OwnBytes(Schema *schema, PaxHeader *header, int row)
+{
+    int bytes = 0;
+
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        if (schema->columns[c]->type != VARCHAR)
+            continue;
+        byte *entry = Pax_VarEntry(header, c, row);
+        int length = DecodeShort(entry + sizeof(short));
+        if (length == 0 || !Pax_IsDictColumn((byte *)header, c))
+            bytes += length;
+        else if (Pax_FindValue(header, c, (byte *)header + DecodeShort(entry), length, row) == NULL)
+            bytes += length + PAX_DICT_ENTRY_SIZE;
+    }
+    return bytes;
+}
+
+/*
+ Counts the heap bytes of row as dead, but for dictionary values other rows still
+ use; the dictionary entries of the others are dropped
+ */
+static void Pax_DropValues(Schema *schema, PaxHeader *header, int row)
+{
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        if (schema->columns[c]->type != VARCHAR)
+            continue;
+        byte *entry = Pax_VarEntry(header, c, row);
+        int length = DecodeShort(entry + sizeof(short));
+        if (length > 0 && Pax_IsDictColumn((byte *)header, c))
+        {
+            bool found;
+            int i = Pax_DictSearch(header, c, (byte *)header + DecodeShort(entry), length, &found);
+            byte *dictEntry = Pax_DictEntry(header, i);
+            int refs = DecodeShort(PAX_DICT_REFS(dictEntry)) - 1;
+            if (found && refs > 0)
+            {
+                EncodeShort((short)refs, PAX_DICT_REFS(dictEntry));
+                length = 0; // Still shared
+            }
+            else if (found)
+            {
+                memmove(dictEntry, dictEntry + PAX_DICT_ENTRY_SIZE, (header->dictSize - i - 1) * PAX_DICT_ENTRY_SIZE);
+                header->dictSize--;
+            }
+        }
+        header->deadBytes += length;
+        EncodeShort(0, entry + sizeof(short));
+    }
+}
+
+/*
+ Marks row as deleted; its heap bytes are reclaimed by the next reorganization.
+ Trailing deleted rows are dropped from the page.
+ */
+void Pax_DeleteRow(Schema *schema, byte *pagebuf, int row)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    byte *flags = PAX_ROW_FLAGS(header);
+
+    Pax_DropValues(schema, header, row);
+    flags[row] = PAX_ROW_DELETED;
+    while (header->numRows > 0 && flags[header->numRows - 1] == PAX_ROW_DELETED)
+        header->numRows--;
+}
+
+/*
+ Replaces row by an encoded record, in place, reorganizing the page if its VARCHARs need it.
+ Returns false, leaving the page unchanged, if the page cannot hold the new version
+ */
+bool Pax_UpdateRow(Schema *schema, byte *pagebuf, int row, byte *record, int len)
+{
+    PaxHeader *header = (PaxHeader *)pagebuf;
+    int newEntries;
+    int varBytes = Pax_VarBytesIn(schema, header, record, len, row, &newEntries);
+
+    if (Pax_FreeSpace(pagebuf) + Pax_OwnBytes(schema, header, row) < varBytes + newEntries * PAX_DICT_ENTRY_SIZE)
+    {
+        return false;
+    }
+    Pax_DropValues(schema, header, row);
+    Pax_MakeRoom(schema, pagebuf, header->numRows, varBytes, newEntries);
+    Pax_WriteRow(schema, pagebuf, row, record, len);
+    return true;
+}
+
+bool Pax_IsDictColumn(byte *pagebuf, int column)
+{
+    return column < PAX_MAX_DICT_COLUMNS && (((PaxHeader *)pagebuf)->dictColumns & (1 << column));
+}
+
+// Code of a heap entry: its offset and length, as a value comparable for equality
+static int Pax_EntryCode(byte *entry)
+{
+    return (DecodeShort(entry + sizeof(short)) << 16) | (unsigned short)DecodeShort(entry);
+}
+
+/*
+ Returns the code of a value in a dictionary encoded column of the page, or
+ PAX_NO_CODE if no live row holds it (the empty string always has code 0).
+ Rows of the page hold value exactly when their Pax_Code for the column is this code
+ */
+int Pax_FindCode(byte *pagebuf, int column, byte *value, int len)
+{
+    if (len == 0)
+    {
+        return Pax_IsDictColumn(pagebuf, column) ? 0 : PAX_NO_CODE;
+    }
+    byte *entry = Pax_FindValue((PaxHeader *)pagebuf, column, value, len, -1);
+    return (entry == NULL) ? PAX_NO_CODE : Pax_EntryCode(entry);
+}
+
+/*
+ Returns the code of the value of a live row in a dictionary encoded column
+ */
+int Pax_Code(byte *pagebuf, int column, int row)
+{
+    return Pax_EntryCode(Pax_VarEntry((PaxHeader *)pagebuf, column, row));
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+#ifndef _PAX_H_
+#define _PAX_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// PAX pages (TABLE_LAYOUT_PAX): the rows of a page are stored column by column,
+// one minipage per column, so a scan of one column reads it contiguously.
+//
+// [PaxHeader][minipage offsets][column 0 minipage]...[column n-1 minipage][row flags][dictionary] ... free ... [VARCHAR heap]
+//
+// An INT or LONG minipage holds capacity values back to back, as encoded by codec.c.
+// A VARCHAR minipage holds capacity (short offset, short length) entries into the
+// heap, which grows down from the end of the page. The row flags minipage holds
+// one byte per row, PAX_ROW_LIVE or PAX_ROW_DELETED.
+// The capacity is fitted to the rows seen so far: when the minipages or the heap
+// run out of room, the page is reorganized with a new capacity, moving the
+// minipages and compacting the heap. Row numbers, and so record ids, never change.
+//
+// Dictionary encoding: a VARCHAR column marked dictionary in the schema (one of
+// the first PAX_MAX_DICT_COLUMNS) keeps each distinct value once in the heap of
+// a page, and its rows share the entry, which then serves as the value's code
+// in the page. The page records the columns it encodes this way when it is set up,
+// so equal codes mean equal values and, on such a page, unequal codes unequal ones.
+// The empty string takes no heap entry: its code is 0. The distinct values of all
+// these columns are listed in the dictionary, sorted by column, length and bytes,
+// with the number of live rows holding each, so that a value is looked up by
+// binary search and its heap bytes are freed with the last row holding it.
+// The dictionary has room for dictCapacity entries, fitted like the minipages.
+
+#define PAX_PAGE_MARKER (-2) // First short of a PAX page, where a row page keeps its (never negative) slot count
+#define PAX_IS_PAGE(pagebuf) (((PaxHeader *)(pagebuf))->marker == PAX_PAGE_MARKER)
+
+#define PAX_ROW_DELETED 0
+#define PAX_ROW_LIVE    1
+#define PAX_VAR_ENTRY_SIZE (2 * sizeof(short)) // Offset and length of a VARCHAR value in the heap
+#define PAX_DICT_ENTRY_SIZE (4 * sizeof(short)) // Offset and length as above, rows holding the value, column
+#define PAX_MAX_DICT_COLUMNS 16
+#define PAX_NO_CODE (-1) // Pax_FindCode: the value is not in the page
+
+typedef struct {
+    short marker;       // PAX_PAGE_MARKER
+    short numColumns;
+    short numRows;      // Rows in the page, deleted ones included
+    short capacity;     // Rows the minipages have room for
+    short rowBytes;     // Minipage bytes per row, the row flag included
+    short heapOffset;   // Start of the VARCHAR heap
+    short deadBytes;    // Heap bytes of deleted or updated values, reclaimed by reorganizing
+    unsigned short dictColumns; // Bit c: VARCHAR column c is dictionary encoded in this page
+    short dictSize;     // Entries in the dictionary
+    short dictCapacity; // Entries the dictionary has room for
+    short minipages[];  // Offset of the minipage of each column, then of the row flags
+} PaxHeader;
+
+#define PAX_HEADER_SIZE(numColumns) (sizeof(PaxHeader) + ((numColumns) + 1) * sizeof(short))
+#define PAX_ROW_FLAGS(header) ((byte *)(header) + (header)->minipages[(header)->numColumns])
+#define PAX_DICT(header) (PAX_ROW_FLAGS(header) + (header)->capacity)
+
+void
+Pax_InitPage(Schema *schema, byte *pagebuf);
+
+int
+Pax_FreeSpace(byte *pagebuf);
+
+int
+Pax_RowSpace(Schema *schema, byte *record, int len);
+
+int
+Pax_MaxRowSpace(Schema *schema);
+
+int
+Pax_RowSpaceIn(Schema *schema, byte *pagebuf, byte *record, int len);
+
+int
+Pax_AddRow(Schema *schema, byte *pagebuf, byte *record, int len);
+
+bool
+Pax_IsLive(byte *pagebuf, int row);
+
+int
+Pax_GetRow(Schema *schema, byte *pagebuf, int row, byte *record, int maxlen);
+
+void
+Pax_DeleteRow(Schema *schema, byte *pagebuf, int row);
+
+bool
+Pax_UpdateRow(Schema *schema, byte *pagebuf, int row, byte *record, int len);
+
+bool
+Pax_IsDictColumn(byte *pagebuf, int column);
+
+int
+Pax_FindCode(byte *pagebuf, int column, byte *value, int len);
+
+int
+Pax_Code(byte *pagebuf, int column, int row);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,200 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "tbl.h"
+#include "pred.h"
+#include "codec.h"
+#include "record.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+PredicateList *Pred_Create(Schema *schema)
+{
+    PredicateList *list = (PredicateList *)calloc(1, sizeof(PredicateList));
+    if (list != NULL)
+    {
+        list->schema = schema;
+    }
+    return list;
+}
+
+void Pred_Free(PredicateList *list)
+{
+    if (list == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < list->numPreds; i++)
+    {
+        free(list->preds[i].str);
+    }
+    free(list);
+}
+
+/*
+ Appends a predicate on column
+ */
+static Predicate *Pred_Add(PredicateList *list, int column, int op)
+{
+    if (list->numPreds == PRED_MAX_PREDICATES || column < 0 || column >= list->schema->numColumns
+            || op < EQUAL || op > NOT_EQUAL)
+    {
+        return NULL;
+    }
+    Predicate *pred = &list->preds[list->numPreds];
+    pred->column = column;
+    pred->type = list->schema->columns[column]->type;
+    pred->op = op;
+    pred->str = NULL;
+    return pred;
+}
+
+/*
+ Adds "column op value" for an INT or LONG column
+ Returns 0, or -1 if the predicate is invalid or the list is full
+ */
+int Pred_AddInt(PredicateList *list, int column, int op, long long value)
+{
+    Predicate *pred = Pred_Add(list, column, op);
+    if (pred == NULL || pred->type == VARCHAR)
+    {
+        return -1;
+    }
+    pred->num = value;
+    list->numPreds++;
+    return 0;
+}
+
+/*
+ Adds "column op value" for a VARCHAR column; strings compare like memcmp, shorter first on ties
+ Returns 0, or -1 if the predicate is invalid or the list is full
+ */
+int Pred_AddString(PredicateList *list, int column, int op, char *value)
+{
+    Predicate *pred = Pred_Add(list, column, op);
+    if (pred == NULL || pred->type != VARCHAR)
+    {
+        return -1;
+    }
+    pred->str = strdup(value);
+    pred->strLen = strlen(value);
+    list->numPreds++;
+    return 0;
+}
+
+static bool Pred_Test(int op, int cmp)
+{
+    switch (op)
+    {
+    case EQUAL:
+        return cmp == 0;
+    case LESS_THAN:
+        return cmp < 0;
+    case GREATER_THAN:
+        return cmp > 0;
+    case LESS_THAN_EQUAL:
+        return cmp <= 0;
+    case GREATER_THAN_EQUAL:
+        return cmp >= 0;
+    case NOT_EQUAL:
+        return cmp != 0;
+    }
+    return false;
+}
+
+/*
+ Returns true if the encoded record satisfies every predicate of the list.
+ Values are compared in place, located with Record_Field; nothing is decoded into a row.
+ */
+bool Pred_Eval(PredicateList *list, byte *record, int len)
+{
+    for (int i = 0; i < list->numPreds; i++)
+    {
+        Predicate *pred = &list->preds[i];
+        int fieldLen, cmp;
+        byte *field = Record_Field(list->schema, record, len, pred->column, &fieldLen);
+
+        if (field == NULL)
+        {
+            return false;
+        }
+        switch (pred->type)
+        {
+        case INT:
+        {
+            int value = DecodeInt(field);
+            cmp = (value < pred->num) ? -1 : (value > pred->num);
+            break;
+        }
+        case LONG:
+        {
+            long long value = DecodeLong(field);
+            cmp = (value < pred->num) ? -1 : (value > pred->num);
+            break;
+        }
+        case VARCHAR:
+        default:
+        {
+            cmp = memcmp(field, pred->str, (fieldLen < pred->strLen) ? fieldLen : pred->strLen);
+            if (cmp == 0)
+                cmp = fieldLen - pred->strLen;
+            break;
+        }
+        }
+        if (!Pred_Test(pred->op, cmp))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ Narrows [*low, *high] to the values of an INT or LONG column that the predicates
+ on it allow (NULL list for none); *low > *high if none is
+ */
+void Pred_Range(PredicateList *list, int column, long long *low, long long *high)
+{
+    for (int i = 0; list != NULL && i < list->numPreds; i++)
+    {
+        Predicate *pred = &list->preds[i];
+        long long predLow = LLONG_MIN, predHigh = LLONG_MAX;
+        if (pred->column != column || pred->type == VARCHAR)
+            continue;
+        switch (pred->op)
+        {
+        case EQUAL:
+            predLow = predHigh = pred->num;
+            break;
+        case LESS_THAN:
+            if (pred->num == LLONG_MIN)
+                predLow = LLONG_MAX; // Nothing is less
+            else
+                predHigh = pred->num - 1;
+            break;
+        case LESS_THAN_EQUAL:
+            predHigh = pred->num;
+            break;
+        case GREATER_THAN:
+            if (pred->num == LLONG_MAX)
+                predHigh = LLONG_MIN; // Nothing is greater
+            else
+                predLow = pred->num + 1;
+            break;
+        case GREATER_THAN_EQUAL:
+            predLow = pred->num;
+            break;
+        }
+        if (predLow > *low)
+            *low = predLow;
+        if (predHigh < *high)
+            *high = predHigh;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+
@@ -0,0 +1,49 @@
+#ifndef _PRED_H_
+#define _PRED_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// A conjunction of "column op constant" tests evaluated on encoded records.
+// op is one of EQUAL, NOT_EQUAL, LESS_THAN, LESS_THAN_EQUAL, GREATER_THAN and
+// GREATER_THAN_EQUAL from am.h, with the same meaning as for AM_OpenIndexScan.
+
+#define PRED_MAX_PREDICATES 16
+
+typedef struct {
+    int column;       // Column index in the schema
+    int type;         // VARCHAR, INT or LONG, from the schema
+    int op;           // Comparison operator
+    long long num;    // Constant for INT and LONG columns
+    char *str;        // Constant for VARCHAR columns
+    int strLen;       // Length of str
+} Predicate;
+
+typedef struct PredicateList {
+    Schema *schema;
+    int numPreds;
+    Predicate preds[PRED_MAX_PREDICATES];
+} PredicateList;
+
+PredicateList *
+Pred_Create(Schema *schema);
+
+int
+Pred_AddInt(PredicateList *list, int column, int op, long long value);
+
+int
+Pred_AddString(PredicateList *list, int column, int op, char *value);
+
+bool
+Pred_Eval(PredicateList *list, byte *record, int len);
+
+void
+Pred_Free(PredicateList *list);
+
+void
+Pred_Range(PredicateList *list, int column, long long *low, long long *high);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
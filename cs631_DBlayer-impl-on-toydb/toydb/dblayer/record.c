@@ -0,0 +1,270 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "record.h"
+#include "codec.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Sets the record format of a table's schema and lays out its columns:
+ for V1, the offset of each fixed field and of each VARCHAR's offset entry.
+ */
+void Record_SetFormat(Schema *schema, int format)
+{
+    int offset = RECORD_V1_FORMAT_SIZE;
+
+    schema->recordFormat = format;
+    // Fixed-width fields first, in schema order
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        ColumnDesc *colDesc = schema->columns[i];
+        if (colDesc->type == INT)
+        {
+            colDesc->offset = offset;
+            offset += 4;
+        }
+        else if (colDesc->type == LONG)
+        {
+            colDesc->offset = offset;
+            offset += 8;
+        }
+    }
+    // Then the offset table of the VARCHARs
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        ColumnDesc *colDesc = schema->columns[i];
+        if (colDesc->type == VARCHAR)
+        {
+            colDesc->offset = offset;
+            offset += 2;
+        }
+    }
+    schema->headerSize = offset;
+}
+
+/*
+ Packs fields back to back (V0)
+ */
+static int Record_EncodeV0(Schema *schema, char **fields, byte *record, int spaceLeft)
+{
+    int byteOffset = 0, bytesEncoded = 0;
+
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        switch (schema->columns[i]->type)
+        {
+        case VARCHAR:
+            bytesEncoded = EncodeCString(fields[i], record + byteOffset, spaceLeft);
+            break;
+        case INT:
+            bytesEncoded = EncodeInt(atoi(fields[i]), record + byteOffset);
+            break;
+        case LONG:
+            bytesEncoded = EncodeLong(atoll(fields[i]), record + byteOffset);
+            break;
+        }
+        byteOffset += bytesEncoded;
+        spaceLeft -= bytesEncoded;
+    }
+    return byteOffset;
+}
+
+/*
+ Writes the format byte, the fixed fields and the VARCHAR offset table, then
+ the string bytes (V1). Strings are truncated to the space left.
+ */
+static int Record_EncodeV1(Schema *schema, char **fields, byte *record, int spaceLeft)
+{
+    int byteOffset = schema->headerSize;
+
+    if (byteOffset > spaceLeft)
+    {
+        return -1;
+    }
+    record[0] = RECORD_FORMAT_V1;
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        ColumnDesc *colDesc = schema->columns[i];
+        switch (colDesc->type)
+        {
+        case VARCHAR:
+        {
+            int length = strlen(fields[i]);
+            if (byteOffset + length > spaceLeft)
+            {
+                length = spaceLeft - byteOffset;
+            }
+            EncodeShort((short)byteOffset, record + colDesc->offset);
+            memcpy(record + byteOffset, fields[i], length);
+            byteOffset += length;
+            break;
+        }
+        case INT:
+            EncodeInt(atoi(fields[i]), record + colDesc->offset);
+            break;
+        case LONG:
+            EncodeLong(atoll(fields[i]), record + colDesc->offset);
+            break;
+        }
+    }
+    return byteOffset;
+}
+
+/*
+ Encodes an array of strings (fields) into record, in the schema's record format.
+ Returns the number of bytes encoded, or -1 if the fixed part does not fit
+ */
+int Record_Encode(Schema *schema, char **fields, byte *record, int spaceLeft)
+{
+    if (schema->recordFormat == RECORD_FORMAT_V0)
+    {
+        return Record_EncodeV0(schema, fields, record, spaceLeft);
+    }
+    return Record_EncodeV1(schema, fields, record, spaceLeft);
+}
+
+/*
+ Builds a record in the schema's record format from the encoded value of each
+ column: values[i] points to lens[i] bytes, as Record_Field returns them.
+ Returns the record length, or -1 if it does not fit in spaceLeft bytes
+ */
+int Record_Build(Schema *schema, byte **values, int *lens, byte *record, int spaceLeft)
+{
+    int byteOffset = (schema->recordFormat == RECORD_FORMAT_V0) ? 0 : schema->headerSize;
+
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        byteOffset += lens[i] + ((schema->recordFormat == RECORD_FORMAT_V0 && schema->columns[i]->type == VARCHAR) ? 2 : 0);
+    }
+    if (byteOffset > spaceLeft)
+    {
+        return -1;
+    }
+
+    if (schema->recordFormat == RECORD_FORMAT_V0)
+    {
+        byteOffset = 0;
+        for (int i = 0; i < schema->numColumns; i++)
+        {
+            if (schema->columns[i]->type == VARCHAR)
+            {
+                byteOffset += EncodeShort((short)lens[i], record + byteOffset);
+            }
+            memcpy(record + byteOffset, values[i], lens[i]);
+            byteOffset += lens[i];
+        }
+        return byteOffset;
+    }
+
+    byteOffset = schema->headerSize;
+    record[0] = RECORD_FORMAT_V1;
+    for (int i = 0; i < schema->numColumns; i++)
+    {
+        ColumnDesc *colDesc = schema->columns[i];
+        if (colDesc->type == VARCHAR)
+        {
+            EncodeShort((short)byteOffset, record + colDesc->offset);
+            memcpy(record + byteOffset, values[i], lens[i]);
+            byteOffset += lens[i];
+        }
+        else
+        {
+            memcpy(record + colDesc->offset, values[i], lens[i]);
+        }
+    }
+    return byteOffset;
+}
+
+/*
+ Returns a pointer to the encoded value of a column inside a record of len bytes,
+ and its length in fieldLen: 4 for INT, 8 for LONG and the string length for a
+ VARCHAR, whose bytes are returned without any length prefix or terminator.
+ Nothing is copied; V1 records are read in O(1), V0 ones by skipping the columns before.
+ Returns NULL if the record is not in the table's format or does not hold the column.
+ */
+byte *Record_Field(Schema *schema, byte *record, int len, int column, int *fieldLen)
+{
+    ColumnDesc *colDesc = schema->columns[column];
+
+    *fieldLen = 0;
+    if (schema->recordFormat == RECORD_FORMAT_V0)
+    {
+        byte *field = record;
+        for (int i = 0; i < column; i++)
+        {
+            switch (schema->columns[i]->type)
+            {
+            case VARCHAR:
+                if (field + 2 > record + len)
+                    return NULL;
+                field += (unsigned short)DecodeShort(field) + 2;
+                break;
+            case INT:
+                field += 4;
+                break;
+            case LONG:
+                field += 8;
+                break;
+            }
+        }
+        int size = (colDesc->type == INT) ? 4 : (colDesc->type == LONG) ? 8 : 2;
+        if (field + size > record + len)
+            return NULL;
+        if (colDesc->type == VARCHAR)
+        {
+            size = (unsigned short)DecodeShort(field);
+            if (field + 2 + size > record + len)
+                return NULL;
+            *fieldLen = size;
+            return field + 2;
+        }
+        *fieldLen = size;
+        return field;
+    }
+
+    if (len < schema->headerSize || record[0] != RECORD_FORMAT_V1)
+    {
+        return NULL;
+    }
+    switch (colDesc->type)
+    {
+    case VARCHAR:
+    {
+        int start = (unsigned short)DecodeShort(record + colDesc->offset);
+        int end = (colDesc->offset + 2 == schema->headerSize) ? len
+                  : (unsigned short)DecodeShort(record + colDesc->offset + 2);
+        if (start < schema->headerSize || end < start || end > len)
+            return NULL;
+        *fieldLen = end - start;
+        return record + start;
+    }
+    case INT:
+        *fieldLen = 4;
+        return record + colDesc->offset;
+    default:
+        *fieldLen = 8;
+        return record + colDesc->offset;
+    }
+}
+
+/*
+ Record_Field, reading a column the record does not hold as the column's default:
+ 0 for INT and LONG, the empty string for VARCHAR. Never returns NULL.
+ */
+byte *Record_FieldOrDefault(Schema *schema, byte *record, int len, int column, int *fieldLen)
+{
+    static byte zero[8];
+
+    byte *field = Record_Field(schema, record, len, column, fieldLen);
+    if (field != NULL)
+    {
+        return field;
+    }
+    *fieldLen = (schema->columns[column]->type == INT) ? 4 : (schema->columns[column]->type == LONG) ? 8 : 0;
+    return zero;
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,46 @@
+#ifndef _RECORD_H_
+#define _RECORD_H_
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Record formats, chosen per table through its schema (see Record_SetFormat)
+//
+// V0: fields back to back in schema order; VARCHARs carry a 2 byte length prefix.
+//     Reaching a column means skipping every VARCHAR before it.
+//
+// V1: [format byte][INT/LONG fields][2 byte start offset per VARCHAR][VARCHAR bytes]
+//     Fixed fields and offset entries sit at offsets known from the schema alone,
+//     so any column is found in O(1). A VARCHAR ends where the next one starts,
+//     the last one at the end of the record. Offsets are unsigned shorts, so
+//     records are limited to 64KB.
+//
+// The format belongs to the table, not to each record: records carry no version a
+// reader could convert from. The V1 format byte only lets Record_Field refuse a
+// record in another format instead of misreading it. A record that does not hold
+// a column (in another format, or shorter than the schema says) has no value for
+// it; Record_FieldOrDefault reads such a column as 0 or the empty string.
+#define RECORD_FORMAT_V0 0
+#define RECORD_FORMAT_V1 1
+#define RECORD_FORMAT_DEFAULT RECORD_FORMAT_V1
+
+#define RECORD_V1_FORMAT_SIZE 1
+
+void
+Record_SetFormat(Schema *schema, int format);
+
+int
+Record_Encode(Schema *schema, char **fields, byte *record, int spaceLeft);
+
+int
+Record_Build(Schema *schema, byte **values, int *lens, byte *record, int spaceLeft);
+
+byte *
+Record_Field(Schema *schema, byte *record, int len, int column, int *fieldLen);
+
+byte *
+Record_FieldOrDefault(Schema *schema, byte *record, int len, int column, int *fieldLen);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
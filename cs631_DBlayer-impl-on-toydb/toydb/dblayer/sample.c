@@ -0,0 +1,295 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "tbl.h"
+#include "sample.h"
+#include "pred.h"
+#include "record.h"
+#include "codec.h"
+#include "iot.h"
+#include "../pflayer/pf.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// State of Sample_Aggregate over the rows Table_Sample hands it
+typedef struct {
+    Schema *schema;
+    int column;            // -1 for COUNT
+    PredicateList *filter;
+    double count, sum;     // Of the matching rows of the page being read
+    double sumCount, sumCount2, sumValue, sumValue2, sumProduct; // Over the pages done
+    long long rowsRead, rowsMatched;
+} SampleState;
+
+static int Sample_ComparePages(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/*
+ Picks numChosen of pages 0 to numPages - 1 at random, in page order
+ */
+static int *Sample_ChoosePages(int numPages, int numChosen, unsigned long long seed)
+{
+    int *pages = (int *)malloc(((numPages > 0) ? numPages : 1) * sizeof(int));
+    if (pages == NULL)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < numPages; i++)
+        pages[i] = i;
+    for (int i = 0; i < numChosen && numChosen < numPages; i++) // Partial Fisher-Yates shuffle
+    {
+        unsigned long long hash = (seed += 0x9e3779b97f4a7c15ULL); // splitmix64
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        hash ^= hash >> 31;
+        int j = i + (int)(hash % (unsigned long long)(numPages - i));
+        int page = pages[i];
+        pages[i] = pages[j];
+        pages[j] = page;
+    }
+    qsort(pages, numChosen, sizeof(int), Sample_ComparePages);
+    return pages;
+}
+
+/*
+ Lists the leaves of an index-organized table in pleaves, in key order, from the
+ inner nodes level by level: no leaf is read.
+ Returns the number of leaves, or an error code
+ */
+static int Sample_IotLeaves(Table *tbl, int **pleaves)
+{
+    int numPages, numLevel = 1, numNext;
+    char *pagebuf;
+
+    int ret_val = PF_GetNumPages(tbl->file_descriptor, &numPages);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int *level = (int *)malloc(numPages * sizeof(int)), *next = (int *)malloc(numPages * sizeof(int));
+    if (level == NULL || next == NULL)
+    {
+        free(level);
+        free(next);
+        return PFE_NOMEM;
+    }
+    level[0] = tbl->rootPage;
+    while (1)
+    {
+        ret_val = PF_GetThisPage(tbl->file_descriptor, level[0], &pagebuf);
+        if (ret_val != PFE_OK)
+            break;
+        bool leaf = IOT_IS_LEAF(pagebuf);
+        PF_UnfixPage(tbl->file_descriptor, level[0], FALSE);
+        if (leaf)
+        {
+            free(next);
+            *pleaves = level;
+            return numLevel;
+        }
+        // The children of the level's nodes make the level below
+        numNext = 0;
+        for (int i = 0; ret_val == PFE_OK && i < numLevel; i++)
+        {
+            ret_val = PF_GetThisPage(tbl->file_descriptor, level[i], &pagebuf);
+            if (ret_val != PFE_OK)
+                break;
+            IotNode *node = (IotNode *)pagebuf;
+            for (int c = 0; c <= node->numKeys && numNext < numPages; c++)
+                next[numNext++] = node->children[c];
+            PF_UnfixPage(tbl->file_descriptor, level[i], FALSE);
+        }
+        if (ret_val != PFE_OK)
+            break;
+        int *swap = level;
+        level = next;
+        next = swap;
+        numLevel = numNext;
+    }
+    free(level);
+    free(next);
+    return ret_val;
+}
+
+/*
+ Table_Sample reading at least minPages pages (all of them in a smaller table) when
+ fraction is above 0, calling pagefn (if not NULL) after the rows of each page read.
+ The pages of an index-organized table are its leaves. Their number is returned in
+ pnumPages (if not NULL)
+ */
+static int Sample_Pages(Table *tbl, double fraction, int minPages, unsigned long long seed, void *callbackObj,
+                        ReadFunc callbackfn, void (*pagefn)(void *callbackObj), int *pnumPages)
+{
+    int numPages, *leaves = NULL;
+    int ret_val = 0;
+
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        numPages = Sample_IotLeaves(tbl, &leaves);
+        if (numPages < 0)
+            return numPages;
+    }
+    else if ((ret_val = PF_GetNumPages(tbl->file_descriptor, &numPages)) != PFE_OK)
+    {
+        return ret_val;
+    }
+    if (pnumPages != NULL)
+        *pnumPages = numPages;
+    int numChosen = (fraction >= 1) ? numPages : (fraction > 0) ? (int)(fraction * numPages + 0.5) : 0;
+    if (fraction > 0 && numChosen < minPages)
+        numChosen = (minPages < numPages) ? minPages : numPages;
+    int *pages = Sample_ChoosePages(numPages, numChosen, seed);
+    if (pages == NULL)
+    {
+        free(leaves);
+        return PFE_NOMEM;
+    }
+    for (int p = 0; leaves != NULL && p < numChosen; p++)
+        pages[p] = leaves[pages[p]];
+
+    // The scans must not meet the bulk-append tail fixed
+    bool wasBulk = tbl->bulkAppend;
+    Table_SetBulkAppend(tbl, false);
+    for (int p = 0; ret_val == 0 && p < numChosen; p++)
+    {
+        TableScan *scan;
+        RecId rid;
+        byte *record;
+        int len;
+
+        ret_val = Table_OpenScan(tbl, pages[p], pages[p], &scan);
+        if (ret_val != 0)
+            break;
+        while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+        {
+            callbackfn(callbackObj, rid, record, len);
+        }
+        if (ret_val == PFE_EOF)
+            ret_val = 0;
+        Table_CloseScan(scan);
+        if (pagefn != NULL)
+            pagefn(callbackObj);
+    }
+    Table_SetBulkAppend(tbl, wasBulk);
+    free(pages);
+    free(leaves);
+    return (ret_val == 0) ? numChosen : ret_val;
+}
+
+/*
+ Calls callbackfn on the rows of a share fraction of the table's pages, rounded to
+ the nearest page count but at least one page when fraction is above 0, picked at
+ random from seed. Free pages and pages without rows are read like the others; of
+ an index-organized table only the leaves are sampled.
+ Returns the number of pages read, or an error code
+ */
+int Table_Sample(Table *tbl, double fraction, unsigned long long seed, void *callbackObj, ReadFunc callbackfn)
+{
+    return Sample_Pages(tbl, fraction, 1, seed, callbackObj, callbackfn, NULL, NULL);
+}
+
+/*
+ Adds the totals of the page done to the sums over pages
+ */
+static void Sample_EndPage(void *callbackObj)
+{
+    SampleState *state = (SampleState *)callbackObj;
+
+    state->sumCount += state->count;
+    state->sumCount2 += state->count * state->count;
+    state->sumValue += state->sum;
+    state->sumValue2 += state->sum * state->sum;
+    state->sumProduct += state->count * state->sum;
+    state->count = state->sum = 0;
+}
+
+static void Sample_AddRow(void *callbackObj, RecId rid, byte *row, int len)
+{
+    SampleState *state = (SampleState *)callbackObj;
+
+    state->rowsRead++;
+    if (state->filter != NULL && !Pred_Eval(state->filter, row, len))
+    {
+        return;
+    }
+    state->rowsMatched++;
+    state->count++;
+    if (state->column >= 0)
+    {
+        int fieldLen;
+        byte *field = Record_FieldOrDefault(state->schema, row, len, state->column, &fieldLen);
+        state->sum += (state->schema->columns[state->column]->type == INT) ? DecodeInt(field) : DecodeLong(field);
+    }
+}
+
+/*
+ Estimates COUNT (column unused), SUM or AVG of an INT or LONG column over the rows
+ of the table passing filter (NULL for all) from a share fraction of its pages,
+ see Table_Sample, but at least SAMPLE_MIN_PAGES of them so that the interval is
+ finite; a table with no more pages is read whole, for the exact value. AVG
+ estimates 0, with an infinite interval, if no row matched.
+ Returns 0, SAMPLEE_COLUMN, or an error code
+ */
+int Sample_Aggregate(Table *tbl, int aggregate, int column, PredicateList *filter,
+                     double fraction, unsigned long long seed, SampleEstimate *est)
+{
+    SampleState state;
+    Schema *schema = tbl->schema;
+
+    memset(&state, 0, sizeof(SampleState));
+    state.schema = schema;
+    state.column = -1;
+    state.filter = filter;
+    if (aggregate != SAMPLE_COUNT)
+    {
+        if (schema == NULL || column < 0 || column >= schema->numColumns
+                || (schema->columns[column]->type != INT && schema->columns[column]->type != LONG))
+            return SAMPLEE_COLUMN;
+        state.column = column;
+    }
+    int n = Sample_Pages(tbl, fraction, SAMPLE_MIN_PAGES, seed, &state, Sample_AddRow, Sample_EndPage,
+                         &est->numPages);
+    if (n < 0)
+    {
+        return n;
+    }
+
+    // Page totals: mean and variance of the estimate, N pages of which n were read
+    double N = est->numPages;
+    double fpc = (n > 0) ? 1 - n / N : 0;
+    double variance = INFINITY;
+    if (aggregate == SAMPLE_AVG)
+    {
+        double ratio = (state.sumCount > 0) ? state.sumValue / state.sumCount : 0;
+        double meanCount = (n > 0) ? state.sumCount / n : 0;
+        est->estimate = ratio;
+        if (n > 1 && meanCount > 0) // Residuals value - ratio * count of the pages
+        {
+            double residuals = state.sumValue2 - 2 * ratio * state.sumProduct + ratio * ratio * state.sumCount2;
+            variance = fpc * residuals / (n - 1) / n / (meanCount * meanCount);
+        }
+    }
+    else
+    {
+        double sum = (aggregate == SAMPLE_COUNT) ? state.sumCount : state.sumValue;
+        double sum2 = (aggregate == SAMPLE_COUNT) ? state.sumCount2 : state.sumValue2;
+        est->estimate = (n > 0) ? N * sum / n : 0;
+        if (n > 1)
+            variance = N * N * fpc * (sum2 - sum * sum / n) / (n - 1) / n;
+    }
+    if (n == N && n > 0 && (aggregate != SAMPLE_AVG || state.sumCount > 0))
+        variance = 0; // Every page was read
+    double margin = SAMPLE_Z * sqrt((variance > 0) ? variance : 0);
+    est->low = est->estimate - margin;
+    est->high = est->estimate + margin;
+    est->pagesRead = n;
+    est->rowsRead = state.rowsRead;
+    est->rowsMatched = state.rowsMatched;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------
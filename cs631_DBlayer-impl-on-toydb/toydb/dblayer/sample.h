@@ -0,0 +1,55 @@
+#ifndef _SAMPLE_H_
+#define _SAMPLE_H_
+#include <stdbool.h>
+#include "tbl.h"
+#include "pred.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Block sampling: Table_Sample reads a share of the table's pages, picked at random
+// without replacement (the same for the same seed), in page order, and passes each
+// of their rows to a callback like Table_Scan does.
+//
+// Approximate aggregates over such a sample: the pages read are a simple random
+// sample of the table's, so the total of a page scaled up by the page count is an
+// unbiased estimate of the table's total (COUNT, SUM), and the ratio of two totals
+// estimates AVG. The confidence intervals come from the spread of the page totals,
+// with the finite population correction: they narrow to the exact value as the
+// share read goes to 1. Rows of a page tend to be alike, so the interval is wider
+// than for as many rows picked one by one; it is what the pages read tell.
+//
+// Table_Sample(fraction) reads fraction * N of the table's N pages, rounded to the
+// nearest count, all of them for a fraction of 1 or more, none for 0 or less, and
+// at least one for any fraction above 0. Sample_Aggregate reads at least
+// SAMPLE_MIN_PAGES, since the spread of fewer page totals gives no interval.
+// The pages of an index-organized table are its N leaves, listed from its inner
+// nodes; the inner nodes and the meta page hold no rows and are never sampled.
+
+#define SAMPLE_COUNT 0
+#define SAMPLE_SUM   1
+#define SAMPLE_AVG   2
+
+#define SAMPLE_Z 1.96 // 95% confidence intervals
+#define SAMPLE_MIN_PAGES 2 // Fewest pages Sample_Aggregate reads, or all of a smaller table
+
+#define SAMPLEE_COLUMN (-46) // Aggregate over a column that is not INT or LONG
+
+typedef struct {
+    double estimate;  // Of the aggregate over the whole table
+    double low, high; // Confidence interval, infinite with fewer than 2 pages read of more
+    int pagesRead;
+    int numPages;          // N: pages of the table, leaves of an index-organized one
+    long long rowsRead;    // Rows of the pages read
+    long long rowsMatched; // Those passing the filter
+} SampleEstimate;
+
+int
+Table_Sample(Table *tbl, double fraction, unsigned long long seed, void *callbackObj, ReadFunc callbackfn);
+
+int
+Sample_Aggregate(Table *tbl, int aggregate, int column, PredicateList *filter,
+                 double fraction, unsigned long long seed, SampleEstimate *est);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,410 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "tbl.h"
+#include "stats.h"
+#include "catalog.h"
+#include "sample.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+#define STATS_HLL_REGISTERS (1 << STATS_HLL_BITS)
+#define STATS_EMPTY_KEY Stats_StringKey("", 0) // The smallest key
+#define STATS_SEED 0x5eed5eed5eed5eedULL
+
+// What Table_Analyze gathers on a column
+typedef struct {
+    long long *sample;     // Reservoir of up to STATS_SAMPLE_ROWS keys
+    int numSample;
+    long long numValues;   // Values read, empty ones left out
+    long long numEmpty;
+    unsigned char registers[STATS_HLL_REGISTERS]; // HyperLogLog sketch
+} ColumnSampler;
+
+// State of Table_Analyze over the rows Table_Sample hands it
+typedef struct {
+    Schema *schema;
+    ColumnSampler *samplers;
+    long long rowsRead;
+    unsigned long long rng;
+} AnalyzeState;
+
+static unsigned long long Stats_Mix(unsigned long long hash)
+{
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL; // splitmix64 finalizer
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+static unsigned long long Stats_Random(unsigned long long *state)
+{
+    *state += 0x9e3779b97f4a7c15ULL;
+    return Stats_Mix(*state);
+}
+
+static int Stats_CompareKeys(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ Key of a VARCHAR value: its first 8 bytes, big-endian and padded with zeros, the
+ sign bit flipped, so that keys compare like the strings (see Pred_AddString)
+ */
+long long Stats_StringKey(char *str, int len)
+{
+    unsigned long long key = 0;
+    for (int i = 0; i < 8; i++)
+        key = (key << 8) | ((i < len) ? (unsigned char)str[i] : 0);
+    return (long long)(key ^ (1ULL << 63));
+}
+
+static void Stats_AddValue(ColumnSampler *sampler, ColumnDesc *col, byte *field, int len, unsigned long long *rng)
+{
+    long long key;
+    unsigned long long hash;
+
+    if (col->type == VARCHAR)
+    {
+        if (len == 0)
+        {
+            sampler->numEmpty++;
+            return;
+        }
+        key = Stats_StringKey((char *)field, len);
+        hash = 0xcbf29ce484222325ULL; // FNV-1a over the whole value
+        for (int i = 0; i < len; i++)
+            hash = (hash ^ field[i]) * 0x100000001b3ULL;
+    }
+    else
+    {
+        key = (col->type == INT) ? DecodeInt(field) : DecodeLong(field);
+        hash = (unsigned long long)key;
+    }
+    hash = Stats_Mix(hash);
+    unsigned long long rest = hash << STATS_HLL_BITS;
+    int rank = (rest == 0) ? 64 - STATS_HLL_BITS + 1 : __builtin_clzll(rest) + 1;
+    unsigned char *reg = &sampler->registers[hash >> (64 - STATS_HLL_BITS)];
+    if (rank > *reg)
+        *reg = rank;
+
+    // Reservoir sampling (algorithm R)
+    sampler->numValues++;
+    if (sampler->numSample < STATS_SAMPLE_ROWS)
+    {
+        sampler->sample[sampler->numSample++] = key;
+    }
+    else
+    {
+        unsigned long long slot = Stats_Random(rng) % (unsigned long long)sampler->numValues;
+        if (slot < STATS_SAMPLE_ROWS)
+            sampler->sample[slot] = key;
+    }
+}
+
+static void Stats_AddRow(void *callbackObj, RecId rid, byte *row, int len)
+{
+    AnalyzeState *state = (AnalyzeState *)callbackObj;
+    int fieldLen;
+
+    state->rowsRead++;
+    for (int i = 0; i < state->schema->numColumns; i++)
+    {
+        byte *field = Record_FieldOrDefault(state->schema, row, len, i, &fieldLen);
+        Stats_AddValue(&state->samplers[i], state->schema->columns[i], field, fieldLen, &state->rng);
+    }
+}
+
+static double Stats_HllEstimate(ColumnSampler *sampler)
+{
+    double m = STATS_HLL_REGISTERS, sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < STATS_HLL_REGISTERS; i++)
+    {
+        sum += ldexp(1.0, -sampler->registers[i]);
+        zeros += (sampler->registers[i] == 0);
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) // Linear counting for small sets
+        estimate = m * log(m / zeros);
+    return estimate;
+}
+
+static bool Stats_IsMcv(ColumnStats *cs, long long key)
+{
+    for (int i = 0; i < cs->numMcvs; i++)
+    {
+        if (cs->mcvs[i] == key)
+            return true;
+    }
+    return false;
+}
+
+/*
+ Turns what was gathered on a column, out of rowsRead rows of the table's
+ numRows, into its statistics. Sorts the sampler's keys.
+ */
+static void Stats_Build(ColumnSampler *sampler, long long rowsRead, double numRows, ColumnStats *cs)
+{
+    long long *sample = sampler->sample;
+    int n = sampler->numSample;
+
+    memset(cs, 0, sizeof(ColumnStats));
+    cs->nullFrac = (rowsRead > 0) ? (double)sampler->numEmpty / rowsRead : 0;
+    if (n == 0)
+    {
+        return;
+    }
+    qsort(sample, n, sizeof(long long), Stats_CompareKeys);
+
+    // Distinct keys of the sample, those seen once, and the most common
+    long long distinct = 0, once = 0;
+    int counts[STATS_MCV_COUNT];
+    for (int i = 0, run; i < n; i += run)
+    {
+        for (run = 1; i + run < n && sample[i + run] == sample[i]; run++)
+            ;
+        distinct++;
+        once += (run == 1);
+        int at = cs->numMcvs;
+        while (at > 0 && counts[at - 1] < run)
+            at--;
+        if (at == STATS_MCV_COUNT)
+            continue;
+        int last = (cs->numMcvs < STATS_MCV_COUNT) ? cs->numMcvs++ : STATS_MCV_COUNT - 1;
+        memmove(&counts[at + 1], &counts[at], (last - at) * sizeof(int));
+        memmove(&cs->mcvs[at + 1], &cs->mcvs[at], (last - at) * sizeof(long long));
+        counts[at] = run;
+        cs->mcvs[at] = sample[i];
+    }
+
+    double values = numRows * (1 - cs->nullFrac);
+    if (n == sampler->numValues && rowsRead >= numRows)
+        cs->ndv = distinct; // Every value was counted
+    else if (rowsRead >= numRows)
+        cs->ndv = Stats_HllEstimate(sampler);
+    else
+    {
+        cs->ndv = n * (double)distinct / (n - once + once * n / values); // Haas-Stokes Duj1
+        if (cs->ndv < Stats_HllEstimate(sampler)) // Values seen in the pages read
+            cs->ndv = Stats_HllEstimate(sampler);
+    }
+    if (cs->ndv > values)
+        cs->ndv = values;
+    if (cs->ndv < distinct)
+        cs->ndv = distinct;
+
+    // Keep values well above the average frequency, or all of them if they fit
+    int keep = 0;
+    while (keep < cs->numMcvs && (distinct <= STATS_MCV_COUNT
+            || (counts[keep] > 1 && counts[keep] * (double)distinct > 1.25 * n)))
+    {
+        cs->mcvFreqs[keep] = (double)counts[keep] / n * (1 - cs->nullFrac);
+        keep++;
+    }
+    cs->numMcvs = keep;
+
+    // Histogram of the other values
+    int m = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!Stats_IsMcv(cs, sample[i]))
+            sample[m++] = sample[i];
+    }
+    if (m >= 2)
+    {
+        cs->numBounds = (m < STATS_HISTOGRAM_BUCKETS + 1) ? m : STATS_HISTOGRAM_BUCKETS + 1;
+        for (int i = 0; i < cs->numBounds; i++)
+            cs->bounds[i] = sample[(long long)i * (m - 1) / (cs->numBounds - 1)];
+    }
+}
+
+/*
+ Collects the column statistics of the table from samplePages of its pages picked
+ at random by Table_Sample (STATS_SAMPLE_PAGES if samplePages is 0 or less, all of them if it has
+ no more), and records them, with the estimated row count, in its catalog.
+ Returns 0, CATE_INVALID for a table without a schema, or an error code
+ */
+int Table_Analyze(Table *tbl, int samplePages)
+{
+    Schema *schema = tbl->schema;
+    AnalyzeState state;
+    int numPages;
+
+    if (schema == NULL)
+    {
+        return CATE_INVALID;
+    }
+    int ret_val = PF_GetNumPages(tbl->file_descriptor, &numPages);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    if (samplePages <= 0)
+        samplePages = STATS_SAMPLE_PAGES;
+    state.schema = schema;
+    state.rowsRead = 0;
+    state.rng = STATS_SEED;
+    state.samplers = (ColumnSampler *)calloc(schema->numColumns, sizeof(ColumnSampler));
+    ColumnStats *columnStats = (ColumnStats *)calloc(schema->numColumns, sizeof(ColumnStats));
+    bool ok = (state.samplers != NULL && columnStats != NULL);
+    for (int i = 0; ok && i < schema->numColumns; i++)
+        ok = (state.samplers[i].sample = (long long *)malloc(STATS_SAMPLE_ROWS * sizeof(long long))) != NULL;
+    if (!ok)
+        ret_val = PFE_NOMEM;
+
+    int numRead = 0;
+    if (ret_val == 0)
+    {
+        numRead = Table_Sample(tbl, (samplePages < numPages) ? (double)samplePages / numPages : 1,
+                               STATS_SEED, &state, Stats_AddRow);
+        ret_val = (numRead < 0) ? numRead : 0;
+    }
+    if (ret_val == 0)
+    {
+        double numRows = (numRead < numPages) ? (double)state.rowsRead * numPages / numRead : state.rowsRead;
+        for (int i = 0; i < schema->numColumns; i++)
+            Stats_Build(&state.samplers[i], state.rowsRead, numRows, &columnStats[i]);
+        tbl->stats.numRows = llround(numRows);
+        tbl->stats.numPages = numPages;
+        free(tbl->columnStats);
+        tbl->columnStats = columnStats;
+        columnStats = NULL;
+        ret_val = Catalog_Write(tbl);
+    }
+    for (int i = 0; state.samplers != NULL && i < schema->numColumns; i++)
+        free(state.samplers[i].sample);
+    free(state.samplers);
+    free(columnStats);
+    return ret_val;
+}
+
+static bool Stats_Matches(long long value, int op, long long key)
+{
+    switch (op)
+    {
+    case EQUAL:
+        return value == key;
+    case NOT_EQUAL:
+        return value != key;
+    case LESS_THAN:
+        return value < key;
+    case LESS_THAN_EQUAL:
+        return value <= key;
+    case GREATER_THAN:
+        return value > key;
+    case GREATER_THAN_EQUAL:
+        return value >= key;
+    }
+    return true;
+}
+
+/*
+ Share of the histogram's values below key, interpolating within its bucket
+ */
+static double Stats_HistogramBelow(ColumnStats *cs, long long key)
+{
+    int last = cs->numBounds - 1;
+    if (last < 1)
+    {
+        return 0.5;
+    }
+    if (key <= cs->bounds[0])
+    {
+        return 0;
+    }
+    if (key > cs->bounds[last])
+    {
+        return 1;
+    }
+    int i = 0;
+    while (i < last - 1 && cs->bounds[i + 1] < key)
+        i++;
+    double width = (double)cs->bounds[i + 1] - (double)cs->bounds[i];
+    double part = (width > 0) ? ((double)key - (double)cs->bounds[i]) / width : 0.5;
+    return (i + part) / last;
+}
+
+/*
+ Estimated share of the table's rows whose value in column satisfies "op key",
+ key as described in stats.h. Without statistics, falls back on fixed guesses.
+ */
+double Stats_Selectivity(Table *tbl, int column, int op, long long key)
+{
+    if (op == ALL)
+    {
+        return 1;
+    }
+    if (tbl->columnStats == NULL)
+    {
+        if (op == EQUAL)
+            return STATS_DEFAULT_EQ;
+        return (op == NOT_EQUAL) ? 1 - STATS_DEFAULT_EQ : STATS_DEFAULT_RANGE;
+    }
+    ColumnStats *cs = &tbl->columnStats[column];
+    double sel = Stats_Matches(STATS_EMPTY_KEY, op, key) ? cs->nullFrac : 0;
+    double mcvTotal = 0;
+    for (int i = 0; i < cs->numMcvs; i++)
+    {
+        mcvTotal += cs->mcvFreqs[i];
+        if (Stats_Matches(cs->mcvs[i], op, key))
+            sel += cs->mcvFreqs[i];
+    }
+    // The values left to the histogram, and the share of one of them
+    double rest = 1 - cs->nullFrac - mcvTotal;
+    if (rest < 0)
+        rest = 0;
+    double otherNdv = cs->ndv - cs->numMcvs;
+    bool isMcv = Stats_IsMcv(cs, key);
+    double one = (isMcv || (cs->numBounds > 0 && (key < cs->bounds[0] || key > cs->bounds[cs->numBounds - 1])))
+                 ? 0 : rest / ((otherNdv > 1) ? otherNdv : 1);
+    double below = Stats_HistogramBelow(cs, key);
+
+    switch (op)
+    {
+    case EQUAL:
+        sel += one;
+        break;
+    case NOT_EQUAL:
+        sel += rest - one;
+        break;
+    case LESS_THAN:
+        sel += rest * below;
+        break;
+    case LESS_THAN_EQUAL:
+        sel += rest * below + one;
+        break;
+    case GREATER_THAN:
+        sel += rest * (1 - below) - one;
+        break;
+    case GREATER_THAN_EQUAL:
+        sel += rest * (1 - below);
+        break;
+    }
+    return (sel < 0) ? 0 : (sel > 1) ? 1 : sel;
+}
+
+/*
+ Estimated share of the table's rows passing all of filter's predicates, taken
+ as independent
+ */
+double Stats_FilterSelectivity(Table *tbl, PredicateList *filter)
+{
+    double sel = 1;
+    for (int i = 0; filter != NULL && i < filter->numPreds; i++)
+    {
+        Predicate *pred = &filter->preds[i];
+        long long key = (pred->type == VARCHAR) ? Stats_StringKey(pred->str, pred->strLen) : pred->num;
+        sel *= Stats_Selectivity(tbl, pred->column, pred->op, key);
+    }
+    return sel;
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,56 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+#include <stdbool.h>
+#include "tbl.h"
+#include "pred.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Column statistics for selectivity estimation. Table_Analyze reads a random sample
+// of the table's pages (see sample.h) and records, per column, the share of empty values, the
+// number of distinct values, the most common values (MCVs) with their frequencies
+// and an equi-depth histogram of the other values; the table's catalog keeps them.
+//
+// Values are compared as 64-bit keys: INT and LONG values as they are, VARCHAR
+// values by their first 8 bytes (see Stats_StringKey), which keeps their order.
+// Records have no NULLs; empty VARCHAR values stand in for them.
+//
+// The distinct count comes from a HyperLogLog sketch of the rows read when the
+// whole table was, and from the Haas-Stokes estimator over the sample otherwise:
+// n * d / (n - f1 + f1 * n / N), with d values seen, f1 of them once, in n of N
+// rows (all N when every value in the sample is different).
+
+#define STATS_SAMPLE_PAGES 256      // Pages Table_Analyze reads by default
+#define STATS_SAMPLE_ROWS 30000     // Rows kept per column for MCVs and histogram
+#define STATS_HLL_BITS 10           // 1024 HyperLogLog registers, about 3% error
+#define STATS_MCV_COUNT 32
+#define STATS_HISTOGRAM_BUCKETS 32
+
+#define STATS_DEFAULT_EQ 0.005      // Selectivity of "column = constant" without statistics
+#define STATS_DEFAULT_RANGE (1.0 / 3) // and of a range predicate
+
+typedef struct ColumnStats {
+    double nullFrac;  // Share of empty VARCHAR values
+    double ndv;       // Distinct values, empty ones left out
+    int numMcvs;
+    long long mcvs[STATS_MCV_COUNT];      // Most common first
+    double mcvFreqs[STATS_MCV_COUNT];     // Share of all rows
+    int numBounds;                        // 0, or 2 to STATS_HISTOGRAM_BUCKETS + 1
+    long long bounds[STATS_HISTOGRAM_BUCKETS + 1]; // Each bucket holds as many of the other values
+} ColumnStats;
+
+int
+Table_Analyze(Table *tbl, int samplePages);
+
+long long
+Stats_StringKey(char *str, int len);
+
+double
+Stats_Selectivity(Table *tbl, int column, int op, long long key);
+
+double
+Stats_FilterSelectivity(Table *tbl, PredicateList *filter);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
@@ -3,9 +3,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
 #include "tbl.h"
+#include "db.h"
+#include "fsm.h"
+#include "pred.h"
+#include "record.h"
+#include "ovf.h"
+#include "pax.h"
+#include "zm.h"
+#include "iot.h"
+#include "idx.h"
+#include "catalog.h"
+#include "cluster.h"
 #include "codec.h"
 #include "../pflayer/pf.h"
+#include "../amlayer/am.h"
 
 #define SLOT_COUNT_OFFSET 2
 #define checkerr(err)           \
@@ -21,6 +36,10 @@ int getLen(int slot, byte *pageBuf);
 int getNumSlots(byte *pageBuf);
 void setNumSlots(byte *pageBuf, int nslots);
 int getNthSlotOffset(int slot, char *pageBuf);
+// IMPLEMENTED---------------------------------------------------------------------------------------
+static int Table_OpenFile(char *dbname, Schema *schema, int layout, int keyColumn, bool overwrite, Table **ptable);
+static int Table_DeleteRow(Table *tbl, RecId rid);
+// ---------------------------------------------------------------------------------------
 
 /**
    Opens a paged file, creating one if it doesn't exist, and optionally
@@ -32,16 +51,69 @@ int Table_Open(char *dbname, Schema *schema, bool overwrite, Table **ptable)
 {
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    // Initialize PF, create PF file,
-    PF_Init();
+    return Table_OpenLayout(dbname, schema, TABLE_LAYOUT_ROW, overwrite, ptable);
+
+// ---------------------------------------------------------------------------------------
+}
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Like Table_Open, choosing the page layout of a new table: TABLE_LAYOUT_ROW, or
+ TABLE_LAYOUT_PAX for column minipages (see pax.h), which needs a schema.
+ PAX rows are not split into overflow pages: inserting a row that does not fit
+ in an empty page returns PFE_NOBUF.
+ An existing table keeps the layout its pages were written in.
+ Index-organized tables are created by Table_OpenIndexOrganized.
+ */
+int Table_OpenLayout(char *dbname, Schema *schema, int layout, bool overwrite, Table **ptable)
+{
+    return Table_OpenFile(dbname, schema, layout, -1, overwrite, ptable);
+}
+
+/*
+ Like Table_Open, creating an index-organized table keyed on column keyColumn
+ (INT or LONG) if there is none, see iot.h. A row's record id is its key.
+ Rows longer than IOT_MAX_ROW_SPACE are refused with PFE_NOBUF, and rows whose
+ key is taken with IOTE_DUPLICATEKEY.
+ An existing table keeps the layout (and the key) it was created with.
+ */
+int Table_OpenIndexOrganized(char *dbname, Schema *schema, int keyColumn, bool overwrite, Table **ptable)
+{
+    return Table_OpenFile(dbname, schema, TABLE_LAYOUT_IOT, keyColumn, overwrite, ptable);
+}
+
+/*
+ Opens or creates a table, of layout (and key column, for TABLE_LAYOUT_IOT) if it is new
+ */
+static int Table_OpenFile(char *dbname, Schema *schema, int layout, int keyColumn, bool overwrite, Table **ptable)
+{
+
+    // Initialize PF (only the first time, so tables opened later in the
+    // session keep the buffer pool), create PF file,
+    Db_InitPF();
+    int ret_val = Cluster_Recover(dbname); // A swap of clustered files stopped partway
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
     if (overwrite)
     {
         PF_DestroyFile(dbname);
+        Catalog_Destroy(dbname);
     }
-    int ret_val, file_descriptor, pagenum;
+    int file_descriptor, pagenum;
     char *pagebuf;
     Table *tableHandle;
 
+    // The catalog describes the table, and gives it its schema if the caller has none
+    Catalog cat;
+    bool cataloged = !overwrite && Catalog_Read(dbname, &cat) == PFE_OK;
+    if (cataloged && schema == NULL)
+    {
+        schema = cat.schema;
+    }
+
     file_descriptor = PF_OpenFile(dbname);
     if (file_descriptor < 0)
     {
@@ -56,7 +128,10 @@ int Table_Open(char *dbname, Schema *schema, bool overwrite, Table **ptable)
     // Allocate Table structure  and initialize and return via ptable
     tableHandle = (Table *)malloc(sizeof(Table));
     tableHandle->schema = schema;
+    tableHandle->fname = strdup(dbname);
     tableHandle->file_descriptor = file_descriptor;
+    tableHandle->layout = (schema != NULL) ? layout : TABLE_LAYOUT_ROW;
+    tableHandle->keyColumn = tableHandle->rootPage = -1; // Set for index-organized tables
 
     // Attempt to get the first page of table
     ret_val = PF_GetFirstPage(file_descriptor, &pagenum, &pagebuf);
@@ -66,6 +141,12 @@ int Table_Open(char *dbname, Schema *schema, bool overwrite, Table **ptable)
         tableHandle->firstPageNum = pagenum; // Store the first page number
         tableHandle->currentPageNum = pagenum;
         tableHandle->pagebuf = NULL;
+        tableHandle->layout = PAX_IS_PAGE(pagebuf) ? TABLE_LAYOUT_PAX : TABLE_LAYOUT_ROW;
+        if (IOT_IS_META(pagebuf))
+        {
+            tableHandle->layout = TABLE_LAYOUT_IOT;
+            ret_val = IOT_Load(tableHandle, pagebuf);
+        }
         PF_UnfixPage(tableHandle->file_descriptor, pagenum, false);
 
     }
@@ -74,16 +155,50 @@ int Table_Open(char *dbname, Schema *schema, bool overwrite, Table **ptable)
         tableHandle->firstPageNum = pagenum; // Store the first page number as -1
         tableHandle->currentPageNum = pagenum;
         tableHandle->pagebuf = NULL;
+        ret_val = (layout == TABLE_LAYOUT_IOT) ? IOT_Create(tableHandle, keyColumn) : 0;
     }
-    else
+    if (ret_val < 0)
     {
         // If there's an error other than EOF, close the file and return error
         PF_PrintError("TABLE-INSERT: PF_GetFirstPage");
         PF_CloseFile(file_descriptor);
+        free(tableHandle->fname);
         free(tableHandle);
+        if (cataloged)
+        {
+            Catalog_FreeSchema(cat.schema);
+            free(cat.columnStats);
+        }
         return ret_val; // Return the error code
     }
 
+    tableHandle->bulkAppend = false;
+    tableHandle->tailPinned = false;
+    tableHandle->zmTail = NULL;
+    tableHandle->numIndexes = 0; // See Table_AddIndex
+    tableHandle->columnStats = NULL;
+    tableHandle->ownsSchema = cataloged && schema == cat.schema;
+
+    tableHandle->fsmFD = tableHandle->ovfFD = tableHandle->zmFD = -1;
+    if (tableHandle->layout != TABLE_LAYOUT_IOT) // Leaves are found through the tree
+    {
+        // Open the free-space map, building it if the table has none yet
+        ret_val = FSM_Open(tableHandle, dbname, overwrite);
+        checkerr(ret_val);
+        ret_val = OVF_Open(tableHandle, dbname, overwrite);
+        checkerr(ret_val);
+        ret_val = ZM_Open(tableHandle, dbname, overwrite);
+        checkerr(ret_val);
+    }
+
+    // Reopen the recorded indexes, or record the new table
+    ret_val = Catalog_Attach(tableHandle, cataloged ? &cat : NULL);
+    if (ret_val < 0)
+    {
+        Table_Close(tableHandle);
+        return ret_val;
+    }
+
     *ptable = tableHandle; // Return the initialized Table structure
     // The Table structure only stores the schema. The current functionality
     // does not really need the schema, because we are only concentrating
@@ -99,20 +214,57 @@ void Table_Close(Table *tbl)
     {
         return; // Nothing to close
     }
+    Table_SetBulkAppend(tbl, false); // Releases the tail page
+    Index_Close(tbl);
+    FSM_Close(tbl);
+    OVF_Close(tbl);
+    ZM_Close(tbl);
     // Close file
     int ret_val = PF_CloseFile(tbl->file_descriptor);
     checkerr(ret_val);
 
     // Free the Table struct itself
+    if (tbl->ownsSchema)
+        Catalog_FreeSchema(tbl->schema);
+    free(tbl->columnStats);
+    free(tbl->fname);
     free(tbl);
 // ---------------------------------------------------------------------------------------
 }
 
-int Table_Insert(Table *tbl, byte *record, int len, RecId *rid)
-{
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
+/*
+ Adds record to a fixed page of the table with room for it, in the table's layout
+ Returns its slot or row
+ */
+static int Table_AddToPage(Table *tbl, byte *pagebuf, byte *record, int len, short flags)
+{
+    if (tbl->layout == TABLE_LAYOUT_PAX)
+    {
+        return Pax_AddRow(tbl->schema, pagebuf, record, len);
+    }
+    return Page_AddRecord(pagebuf, record, len, flags);
+}
+
+/*
+ Stores record as given in the heap, with slot flags flags
+ */
+static int Table_InsertStored(Table *tbl, byte *record, int len, short flags, RecId *rid)
+{
     int ret_val;
+    // Space the record takes in a page of the table's layout
+    int space = (tbl->layout == TABLE_LAYOUT_PAX) ? Pax_RowSpace(tbl->schema, record, len) : len;
+    if (tbl->bulkAppend)
+    {
+        // Values the tail page's dictionaries hold take no room in it
+        if (tbl->layout == TABLE_LAYOUT_PAX && tbl->tailPinned)
+            space = Pax_RowSpaceIn(tbl->schema, tbl->pagebuf, record, len);
+        // Append to the fixed tail page, no free-space search and no unfix
+        Pin_TailPage(tbl, space);
+        *rid = BUILD_RECORD_ID(tbl->currentPageNum, Table_AddToPage(tbl, tbl->pagebuf, record, len, flags));
+        return 0;
+    }
     // Check if Table has no pages
     if (tbl->currentPageNum == -1 && tbl->firstPageNum == -1 && tbl->pagebuf == NULL)
     {
@@ -121,168 +273,1194 @@ int Table_Insert(Table *tbl, byte *record, int len, RecId *rid)
     }
     else
     {
-        ret_val = Find_FreeSpace(tbl, len);
-        if (ret_val == -1 || ret_val == PFE_EOF) // Couldn't find required freespace in existing pages
+        ret_val = Find_FreeSpace(tbl, space);
+        if (ret_val == PFE_EOF) // Couldn't find required freespace in existing pages
         {
             ret_val = Alloc_NewPage(tbl); // Allocate a fresh page if len is not enough for remaining space
         }
+        else if (ret_val < 0)
+        {
+            return ret_val;
+        }
     }
     // Get the next free slot on page, and copy record in the free space
     // Update slot and free space index information on top of page.
     // Also unfixes the page
-    Copy_ToFreeSpace(tbl, record, len, rid);
+    Copy_ToFreeSpace(tbl, record, len, flags, rid);
 
     return 0;
+}
+
+/*
+ Stores the overflow stub of a record longer than TABLE_OVERFLOW_THRESHOLD in
+ stub and points record and len at it, see ovf.h. Shorter records are left as they are.
+ Returns the slot flags of the record to store, or a negative PF error code
+ */
+static int Table_StoredForm(Table *tbl, byte **record, int *len, byte *stub)
+{
+    if (*len <= TABLE_OVERFLOW_THRESHOLD)
+    {
+        return 0;
+    }
+    int ret_val = OVF_MakeStub(tbl, *record, *len, stub);
+    if (ret_val < 0)
+    {
+        return ret_val;
+    }
+    *record = stub;
+    *len = ret_val;
+    return SLOT_OVERFLOW;
+}
+
+/*
+ Stores a record in the table's layout, without touching its indexes
+ */
+static int Table_InsertRow(Table *tbl, byte *record, int len, RecId *rid)
+{
+    byte *full = record;
+    int fullLen = len;
+    int flags = 0;
+    byte stub[OVF_STUB_SIZE];
+
+    // Index-organized rows go to their place in key order
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return IOT_Insert(tbl, record, len, rid);
+    }
+    // PAX rows are split over the minipages of one page
+    if (tbl->layout == TABLE_LAYOUT_PAX)
+    {
+        if (Pax_RowSpace(tbl->schema, record, len) > Pax_MaxRowSpace(tbl->schema))
+            return PFE_NOBUF;
+    }
+    else
+    {
+        // Long records leave a stub in the heap and the rest in overflow pages
+        flags = Table_StoredForm(tbl, &record, &len, stub);
+        if (flags < 0)
+        {
+            return flags;
+        }
+    }
+    int ret_val = Table_InsertStored(tbl, record, len, flags, rid);
+    if (ret_val != 0)
+    {
+        if (flags == SLOT_OVERFLOW)
+            OVF_Free(tbl, stub); // The stub was not stored; drop its chain
+        return ret_val;
+    }
+    // The zone map covers the whole record, not just an overflow stub's prefix
+    return ZM_Add(tbl, RECORD_ID_PAGE(*rid), full, fullLen);
+}
+
+// ---------------------------------------------------------------------------------------
+
+int Table_Insert(Table *tbl, byte *record, int len, RecId *rid)
+{
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+    int ret_val = Table_InsertRow(tbl, record, len, rid);
+    if (ret_val != 0 || tbl->numIndexes == 0)
+    {
+        return ret_val;
+    }
+    ret_val = Index_Insert(tbl, *rid, record, len);
+    if (ret_val != 0)
+    {
+        // Not in every index (AME_KEYFULL, say): take the row out again, keeping
+        // the AM error to report
+        int amErrno = AM_Errno;
+        Index_Delete(tbl, *rid, record, len);
+        Table_DeleteRow(tbl, *rid);
+        AM_Errno = amErrno;
+    }
+    return ret_val;
 // ---------------------------------------------------------------------------------------
 }
 
+/*
+ Takes the stored records of a batch whose index inserts failed out of the indexes,
+ then puts them back one by one. From the first that does not go into every index
+ on, the records are deleted again.
+ Returns the number of records kept
+ */
+static int Table_UndoBatch(Table *tbl, byte **records, int *lens, int n, RecId *rids)
+{
+    int amErrno = AM_Errno; // Of the failed insert, to report
+    int kept;
+
+    for (int i = 0; i < n; i++)
+    {
+        Index_Delete(tbl, rids[i], records[i], lens[i]);
+    }
+    for (kept = 0; kept < n; kept++)
+    {
+        if (Index_Insert(tbl, rids[kept], records[kept], lens[kept]) != 0)
+        {
+            Index_Delete(tbl, rids[kept], records[kept], lens[kept]);
+            break;
+        }
+    }
+    for (int i = kept; i < n; i++)
+    {
+        Table_DeleteRow(tbl, rids[i]);
+    }
+    AM_Errno = amErrno;
+    return kept;
+}
+
+/*
+ Inserts n records, appending them through the bulk-append tail page, and
+ returns their record ids in rids. The table's bulk-append mode is restored
+ on exit, so outside bulk-append mode the tail is released again.
+ The keys of the batch go into each index of the table in key order, so that
+ each leaf they reach is fixed once (see idx.h).
+ Returns 0 or the error code of the first insert that failed; the records before it are
+ stored and indexed, that one and those after it are not stored
+ */
+int Table_InsertBatch(Table *tbl, byte **records, int *lens, int n, RecId *rids)
+{
+    bool wasBulk = tbl->bulkAppend;
+    int ret_val = 0, stored;
+
+    tbl->bulkAppend = true;
+    for (stored = 0; stored < n && ret_val == 0; stored++)
+    {
+        ret_val = Table_InsertRow(tbl, records[stored], lens[stored], &rids[stored]);
+    }
+    Table_SetBulkAppend(tbl, wasBulk);
+    if (ret_val != 0)
+        stored--;
+    int index_val = Index_InsertBatch(tbl, rids, records, lens, stored);
+    if (index_val != 0)
+    {
+        // A row not in every index (AME_KEYFULL, say) must not stay in the table
+        Table_UndoBatch(tbl, records, lens, stored, rids);
+    }
+    return (ret_val != 0) ? ret_val : index_val;
+}
+
+/*
+ Turns bulk-append mode on or off. In bulk-append mode inserts go to the tail
+ page, which stays fixed until it is full, then a new page is allocated
+ directly. Turning the mode off unfixes the tail and records its free space.
+ */
+void Table_SetBulkAppend(Table *tbl, bool on)
+{
+    if (!on && tbl->tailPinned)
+    {
+        Unpin_TailPage(tbl);
+    }
+    tbl->bulkAppend = on;
+}
+
 /*
   Given an record id, fill in the record (but at most maxlen bytes). Page is unfixed on exit
-  Returns the number of bytes copied.
+  Returns the number of bytes copied, or PFE_INVALIDPAGE if there is no such record.
  */
 int Table_Get(Table *tbl, RecId rid, byte *record, int maxlen)
 {
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    int slot = rid & 0xFFFF;
-    int pageNum = rid >> 16;
+    // The record id of an index-organized row is its key
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return IOT_Get(tbl, rid, record, maxlen);
+    }
+    int slot = RECORD_ID_SLOT(rid);
+    int pageNum = RECORD_ID_PAGE(rid);
     int len;
     char *pagebuf;
     PageHeader *header;
     int ret_val = PF_GetThisPage(tbl->file_descriptor, pageNum, &pagebuf);
+    // PFE_PAGEFIXED: page is fixed by someone else (e.g. the bulk-append tail), leave it fixed
     if (ret_val != PFE_OK && ret_val != PFE_PAGEFIXED)
     {
         PF_PrintError("TABLE_GET ");
         return 0;
     }
+    // PAX pages rebuild the record from its minipages
+    if (PAX_IS_PAGE(pagebuf))
+    {
+        len = Pax_GetRow(tbl->schema, pagebuf, slot, record, maxlen);
+        if (ret_val == PFE_OK)
+            PF_UnfixPage(tbl->file_descriptor, pageNum, false);
+        return len;
+    }
     // In the page get the slot offset of the record, and
     header = (PageHeader*)pagebuf;
-    int offset = header->recordoffset[slot];
+    if (slot >= header->numRecords || !INSLOT_IS_LIVE(header, slot))
+    {
+        if (ret_val == PFE_OK)
+            PF_UnfixPage(tbl->file_descriptor, pageNum, false);
+        return PFE_INVALIDPAGE; // Deleted or never inserted
+    }
+    int offset = header->slots[slot].offset;
     int recordSize = INSLOT_RECORD_SIZE(header, slot);
+    if (INSLOT_IS_OVERFLOW(header, slot))
+    {
+        // Prefix from the stub, the rest from the overflow chain
+        recordSize = OVF_Read(tbl, &pagebuf[offset], record, maxlen);
+    }
     // memcpy bytes into the record supplied.
-    if (recordSize > maxlen)
+    else if (recordSize > maxlen)
         memcpy(record, &pagebuf[offset], maxlen);
     else
         memcpy(record, &pagebuf[offset], recordSize);
     // Unfix the page
-    PF_UnfixPage(tbl->file_descriptor, pageNum, false);
+    if (ret_val == PFE_OK)
+        PF_UnfixPage(tbl->file_descriptor, pageNum, false);
     return recordSize; // return size of record
 
 // ---------------------------------------------------------------------------------------
 }
-/*
-Scans the table sequentially and calls the callbackfn on each record item
-Passes callbackObj as first parameter to callbackfn
-*/
-void Table_Scan(Table *tbl, void *callbackObj, ReadFunc callbackfn)
-{
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-    int pagenum = -1, ret_val, recordLen;
-    char *pagebuf;
-    RecId recID;
-    byte record[INPAGE_MAXPOSS_RECORD_SIZE];
-    PageHeader *header;
-    // For each page obtained using PF_GetNextPage
-    while (1)
+/*
+ Fixes the page of rid and checks that the record exists. A page that was already
+ fixed (the bulk-append tail, or the current page of an open cursor) is used as is,
+ and *fixedHere is set to false.
+ Returns PFE_OK, PFE_INVALIDPAGE if there is no such record, or a PF error code
+ */
+static int Fix_RecordPage(Table *tbl, RecId rid, char **pagebuf, bool *fixedHere)
+{
+    int slot = RECORD_ID_SLOT(rid);
+    int pageNum = RECORD_ID_PAGE(rid);
+    int ret_val = PF_GetThisPage(tbl->file_descriptor, pageNum, pagebuf);
+    if (ret_val != PFE_OK && ret_val != PFE_PAGEFIXED)
     {
-        ret_val = PF_GetNextPage(tbl->file_descriptor, &pagenum, &pagebuf);
-        if (ret_val == PFE_EOF) // Stop if there are no more pages in table
-            break;
-        if (ret_val == PFE_OK)
-        {
-            header = (PageHeader*)pagebuf;
-            // Unfix the page since Table_Get will be calling pf_getthispage
-            PF_UnfixPage(tbl->file_descriptor, pagenum, false);
-            //    for each record in that page,
-            for (int i = 0; i < header->numRecords; i++)
-            {
-                recID = BUILD_RECORD_ID(pagenum, i);
-                recordLen = Table_Get(tbl, recID, record, INPAGE_MAXPOSS_RECORD_SIZE);
-                callbackfn(callbackObj, recID, record, recordLen);
-            }
-        }
-        else
-        {
-            PF_PrintError("TABLE_SCAN");
-            break;
-        }
+        return ret_val;
     }
-
-// ---------------------------------------------------------------------------------------
+    *fixedHere = (ret_val == PFE_OK);
+    PageHeader *header = (PageHeader *)*pagebuf;
+    bool live = PAX_IS_PAGE(*pagebuf) ? Pax_IsLive(*pagebuf, slot)
+                : (slot < header->numRecords && INSLOT_IS_LIVE(header, slot));
+    if (!live)
+    {
+        if (*fixedHere)
+            PF_UnfixPage(tbl->file_descriptor, pageNum, false);
+        return PFE_INVALIDPAGE;
+    }
+    return PFE_OK;
 }
 
-// IMPLEMENTED---------------------------------------------------------------------------------------
-
-// Helpers
 /*
- Examines page header and attempts to find a page with freespace length atleast len
- Returns -1 if no such page is there, else returns the page number
+ Copies the overflow stub of the record in slot to stub
+ Returns false, copying nothing, if the record is stored inline
  */
-int Find_FreeSpace(Table *table, int len)
+static bool Page_CopyStub(char *pagebuf, int slot, byte *stub)
 {
-    if (table == NULL || len <= 0)
+    PageHeader *header = (PageHeader *)pagebuf;
+    if (PAX_IS_PAGE(pagebuf) || !INSLOT_IS_OVERFLOW(header, slot))
     {
-        return -1; // Invalid input
+        return false;
     }
+    memcpy(stub, pagebuf + header->slots[slot].offset, OVF_STUB_SIZE);
+    return true;
+}
 
-    // Initialize the page buffer and page number
-    char *pagebuf = NULL;
-    int pagenum = table->currentPageNum;
-    PageHeader *header;
-    // Get the first page
-    int ret_val = PF_GetThisPage(table->file_descriptor, pagenum, &pagebuf);
-
-    // Iterate through all pages in the table
-    while (1)
+/*
+ Records the new free space of a page changed through Fix_RecordPage, then
+ unfixes it dirty. A page fixed by someone else is left fixed, but is unfixed
+ dirty and fixed again so that the change is not lost when its holder unfixes
+ it clean; the buffer does not move in between.
+ */
+static int Release_RecordPage(Table *tbl, int pageNum, char *pagebuf, bool fixedHere)
+{
+    int ret_val = FSM_Update(tbl, pageNum, Page_FreeSpace(pagebuf));
+    if (ret_val != PFE_OK)
     {
-        checkerr(ret_val);
+        return ret_val;
+    }
+    ret_val = PF_UnfixPage(tbl->file_descriptor, pageNum, TRUE);
+    if (ret_val != PFE_OK || fixedHere)
+    {
+        return ret_val;
+    }
+    return PF_GetThisPage(tbl->file_descriptor, pageNum, &pagebuf);
+}
 
-        // Access the page header from the page buffer
-        header = (PageHeader*)pagebuf;
+/*
+ Deletes the record rid from the table's pages, without touching its indexes
+ */
+static int Table_DeleteRow(Table *tbl, RecId rid)
+{
+    char *pagebuf;
+    bool fixedHere;
+    byte oldStub[OVF_STUB_SIZE];
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return IOT_Delete(tbl, rid);
+    }
+    int ret_val = Fix_RecordPage(tbl, rid, &pagebuf, &fixedHere);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    bool overflow = Page_CopyStub(pagebuf, RECORD_ID_SLOT(rid), oldStub);
+    if (PAX_IS_PAGE(pagebuf))
+        Pax_DeleteRow(tbl->schema, pagebuf, RECORD_ID_SLOT(rid));
+    else
+        Page_DeleteRecord(pagebuf, RECORD_ID_SLOT(rid));
+    ret_val = Release_RecordPage(tbl, RECORD_ID_PAGE(rid), pagebuf, fixedHere);
+    if (ret_val == PFE_OK && overflow)
+    {
+        ret_val = OVF_Free(tbl, oldStub);
+    }
+    return ret_val;
+}
 
-        // Calculate the amount of free space
-        int freeSpaceSize = INPAGE_FREESPACE_LEFT(header) - PAGEHEADER_ATTR_SIZE /*To accomodate the new entry in record offset array*/;
+/*
+ Deletes the record rid. Its slot becomes a tombstone, which a later insert into
+ the page may reuse, so rid can come to name another record. Its entries are
+ removed from the table's indexes.
+ Returns 0, PFE_INVALIDPAGE if there is no such record, or a PF error code
+ */
+int Table_Delete(Table *tbl, RecId rid)
+{
+    byte *old = NULL;
+    int oldLen;
+    if (tbl->numIndexes == 0)
+    {
+        return Table_DeleteRow(tbl, rid);
+    }
+    int ret_val = Index_GetRow(tbl, rid, &old, &oldLen); // For its keys
+    if (ret_val == 0)
+        ret_val = Table_DeleteRow(tbl, rid);
+    if (ret_val == 0)
+        ret_val = Index_Delete(tbl, rid, old, oldLen);
+    free(old);
+    return ret_val;
+}
 
-        // Check if the free space is sufficient
-        if (freeSpaceSize >= len)
+/*
+ Replaces the record rid by record of length len, without touching the table's indexes
+ */
+static int Table_UpdateRow(Table *tbl, RecId rid, byte *record, int len, RecId *newRid)
+{
+    char *pagebuf;
+    bool fixedHere, inPlace, overflow;
+    byte stub[OVF_STUB_SIZE], oldStub[OVF_STUB_SIZE];
+    byte *full = record;
+    int fullLen = len;
+    if (tbl->layout == TABLE_LAYOUT_IOT)
+    {
+        return IOT_Update(tbl, rid, record, len, newRid);
+    }
+    int flags = 0;
+    if (tbl->layout == TABLE_LAYOUT_ROW)
+        flags = Table_StoredForm(tbl, &record, &len, stub);
+    else if (Pax_RowSpace(tbl->schema, record, len) > Pax_MaxRowSpace(tbl->schema))
+        return PFE_NOBUF;
+    if (flags < 0)
+    {
+        return flags;
+    }
+    int ret_val = Fix_RecordPage(tbl, rid, &pagebuf, &fixedHere);
+    if (ret_val != PFE_OK)
+    {
+        if (flags == SLOT_OVERFLOW)
+            OVF_Free(tbl, stub);
+        return ret_val;
+    }
+    overflow = Page_CopyStub(pagebuf, RECORD_ID_SLOT(rid), oldStub);
+    if (PAX_IS_PAGE(pagebuf))
+    {
+        inPlace = Pax_UpdateRow(tbl->schema, pagebuf, RECORD_ID_SLOT(rid), record, len);
+        if (!inPlace)
+            Pax_DeleteRow(tbl->schema, pagebuf, RECORD_ID_SLOT(rid));
+    }
+    else
+    {
+        inPlace = Page_UpdateRecord(pagebuf, RECORD_ID_SLOT(rid), record, len, flags);
+        if (!inPlace)
+            Page_DeleteRecord(pagebuf, RECORD_ID_SLOT(rid));
+    }
+    ret_val = Release_RecordPage(tbl, RECORD_ID_PAGE(rid), pagebuf, fixedHere);
+    if (ret_val == PFE_OK && overflow)
+    {
+        ret_val = OVF_Free(tbl, oldStub); // The old version's chain
+    }
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    if (inPlace)
+    {
+        *newRid = rid;
+    }
+    else
+    {
+        ret_val = Table_InsertStored(tbl, record, len, flags, newRid);
+        if (ret_val != 0)
         {
-            table->pagebuf = pagebuf;
-            table->currentPageNum = pagenum; // Update current page number to the pagenum found, otherwise this may lead to PFE_PAGEUNFIXED
-            return pagenum; // Found a suitable page, page is now fixed
+            if (flags == SLOT_OVERFLOW)
+                OVF_Free(tbl, stub);
+            return ret_val;
         }
-        // Unfix this page
-        PF_UnfixPage(table->file_descriptor, pagenum, FALSE);
-        // Move to the next page
-        ret_val = PF_GetNextPage(table->file_descriptor, &pagenum, &pagebuf);
-
-        if (ret_val == PFE_EOF)
-            break; // No more pages
     }
-
-    // No suitable page found
-    return -1;
+    return ZM_Add(tbl, RECORD_ID_PAGE(*newRid), full, fullLen);
 }
+
 /*
- Allocates a new page with and sets up page header, page is fixed on exit
- Exits program on error, else returns 0
- Also sets the currentpagenum and pagebuf in table
+ Replaces the record rid by record of length len. The record stays in its slot
+ if its page can hold the new version (compacting the page if needed); otherwise
+ it is deleted and inserted again elsewhere. newRid is set to the record's id
+ afterwards, to which the table's own indexes are moved (see idx.h); other
+ indexes on the table must be updated to it if it changed.
+ The overflow chain of the old version, if any, is freed.
+ In an index-organized table the new id is the new version's key (see IOT_Update).
+ Returns 0, PFE_INVALIDPAGE if there is no such record, or a PF error code
  */
-int Alloc_NewPage(Table *table)
+int Table_Update(Table *tbl, RecId rid, byte *record, int len, RecId *newRid)
 {
-    int pagenum;
-    char *pagebuf;
-    // Allocate a new page
-    int ret_val = PF_AllocPage(table->file_descriptor, &pagenum, &pagebuf);
-    checkerr(ret_val);
-    // Set up page header
-    PageHeader *header = (PageHeader*)pagebuf;
+    byte *old = NULL;
+    int oldLen;
+    if (tbl->numIndexes == 0)
+    {
+        return Table_UpdateRow(tbl, rid, record, len, newRid);
+    }
+    int ret_val = Index_GetRow(tbl, rid, &old, &oldLen); // For its keys
+    if (ret_val == 0)
+        ret_val = Table_UpdateRow(tbl, rid, record, len, newRid);
+    if (ret_val == 0)
+        ret_val = Index_Update(tbl, rid, old, oldLen, *newRid, record, len);
+    free(old);
+    return ret_val;
+}
 
-    // Set the initial number of slots to 0
-    header->numRecords = 0;
+// ---------------------------------------------------------------------------------------
 
-    // Set offset to the end of free space region by pointing at last byte
+/*
+Scans the table sequentially and calls the callbackfn on each record item
+Passes callbackObj as first parameter to callbackfn
+The row passed points into the fixed page buffer and is only valid during the call
+*/
+void Table_Scan(Table *tbl, void *callbackObj, ReadFunc callbackfn)
+{
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+    Table_ScanWhere(tbl, NULL, callbackObj, callbackfn);
+
+// ---------------------------------------------------------------------------------------
+}
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Like Table_Scan, but calls callbackfn only on the records satisfying filter (NULL for all).
+ The predicates are tested on the encoded record in the page, so rejected rows cost no copy or decode.
+ */
+void Table_ScanWhere(Table *tbl, PredicateList *filter, void *callbackObj, ReadFunc callbackfn)
+{
+    TableScan *scan;
+    RecId recID;
+    byte *record;
+    int recordLen, ret_val;
+
+    ret_val = Table_OpenScan(tbl, -1, -1, &scan);
+    checkerr(ret_val);
+    Table_SetScanFilter(scan, filter);
+    // Each page stays fixed until its last record is handed out: no re-fix and no copy per record
+    while ((ret_val = Table_Next(scan, &recID, &record, &recordLen)) == 0)
+    {
+        callbackfn(callbackObj, recID, record, recordLen);
+    }
+    if (ret_val != PFE_EOF)
+    {
+        PF_PrintError("TABLE_SCAN");
+    }
+    Table_CloseScan(scan);
+}
+
+/*
+ One thread of Table_ParallelScan
+ */
+typedef struct {
+    Table *tbl;
+    PredicateList *filter;
+    void *callbackObj;
+    ReadFunc callbackfn;
+    atomic_int *nextPage; // First page of the next morsel to claim, shared by the workers
+    int numPages;
+    int error;
+} ScanWorker;
+
+/*
+ Claims morsels of TABLE_MORSEL_PAGES pages until the table is exhausted, and
+ scans each with a cursor of its own, filtering and calling back in this thread
+ */
+static void *Scan_Worker(void *arg)
+{
+    ScanWorker *worker = (ScanWorker *)arg;
+    TableScan *scan;
+    RecId recID;
+    byte *record;
+    int recordLen, ret_val, start;
+
+    while ((start = atomic_fetch_add(worker->nextPage, TABLE_MORSEL_PAGES)) < worker->numPages)
+    {
+        ret_val = Table_OpenScan(worker->tbl, start, start + TABLE_MORSEL_PAGES - 1, &scan);
+        if (ret_val != 0)
+        {
+            worker->error = ret_val;
+            break;
+        }
+        Table_SetScanFilter(scan, worker->filter);
+        while ((ret_val = Table_Next(scan, &recID, &record, &recordLen)) == 0)
+        {
+            worker->callbackfn(worker->callbackObj, recID, record, recordLen);
+        }
+        Table_CloseScan(scan);
+        if (ret_val != PFE_EOF)
+        {
+            worker->error = ret_val;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ Scans the table with numWorkers threads, the calling thread being worker 0.
+ Workers claim ranges of TABLE_MORSEL_PAGES pages from a shared counter, so a
+ slow worker holds up no one, and test filter (NULL for all) on the records of
+ their pages. Worker w calls callbackfn with callbackObjs[w]: callbacks run
+ concurrently, each on its own object, in no particular order across workers.
+ Results are merged by the caller once this returns. The callbacks must not
+ modify the table.
+ Returns 0, or the first error a worker ran into
+ */
+int Table_ParallelScan(Table *tbl, PredicateList *filter, int numWorkers,
+                       void **callbackObjs, ReadFunc callbackfn)
+{
+    if (numWorkers < 1)
+        numWorkers = 1;
+    ScanWorker workers[numWorkers];
+    pthread_t threads[numWorkers];
+    bool started[numWorkers];
+    atomic_int nextPage = 0;
+    int numPages, ret_val;
+
+    // Release the bulk-append tail here, rather than from every worker's cursor
+    if (tbl->tailPinned)
+        Unpin_TailPage(tbl);
+    ret_val = PF_GetNumPages(tbl->file_descriptor, &numPages);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    for (int w = 0; w < numWorkers; w++)
+    {
+        workers[w] = (ScanWorker){tbl, filter, callbackObjs[w], callbackfn, &nextPage, numPages, 0};
+        // A worker that cannot be started just leaves its morsels to the others
+        started[w] = (w > 0 && pthread_create(&threads[w], NULL, Scan_Worker, &workers[w]) == 0);
+    }
+    Scan_Worker(&workers[0]);
+    ret_val = workers[0].error;
+    for (int w = 1; w < numWorkers; w++)
+    {
+        if (started[w])
+            pthread_join(threads[w], NULL);
+        if (ret_val == 0)
+            ret_val = workers[w].error;
+    }
+    return ret_val;
+}
+
+/*
+ Opens a cursor over the records of pages startPage to stopPage (both included,
+ -1 for the first page and the last page respectively).
+ Returns 0 on success and a negative error code otherwise.
+ */
+int Table_OpenScan(Table *tbl, int startPage, int stopPage, TableScan **pscan)
+{
+    if (tbl->layout == TABLE_LAYOUT_IOT && stopPage == -1)
+    {
+        return Table_ResumeScan(tbl, LLONG_MIN, -1, pscan); // Every key, in order
+    }
+    return Table_ResumeScan(tbl, BUILD_RECORD_ID((startPage < 0 ? 0 : startPage), 0), stopPage, pscan);
+}
+
+/*
+ Opens a cursor that starts at the record a previous cursor would have returned
+ next, as given by Table_ScanToken, and stops after page stopPage (-1 for the end).
+ An index-organized table scanned to its end returns its rows in key order,
+ and the token is then the smallest key left to return.
+ */
+int Table_ResumeScan(Table *tbl, RecId token, int stopPage, TableScan **pscan)
+{
+    TableScan *scan = (TableScan *)malloc(sizeof(TableScan));
+    if (scan == NULL)
+    {
+        return PFE_NOMEM;
+    }
+    // The page walk cannot fix a pinned tail page, release it
+    if (tbl->tailPinned)
+        Unpin_TailPage(tbl);
+
+    scan->tbl = tbl;
+    scan->stopPage = stopPage;
+    scan->pagenum = RECORD_ID_PAGE(token) - 1; // PF_GetNextPage starts after this page
+    scan->pagebuf = NULL;
+    scan->slot = RECORD_ID_SLOT(token);
+    scan->done = false;
+    scan->filter = NULL;
+    scan->projection = 0;
+    scan->ovfBuf = NULL;
+    scan->ovfBufSize = 0;
+    scan->keyOrder = (tbl->layout == TABLE_LAYOUT_IOT && stopPage == -1);
+    scan->keyLow = token;
+    scan->keyHigh = LLONG_MAX;
+    scan->nextLeaf = SCAN_DESCEND;
+    if (scan->keyOrder)
+    {
+        scan->pagenum = -1;
+        scan->slot = 0;
+    }
+    *pscan = scan;
+    return 0;
+}
+
+/*
+ Fixes the next used page of a scan range by page number, never touching a page past
+ stopPage: parallel workers scan adjacent ranges and must not fix each other's pages.
+ Pages the zone map shows cannot satisfy the scan's filter are skipped unread.
+ */
+static int Scan_NextPageInRange(TableScan *scan)
+{
+    int numPages, ret_val;
+
+    ret_val = PF_GetNumPages(scan->tbl->file_descriptor, &numPages);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    int last = (scan->stopPage != -1 && scan->stopPage < numPages - 1) ? scan->stopPage : numPages - 1;
+    for (int pageNum = scan->pagenum + 1; pageNum <= last; pageNum++)
+    {
+        if (!ZM_MayMatch(scan->tbl, pageNum, scan->filter))
+            continue;
+        ret_val = PF_GetThisPage(scan->tbl->file_descriptor, pageNum, &scan->pagebuf);
+        if (ret_val == PFE_OK)
+        {
+            scan->pagenum = pageNum;
+            return PFE_OK;
+        }
+        if (ret_val != PFE_INVALIDPAGE) // Free pages are skipped
+        {
+            return ret_val;
+        }
+    }
+    if (last > scan->pagenum)
+    {
+        scan->pagenum = last; // Token points just past the pages looked at
+        scan->slot = 0;
+    }
+    return PFE_EOF;
+}
+
+/*
+ Looks up the constants of the filter's equality tests on dictionary encoded
+ columns of the scan's PAX page, so that Scan_PaxRow compares codes instead of strings.
+ Returns false if one of them is not in the page, which then has no match
+ (its code is PAX_NO_CODE, which no row has)
+ */
+static bool Scan_ResolveCodes(TableScan *scan)
+{
+    PredicateList *filter = scan->filter;
+    bool found = true;
+
+    for (int i = 0; filter != NULL && i < filter->numPreds; i++)
+    {
+        Predicate *pred = &filter->preds[i];
+        scan->codes[i] = SCAN_NO_CODE;
+        if (pred->type != VARCHAR || pred->op != EQUAL || !Pax_IsDictColumn(scan->pagebuf, pred->column))
+            continue;
+        scan->codes[i] = Pax_FindCode(scan->pagebuf, pred->column, (byte *)pred->str, pred->strLen);
+        if (scan->codes[i] == PAX_NO_CODE)
+            found = false;
+    }
+    return found;
+}
+
+/*
+ Narrows the key range of a key-order scan to the keys its filter allows
+ */
+static void Scan_KeyRange(TableScan *scan)
+{
+    Pred_Range(scan->filter, scan->tbl->keyColumn, &scan->keyLow, &scan->keyHigh);
+}
+
+/*
+ Fixes the next leaf of a key-order scan: the leaf covering its first key, then
+ the following ones
+ */
+static int Scan_NextLeaf(TableScan *scan)
+{
+    Table *tbl = scan->tbl;
+    int ret_val;
+
+    if (scan->nextLeaf == SCAN_DESCEND)
+    {
+        Scan_KeyRange(scan);
+        if (scan->keyLow > scan->keyHigh)
+            return PFE_EOF;
+        ret_val = IOT_FixLeaf(tbl, scan->keyLow, &scan->pagenum, &scan->pagebuf);
+        if (ret_val != PFE_OK)
+            return ret_val;
+        scan->slot = IOT_LeafSearch(tbl, scan->pagebuf, scan->keyLow, NULL);
+    }
+    else
+    {
+        if (scan->nextLeaf == -1)
+            return PFE_EOF;
+        ret_val = PF_GetThisPage(tbl->file_descriptor, scan->nextLeaf, &scan->pagebuf);
+        if (ret_val != PFE_OK)
+            return ret_val;
+        scan->pagenum = scan->nextLeaf;
+        scan->slot = 0;
+    }
+    scan->nextLeaf = ((IotLeaf *)scan->pagebuf)->nextLeaf;
+    return PFE_OK;
+}
+
+/*
+ Fixes the next page of the scan range, or marks the scan done
+ Returns 0, PFE_EOF or a negative error code
+ */
+static int Scan_NextPage(TableScan *scan)
+{
+    int expected = scan->pagenum + 1;
+    int ret_val;
+
+    if (scan->keyOrder)
+    {
+        ret_val = Scan_NextLeaf(scan);
+        if (ret_val != PFE_OK)
+        {
+            scan->pagebuf = NULL;
+            if (ret_val == PFE_EOF)
+                scan->done = true;
+        }
+        return ret_val;
+    }
+    while (1)
+    {
+        if (scan->stopPage == -1 && (scan->filter == NULL || scan->tbl->zmFD < 0))
+            ret_val = PF_GetNextPage(scan->tbl->file_descriptor, &scan->pagenum, &scan->pagebuf);
+        else
+            ret_val = Scan_NextPageInRange(scan);
+        if (ret_val != PFE_OK)
+        {
+            scan->pagebuf = NULL;
+            if (ret_val == PFE_EOF)
+                scan->done = true;
+            return ret_val;
+        }
+        if (scan->pagenum != expected)
+        {
+            scan->slot = 0; // Resume position was on a page that is gone
+        }
+        if (!PAX_IS_PAGE(scan->pagebuf) || Scan_ResolveCodes(scan))
+        {
+            return 0;
+        }
+        PF_UnfixPage(scan->tbl->file_descriptor, scan->pagenum, false);
+        scan->slot = 0;
+    }
+}
+
+/*
+ Restricts the scan to the records satisfying filter from now on (NULL for all).
+ The filter must outlive the scan.
+ */
+void Table_SetScanFilter(TableScan *scan, PredicateList *filter)
+{
+    scan->filter = filter;
+    if (scan->pagebuf != NULL && PAX_IS_PAGE(scan->pagebuf))
+    {
+        Scan_ResolveCodes(scan);
+    }
+}
+
+/*
+ Tells the scan which columns will be read from the records it returns: bit i
+ of columns for column i of the schema, 0 for all. Overflow records whose
+ projected and filtered columns all lie in their inline prefix are then returned
+ without reading their overflow pages; the other columns of such records are not valid.
+ */
+void Table_SetScanProjection(TableScan *scan, unsigned long long columns)
+{
+    scan->projection = columns;
+}
+
+/*
+ Returns true if the columns the scan uses all lie in the inline prefix of an
+ overflow record, which needs the schema's V1 offsets to be known
+ */
+static bool Scan_PrefixSuffices(TableScan *scan, byte *stub)
+{
+    Schema *schema = scan->tbl->schema;
+    unsigned long long used = scan->projection;
+    int fieldLen;
+
+    if (used == 0 || schema == NULL || schema->recordFormat != RECORD_FORMAT_V1
+            || schema->headerSize > TABLE_INLINE_PREFIX)
+    {
+        return false;
+    }
+    for (int i = 0; scan->filter != NULL && i < scan->filter->numPreds; i++)
+    {
+        used |= 1ULL << scan->filter->preds[i].column;
+    }
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        if (!(used & (1ULL << c)))
+            continue;
+        byte *prefix = OVF_STUB_PREFIX(stub);
+        byte *field = Record_Field(schema, prefix, OVF_STUB_LENGTH(stub), c, &fieldLen);
+        if (field == NULL || field - prefix + fieldLen > TABLE_INLINE_PREFIX)
+            return false;
+    }
+    return true;
+}
+
+/*
+ Points record and len at an overflow record: its inline prefix if that is all
+ the scan uses, else the whole record read into the scan's overflow buffer
+ */
+static int Scan_Overflow(TableScan *scan, byte *stub, byte **record, int *len)
+{
+    int fullLen = OVF_STUB_LENGTH(stub);
+
+    if (Scan_PrefixSuffices(scan, stub))
+    {
+        *record = OVF_STUB_PREFIX(stub);
+        *len = TABLE_INLINE_PREFIX;
+        return 0;
+    }
+    if (fullLen > scan->ovfBufSize)
+    {
+        byte *buf = (byte *)realloc(scan->ovfBuf, fullLen);
+        if (buf == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        scan->ovfBuf = buf;
+        scan->ovfBufSize = fullLen;
+    }
+    *record = scan->ovfBuf;
+    *len = OVF_Read(scan->tbl, stub, scan->ovfBuf, fullLen);
+    return (*len < 0) ? *len : 0;
+}
+
+/*
+ Returns false if a live row of the scan's PAX page fails one of the filter's
+ equality tests on a dictionary encoded column, by its code
+ */
+static bool Scan_CodesMatch(TableScan *scan, int row)
+{
+    PredicateList *filter = scan->filter;
+
+    for (int i = 0; filter != NULL && i < filter->numPreds; i++)
+    {
+        if (scan->codes[i] != SCAN_NO_CODE
+                && Pax_Code(scan->pagebuf, filter->preds[i].column, row) != scan->codes[i])
+            return false;
+    }
+    return true;
+}
+
+/*
+ Rebuilds the next live row of the scan's PAX page satisfying the filter into the
+ scan's buffer. Returns 0, or PFE_EOF once the page is exhausted and unfixed
+ */
+static int Scan_PaxRow(TableScan *scan, RecId *rid, byte **record, int *len)
+{
+    PaxHeader *header = (PaxHeader *)scan->pagebuf;
+    int ret_val;
+
+    if (scan->ovfBufSize < 2 * PF_PAGE_SIZE)
+    {
+        byte *buf = (byte *)realloc(scan->ovfBuf, 2 * PF_PAGE_SIZE); // Holds any row of a page
+        if (buf == NULL)
+        {
+            return PFE_NOMEM;
+        }
+        scan->ovfBuf = buf;
+        scan->ovfBufSize = 2 * PF_PAGE_SIZE;
+    }
+    for (; scan->slot < header->numRows; scan->slot++)
+    {
+        if (!Scan_CodesMatch(scan, scan->slot))
+            continue;
+        ret_val = Pax_GetRow(scan->tbl->schema, scan->pagebuf, scan->slot, scan->ovfBuf, scan->ovfBufSize);
+        if (ret_val < 0)
+            continue; // Deleted
+        if (scan->filter == NULL || Pred_Eval(scan->filter, scan->ovfBuf, ret_val))
+        {
+            *rid = BUILD_RECORD_ID(scan->pagenum, scan->slot);
+            *record = scan->ovfBuf;
+            *len = ret_val;
+            scan->slot++;
+            return 0;
+        }
+    }
+    PF_UnfixPage(scan->tbl->file_descriptor, scan->pagenum, false);
+    scan->pagebuf = NULL;
+    return PFE_EOF;
+}
+
+/*
+ Returns the next row of the scan's index-organized table page satisfying the
+ filter, pointing into the page; its record id is its key. Inner and meta pages,
+ met by scans in page order, have none. A key-order scan ends past its last key.
+ Returns 0, or PFE_EOF once the page is exhausted and unfixed
+ */
+static int Scan_IotRow(TableScan *scan, RecId *rid, byte **record, int *len)
+{
+    IotLeaf *leaf = (IotLeaf *)scan->pagebuf;
+
+    for (; IOT_IS_LEAF(scan->pagebuf) && scan->slot < leaf->numRows; scan->slot++)
+    {
+        *record = IOT_LeafRow(scan->pagebuf, scan->slot, len);
+        long long key = IOT_RowKey(scan->tbl, *record, *len);
+        if (scan->keyOrder)
+        {
+            if (key > scan->keyHigh)
+            {
+                scan->done = true;
+                break;
+            }
+            scan->keyLow = (key == LLONG_MAX) ? key : key + 1;
+        }
+        if (scan->filter == NULL || Pred_Eval(scan->filter, *record, *len))
+        {
+            *rid = key;
+            scan->slot++;
+            return 0;
+        }
+    }
+    PF_UnfixPage(scan->tbl->file_descriptor, scan->pagenum, false);
+    scan->pagebuf = NULL;
+    return PFE_EOF;
+}
+
+/*
+ Returns the next record of the scan in record and len, pointing into the page
+ buffer, or into the scan's own buffer for a record stored in overflow pages. The pointer is valid until the next call on the cursor or its close.
+ Deleted records and those rejected by the scan's filter are skipped in place.
+ Returns 0, PFE_EOF at the end of the range, or a negative error code
+ */
+int Table_Next(TableScan *scan, RecId *rid, byte **record, int *len)
+{
+    PageHeader *header;
+    int ret_val;
+
+    while (1)
+    {
+        if (scan->pagebuf == NULL)
+        {
+            if (scan->done)
+                return PFE_EOF;
+            if ((ret_val = Scan_NextPage(scan)) != 0)
+                return ret_val;
+        }
+        if (PAX_IS_PAGE(scan->pagebuf))
+        {
+            if ((ret_val = Scan_PaxRow(scan, rid, record, len)) != PFE_EOF)
+                return ret_val;
+            scan->slot = 0; // Page exhausted, Scan_PaxRow released it
+            continue;
+        }
+        if (IOT_IS_PAGE(scan->pagebuf))
+        {
+            if ((ret_val = Scan_IotRow(scan, rid, record, len)) != PFE_EOF)
+                return ret_val;
+            scan->slot = 0; // Page exhausted, Scan_IotRow released it
+            continue;
+        }
+        header = (PageHeader *)scan->pagebuf;
+        while (scan->slot < header->numRecords)
+        {
+            if (!INSLOT_IS_LIVE(header, scan->slot))
+            {
+                scan->slot++;
+                continue;
+            }
+            *rid = BUILD_RECORD_ID(scan->pagenum, scan->slot);
+            *record = scan->pagebuf + header->slots[scan->slot].offset;
+            *len = INSLOT_RECORD_SIZE(header, scan->slot);
+            if (INSLOT_IS_OVERFLOW(header, scan->slot)
+                    && (ret_val = Scan_Overflow(scan, *record, record, len)) != 0)
+                return ret_val;
+            scan->slot++;
+            if (scan->filter == NULL || Pred_Eval(scan->filter, *record, *len))
+                return 0;
+        }
+        // Page exhausted, release it
+        PF_UnfixPage(scan->tbl->file_descriptor, scan->pagenum, false);
+        scan->pagebuf = NULL;
+        scan->slot = 0;
+    }
+}
+
+/*
+ Returns up to maxRecords next records of the scan, all from the same page, so
+ the pointers stay valid until the next call on the cursor or its close.
+ Returns the number of records, 0 at the end of the range, or a negative error code
+ */
+int Table_NextBatch(TableScan *scan, RecId *rids, byte **records, int *lens, int maxRecords)
+{
+    int n = 0, ret_val;
+
+    if (maxRecords <= 0)
+        return 0;
+    ret_val = Table_Next(scan, &rids[0], &records[0], &lens[0]);
+    if (ret_val != 0)
+        return (ret_val == PFE_EOF) ? 0 : ret_val;
+
+    // Rest of the batch from the page the first record is on; PAX rows are
+    // rebuilt in the scan's buffer, so one at a time, and so are index-organized
+    // rows, which end key-order scans on their own
+    if (scan->pagebuf == NULL || PAX_IS_PAGE(scan->pagebuf) || IOT_IS_PAGE(scan->pagebuf))
+        return 1;
+    PageHeader *header = (PageHeader *)scan->pagebuf;
+    for (n = 1; n < maxRecords && scan->slot < header->numRecords; scan->slot++)
+    {
+        if (!INSLOT_IS_LIVE(header, scan->slot))
+            continue;
+        if (INSLOT_IS_OVERFLOW(header, scan->slot))
+            break; // Would reuse the overflow buffer, leave it to the next batch
+        rids[n] = BUILD_RECORD_ID(scan->pagenum, scan->slot);
+        records[n] = scan->pagebuf + header->slots[scan->slot].offset;
+        lens[n] = INSLOT_RECORD_SIZE(header, scan->slot);
+        if (scan->filter == NULL || Pred_Eval(scan->filter, records[n], lens[n]))
+            n++;
+    }
+    return n;
+}
+
+/*
+ Returns a continuation token for the scan: the position of the next record it
+ would return. Table_ResumeScan continues from it, even in another session.
+ */
+RecId Table_ScanToken(TableScan *scan)
+{
+    if (scan->keyOrder)
+        return scan->keyLow;
+    if (scan->pagebuf != NULL)
+        return BUILD_RECORD_ID(scan->pagenum, scan->slot);
+    return BUILD_RECORD_ID(scan->pagenum + 1, scan->slot);
+}
+
+void Table_CloseScan(TableScan *scan)
+{
+    if (scan->pagebuf != NULL)
+    {
+        PF_UnfixPage(scan->tbl->file_descriptor, scan->pagenum, false);
+    }
+    free(scan->ovfBuf);
+    free(scan);
+}
+
+// ---------------------------------------------------------------------------------------
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Helpers
+/*
+ Finds a page with freespace length atleast len: the current page if it has room,
+ else the page the free-space map points to
+ Returns the page number, fixed, PFE_EOF if no such page is there, or the PF error
+ code of a page that could not be fixed (PFE_PAGEFIXED if it is fixed already)
+ */
+int Find_FreeSpace(Table *table, int len)
+{
+    if (table == NULL || len <= 0)
+    {
+        return PFE_EOF; // Invalid input
+    }
+
+    char *pagebuf = NULL;
+    int pagenum = table->currentPageNum;
+    int ret_val;
+
+    // At most two page accesses: the current page, then the one from the map
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        ret_val = PF_GetThisPage(table->file_descriptor, pagenum, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+
+        // Check if the free space is sufficient
+        if (Page_FreeSpace(pagebuf) >= len)
+        {
+            table->pagebuf = pagebuf;
+            table->currentPageNum = pagenum; // Update current page number to the pagenum found, otherwise this may lead to PFE_PAGEUNFIXED
+            return pagenum; // Found a suitable page, page is now fixed
+        }
+        // Unfix this page; a map that promised it room is corrected
+        int freeBytes = Page_FreeSpace(pagebuf);
+        PF_UnfixPage(table->file_descriptor, pagenum, FALSE);
+        if (attempt > 0)
+            FSM_Update(table, pagenum, freeBytes);
+
+        pagenum = FSM_Search(table, len);
+        if (pagenum == -1 || pagenum == table->currentPageNum)
+            break;
+    }
+
+    // No suitable page found
+    return PFE_EOF;
+}
+
+/*
+ Returns the number of bytes a new record can take in the page, its slot accounted for.
+ Fragmented bytes count: Page_AddRecord compacts the page when it needs them.
+ For a PAX page, the space new rows can take, see Pax_FreeSpace.
+ */
+int Page_FreeSpace(byte *pagebuf)
+{
+    if (PAX_IS_PAGE(pagebuf))
+    {
+        return Pax_FreeSpace(pagebuf);
+    }
+    PageHeader *header = (PageHeader *)pagebuf;
+    return INPAGE_FREESPACE_LEFT(header) + header->fragmentedBytes - PAGEHEADER_SLOT_SIZE /*To accomodate a new slot*/;
+}
+
+/*
+ Allocates a new page with and sets up page header, page is fixed on exit
+ Exits program on error, else returns 0
+ Also sets the currentpagenum and pagebuf in table
+ */
+int Alloc_NewPage(Table *table)
+{
+    int pagenum;
+    char *pagebuf;
+    // Allocate a new page
+    int ret_val = PF_AllocPage(table->file_descriptor, &pagenum, &pagebuf);
+    checkerr(ret_val);
+    // Set up page header
+    PageHeader *header = (PageHeader*)pagebuf;
+    if (table->layout == TABLE_LAYOUT_PAX)
+    {
+        Pax_InitPage(table->schema, pagebuf);
+        table->currentPageNum = pagenum;
+        table->pagebuf = pagebuf;
+        return 0;
+    }
+
+    // Set the initial number of slots to 0
+    header->numRecords = 0;
+
+    // Set offset to the end of free space region by pointing at last byte
     header->freespaceoffset = PF_PAGE_SIZE - 1;
+    header->fragmentedBytes = 0;
 
     // Update table structure
     table->currentPageNum = pagenum;
@@ -291,29 +1469,190 @@ int Alloc_NewPage(Table *table)
 }
 
 /*
- Copies record of length len to freespace region of page denoted by currentpagenum in table
+ Copies record of length len to freespace region of page denoted by currentpagenum in table,
+ with slot flags flags
  Page is assumed to be fixed
  Exits program on error, else returns 0
  Also updates the page header and sets the record's address to rid
 */
 
-int Copy_ToFreeSpace(Table *table, byte *record, int len, RecId *rid)
+int Copy_ToFreeSpace(Table *table, byte *record, int len, short flags, RecId *rid)
 {
-    // Copy record of length len to freespace region
-    PageHeader *header = (PageHeader*) table->pagebuf;
-    // Get freespace of len bytes in this page's buffer using its header
-    memcpy(INPAGE_INSERT_REGION(header, table->pagebuf, len), record, len);
-    // Update header
-    int slot = header->numRecords; // Get next inpage empty record slot
-    header->recordoffset[slot] = header->freespaceoffset - len + 1; // Adds the offset to this record in slot
-    header->numRecords += 1; // Added a new record
-    header->freespaceoffset -= len; // Freespace shrinks by size of record in bytes
+    int slot = Table_AddToPage(table, table->pagebuf, record, len, flags);
+    // Record the space left in the free-space map
+    int ret_val = FSM_Update(table, table->currentPageNum, Page_FreeSpace(table->pagebuf));
+    checkerr(ret_val);
     // Unfix the page
-    int ret_val  = PF_UnfixPage(table->file_descriptor, table->currentPageNum, TRUE);
+    ret_val  = PF_UnfixPage(table->file_descriptor, table->currentPageNum, TRUE);
     checkerr(ret_val);
     // Set record id
     *rid = BUILD_RECORD_ID(table->currentPageNum, slot);
     return 0;
 }
+
+/*
+ Copies record of length len to the freespace region of a fixed page that has room for it
+ (see Page_FreeSpace), compacting the page first if the free space is fragmented.
+ Reuses the first deleted slot if there is one. flags (SLOT_OVERFLOW or 0) are kept in the slot.
+ Updates the page header and returns the slot of the record
+*/
+int Page_AddRecord(byte *pagebuf, byte *record, int len, short flags)
+{
+    PageHeader *header = (PageHeader*) pagebuf;
+    int slot;
+    // Get next inpage empty record slot
+    for (slot = 0; slot < header->numRecords; slot++)
+    {
+        if (!INSLOT_IS_LIVE(header, slot))
+            break;
+    }
+    int slotBytes = (slot == header->numRecords) ? PAGEHEADER_SLOT_SIZE : 0;
+    if (INPAGE_FREESPACE_LEFT(header) < len + slotBytes)
+    {
+        Page_Compact(pagebuf);
+    }
+    // Get freespace of len bytes in this page's buffer using its header
+    memcpy(INPAGE_INSERT_REGION(header, pagebuf, len), record, len);
+    // Update header
+    header->slots[slot].offset = header->freespaceoffset - len + 1; // Adds the offset to this record in slot
+    header->slots[slot].length = len | flags;
+    if (slot == header->numRecords)
+        header->numRecords += 1; // Added a new slot
+    header->freespaceoffset -= len; // Freespace shrinks by size of record in bytes
+    return slot;
+}
+
+/*
+ Marks the record in slot as deleted. Its bytes join the free space directly if
+ they border it, else they are counted as fragmented until the next compaction.
+ Trailing deleted slots are dropped from the header.
+*/
+void Page_DeleteRecord(byte *pagebuf, int slot)
+{
+    PageHeader *header = (PageHeader*) pagebuf;
+    int len = INSLOT_RECORD_SIZE(header, slot);
+
+    if (header->slots[slot].offset == header->freespaceoffset + 1)
+        header->freespaceoffset += len;
+    else
+        header->fragmentedBytes += len;
+    header->slots[slot].length = SLOT_TOMBSTONE;
+
+    while (header->numRecords > 0 && !INSLOT_IS_LIVE(header, header->numRecords - 1))
+        header->numRecords--;
+}
+
+/*
+ Replaces the record in slot by record of length len, keeping the slot.
+ A record that does not grow is overwritten in place; a larger one is moved
+ within the page, compacting it if needed.
+ The slot's flags become flags.
+ Returns false, leaving the page unchanged, if the page cannot hold the new record
+*/
+bool Page_UpdateRecord(byte *pagebuf, int slot, byte *record, int len, short flags)
+{
+    PageHeader *header = (PageHeader*) pagebuf;
+    int oldLen = INSLOT_RECORD_SIZE(header, slot);
+
+    if (len <= oldLen)
+    {
+        memcpy(pagebuf + header->slots[slot].offset, record, len);
+        header->slots[slot].length = len | flags;
+        header->fragmentedBytes += oldLen - len;
+        return true;
+    }
+    // The old bytes count as free once the record moves; no new slot is needed
+    if (INPAGE_FREESPACE_LEFT(header) + header->fragmentedBytes + oldLen < len)
+    {
+        return false;
+    }
+    header->slots[slot].length = SLOT_TOMBSTONE; // Not kept by a compaction
+    header->fragmentedBytes += oldLen;
+    if (INPAGE_FREESPACE_LEFT(header) < len)
+    {
+        Page_Compact(pagebuf);
+    }
+    memcpy(INPAGE_INSERT_REGION(header, pagebuf, len), record, len);
+    header->slots[slot].offset = header->freespaceoffset - len + 1;
+    header->slots[slot].length = len | flags;
+    header->freespaceoffset -= len;
+    return true;
+}
+
+/*
+ Moves the live records of the page together at the end of the page, so that
+ all free space is contiguous. Slot numbers, and so record ids, are unchanged.
+*/
+void Page_Compact(byte *pagebuf)
+{
+    PageHeader *header = (PageHeader*) pagebuf;
+    char copy[PF_PAGE_SIZE];
+    int end = PF_PAGE_SIZE;
+
+    memcpy(copy, pagebuf, PF_PAGE_SIZE);
+    for (int slot = 0; slot < header->numRecords; slot++)
+    {
+        if (!INSLOT_IS_LIVE(header, slot))
+            continue;
+        int len = INSLOT_RECORD_SIZE(header, slot);
+        end -= len;
+        memcpy(pagebuf + end, copy + header->slots[slot].offset, len);
+        header->slots[slot].offset = end;
+    }
+    header->freespaceoffset = end - 1;
+    header->fragmentedBytes = 0;
+}
+
+/*
+ Makes sure the bulk-append tail page is fixed and has room for len bytes:
+ the page last inserted into if it has room, else a newly allocated page.
+ A tail page that is left behind is unfixed and recorded in the free-space map.
+ Exits program on error
+*/
+void Pin_TailPage(Table *table, int len)
+{
+    char *pagebuf;
+    int ret_val;
+
+    if (table->tailPinned)
+    {
+        if (Page_FreeSpace(table->pagebuf) >= len)
+            return; // Current tail still has room
+        Unpin_TailPage(table);
+    }
+    else if (table->currentPageNum != -1)
+    {
+        // Resume on the page last inserted into
+        ret_val = PF_GetThisPage(table->file_descriptor, table->currentPageNum, &pagebuf);
+        checkerr(ret_val);
+        if (Page_FreeSpace(pagebuf) >= len)
+        {
+            table->pagebuf = pagebuf;
+            table->tailPinned = true;
+            return;
+        }
+        PF_UnfixPage(table->file_descriptor, table->currentPageNum, FALSE);
+    }
+
+    Alloc_NewPage(table);
+    if (table->firstPageNum == -1)
+        table->firstPageNum = table->currentPageNum;
+    table->tailPinned = true;
+}
+
+/*
+ Unfixes the bulk-append tail page and records its free space and zone map entry
+ Exits program on error
+*/
+void Unpin_TailPage(Table *table)
+{
+    int ret_val = ZM_FlushTail(table);
+    checkerr(ret_val);
+    ret_val = FSM_Update(table, table->currentPageNum, Page_FreeSpace(table->pagebuf));
+    checkerr(ret_val);
+    ret_val = PF_UnfixPage(table->file_descriptor, table->currentPageNum, TRUE);
+    checkerr(ret_val);
+    table->tailPinned = false;
+}
 // ---------------------------------------------------------------------------------------
 
@@ -8,39 +8,82 @@
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
-#define PAGEHEADER_FIXED_ATTR_COUNT (2)
-#define PAGEHEADER_VARIABLE_ATTR_COUNT (header->numRecords)
-#define PAGEHEADER_ATTR_SIZE (sizeof(short))
-#define PAGEHEADER_SIZE(header) ( (PAGEHEADER_VARIABLE_ATTR_COUNT + PAGEHEADER_FIXED_ATTR_COUNT) *PAGEHEADER_ATTR_SIZE) // #recordoffset + numRecords + freespaceoffset
+#define PAGEHEADER_FIXED_ATTR_COUNT (3)
+#define PAGEHEADER_VARIABLE_ATTR_COUNT (2 * header->numRecords) // Offset and length per slot
+#define PAGEHEADER_ATTR_SIZE ((int)sizeof(short))
+#define PAGEHEADER_SLOT_SIZE (2 * PAGEHEADER_ATTR_SIZE)
+#define PAGEHEADER_SIZE(header) ( (PAGEHEADER_VARIABLE_ATTR_COUNT + PAGEHEADER_FIXED_ATTR_COUNT) *PAGEHEADER_ATTR_SIZE) // slots + numRecords + freespaceoffset + fragmentedBytes
 
 #define INPAGE_FREESPACE_LEFT(header) (header->freespaceoffset - PAGEHEADER_SIZE(header) + 1) 
-#define INPAGE_MAXPOSS_RECORD_SIZE (PF_PAGE_SIZE - 3*PAGEHEADER_ATTR_SIZE) // Three attributes in page header
+#define INPAGE_MAXPOSS_RECORD_SIZE (PF_PAGE_SIZE - PAGEHEADER_FIXED_ATTR_COUNT*PAGEHEADER_ATTR_SIZE - PAGEHEADER_SLOT_SIZE) // Fixed header and one slot
 #define INPAGE_INSERT_REGION(header,pagebuffer,length) ( (pagebuffer + header->freespaceoffset) - length + 1) 
 
-#define BUILD_RECORD_ID(pagenum,slot) (pagenum << 16 | slot) // 4 Byte Rec ID : [ (MSB) 2 Byte Page num | 2 Byte slot num inside that page (LSB) ]
-#define INSLOT_RECORD_SIZE(header,slot) ( (slot == 0) ?\
-                                                (PF_PAGE_SIZE - header->recordoffset[0])\ 
-                                                    : (header->recordoffset[slot-1] - header->recordoffset[slot]) ); 
+#define BUILD_RECORD_ID(pagenum,slot) ((RecId)(pagenum) << 16 | (slot)) // 8 Byte Rec ID : [ (MSB) 6 Byte Page num | 2 Byte slot num inside that page (LSB) ]
+#define RECORD_ID_PAGE(rid) ((int)((rid) >> 16))
+#define RECORD_ID_SLOT(rid) ((int)((rid) & 0xFFFF))
+#define SLOT_TOMBSTONE (-1) // Length of a deleted record's slot
+#define SLOT_OVERFLOW 0x4000 // Flag in a slot's length: the record is an overflow stub, see ovf.h
+#define SLOT_LENGTH_MASK 0x3FFF
+#define INSLOT_RECORD_SIZE(header,slot) (header->slots[slot].length & SLOT_LENGTH_MASK)
+#define INSLOT_IS_LIVE(header,slot) (header->slots[slot].length != SLOT_TOMBSTONE)
+#define INSLOT_IS_OVERFLOW(header,slot) (INSLOT_IS_LIVE(header,slot) && (header->slots[slot].length & SLOT_OVERFLOW))
 // ---------------------------------------------------------------------------------------
 
 typedef char byte;
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+#define TABLE_LAYOUT_ROW 0 // Slotted pages of whole records
+#define TABLE_LAYOUT_PAX 1 // Pages of column minipages, see pax.h
+#define TABLE_LAYOUT_IOT 2 // Rows in the leaves of a B+ tree on a key column, see iot.h
+// ---------------------------------------------------------------------------------------
+
 typedef struct {
     char *name;
     int  type;  // one of VARCHAR, INT, LONG
+// IMPLEMENTED---------------------------------------------------------------------------------------
+    int  offset; // V1 records: offset of the value (INT, LONG) or of its offset entry (VARCHAR)
+    bool dictionary; // VARCHAR: dictionary encoded in the pages of PAX tables, see pax.h
+// ---------------------------------------------------------------------------------------
 } ColumnDesc;
 
 typedef struct {
     int numColumns;
     ColumnDesc **columns; // array of column descriptors
+// IMPLEMENTED---------------------------------------------------------------------------------------
+    int recordFormat; // RECORD_FORMAT_V0 or RECORD_FORMAT_V1, see record.h
+    int headerSize;   // V1 records: bytes before the VARCHAR data
+// ---------------------------------------------------------------------------------------
 } Schema;
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
 typedef struct {
-    short numRecords;      // Stores the number of records in the page
+    short offset; // Offset of the record in pagebuf
+    short length; // Length of the record in bytes and SLOT_OVERFLOW flag, SLOT_TOMBSTONE once it is deleted
+} PageSlot;
+
+typedef struct {
+    short numRecords;      // Stores the number of slots in the page, tombstones included
     short freespaceoffset; // Stores the offset to the end of freespace region in the pagebuf
-    short recordoffset[]; // Stores the offset of each record in pagebuf which are stored bottom up
+    short fragmentedBytes; // Bytes freed by deletes and updates below the free space, reclaimed by compaction
+    PageSlot slots[];      // Stores the offset and length of each record in pagebuf which are stored bottom up
 } PageHeader;
+
+#define TABLE_MAX_INDEXES 4 // Secondary indexes a table maintains, see idx.h
+
+typedef struct {
+    int indexNo;    // Index number, the index file is "<table>.indexNo"
+    int column;     // Indexed column, INT or VARCHAR
+    char attrType;  // 'i' for an INT column, 'c' for a VARCHAR one, as for AM_CreateIndex
+    int attrLength; // Key length in bytes: 4, or the VARCHAR prefix indexed
+    int fd;         // PF file descriptor of the open index
+} TableIndex;
+
+typedef struct {
+    long long numRows; // Rows when statistics were last collected (estimated from a sample), -1 if they never were
+    int numPages;      // Pages of the table then
+} TableStats;
+
+struct ColumnStats; // see stats.h
 // ---------------------------------------------------------------------------------------
 
 
@@ -48,15 +91,60 @@ typedef struct {
     Schema *schema;
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
+    char *fname; // Name of the table's file, which its side files (see fsm.h, ovf.h, zm.h) extend
     int file_descriptor; // Cache the file descriptor associated with the file representing the table
     int firstPageNum; // Store the address of the head of the page list of the file
     int currentPageNum; // Store the address of the current page of the table being referred
     char* pagebuf; // Points to a page's data buffer
+    int fsmFD; // File descriptor of the table's free-space map (see fsm.h)
+    int ovfFD; // File descriptor of the table's overflow pages (see ovf.h)
+    int zmFD; // File descriptor of the table's zone map (see zm.h), -1 if it has none
+    bool bulkAppend; // Inserts append to a tail page kept fixed, skipping the free-space search
+    bool tailPinned; // Page currentPageNum is fixed as the bulk-append tail
+    byte *zmTail; // Zone map entry of the tail page's rows, not written yet (see zm.h), or NULL
+    int layout; // TABLE_LAYOUT_ROW, TABLE_LAYOUT_PAX or TABLE_LAYOUT_IOT
+    int keyColumn; // TABLE_LAYOUT_IOT: column the rows are keyed and ordered on
+    int rootPage;  // TABLE_LAYOUT_IOT: root of the B+ tree
+    int numIndexes; // Secondary indexes kept current by inserts, deletes and updates
+    TableIndex indexes[TABLE_MAX_INDEXES];
+    bool ownsSchema;  // The schema was read from the catalog and is freed with the table, see catalog.h
+    TableStats stats; // Statistics recorded in the catalog
+    struct ColumnStats *columnStats; // Per column, NULL until the table is analyzed, see Table_Analyze
 // ---------------------------------------------------------------------------------------
 
 } Table ;
 
-typedef int RecId;
+typedef long long RecId; // See BUILD_RECORD_ID; the same 64 bits as AM_RecId in index leaves
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+struct PredicateList; // see pred.h
+
+#define TABLE_SCAN_MAX_CODES 16 // PRED_MAX_PREDICATES
+#define SCAN_NO_CODE (-2)      // Predicate not evaluated on dictionary codes
+
+// Cursor over the records of a table, see Table_OpenScan
+typedef struct {
+    Table *tbl;
+    int stopPage;  // Last page to scan, -1 to scan to the end of the table
+    int pagenum;   // Page being scanned if pagebuf != NULL, else the page before the next one
+    char *pagebuf; // Current page, fixed while not NULL
+    int slot;      // Next slot to return, in page pagenum if pagebuf != NULL, else in page pagenum+1
+    bool done;     // Past stopPage or the last page
+    struct PredicateList *filter; // Only records satisfying it are returned, NULL for all
+    unsigned long long projection; // Bit i set if column i is used, 0 for all columns
+    int codes[TABLE_SCAN_MAX_CODES]; // Per filter predicate, its code in the current PAX page or SCAN_NO_CODE, see Scan_ResolveCodes
+    byte *ovfBuf;  // Overflow record or PAX row last returned
+    int ovfBufSize;
+    bool keyOrder;     // Index-organized table scanned to its end: leaves are walked in key order
+    long long keyLow;  // Key order: next key to return, the scan's token
+    long long keyHigh; // Key order: last key the filter allows
+    int nextLeaf;      // Key order: leaf after the current one, -1 after the last, SCAN_DESCEND before the first
+} TableScan;
+
+#define SCAN_DESCEND (-2)
+
+// ---------------------------------------------------------------------------------------
 
 // IMPLEMENTED---------------------------------------------------------------------------------------
 
@@ -68,7 +156,28 @@ int
 Find_FreeSpace(Table* table, int len);
 
 int
-Copy_ToFreeSpace(Table* table, byte* record, int len, RecId* rid);
+Copy_ToFreeSpace(Table* table, byte* record, int len, short flags, RecId* rid);
+
+int
+Page_FreeSpace(byte* pagebuf);
+
+int
+Page_AddRecord(byte* pagebuf, byte* record, int len, short flags);
+
+void
+Page_DeleteRecord(byte* pagebuf, int slot);
+
+bool
+Page_UpdateRecord(byte* pagebuf, int slot, byte* record, int len, short flags);
+
+void
+Page_Compact(byte* pagebuf);
+
+void
+Pin_TailPage(Table* table, int len);
+
+void
+Unpin_TailPage(Table* table);
 
 // ---------------------------------------------------------------------------------------
 
@@ -76,18 +185,86 @@ Copy_ToFreeSpace(Table* table, byte* record, int len, RecId* rid);
 int
 Table_Open(char *fname, Schema *schema, bool overwrite, Table **table);
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+int
+Table_OpenLayout(char *fname, Schema *schema, int layout, bool overwrite, Table **table);
+
+int
+Table_OpenIndexOrganized(char *fname, Schema *schema, int keyColumn, bool overwrite, Table **table);
+
+// ---------------------------------------------------------------------------------------
+
 int
 Table_Insert(Table *t, byte *record, int len, RecId *rid);
 
+int
+Table_InsertBatch(Table *t, byte **records, int *lens, int n, RecId *rids);
+
+void
+Table_SetBulkAppend(Table *t, bool on);
+
 int
 Table_Get(Table *t, RecId rid, byte *record, int maxlen);
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+int
+Table_Delete(Table *t, RecId rid);
+
+int
+Table_Update(Table *t, RecId rid, byte *record, int len, RecId *newRid);
+
+// ---------------------------------------------------------------------------------------
+
 void
 Table_Close(Table *);
 
+// row points into the page buffer, which stays fixed only for the duration of the call
 typedef void (*ReadFunc)(void *callbackObj, RecId rid, byte *row, int len);
 
 void
 Table_Scan(Table *tbl, void *callbackObj, ReadFunc callbackfn);
 
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+void
+Table_ScanWhere(Table *tbl, struct PredicateList *filter, void *callbackObj, ReadFunc callbackfn);
+
+#define TABLE_MORSEL_PAGES 64 // Pages a parallel scan worker claims at a time
+
+int
+Table_ParallelScan(Table *tbl, struct PredicateList *filter, int numWorkers,
+                   void **callbackObjs, ReadFunc callbackfn);
+
+// ---------------------------------------------------------------------------------------
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+int
+Table_OpenScan(Table *tbl, int startPage, int stopPage, TableScan **pscan);
+
+int
+Table_ResumeScan(Table *tbl, RecId token, int stopPage, TableScan **pscan);
+
+int
+Table_Next(TableScan *scan, RecId *rid, byte **record, int *len);
+
+int
+Table_NextBatch(TableScan *scan, RecId *rids, byte **records, int *lens, int maxRecords);
+
+void
+Table_SetScanFilter(TableScan *scan, struct PredicateList *filter);
+
+void
+Table_SetScanProjection(TableScan *scan, unsigned long long columns);
+
+RecId
+Table_ScanToken(TableScan *scan);
+
+void
+Table_CloseScan(TableScan *scan);
+
+// ---------------------------------------------------------------------------------------
+
 #endif
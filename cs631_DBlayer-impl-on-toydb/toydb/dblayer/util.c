@@ -5,6 +5,7 @@
 #include <ctype.h>
 #include "tbl.h"
 #include "util.h"
+#include "record.h"
 
 char *trim(char *str)
 {
@@ -57,9 +58,11 @@ parseSchema(char *buf) {
     sch->numColumns = n;
     for (int i = 0; i < n; i++) {
 	int c = split(tokens[i],":", descTokens);
-	assert(c == 2);
+	// name:type, or name:varchar:dict for a dictionary encoded column (see pax.h)
+	assert(c == 2 || c == 3);
 	ColumnDesc *cd = (ColumnDesc *) malloc(sizeof(ColumnDesc));
 	cd->name = strdup(descTokens[0]);
+	cd->dictionary = (c == 3 && stricmp(descTokens[2], "dict") == 0);
 	char *type = descTokens[1];
 	int itype = 0;
 	if (stricmp(type, "varchar") == 0) {
@@ -75,6 +78,7 @@ parseSchema(char *buf) {
 	cd->type = itype;
 	sch->columns[i] = cd;
     }
+    Record_SetFormat(sch, RECORD_FORMAT_DEFAULT);
     free(buf);
     return sch;
 }
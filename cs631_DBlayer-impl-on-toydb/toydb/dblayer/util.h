@@ -1,5 +1,5 @@
 #define MAX_TOKENS 100
-#define MAX_LINE_LEN   1000
+#define MAX_LINE_LEN   32768 // Long lines become overflow records, see ovf.h
 
 int stricmp(char const *a, char const *b);
 char *trim(char *str);
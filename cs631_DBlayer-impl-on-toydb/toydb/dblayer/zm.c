@@ -0,0 +1,409 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tbl.h"
+#include "zm.h"
+#include "pred.h"
+#include "record.h"
+#include "codec.h"
+#include "../pflayer/pf.h"
+#include "../amlayer/am.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+/*
+ Hashes a string for the Bloom filters (FNV-1a)
+ */
+static unsigned long long ZM_Hash(byte *str, int len)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Bit number i of the ZM_BLOOM_HASHES bits of a string, by double hashing
+#define ZM_BLOOM_BIT(hash, i) ((unsigned)(((hash) + (i) * (((hash) >> 32) | 1)) % ZM_BLOOM_BITS))
+
+/*
+ Writes the column types of the schema to the header page
+ */
+static void ZM_WriteHeader(Schema *schema, char *pagebuf)
+{
+    memset(pagebuf, 0, PF_PAGE_SIZE);
+    EncodeInt(ZM_MAGIC, pagebuf);
+    EncodeInt(schema->numColumns, pagebuf + 4);
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        pagebuf[8 + c] = (char)schema->columns[c]->type;
+    }
+}
+
+/*
+ Returns true if the header page was written for the column types of schema
+ */
+static bool ZM_HeaderMatches(Schema *schema, char *pagebuf)
+{
+    if (DecodeInt(pagebuf) != ZM_MAGIC || DecodeInt(pagebuf + 4) != schema->numColumns)
+    {
+        return false;
+    }
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        if (pagebuf[8 + c] != (char)schema->columns[c]->type)
+            return false;
+    }
+    return true;
+}
+
+/*
+ Creates an empty zone map for the table's schema
+ */
+static int ZM_Create(Table *tbl, char *zmName)
+{
+    char *pagebuf;
+    int pagenum;
+    int ret_val = PF_CreateFile(zmName);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    tbl->zmFD = PF_OpenFile(zmName);
+    if (tbl->zmFD < 0)
+    {
+        return tbl->zmFD;
+    }
+    ret_val = PF_AllocPage(tbl->zmFD, &pagenum, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ZM_WriteHeader(tbl->schema, pagebuf);
+    return PF_UnfixPage(tbl->zmFD, pagenum, TRUE);
+}
+
+/*
+ Opens the zone map "<dbname>.zm" of a table, creating it (and building it from
+ the table's records) if it does not exist or was built for other column types.
+ A table opened without a schema, or with too many columns for an entry to fit
+ a page, has no zone map: a stale one is removed, since its inserts will not be recorded.
+ Must be called once the table's other files are open.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int ZM_Open(Table *tbl, char *dbname, bool overwrite)
+{
+    char zmName[strlen(dbname) + sizeof(ZM_SUFFIX)];
+    char *pagebuf;
+    int ret_val;
+
+    sprintf(zmName, "%s%s", dbname, ZM_SUFFIX);
+    tbl->zmFD = -1;
+    if (tbl->schema == NULL || ZM_ENTRY_SIZE(tbl->schema) > PF_PAGE_SIZE)
+    {
+        PF_DestroyFile(zmName);
+        return 0;
+    }
+    if (!overwrite)
+    {
+        tbl->zmFD = PF_OpenFile(zmName);
+    }
+    if (tbl->zmFD >= 0)
+    {
+        ret_val = PF_GetThisPage(tbl->zmFD, ZM_HEADER_PAGE, &pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        bool matches = ZM_HeaderMatches(tbl->schema, pagebuf);
+        PF_UnfixPage(tbl->zmFD, ZM_HEADER_PAGE, FALSE);
+        if (matches)
+        {
+            return 0;
+        }
+        PF_CloseFile(tbl->zmFD);
+        tbl->zmFD = -1;
+    }
+
+    PF_DestroyFile(zmName);
+    ret_val = ZM_Create(tbl, zmName);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    if (tbl->firstPageNum != -1)
+    {
+        return ZM_Rebuild(tbl); // Table predates its zone map
+    }
+    return 0;
+}
+
+void ZM_Close(Table *tbl)
+{
+    free(tbl->zmTail);
+    tbl->zmTail = NULL;
+    if (tbl->zmFD >= 0)
+    {
+        PF_CloseFile(tbl->zmFD);
+        tbl->zmFD = -1;
+    }
+}
+
+/*
+ Fixes the zone map page holding the entry of heap page pagenum, allocating
+ (zeroed, meaning nothing recorded) the pages up to it if create is set.
+ Returns PFE_OK, PFE_INVALIDPAGE for a missing page, or a PF error code
+ */
+static int ZM_GetPage(Table *tbl, int pagenum, bool create, char **pagebuf)
+{
+    int zmPage = 1 + pagenum / ZM_ENTRIES_PER_PAGE(tbl->schema);
+    int allocated;
+    int ret_val = PF_GetThisPage(tbl->zmFD, zmPage, pagebuf);
+    if (ret_val != PFE_INVALIDPAGE || !create)
+    {
+        return ret_val;
+    }
+
+    // Zone map pages are never disposed, so they are allocated in order
+    while (1)
+    {
+        ret_val = PF_AllocPage(tbl->zmFD, &allocated, pagebuf);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+        memset(*pagebuf, 0, PF_PAGE_SIZE);
+        if (allocated == zmPage)
+        {
+            return PFE_OK;
+        }
+        ret_val = PF_UnfixPage(tbl->zmFD, allocated, TRUE);
+        if (ret_val != PFE_OK)
+        {
+            return ret_val;
+        }
+    }
+}
+
+/*
+ Widens a synopsis entry to cover an encoded record
+ */
+static void ZM_Widen(Schema *schema, byte *entry, byte *record, int len)
+{
+    bool first = !(entry[0] & ZM_ENTRY_SET);
+    int fieldLen;
+
+    entry[0] |= ZM_ENTRY_SET;
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        byte *synopsis = entry + ZM_FLAGS_SIZE + c * ZM_COLUMN_SIZE;
+        byte *field = Record_Field(schema, record, len, c, &fieldLen);
+        if (field == NULL)
+            continue;
+        if (schema->columns[c]->type == VARCHAR)
+        {
+            unsigned long long hash = ZM_Hash(field, fieldLen);
+            for (int i = 0; i < ZM_BLOOM_HASHES; i++)
+            {
+                unsigned bit = ZM_BLOOM_BIT(hash, i);
+                synopsis[bit / 8] |= 1 << (bit % 8);
+            }
+            continue;
+        }
+        long long value = (schema->columns[c]->type == INT) ? DecodeInt(field) : DecodeLong(field);
+        if (first || value < DecodeLong(synopsis))
+            EncodeLong(value, synopsis);
+        if (first || value > DecodeLong(synopsis + 8))
+            EncodeLong(value, synopsis + 8);
+    }
+}
+
+/*
+ Widens a synopsis entry to cover another one
+ */
+static void ZM_Merge(Schema *schema, byte *entry, byte *other)
+{
+    bool first = !(entry[0] & ZM_ENTRY_SET);
+
+    entry[0] |= ZM_ENTRY_SET;
+    for (int c = 0; c < schema->numColumns; c++)
+    {
+        byte *synopsis = entry + ZM_FLAGS_SIZE + c * ZM_COLUMN_SIZE;
+        byte *from = other + ZM_FLAGS_SIZE + c * ZM_COLUMN_SIZE;
+        if (schema->columns[c]->type == VARCHAR)
+        {
+            for (int i = 0; i < ZM_COLUMN_SIZE; i++)
+                synopsis[i] |= from[i];
+            continue;
+        }
+        if (first || DecodeLong(from) < DecodeLong(synopsis))
+            EncodeLong(DecodeLong(from), synopsis);
+        if (first || DecodeLong(from + 8) > DecodeLong(synopsis + 8))
+            EncodeLong(DecodeLong(from + 8), synopsis + 8);
+    }
+}
+
+/*
+ Widens the synopsis of heap page pagenum to cover an encoded record.
+ Called for every record stored in the page. Records of the bulk-append tail
+ page are gathered in memory, and written with ZM_FlushTail once the table
+ leaves the page.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int ZM_Add(Table *tbl, int pagenum, byte *record, int len)
+{
+    Schema *schema = tbl->schema;
+    char *pagebuf;
+
+    if (tbl->zmFD < 0)
+    {
+        return 0;
+    }
+    if (tbl->tailPinned && pagenum == tbl->currentPageNum)
+    {
+        if (tbl->zmTail == NULL)
+        {
+            tbl->zmTail = (byte *)calloc(1, ZM_ENTRY_SIZE(schema));
+            if (tbl->zmTail == NULL)
+                return PFE_NOMEM;
+        }
+        ZM_Widen(schema, tbl->zmTail, record, len);
+        return 0;
+    }
+    int ret_val = ZM_GetPage(tbl, pagenum, true, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ZM_Widen(schema, pagebuf + (pagenum % ZM_ENTRIES_PER_PAGE(schema)) * ZM_ENTRY_SIZE(schema), record, len);
+    return PF_UnfixPage(tbl->zmFD, 1 + pagenum / ZM_ENTRIES_PER_PAGE(schema), TRUE);
+}
+
+/*
+ Writes the synopsis gathered for the bulk-append tail page (see ZM_Add) to the
+ zone map. Called before the tail page is unfixed.
+ Returns 0 on success and a negative PF error code otherwise.
+ */
+int ZM_FlushTail(Table *tbl)
+{
+    Schema *schema = tbl->schema;
+    int pagenum = tbl->currentPageNum;
+    char *pagebuf;
+
+    if (tbl->zmFD < 0 || tbl->zmTail == NULL || !(tbl->zmTail[0] & ZM_ENTRY_SET))
+    {
+        return 0;
+    }
+    int ret_val = ZM_GetPage(tbl, pagenum, true, &pagebuf);
+    if (ret_val != PFE_OK)
+    {
+        return ret_val;
+    }
+    ZM_Merge(schema, pagebuf + (pagenum % ZM_ENTRIES_PER_PAGE(schema)) * ZM_ENTRY_SIZE(schema), tbl->zmTail);
+    memset(tbl->zmTail, 0, ZM_ENTRY_SIZE(schema));
+    return PF_UnfixPage(tbl->zmFD, 1 + pagenum / ZM_ENTRIES_PER_PAGE(schema), TRUE);
+}
+
+/*
+ Returns false if no record of heap page pagenum can satisfy filter, from the
+ page's synopsis. INT and LONG tests are checked against the page's range,
+ VARCHAR equality against its Bloom filter. Returns true when in doubt
+ (no zone map, or its page in use elsewhere, e.g. by another scan thread).
+ */
+bool ZM_MayMatch(Table *tbl, int pagenum, PredicateList *filter)
+{
+    Schema *schema = tbl->schema;
+    char *pagebuf;
+    bool mayMatch = true;
+
+    if (tbl->zmFD < 0 || filter == NULL)
+    {
+        return true;
+    }
+    int ret_val = ZM_GetPage(tbl, pagenum, false, &pagebuf);
+    if (ret_val == PFE_INVALIDPAGE)
+    {
+        return false; // Nothing recorded for the page
+    }
+    if (ret_val != PFE_OK)
+    {
+        return true;
+    }
+    byte *entry = pagebuf + (pagenum % ZM_ENTRIES_PER_PAGE(schema)) * ZM_ENTRY_SIZE(schema);
+    if (!(entry[0] & ZM_ENTRY_SET))
+    {
+        mayMatch = false;
+    }
+    for (int i = 0; mayMatch && i < filter->numPreds; i++)
+    {
+        Predicate *pred = &filter->preds[i];
+        byte *synopsis = entry + ZM_FLAGS_SIZE + pred->column * ZM_COLUMN_SIZE;
+        if (pred->type == VARCHAR)
+        {
+            if (pred->op != EQUAL)
+                continue;
+            unsigned long long hash = ZM_Hash(pred->str, pred->strLen);
+            for (int h = 0; h < ZM_BLOOM_HASHES; h++)
+            {
+                unsigned bit = ZM_BLOOM_BIT(hash, h);
+                if (!(synopsis[bit / 8] & (1 << (bit % 8))))
+                    mayMatch = false;
+            }
+            continue;
+        }
+        long long min = DecodeLong(synopsis), max = DecodeLong(synopsis + 8);
+        switch (pred->op)
+        {
+        case EQUAL:
+            mayMatch = (min <= pred->num && pred->num <= max);
+            break;
+        case LESS_THAN:
+            mayMatch = (min < pred->num);
+            break;
+        case LESS_THAN_EQUAL:
+            mayMatch = (min <= pred->num);
+            break;
+        case GREATER_THAN:
+            mayMatch = (max > pred->num);
+            break;
+        case GREATER_THAN_EQUAL:
+            mayMatch = (max >= pred->num);
+            break;
+        case NOT_EQUAL:
+            mayMatch = !(min == pred->num && max == pred->num);
+            break;
+        }
+    }
+    PF_UnfixPage(tbl->zmFD, 1 + pagenum / ZM_ENTRIES_PER_PAGE(schema), FALSE);
+    return mayMatch;
+}
+
+/*
+ Recomputes the zone map from the records of the table
+ */
+int ZM_Rebuild(Table *tbl)
+{
+    TableScan *scan;
+    RecId rid;
+    byte *record;
+    int len, ret_val;
+
+    ret_val = Table_OpenScan(tbl, -1, -1, &scan);
+    if (ret_val != 0)
+    {
+        return ret_val;
+    }
+    while ((ret_val = Table_Next(scan, &rid, &record, &len)) == 0)
+    {
+        ret_val = ZM_Add(tbl, RECORD_ID_PAGE(rid), record, len);
+        if (ret_val != PFE_OK)
+            break;
+    }
+    Table_CloseScan(scan);
+    return (ret_val == PFE_EOF) ? 0 : ret_val;
+}
+
+// ---------------------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+#ifndef _ZM_H_
+#define _ZM_H_
+#include <stdbool.h>
+#include "tbl.h"
+
+// IMPLEMENTED---------------------------------------------------------------------------------------
+
+// Zone map: a separate paged file "<table>.zm" holding a synopsis of every heap
+// page, so that predicate scans skip the pages that cannot hold a match.
+// Page 0 records the column types the synopses were built for; a table opened
+// with another schema gets its zone map rebuilt.
+// Page i+1 holds the entries of heap pages [i*ZM_ENTRIES_PER_PAGE, (i+1)*ZM_ENTRIES_PER_PAGE):
+//   [flags][per column: min and max (INT, LONG) or a ZM_BLOOM_BITS bit Bloom filter (VARCHAR)]
+// Entries only ever widen: deleted values are still covered, which is safe.
+// Rows bulk-appended to a tail page widen an entry kept in memory instead, merged
+// into the zone map page once when the tail is unfixed.
+
+#define ZM_SUFFIX ".zm"
+#define ZM_HEADER_PAGE 0
+#define ZM_MAGIC 0x5a4d4150 // "PAMZ"
+#define ZM_ENTRY_SET 1       // Entry flag: some record has been recorded for the page
+#define ZM_FLAGS_SIZE 8
+#define ZM_COLUMN_SIZE 16    // Two long longs, or the Bloom filter
+#define ZM_BLOOM_BITS (8 * ZM_COLUMN_SIZE)
+#define ZM_BLOOM_HASHES 3
+#define ZM_ENTRY_SIZE(schema) (ZM_FLAGS_SIZE + (schema)->numColumns * ZM_COLUMN_SIZE)
+#define ZM_ENTRIES_PER_PAGE(schema) (PF_PAGE_SIZE / ZM_ENTRY_SIZE(schema))
+
+int
+ZM_Open(Table *tbl, char *dbname, bool overwrite);
+
+void
+ZM_Close(Table *tbl);
+
+int
+ZM_Add(Table *tbl, int pagenum, byte *record, int len);
+
+int
+ZM_FlushTail(Table *tbl);
+
+bool
+ZM_MayMatch(Table *tbl, int pagenum, struct PredicateList *filter);
+
+int
+ZM_Rebuild(Table *tbl);
+
+// ---------------------------------------------------------------------------------------
+
+#endif
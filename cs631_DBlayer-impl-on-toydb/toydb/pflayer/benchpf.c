@@ -0,0 +1,144 @@
+/* benchpf.c: measures how page reads scale with the number of threads.
+Creates a file of numpages pages, then for 1, 2, 4 ... maxthreads
+threads drops the file from the operating system's page cache and has
+the threads fix and unfix numreads random pages between them through
+PF_GetThisPage(), and reports the pages read per second. The pages come
+from disk, so the threads overlap their reads only if the PF layer does
+not hold its latch while reading. The file should be much larger than
+numreads pages, so that few reads find a page already cached by an
+earlier one.
+
+usage: benchpf [numpages [numreads [maxthreads]]] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "pf.h"
+#include "pftypes.h"
+
+#define BENCH_FILE "benchpf.file"
+
+static int BENCHfd;		/* PF file descriptor of the file */
+static int BENCHnumpages;	/* # of pages in the file */
+static int BENCHreads;		/* # of pages each thread reads */
+static unsigned int BENCHrun;	/* # of the run, varies the pages read */
+
+static double benchNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+static void benchDropCache()
+/****************************************************************************
+SPECIFICATIONS:
+	Flush the file and ask the operating system to drop its pages from
+	the page cache, so that the next reads go to disk.
+*****************************************************************************/
+{
+    int unixfd;
+
+    if ((unixfd = open(BENCH_FILE,O_RDONLY)) < 0) {
+        perror(BENCH_FILE);
+        exit(1);
+    }
+    fsync(unixfd);
+    posix_fadvise(unixfd,0,0,POSIX_FADV_DONTNEED);
+    close(unixfd);
+}
+
+static void *benchWorker(arg)
+void *arg;	/* seed of the thread */
+/****************************************************************************
+SPECIFICATIONS:
+	Fix and unfix BENCHreads random pages, checking that each page
+	holds its own number. Returns the number of bad pages.
+*****************************************************************************/
+{
+    unsigned int seed = (unsigned int)(long)arg * 7919 + BENCHrun;
+    long bad = 0;
+    char *buf;
+    int i, pagenum, error;
+
+    for (i = 0; i < BENCHreads; i++) {
+        pagenum = rand_r(&seed) % BENCHnumpages;
+        if ((error = PF_GetThisPage(BENCHfd,pagenum,&buf)) != PFE_OK) {
+            /* another thread has the page fixed: count it as read */
+            if (error != PFE_PAGEFIXED)
+                bad++;
+            continue;
+        }
+        if (*(int *)buf != pagenum)
+            bad++;
+        PF_UnfixPage(BENCHfd,pagenum,FALSE);
+    }
+    return((void *)bad);
+}
+
+int main(argc,argv)
+int argc;
+char **argv;
+{
+    int maxthreads, nthreads, numreads, i, pagenum, error;
+    long bad = 0;
+    char *buf;
+    double start;
+
+    BENCHnumpages = (argc > 1) ? atoi(argv[1]) : 250000;
+    numreads = (argc > 2) ? atoi(argv[2]) : 8000;
+    maxthreads = (argc > 3) ? atoi(argv[3]) : 16;
+    if (maxthreads > PF_MAX_BUFS) {
+        /* each thread keeps a buffer fixed */
+        maxthreads = PF_MAX_BUFS;
+    }
+
+    PF_Init();
+    unlink(BENCH_FILE);
+    if ((error = PF_CreateFile(BENCH_FILE)) != PFE_OK) {
+        PF_PrintError("create");
+        exit(1);
+    }
+    if ((BENCHfd = PF_OpenFile(BENCH_FILE)) < 0) {
+        PF_PrintError("open");
+        exit(1);
+    }
+    for (i = 0; i < BENCHnumpages; i++) {
+        if ((error = PF_AllocPage(BENCHfd,&pagenum,&buf)) != PFE_OK) {
+            PF_PrintError("alloc");
+            exit(1);
+        }
+        *(int *)buf = pagenum;
+        PF_UnfixPage(BENCHfd,pagenum,TRUE);
+    }
+    /* write the pages out */
+    PF_CloseFile(BENCHfd);
+    BENCHfd = PF_OpenFile(BENCH_FILE);
+
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        pthread_t threads[nthreads];
+        void *result;
+
+        BENCHreads = numreads / nthreads;
+        BENCHrun++;
+        benchDropCache();
+        start = benchNow();
+        for (i = 0; i < nthreads; i++)
+            pthread_create(&threads[i],NULL,benchWorker,(void *)(long)(i + 1));
+        for (i = 0; i < nthreads; i++) {
+            pthread_join(threads[i],&result);
+            bad += (long)result;
+        }
+        printf("%2d threads: %7d pages, %8.0f pages/s\n",nthreads,
+               nthreads * BENCHreads,
+               nthreads * BENCHreads / (benchNow() - start));
+    }
+
+    PF_CloseFile(BENCHfd);
+    PF_DestroyFile(BENCH_FILE);
+    printf("%s\n",bad ? "FAILED" : "OK");
+    return(bad != 0);
+}
@@ -1,8 +1,14 @@
 /* buf.c: buffer management routines. The interface routines are:
 PFbufGet(), PFbufUnfix(), PFbufAlloc(), PFbufReleaseFile(), PFbufUsed() and
-PFbufPrint() */
+PFbufPrint(), plus PFbufGetRef(), PFbufUnfixRef() and PFbufExt(), which
+reach a page through a PF_PageRef instead of the hash table. When a trace is open (see trace.c), every get, unfix and
+alloc is also logged for offline replay by pfsim. While a shared pool
+is attached (see shmbuf.c), each routine hands over to its PFshm
+counterpart instead of using the private buffer list. */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 #include "pf.h"
 #include "pftypes.h"
 #include "pfinternals.h"
@@ -14,6 +20,37 @@ static PFbpage *PFlastbpage = NULL;	/* ptr to last buffer page, or NULL */
 static PFbpage *PFfreebpage= NULL;	/* list of free buffer pages */
 
 
+static void PFbufDropExt(bpage)
+PFbpage *bpage;
+/****************************************************************************
+SPECIFICATIONS:
+	Free the memory attached to the buffer page by PFbufExt(). It
+	describes the page as it was, so it goes whenever the page is
+	modified or leaves the buffer.
+*****************************************************************************/
+{
+    if (bpage->ext != NULL) {
+        free(bpage->ext);
+        bpage->ext = NULL;
+        bpage->extsize = 0;
+    }
+}
+
+
+static void PFbufForget(bpage)
+PFbpage *bpage;
+/****************************************************************************
+SPECIFICATIONS:
+	The buffer page no longer holds the page it held: invalidate all
+	PF_PageRefs to it by bumping its generation, and drop its
+	attached memory.
+*****************************************************************************/
+{
+    bpage->gen++;
+    PFbufDropExt(bpage);
+}
+
+
 static void PFbufInsertFree(bpage)
 PFbpage *bpage;
 /****************************************************************************
@@ -23,6 +60,7 @@ SPECIFICATIONS:
 AUTHOR: clc
 *****************************************************************************/
 {
+    PFbufForget(bpage);
     bpage->nextpage = PFfreebpage;
     PFfreebpage = bpage;
 }
@@ -149,6 +187,11 @@ GLOBAL VARIABLES MODIFIED:
             PFerrno = PFE_NOMEM;
             return(PFerrno);
         }
+        (*bpage)->gen = 0;
+        (*bpage)->loading = FALSE;
+        (*bpage)->ext = NULL;
+        (*bpage)->extsize = 0;
+
         /* increment # of pages allocated */
         PFnumbpage++;
     } else {
@@ -186,6 +229,9 @@ GLOBAL VARIABLES MODIFIED:
         /* unlink from buffer list */
         PFbufUnlink(tbpage);
 
+        /* unswizzle: references to the old page become invalid */
+        PFbufForget(tbpage);
+
         *bpage = tbpage;
 
     }
@@ -223,6 +269,9 @@ SPECIFICATIONS:
 		PFpage *fpage;
 	which will write one page into the file.
 	It is an error to read a page already fixed in the buffer.
+	readfcn() may release the latch while it reads (see PFlatchWait()):
+	the buffer is in the hash table, fixed and marked loading
+	meanwhile, and other gets of the page wait for the read to end.
 
 RETURN VALUE:
 	PFE_OK	if no error.
@@ -236,7 +285,20 @@ GLOBAL VARIABLES MODIFIED:
     PFbpage *bpage;	/* pointer to buffer */
     int error;
 
-    if ((bpage=PFhashFind(fd,pagenum)) == NULL) {
+    if (PFtracefp != NULL) {
+        PFtraceRecord(fd,pagenum,PF_TRACE_GET,FALSE);
+    }
+
+    if (PFshmActive) {
+        return(PFshmGet(fd,pagenum,fpage,readfcn,writefcn));
+    }
+
+    /* a page being read in by another thread is waited for */
+    while ((bpage=PFhashFind(fd,pagenum)) != NULL && bpage->loading) {
+        PFlatchWait();
+    }
+
+    if (bpage == NULL) {
         /* page not in buffer. */
 
         /* allocate an empty page */
@@ -246,17 +308,9 @@ GLOBAL VARIABLES MODIFIED:
             return(error);
         }
 
-        /* read the page */
-        if ((error=(*readfcn)(fd,pagenum,&bpage->fpage))!= PFE_OK) {
-            /* error reading the page. put buffer back into
-            the free list, and return gracefully */
-            PFbufUnlink(bpage);
-            PFbufInsertFree(bpage);
-            *fpage = NULL;
-            return(error);
-        }
-
-        /* insert new page into hash table */
+        /* insert new page into hash table, fixed and loading, so
+        that it is neither read twice nor chosen as a victim while
+        readfcn() runs with the latch released */
         if ((error=PFhashInsert(fd,pagenum,bpage))!=PFE_OK) {
             /* failed to insert into hash table */
             /* put page into free list */
@@ -269,6 +323,23 @@ GLOBAL VARIABLES MODIFIED:
         bpage->fd = fd;
         bpage->page = pagenum;
         bpage->dirty = FALSE;
+        bpage->fixed = TRUE;
+        bpage->loading = TRUE;
+
+        /* read the page */
+        error = (*readfcn)(fd,pagenum,&bpage->fpage);
+        bpage->loading = FALSE;
+        PFlatchBroadcast();
+        if (error != PFE_OK) {
+            /* error reading the page. put buffer back into
+            the free list, and return gracefully */
+            PFhashDelete(fd,pagenum);
+            bpage->fixed = FALSE;
+            PFbufUnlink(bpage);
+            PFbufInsertFree(bpage);
+            *fpage = NULL;
+            return(error);
+        }
     } else if (bpage->fixed) {
         /* page already in memory, and is fixed, so we can't
         get it again. */
@@ -305,6 +376,14 @@ RETURN VALUE:
 {
     PFbpage *bpage;
 
+    if (PFtracefp != NULL) {
+        PFtraceRecord(fd,pagenum,PF_TRACE_UNFIX,dirty);
+    }
+
+    if (PFshmActive) {
+        return(PFshmUnfix(fd,pagenum,dirty,PFwritefcn));
+    }
+
     if ((bpage= PFhashFind(fd,pagenum))==NULL) {
         /* page not in buffer */
         PFerrno = PFE_PAGENOTINBUF;
@@ -321,6 +400,7 @@ RETURN VALUE:
         /* mark this page dirty */
     {
         bpage->dirty = TRUE;
+        PFbufDropExt(bpage);
     }
 
     /* unfix the page */
@@ -360,6 +440,14 @@ RETURN VALUE:
 
     *fpage = NULL;	/* initial value of fpage */
 
+    if (PFtracefp != NULL) {
+        PFtraceRecord(fd,pagenum,PF_TRACE_ALLOC,FALSE);
+    }
+
+    if (PFshmActive) {
+        return(PFshmAlloc(fd,pagenum,fpage));
+    }
+
     if ((bpage=PFhashFind(fd,pagenum))!= NULL) {
         /* page already in buffer*/
         PFerrno = PFE_PAGEINBUF;
@@ -417,6 +505,10 @@ IMPLEMENTATION NOTES:
     PFbpage *temppage;
     int error;		/* error code */
 
+    if (PFshmActive) {
+        return(PFshmReleaseFile(fd));
+    }
+
     /* Do linear scan of the buffer to find pages belonging to the file */
     bpage = PFfirstbpage;
     while (bpage != NULL) {
@@ -476,6 +568,10 @@ RETURN VALUE: PF error codes.
 {
     PFbpage *bpage;	/* pointer to the bpage we are looking for */
 
+    if (PFshmActive) {
+        return(PFshmUsed(fd,pagenum));
+    }
+
     /* Find page in the buffer */
     if ((bpage=PFhashFind(fd,pagenum))==NULL) {
         /* page not in the buffer */
@@ -491,6 +587,7 @@ RETURN VALUE: PF error codes.
 
     /* mark this page dirty */
     bpage->dirty = TRUE;
+    PFbufDropExt(bpage);
 
     /* make this page head of the list of buffers*/
     PFbufUnlink(bpage);
@@ -499,6 +596,133 @@ RETURN VALUE: PF error codes.
     return(PFE_OK);
 }
 
+int
+PFbufGetRef(
+    int fd,	/* file descriptor */
+    int pagenum,	/* page number */
+    PF_PageRef *ref,	/* reference to the buffer last holding the page */
+    PFfpage **fpage,	/* pointer to pointer to file page */
+    int (*readfcn)(),	/* function to read a page */
+    int (*writefcn)()	/* function to write a page */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Same as PFbufGet(), but first try the buffer that "ref" points
+	to. If it still holds the page (same generation, fd and page
+	number), fix it there without looking in the hash table.
+	Otherwise fall back to PFbufGet() and make "ref" point to the
+	buffer the page is now in.
+	With a shared pool, "ref" is not used and is cleared.
+
+RETURN VALUE: as PFbufGet().
+*****************************************************************************/
+{
+    PFbpage *bpage;
+    int error;
+
+    bpage = (PFbpage *)ref->frame;
+    if (PFshmActive || bpage == NULL || bpage->gen != ref->gen
+            || bpage->fd != fd || bpage->page != pagenum || bpage->loading) {
+        /* unswizzled, the buffer was given to another page, or it is
+        still being read in */
+        ref->frame = NULL;
+        error = PFbufGet(fd,pagenum,fpage,readfcn,writefcn);
+        if (!PFshmActive && (error == PFE_OK || error == PFE_PAGEFIXED)) {
+            bpage = (PFbpage *)((char *)*fpage - offsetof(PFbpage,fpage));
+            ref->frame = (void *)bpage;
+            ref->gen = bpage->gen;
+        }
+        return(error);
+    }
+
+    if (PFtracefp != NULL) {
+        PFtraceRecord(fd,pagenum,PF_TRACE_GET,FALSE);
+    }
+
+    *fpage = &bpage->fpage;
+    if (bpage->fixed) {
+        PFerrno = PFE_PAGEFIXED;
+        return(PFerrno);
+    }
+    bpage->fixed = TRUE;
+    return(PFE_OK);
+}
+
+int
+PFbufUnfixRef(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    PF_PageRef *ref,	/* reference set by PFbufGetRef() */
+    int dirty	/* TRUE if page is dirty */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Same as PFbufUnfix(), but go through "ref" when it is valid.
+
+RETURN VALUE: as PFbufUnfix().
+*****************************************************************************/
+{
+    PFbpage *bpage;
+
+    bpage = (PFbpage *)ref->frame;
+    if (PFshmActive || bpage == NULL || bpage->gen != ref->gen
+            || bpage->fd != fd || bpage->page != pagenum) {
+        return(PFbufUnfix(fd,pagenum,dirty));
+    }
+
+    if (PFtracefp != NULL) {
+        PFtraceRecord(fd,pagenum,PF_TRACE_UNFIX,dirty);
+    }
+
+    if (!bpage->fixed) {
+        PFerrno = PFE_PAGEUNFIXED;
+        return(PFerrno);
+    }
+    if (dirty) {
+        bpage->dirty = TRUE;
+        PFbufDropExt(bpage);
+    }
+    bpage->fixed = FALSE;
+    PFbufUnlink(bpage);
+    PFbufLinkHead(bpage);
+    return(PFE_OK);
+}
+
+char *
+PFbufExt(
+    PF_PageRef *ref,	/* reference to a fixed page */
+    int size	/* # of bytes wanted */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Return "size" bytes of memory attached to the buffer "ref"
+	points to, zeroed when first attached. The memory lives as long
+	as the buffer holds the page unmodified: it is freed when the
+	page is marked dirty or leaves the buffer. Callers use it to cache
+	facts derived from the page, such as references to its children.
+
+RETURN VALUE:
+	pointer to the memory, or NULL if "ref" is not valid, there is
+	no memory, or a shared pool is in use.
+*****************************************************************************/
+{
+    PFbpage *bpage;
+
+    bpage = (PFbpage *)ref->frame;
+    if (PFshmActive || bpage == NULL || bpage->gen != ref->gen) {
+        return(NULL);
+    }
+    if (bpage->extsize < size) {
+        PFbufDropExt(bpage);
+        if ((bpage->ext = malloc(size)) == NULL) {
+            return(NULL);
+        }
+        memset(bpage->ext,0,size);
+        bpage->extsize = size;
+    }
+    return(bpage->ext);
+}
+
 void PFbufPrint()
 /****************************************************************************
 SPECIFICATIONS:
@@ -510,6 +734,11 @@ AUTHOR: clc
 {
     PFbpage *bpage;
 
+    if (PFshmActive) {
+        PFshmPrint();
+        return;
+    }
+
     printf("buffer content:\n");
     if (PFfirstbpage == NULL) {
         printf("empty\n");
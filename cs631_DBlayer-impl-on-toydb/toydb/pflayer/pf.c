@@ -1,6 +1,7 @@
 /* pf.c: Paged File Interface Routines+ support routines */
 #include <stdio.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/file.h>
 #include "pf.h"
@@ -9,6 +10,7 @@
 #include "pftypes.h"
 #include "pfinternals.h"
 #include <unistd.h>
+#include <pthread.h>
 extern int
 PFbufUsed(
     int fd,		/* file descriptor */
@@ -20,9 +22,22 @@ PFbufUsed(
 #define L_SET 0
 #endif
 
-int PFerrno = PFE_OK;	/* last error message */
+_Thread_local int PFerrno = PFE_OK;	/* last error message, per thread */
+
+/* the latch: serializes the interface routines that touch the file
+table or the buffer pool, so that several threads of a process can
+fix and unfix pages. Page data is not latched; threads must not fix
+the same page at once, since a page is fixed or not, with no count
+of who fixed it. Pages are read from disk with the latch released
+(see PFreadUnlatched()), so that reads of several threads overlap. */
+static pthread_mutex_t PFlatch = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PFloaded = PTHREAD_COND_INITIALIZER; /* see PFlatchWait() */
+
+#define PFlatchAcquire() pthread_mutex_lock(&PFlatch)
+#define PFlatchRelease() pthread_mutex_unlock(&PFlatch)
 
 static PFftab_ele PFftab[PF_FTAB_SIZE]; /* table of opened files */
+static int PFopens = 0; /* # of files opened, for PF_FileStamp() */
 
 /* true if file descriptor fd is invaild */
 #define PFinvalidFd(fd) ((fd) < 0 || (fd) >= PF_FTAB_SIZE \
@@ -121,15 +136,11 @@ RETURN VALUE:
 {
     int error;
 
-    /* seek to the appropriate place */
-    if ((error=lseek(PFftab[fd].unixfd,pagenum*sizeof(PFfpage)+PF_HDR_SIZE,
-                     L_SET)) == -1) {
-        PFerrno = PFE_UNIX;
-        return(PFerrno);
-    }
-
-    /* read the data */
-    if((error=read(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage)))
+    /* read the data at its place, without moving the file offset,
+    which other threads' reads share; the offset is computed in off_t
+    so that files beyond 2GB work */
+    if((error=pread(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage),
+                    (off_t)pagenum*sizeof(PFfpage)+PF_HDR_SIZE))
             !=sizeof(PFfpage)) {
         if (error <0) {
             PFerrno = PFE_UNIX;
@@ -163,15 +174,9 @@ RETURN VALUE:
 {
     int error;
 
-    /* seek to the right place */
-    if ((error=lseek(PFftab[fd].unixfd,pagenum*sizeof(PFfpage)+PF_HDR_SIZE,
-                     L_SET)) == -1) {
-        PFerrno = PFE_UNIX;
-        return(PFerrno);
-    }
-
-    /* write out the page */
-    if((error=write(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage)))
+    /* write out the page at its place (as in PFreadfcn()) */
+    if((error=pwrite(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage),
+                     (off_t)pagenum*sizeof(PFfpage)+PF_HDR_SIZE))
             !=sizeof(PFfpage)) {
         if (error <0) {
             PFerrno = PFE_UNIX;
@@ -185,6 +190,76 @@ RETURN VALUE:
 
 }
 
+static int
+PFreadUnlatched(
+    int fd,	/* file descriptor */
+    int pagenum, /* page number */
+    PFfpage *buf	/* buffer to read the page into */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Same as PFreadfcn(), but with the latch released during the read,
+	for the routines that only fix existing pages. The buffer manager
+	keeps the buffer fixed and marked loading meanwhile, so that it is
+	neither reused nor read in twice, and the file cannot be closed.
+	With a shared buffer pool the latch is kept: the pool has its
+	own loading state and releases its own latch instead.
+
+RETURN VALUE: as PFreadfcn().
+*****************************************************************************/
+{
+    int error;
+
+    if (PFshmActive) {
+        return(PFreadfcn(fd,pagenum,buf));
+    }
+    PFlatchRelease();
+    error = PFreadfcn(fd,pagenum,buf);
+    PFlatchAcquire();
+    return(error);
+}
+
+void
+PFlatchWait()
+/****************************************************************************
+SPECIFICATIONS:
+	Wait, with the latch released, until another thread calls
+	PFlatchBroadcast(); used by the buffer manager to wait for a page
+	another thread is reading in. The latch must be held on entry
+	and is held again on return. Callers recheck what they wait for.
+*****************************************************************************/
+{
+    pthread_cond_wait(&PFloaded,&PFlatch);
+}
+
+void
+PFlatchBroadcast()
+/****************************************************************************
+SPECIFICATIONS:
+	Wake all the threads in PFlatchWait(). The latch must be held.
+*****************************************************************************/
+{
+    pthread_cond_broadcast(&PFloaded);
+}
+
+void
+PFftabIdent(
+    int fd,		/* file descriptor */
+    unsigned long *dev,	/* set to the device of the unix file */
+    unsigned long *ino	/* set to the inode of the unix file */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Give the (device, inode) pair of the file indexed by "fd". Unlike
+	fd, it names the same file in every process.
+
+RETURN VALUE: none
+*****************************************************************************/
+{
+    *dev = PFftab[fd].dev;
+    *ino = PFftab[fd].ino;
+}
+
 
 /************************* Interface Routines ****************************/
 
@@ -193,6 +268,11 @@ void PF_Init()
 SPECIFICATIONS:
 	Initialize the PF interface. Must be the first function called
 	in order to use the PF ADT.
+	If the environment variable PF_TRACE names a file, buffer
+	accesses are recorded into it (see PF_TraceOpen()).
+	If the environment variable PF_SHM names a shared-memory segment,
+	the process uses the shared buffer pool of that name (see
+	PF_AttachShared()).
 
 AUTHOR: clc
 
@@ -203,9 +283,23 @@ GLOBAL VARIABLES MODIFIED:
 *****************************************************************************/
 {
     int i;
+    char *tracefname;
+    char *segname;
+
     /* init the hash table */
     PFhashInit();
 
+    /* start a buffer trace if asked to by the environment. A trace
+    already being recorded survives re-initialization. */
+    if (PFtracefp == NULL && (tracefname = getenv("PF_TRACE")) != NULL) {
+        PF_TraceOpen(tracefname);
+    }
+
+    /* likewise join a shared buffer pool */
+    if (!PFshmActive && (segname = getenv("PF_SHM")) != NULL) {
+        PF_AttachShared(segname,0);
+    }
+
     /* init the file table to be not used*/
     for (i=0; i < PF_FTAB_SIZE; i++) {
         PFftab[i].fname = NULL;
@@ -277,6 +371,7 @@ RETURN VALUE:
 *****************************************************************************/
 {
     int error;
+    struct stat st;
 
     if (PFtabFindFname(fname)!= -1) {
         /* file is open */
@@ -284,6 +379,12 @@ RETURN VALUE:
         return(PFerrno);
     }
 
+    /* its pages must not outlive it in a shared pool, where a
+    new file on the same inode would find them */
+    if (PFshmActive && stat(fname,&st) == 0) {
+        PFshmInvalidate((unsigned long)st.st_dev,(unsigned long)st.st_ino);
+    }
+
     if ((error =unlink(fname))!= 0) {
         /* unix error */
         PFerrno = PFE_UNIX;
@@ -295,8 +396,10 @@ RETURN VALUE:
 }
 
 
-int
-PF_OpenFile(char *fname		/* name of the file to open */)
+static int PFopenFileAt(int fd, char *fname);
+
+static int
+PFopenFile(char *fname		/* name of the file to open */)
 /****************************************************************************
 SPECIFICATIONS:
 	Open the paged file whose name is fname.  It is possible to open
@@ -317,7 +420,6 @@ IMPLEMENTATION NOTES:
 	returned. Separate buffers are used.
 *****************************************************************************/
 {
-    int count;	/* # of bytes in read */
     int fd; /* file descriptor */
 
     /* find a free entry in the file table */
@@ -326,6 +428,23 @@ IMPLEMENTATION NOTES:
         PFerrno = PFE_FTABFULL;
         return(PFerrno);
     }
+    return(PFopenFileAt(fd,fname));
+}
+
+static int
+PFopenFileAt(int fd,		/* free entry of the file table */
+             char *fname	/* name of the file to open */)
+/****************************************************************************
+SPECIFICATIONS:
+	Open the paged file whose name is fname as file descriptor fd.
+
+RETURN VALUE:
+	fd	if no error.
+	PF error codes otherwise.
+*****************************************************************************/
+{
+    int count;	/* # of bytes in read */
+    struct stat st;	/* to identify the unix file */
 
     /* open the file */
     if ((PFftab[fd].unixfd = open(fname,O_RDWR))< 0) {
@@ -350,6 +469,16 @@ IMPLEMENTATION NOTES:
     /* set file header to be not changed */
     PFftab[fd].hdrchanged = FALSE;
 
+    /* remember which unix file this is */
+    if (fstat(PFftab[fd].unixfd,&st) < 0) {
+        close(PFftab[fd].unixfd);
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+    PFftab[fd].dev = st.st_dev;
+    PFftab[fd].ino = st.st_ino;
+    PFftab[fd].stamp = ++PFopens;
+
     /* save the file name */
     if ((PFftab[fd].fname = savestr(fname)) == NULL) {
         /* no memory */
@@ -361,8 +490,8 @@ IMPLEMENTATION NOTES:
     return(fd);
 }
 
-int
-PF_CloseFile(int fd /* file descriptor to close */)
+static int
+PFcloseFile(int fd /* file descriptor to close */)
 /****************************************************************************
 SPECIFICATIONS:
 	Close the file indexed by file descriptor fd. The file should have
@@ -429,6 +558,39 @@ RETURN VALUE:
 }
 
 
+static int
+PFreopenFile(int fd /* file descriptor to open again */)
+/****************************************************************************
+SPECIFICATIONS:
+	Close the file of fd and open the file of the same name again as
+	fd, so that a file renamed over it since it was opened replaces
+	it. As for PFcloseFile(), no page may be fixed.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PF error code if error; fd is then closed.
+*****************************************************************************/
+{
+    char *fname;	/* name of the file */
+    int error;
+
+    if (PFinvalidFd(fd)) {
+        PFerrno = PFE_FD;
+        return(PFerrno);
+    }
+    if ((fname = savestr(PFftab[fd].fname)) == NULL) {
+        PFerrno = PFE_NOMEM;
+        return(PFerrno);
+    }
+    if ((error=PFcloseFile(fd)) == PFE_OK &&
+            (error=PFopenFileAt(fd,fname)) == fd) {
+        error = PFE_OK;
+    }
+    free(fname);
+    return(error);
+}
+
+
 /****************************************************************************
 PF_GetFirstPage
 	Read the first page into memory and set *pagebuf to point to it.
@@ -457,8 +619,8 @@ PF_GetFirstPage(
 }
 
 
-int
-PF_GetNextPage(
+static int
+PFgetNextPage(
     int fd,	/* file descriptor of the file */
     int *pagenum,	/* old page number on input, new page number on output */
     char **pagebuf	/* pointer to pointer to buffer of page data */
@@ -500,7 +662,7 @@ RETURN VALUE:
 
     /* scan the file until a valid used page is found */
     for (temppage= *pagenum+1; temppage<PFftab[fd].hdr.numpages; temppage++) {
-        if ( (error=PFbufGet(fd,temppage,&fpage,PFreadfcn,
+        if ( (error=PFbufGet(fd,temppage,&fpage,PFreadUnlatched,
                              PFwritefcn))!= PFE_OK) {
             return(error);
         } else if (fpage->nextfree == PF_PAGE_USED) {
@@ -537,8 +699,8 @@ RETURN VALUE:
 		the page data.
 	other PF error codes if other error encountered.
 *****************************************************************************/
-int
-PF_GetThisPage(
+static int
+PFgetThisPage(
     int fd,		/* file descriptor */
     int pagenum,	/* page number to read */
     char **pagebuf	/* pointer to pointer to page data */
@@ -557,7 +719,7 @@ PF_GetThisPage(
         return(PFerrno);
     }
 
-    if ( (error=PFbufGet(fd,pagenum,&fpage,PFreadfcn,PFwritefcn))!= PFE_OK) {
+    if ( (error=PFbufGet(fd,pagenum,&fpage,PFreadUnlatched,PFwritefcn))!= PFE_OK) {
         if (error== PFE_PAGEFIXED) {
             *pagebuf = fpage->pagebuf;
         }
@@ -579,6 +741,112 @@ PF_GetThisPage(
     }
 }
 
+/****************************************************************************
+SPECIFICATIONS:
+	Same as PF_GetThisPage(), but the page is looked for first in the
+	buffer "ref" refers to, which costs no hash table lookup. On
+	return "ref" refers to the buffer holding the page, so a caller
+	that keeps it (for instance next to the child page number in a
+	tree node) reaches the page directly next time. A ref whose
+	buffer was since given to another page is detected and refreshed.
+
+RETURN VALUE: as PF_GetThisPage().
+*****************************************************************************/
+static int
+PFgetRefPage(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number to read */
+    PF_PageRef *ref,	/* reference to the buffer, updated */
+    char **pagebuf	/* pointer to pointer to page data */
+)
+{
+    int error;
+    PFfpage *fpage;
+
+    if (PFinvalidFd(fd)) {
+        PFerrno = PFE_FD;
+        return(PFerrno);
+    }
+
+    if (PFinvalidPagenum(fd,pagenum)) {
+        PFerrno = PFE_INVALIDPAGE;
+        return(PFerrno);
+    }
+
+    if ((error=PFbufGetRef(fd,pagenum,ref,&fpage,PFreadUnlatched,PFwritefcn))!= PFE_OK) {
+        if (error== PFE_PAGEFIXED) {
+            *pagebuf = fpage->pagebuf;
+        }
+        return(error);
+    }
+
+    if (fpage->nextfree == PF_PAGE_USED) {
+        /* page is used*/
+        *pagebuf = (char *)fpage->pagebuf;
+        return(PFE_OK);
+    } else {
+        /* invalid page */
+        if (PFbufUnfixRef(fd,pagenum,ref,FALSE)!= PFE_OK) {
+            printf("internal error:PF_GetRefPage()\n");
+            exit(1);
+        }
+        PFerrno = PFE_INVALIDPAGE;
+        return(PFerrno);
+    }
+}
+
+/****************************************************************************
+SPECIFICATIONS:
+	Same as PF_UnfixPage(), for a page fixed with PF_GetRefPage().
+
+RETURN VALUE: as PF_UnfixPage().
+*****************************************************************************/
+static int
+PFunfixRefPage(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    PF_PageRef *ref,	/* reference set by PF_GetRefPage() */
+    int dirty	/* TRUE if page is dirty */
+)
+{
+    if (PFinvalidFd(fd)) {
+        PFerrno = PFE_FD;
+        return(PFerrno);
+    }
+
+    if (PFinvalidPagenum(fd,pagenum)) {
+        PFerrno = PFE_INVALIDPAGE;
+        return(PFerrno);
+    }
+
+    return(PFbufUnfixRef(fd,pagenum,ref,dirty));
+}
+
+/****************************************************************************
+SPECIFICATIONS:
+	Get "size" bytes of memory attached to the buffer of a page fixed
+	with PF_GetRefPage(). The memory starts zeroed and is freed when
+	the page is modified or leaves the buffer, so it can cache
+	anything derived from the page contents.
+
+RETURN VALUE:
+	pointer to the memory, or NULL if none can be attached (always
+	the case with a shared buffer pool).
+*****************************************************************************/
+char *
+PF_RefExt(
+    PF_PageRef *ref,	/* reference to the buffer of a fixed page */
+    int size	/* # of bytes wanted */
+)
+{
+    char *ext;
+
+    PFlatchAcquire();
+    ext = PFbufExt(ref,size);
+    PFlatchRelease();
+    return(ext);
+}
+
 /****************************************************************************
 SPECIFICATIONS:
 	Allocate a new, empty page for file "fd".
@@ -593,8 +861,8 @@ RETURN VALUE:
 	PF error codes if not ok.
 
 *****************************************************************************/
-int
-PF_AllocPage(
+static int
+PFallocPage(
     int fd,		/* file descriptor */
     int *pagenum,	/* page number */
     char **pagebuf	/* pointer to pointer to page buffer*/
@@ -608,18 +876,26 @@ PF_AllocPage(
         return(PFerrno);
     }
 
-    if (PFftab[fd].hdr.firstfree != PF_PAGE_LIST_END) {
+    fpage = NULL;
+    while (fpage == NULL && PFftab[fd].hdr.firstfree != PF_PAGE_LIST_END) {
         /* get a page from the free list */
         *pagenum = PFftab[fd].hdr.firstfree;
         if ((error=PFbufGet(fd,*pagenum,&fpage,PFreadfcn,
-                            PFwritefcn))!= PFE_OK)
-            /* can't get the page */
-        {
-            return(error);
+                            PFwritefcn))!= PFE_OK) {
+            /* can't get the page. If it was being read in by a scan,
+            another thread may have taken it from the list meanwhile:
+            then try the next free page */
+            if (error != PFE_PAGEFIXED
+                    || PFftab[fd].hdr.firstfree == *pagenum) {
+                return(error);
+            }
+            fpage = NULL;
+            continue;
         }
         PFftab[fd].hdr.firstfree = fpage->nextfree;
         PFftab[fd].hdrchanged = TRUE;
-    } else {
+    }
+    if (fpage == NULL) {
         /* Free list empty, allocate one more page from the file */
         *pagenum = PFftab[fd].hdr.numpages;
         if ((error=PFbufAlloc(fd,*pagenum,&fpage,PFwritefcn))!= PFE_OK)
@@ -666,8 +942,8 @@ RETURN VALUE:
 	PFE_OK	if no error.
 	PF error code if error.
 *****************************************************************************/
-int
-PF_DisposePage(
+static int
+PFdisposePage(
     int fd,		/* file descriptor */
     int pagenum	/* page number */
 )
@@ -723,8 +999,8 @@ RETURN VALUE:
 	PF error code if error.
 
 *****************************************************************************/
-int
-PF_UnfixPage(int fd,	/* file descriptor */
+static int
+PFunfixPage(int fd,	/* file descriptor */
              int pagenum,	/* page number */
              int dirty	/* true if file is dirty */
             )
@@ -743,6 +1019,158 @@ PF_UnfixPage(int fd,	/* file descriptor */
     return(PFbufUnfix(fd,pagenum,dirty));
 }
 
+/****************** Latched Interface Routines ****************************/
+/* Each of these takes the latch around the unlatched routine of the
+same name above, which holds the specifications. */
+
+int
+PF_OpenFile(char *fname)
+{
+    int fd;
+
+    PFlatchAcquire();
+    fd = PFopenFile(fname);
+    PFlatchRelease();
+    return(fd);
+}
+
+int
+PF_CloseFile(int fd)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFcloseFile(fd);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_ReopenFile(int fd)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFreopenFile(fd);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_GetNextPage(int fd, int *pagenum, char **pagebuf)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFgetNextPage(fd,pagenum,pagebuf);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_GetThisPage(int fd, int pagenum, char **pagebuf)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFgetThisPage(fd,pagenum,pagebuf);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_GetRefPage(int fd, int pagenum, PF_PageRef *ref, char **pagebuf)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFgetRefPage(fd,pagenum,ref,pagebuf);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_UnfixRefPage(int fd, int pagenum, PF_PageRef *ref, int dirty)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFunfixRefPage(fd,pagenum,ref,dirty);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_AllocPage(int fd, int *pagenum, char **pagebuf)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFallocPage(fd,pagenum,pagebuf);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_DisposePage(int fd, int pagenum)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFdisposePage(fd,pagenum);
+    PFlatchRelease();
+    return(error);
+}
+
+int
+PF_UnfixPage(int fd, int pagenum, int dirty)
+{
+    int error;
+
+    PFlatchAcquire();
+    error = PFunfixPage(fd,pagenum,dirty);
+    PFlatchRelease();
+    return(error);
+}
+
+/****************************************************************************
+SPECIFICATIONS:
+	Set *numpages to the number of pages of file "fd", free pages
+	included: valid page numbers are 0 to *numpages - 1. Lets
+	callers split a file into page ranges, e.g. for parallel scans.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_FD	if fd is invalid.
+*****************************************************************************/
+int
+PF_GetNumPages(
+    int fd,		/* file descriptor */
+    int *numpages	/* # of pages, set on return */
+)
+{
+    PFlatchAcquire();
+    if (PFinvalidFd(fd)) {
+        PFlatchRelease();
+        PFerrno = PFE_FD;
+        return(PFerrno);
+    }
+    *numpages = PFftab[fd].hdr.numpages;
+    PFlatchRelease();
+    return(PFE_OK);
+}
+
+int
+PF_FileStamp(int fd /* file descriptor */)
+{
+    int stamp;
+
+    PFlatchAcquire();
+    stamp = PFinvalidFd(fd) ? (PFerrno = PFE_FD) : PFftab[fd].stamp;
+    PFlatchRelease();
+    return(stamp);
+}
+
 /* error messages */
 static char *PFerrormsg[]= {
     "No error",
@@ -34,8 +34,15 @@
 /* page size */
 #define PF_PAGE_SIZE	4096
 
+/* direct reference to the buffer holding a page (see PF_GetRefPage()).
+Zero it before first use. */
+typedef struct PF_PageRef {
+    void *frame;	/* buffer, or NULL if not known yet */
+    int gen;		/* generation of the buffer when referenced */
+} PF_PageRef;
+
 /* externs from the PF layer */
-extern int PFerrno;		/* error number of last error */
+extern _Thread_local int PFerrno;	/* error number of last error, per thread */
 extern void PF_Init();
 extern void PF_PrintError();
 
@@ -82,6 +89,18 @@ int PF_OpenFile(char *fname		/* name of the file to open */);
 
 int PF_CloseFile(int fd /* file descriptor to close */);
 
+/****************************************************************************
+PF_ReopenFile:
+	Close file "fd" and open the file of the same name again as "fd",
+	for a file renamed over the one that was open. Caches keyed by the
+	file descriptor see a new PF_FileStamp(). No page may be fixed.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PF error code if error; fd is then closed.
+*****************************************************************************/
+int PF_ReopenFile(int fd /* file descriptor to open again */);
+
 /****************************************************************************
 PF_GetFirstPage
 	Read the first page into memory and set *pagebuf to point to it.
@@ -193,3 +212,128 @@ int PF_UnfixPage(int fd,	/* file descriptor */
                  int pagenum,	/* page number */
                  int dirty	/* true if file is dirty */
                 );
+
+
+/****************************************************************************
+PF_GetNumPages:
+	Set *numpages to the number of pages of file "fd", free pages
+	included.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_FD	if fd is invalid.
+*****************************************************************************/
+int PF_GetNumPages(int fd,	/* file descriptor */
+                   int *numpages	/* # of pages, set on return */
+                  );
+
+/****************************************************************************
+PF_FileStamp:
+	A number that differs for every PF_OpenFile() of this process, so
+	that a cache keyed by file descriptor can tell a file opened again
+	on the same descriptor.
+
+RETURN VALUE:
+	the stamp (> 0) of open file "fd"
+	PFE_FD	if fd is invalid.
+*****************************************************************************/
+int PF_FileStamp(int fd	/* file descriptor */);
+
+/****************************************************************************
+PF_GetRefPage:
+	Same as PF_GetThisPage(), but try the buffer "ref" refers to
+	before the hash table, and make "ref" refer to the page's buffer.
+
+RETURN VALUE: as PF_GetThisPage().
+*****************************************************************************/
+int PF_GetRefPage(int fd,	/* file descriptor */
+                  int pagenum,	/* page number to read */
+                  PF_PageRef *ref,	/* reference to the buffer, updated */
+                  char **pagebuf	/* pointer to pointer to page data */
+                 );
+
+/****************************************************************************
+PF_UnfixRefPage:
+	Same as PF_UnfixPage() for a page fixed with PF_GetRefPage().
+
+RETURN VALUE: as PF_UnfixPage().
+*****************************************************************************/
+int PF_UnfixRefPage(int fd,	/* file descriptor */
+                    int pagenum,	/* page number */
+                    PF_PageRef *ref,	/* reference set by PF_GetRefPage() */
+                    int dirty	/* true if page is dirty */
+                   );
+
+/****************************************************************************
+PF_RefExt:
+	Memory attached to the buffer of a page fixed with PF_GetRefPage(),
+	zeroed at first, freed when the page is modified or evicted.
+
+RETURN VALUE:
+	pointer to "size" bytes, or NULL if none can be attached.
+*****************************************************************************/
+char *PF_RefExt(PF_PageRef *ref,	/* reference to the buffer of a fixed page */
+                int size	/* # of bytes wanted */
+               );
+
+/****************************************************************************
+PF_TraceOpen:
+	Start recording every buffer get, unfix and alloc as a
+	(fd, page, op, dirty) record in the binary trace file "fname".
+	PF_Init() does this automatically when the environment variable
+	PF_TRACE is set. Traces are replayed offline by the pfsim tool.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the trace file cannot be created.
+*****************************************************************************/
+int PF_TraceOpen(char *fname /* name of trace file to write */);
+
+/****************************************************************************
+PF_TraceClose:
+	Stop recording and flush the trace file.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the trace could not be flushed.
+*****************************************************************************/
+int PF_TraceClose();
+
+/****************************************************************************
+PF_AttachShared:
+	Use the buffer pool kept in the POSIX shared-memory segment
+	"segname", creating it with "nbufs" frames (PF_MAX_BUFS if
+	nbufs <= 0) if it does not exist. Processes attached to the same
+	segment share cached pages; dirty pages are written to the file
+	when unfixed. Call right after PF_Init(), which does this itself
+	when the environment variable PF_SHM is set. Pages left fixed by
+	a process that died are unfixed when their frames are needed.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the segment cannot be created or mapped.
+	PFE_NOBUF if too many processes are attached already.
+*****************************************************************************/
+int PF_AttachShared(char *segname,	/* name of shared-memory segment */
+                    int nbufs		/* # of frames if created */
+                   );
+
+/****************************************************************************
+PF_DetachShared:
+	Stop using the shared buffer pool and go back to the private one.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_PAGEFIXED if pages are still fixed.
+*****************************************************************************/
+int PF_DetachShared();
+
+/****************************************************************************
+PF_DestroyShared:
+	Remove the shared-memory segment "segname".
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if there is no such segment.
+*****************************************************************************/
+int PF_DestroyShared(char *segname /* name of shared-memory segment */);
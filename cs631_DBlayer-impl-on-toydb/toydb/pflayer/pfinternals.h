@@ -37,4 +37,100 @@ PFbufUsed(
     int pagenum	/* page number */
 );
 
+int
+PFbufGetRef(
+    int fd,	/* file descriptor */
+    int pagenum,	/* page number */
+    PF_PageRef *ref,	/* reference to the buffer last holding the page */
+    PFfpage **fpage,	/* pointer to pointer to file page */
+    int (*readfcn)(),	/* function to read a page */
+    int (*writefcn)()	/* function to write a page */
+);
+
+int
+PFbufUnfixRef(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    PF_PageRef *ref,	/* reference set by PFbufGetRef() */
+    int dirty	/* TRUE if page is dirty */
+);
+
+char *
+PFbufExt(
+    PF_PageRef *ref,	/* reference to a fixed page */
+    int size	/* # of bytes wanted */
+);
+
 void PFbufPrint();
+
+/****************** Interface functions from Trace Recorder *************/
+extern FILE *PFtracefp;	/* open trace file, or NULL if not tracing */
+
+void
+PFtraceRecord(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    int op,		/* PF_TRACE_GET, PF_TRACE_UNFIX or PF_TRACE_ALLOC */
+    int dirty	/* dirty flag, only meaningful for PF_TRACE_UNFIX */
+);
+
+/****************** Interface functions from Paged File *****************/
+int
+PFwritefcn(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page to write */
+    PFfpage *buf	/* buffer holding the page to write */
+);
+
+void PFlatchWait();	/* wait for PFlatchBroadcast(), latch released meanwhile */
+void PFlatchBroadcast();	/* wake the threads in PFlatchWait() */
+
+void
+PFftabIdent(
+    int fd,		/* file descriptor */
+    unsigned long *dev,	/* set to the device of the unix file */
+    unsigned long *ino	/* set to the inode of the unix file */
+);
+
+/****************** Interface functions from Shared Buffer Pool *********/
+extern int PFshmActive;	/* TRUE while a shared pool is attached */
+
+int
+PFshmGet(
+    int fd,	/* file descriptor */
+    int pagenum,	/* page number */
+    PFfpage **fpage,	/* pointer to pointer to file page */
+    int (*readfcn)(),	/* function to read a page */
+    int (*writefcn)()	/* function to write a page */
+);
+
+int
+PFshmUnfix(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    int dirty,	/* TRUE if page is dirty */
+    int (*writefcn)()	/* function to write a page */
+);
+
+int
+PFshmAlloc(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    PFfpage **fpage	/* pointer to file page */
+);
+
+int PFshmReleaseFile(int fd /* file descriptor */);
+
+int
+PFshmUsed(
+    int fd,		/* file descriptor */
+    int pagenum	/* page number */
+);
+
+void
+PFshmInvalidate(
+    unsigned long dev,	/* device of the file */
+    unsigned long ino	/* inode of the file */
+);
+
+void PFshmPrint();
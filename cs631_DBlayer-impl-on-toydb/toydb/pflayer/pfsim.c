@@ -0,0 +1,493 @@
+/* pfsim.c: replays a buffer access trace written by PF_TraceOpen()
+against several replacement policies (LRU, CLOCK, 2Q and ARC) and
+buffer pool sizes, and reports hit rates and write-backs.
+
+usage: pfsim tracefile [nbufs ...]
+
+A PF_TRACE_GET is a page reference: a hit if the page is resident,
+otherwise a miss that costs one read. A PF_TRACE_ALLOC brings a new
+page in without a read. A dirty PF_TRACE_UNFIX marks the resident page
+dirty; evicting a dirty page costs one write-back. Pages still dirty at
+the end of the trace are reported as flushes. Fixing is not simulated,
+so a policy may evict a page the traced program still had fixed. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "pftypes.h"
+
+#define SIM_LRU		0
+#define SIM_CLOCK	1
+#define SIM_2Q		2
+#define SIM_ARC		3
+#define SIM_NPOLICIES	4
+
+/* list an entry is on */
+#define SIM_NONE	0
+#define SIM_T1		1	/* LRU: the only list. 2Q: A1in. ARC: T1 */
+#define SIM_T2		2	/* 2Q: Am. ARC: T2 */
+#define SIM_B1		3	/* 2Q: A1out (ghost). ARC: B1 (ghost) */
+#define SIM_B2		4	/* ARC: B2 (ghost) */
+#define SIM_NLISTS	5
+
+static char *SIMpolicyname[SIM_NPOLICIES] = { "LRU", "CLOCK", "2Q", "ARC" };
+
+/* a page known to the simulator, resident or ghost */
+typedef struct SIMent {
+    long key;			/* (fd << 32) | page */
+    int list;			/* SIM_T1 ... SIM_B2 */
+    int dirty;			/* TRUE if page is dirty */
+    int ref;			/* CLOCK reference bit */
+    int slot;			/* CLOCK frame index */
+    struct SIMent *prev, *next;	/* links in its list */
+    struct SIMent *hnext;	/* link in its hash bucket */
+} SIMent;
+
+typedef struct SIMlist {
+    SIMent *head;		/* most recently inserted */
+    SIMent *tail;		/* least recently inserted */
+    int len;
+} SIMlist;
+
+/* state of one simulated buffer pool */
+typedef struct SIMpool {
+    int policy;
+    int nbufs;			/* pool size in pages */
+    SIMent **htbl;		/* hash table of known pages */
+    int hsize;
+    SIMlist lists[SIM_NLISTS];
+    SIMent **frames;		/* CLOCK frames */
+    int hand;			/* CLOCK hand */
+    int nresident;
+    double p;			/* ARC target size of T1 */
+    long refs, hits, allocs, writebacks;
+} SIMpool;
+
+#define SIMkey(fd,page) (((long)(fd) << 32) | (unsigned)(page))
+
+static SIMent *SIMfind(SIMpool *pool, long key)
+{
+    SIMent *e;
+
+    for (e = pool->htbl[key % pool->hsize]; e != NULL; e = e->hnext) {
+        if (e->key == key) {
+            return(e);
+        }
+    }
+    return(NULL);
+}
+
+static SIMent *SIMnew(SIMpool *pool, long key)
+{
+    SIMent *e;
+    int bucket = key % pool->hsize;
+
+    if ((e = (SIMent *)calloc(1,sizeof(SIMent))) == NULL) {
+        fprintf(stderr,"pfsim: out of memory\n");
+        exit(1);
+    }
+    e->key = key;
+    e->hnext = pool->htbl[bucket];
+    pool->htbl[bucket] = e;
+    return(e);
+}
+
+static void SIMforget(SIMpool *pool, SIMent *e)
+{
+    SIMent **pe;
+
+    for (pe = &pool->htbl[e->key % pool->hsize]; *pe != e; pe = &(*pe)->hnext)
+        ;
+    *pe = e->hnext;
+    free(e);
+}
+
+static void SIMpush(SIMpool *pool, int list, SIMent *e)
+{
+    SIMlist *l = &pool->lists[list];
+
+    e->list = list;
+    e->prev = NULL;
+    e->next = l->head;
+    if (l->head != NULL) {
+        l->head->prev = e;
+    }
+    l->head = e;
+    if (l->tail == NULL) {
+        l->tail = e;
+    }
+    l->len++;
+}
+
+static void SIMunlink(SIMpool *pool, SIMent *e)
+{
+    SIMlist *l = &pool->lists[e->list];
+
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        l->head = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    } else {
+        l->tail = e->prev;
+    }
+    e->prev = e->next = NULL;
+    e->list = SIM_NONE;
+    l->len--;
+}
+
+/* a resident page leaves the pool: pay for the write if it is dirty */
+static void SIMevict(SIMpool *pool, SIMent *e)
+{
+    if (e->dirty) {
+        pool->writebacks++;
+        e->dirty = FALSE;
+    }
+    pool->nresident--;
+}
+
+/* drop the least recently inserted entry of a list altogether */
+static void SIMdroptail(SIMpool *pool, int list)
+{
+    SIMent *e = pool->lists[list].tail;
+
+    SIMunlink(pool,e);
+    SIMforget(pool,e);
+}
+
+/****************************** LRU ***************************************/
+static void SIMlru(SIMpool *pool, long key, int isref)
+{
+    SIMent *e;
+
+    if ((e = SIMfind(pool,key)) != NULL) {
+        pool->hits += isref;
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_T1,e);
+        return;
+    }
+    if (pool->nresident == pool->nbufs) {
+        SIMevict(pool,pool->lists[SIM_T1].tail);
+        SIMdroptail(pool,SIM_T1);
+    }
+    SIMpush(pool,SIM_T1,SIMnew(pool,key));
+    pool->nresident++;
+}
+
+/****************************** CLOCK *************************************/
+static void SIMclock(SIMpool *pool, long key, int isref)
+{
+    SIMent *e;
+
+    if ((e = SIMfind(pool,key)) != NULL) {
+        pool->hits += isref;
+        e->ref = TRUE;
+        return;
+    }
+    /* advance the hand past referenced frames, clearing their bits */
+    while (pool->frames[pool->hand] != NULL && pool->frames[pool->hand]->ref) {
+        pool->frames[pool->hand]->ref = FALSE;
+        pool->hand = (pool->hand + 1) % pool->nbufs;
+    }
+    if ((e = pool->frames[pool->hand]) != NULL) {
+        SIMevict(pool,e);
+        SIMforget(pool,e);
+    }
+    e = SIMnew(pool,key);
+    e->list = SIM_T1;
+    e->ref = TRUE;
+    e->slot = pool->hand;
+    pool->frames[pool->hand] = e;
+    pool->hand = (pool->hand + 1) % pool->nbufs;
+    pool->nresident++;
+}
+
+/****************************** 2Q ****************************************/
+/* Full 2Q (Johnson and Shasha): A1in is a FIFO of pages seen once,
+A1out remembers pages recently pushed out of A1in, Am is an LRU of pages
+seen again. Kin and Kout use the paper's recommended 25% and 50%. */
+static void SIM2qreclaim(SIMpool *pool)
+{
+    int kin = pool->nbufs / 4 > 0 ? pool->nbufs / 4 : 1;
+    int kout = pool->nbufs / 2 > 0 ? pool->nbufs / 2 : 1;
+    SIMent *e;
+
+    if (pool->nresident < pool->nbufs) {
+        return;
+    }
+    if (pool->lists[SIM_T1].len > kin || pool->lists[SIM_T2].len == 0) {
+        /* page out the tail of A1in and remember it in A1out */
+        e = pool->lists[SIM_T1].tail;
+        SIMevict(pool,e);
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_B1,e);
+        if (pool->lists[SIM_B1].len > kout) {
+            SIMdroptail(pool,SIM_B1);
+        }
+    } else {
+        /* page out the tail of Am, not remembered */
+        SIMevict(pool,pool->lists[SIM_T2].tail);
+        SIMdroptail(pool,SIM_T2);
+    }
+}
+
+static void SIM2q(SIMpool *pool, long key, int isref)
+{
+    SIMent *e = SIMfind(pool,key);
+
+    if (e != NULL && e->list == SIM_T2) {
+        pool->hits += isref;
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_T2,e);
+    } else if (e != NULL && e->list == SIM_T1) {
+        /* correlated reference: leave it where it is in A1in */
+        pool->hits += isref;
+    } else if (e != NULL) {
+        /* ghost hit in A1out: the page has proved itself, go to Am */
+        SIMunlink(pool,e);
+        SIM2qreclaim(pool);
+        SIMpush(pool,SIM_T2,e);
+        pool->nresident++;
+    } else {
+        SIM2qreclaim(pool);
+        SIMpush(pool,SIM_T1,SIMnew(pool,key));
+        pool->nresident++;
+    }
+}
+
+/****************************** ARC ***************************************/
+/* Adaptive Replacement Cache (Megiddo and Modha, FAST 2003). T1/T2
+hold resident pages seen once/more than once, B1/B2 are their ghosts and
+p adapts the share of the pool given to T1. */
+static void SIMarcreplace(SIMpool *pool, int inb2)
+{
+    SIMent *e;
+    int t1len = pool->lists[SIM_T1].len;
+
+    if (t1len > 0 && (pool->lists[SIM_T2].len == 0 || t1len > pool->p
+                      || (inb2 && t1len == (int)pool->p))) {
+        e = pool->lists[SIM_T1].tail;
+        SIMevict(pool,e);
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_B1,e);
+    } else {
+        e = pool->lists[SIM_T2].tail;
+        SIMevict(pool,e);
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_B2,e);
+    }
+}
+
+static void SIMarc(SIMpool *pool, long key, int isref)
+{
+    SIMent *e = SIMfind(pool,key);
+    int c = pool->nbufs;
+    int b1len = pool->lists[SIM_B1].len, b2len = pool->lists[SIM_B2].len;
+    int l1len, l2len;
+    double delta;
+
+    if (e != NULL && (e->list == SIM_T1 || e->list == SIM_T2)) {
+        pool->hits += isref;
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_T2,e);
+        return;
+    }
+
+    if (e != NULL && e->list == SIM_B1) {
+        delta = b1len >= b2len ? 1.0 : (double)b2len / b1len;
+        pool->p = pool->p + delta < c ? pool->p + delta : c;
+        SIMarcreplace(pool,FALSE);
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_T2,e);
+        pool->nresident++;
+        return;
+    }
+
+    if (e != NULL && e->list == SIM_B2) {
+        delta = b2len >= b1len ? 1.0 : (double)b1len / b2len;
+        pool->p = pool->p - delta > 0 ? pool->p - delta : 0;
+        SIMarcreplace(pool,TRUE);
+        SIMunlink(pool,e);
+        SIMpush(pool,SIM_T2,e);
+        pool->nresident++;
+        return;
+    }
+
+    /* complete miss */
+    l1len = pool->lists[SIM_T1].len + b1len;
+    l2len = pool->lists[SIM_T2].len + b2len;
+    if (l1len == c) {
+        if (pool->lists[SIM_T1].len < c) {
+            SIMdroptail(pool,SIM_B1);
+            SIMarcreplace(pool,FALSE);
+        } else {
+            e = pool->lists[SIM_T1].tail;
+            SIMevict(pool,e);
+            SIMdroptail(pool,SIM_T1);
+        }
+    } else if (l1len < c && l1len + l2len >= c) {
+        if (l1len + l2len == 2 * c) {
+            SIMdroptail(pool,SIM_B2);
+        }
+        SIMarcreplace(pool,FALSE);
+    }
+    SIMpush(pool,SIM_T1,SIMnew(pool,key));
+    pool->nresident++;
+}
+
+/**************************** Driver **************************************/
+static void SIMinit(SIMpool *pool, int policy, int nbufs)
+{
+    memset(pool,0,sizeof(SIMpool));
+    pool->policy = policy;
+    pool->nbufs = nbufs;
+    pool->hsize = 4 * nbufs + 1;
+    pool->htbl = (SIMent **)calloc(pool->hsize,sizeof(SIMent *));
+    pool->frames = (SIMent **)calloc(nbufs,sizeof(SIMent *));
+    if (pool->htbl == NULL || pool->frames == NULL) {
+        fprintf(stderr,"pfsim: out of memory\n");
+        exit(1);
+    }
+}
+
+static void SIMfree(SIMpool *pool)
+{
+    SIMent *e, *next;
+    int i;
+
+    for (i = 0; i < pool->hsize; i++) {
+        for (e = pool->htbl[i]; e != NULL; e = next) {
+            next = e->hnext;
+            free(e);
+        }
+    }
+    free(pool->htbl);
+    free(pool->frames);
+}
+
+static void SIMaccess(SIMpool *pool, PFtrace_rec *rec)
+{
+    long key = SIMkey(rec->fd,rec->page);
+    int isref = (rec->op == PF_TRACE_GET);
+    SIMent *e;
+
+    if (rec->op == PF_TRACE_UNFIX) {
+        if (rec->dirty && (e = SIMfind(pool,key)) != NULL
+                && e->list != SIM_B1 && e->list != SIM_B2) {
+            e->dirty = TRUE;
+        }
+        return;
+    }
+
+    pool->refs += isref;
+    pool->allocs += !isref;
+    switch (pool->policy) {
+    case SIM_LRU:
+        SIMlru(pool,key,isref);
+        break;
+    case SIM_CLOCK:
+        SIMclock(pool,key,isref);
+        break;
+    case SIM_2Q:
+        SIM2q(pool,key,isref);
+        break;
+    case SIM_ARC:
+        SIMarc(pool,key,isref);
+        break;
+    }
+}
+
+/* count resident pages still dirty when the trace ends */
+static long SIMdirtyleft(SIMpool *pool)
+{
+    SIMent *e;
+    long n = 0;
+    int i;
+
+    for (i = 0; i < pool->hsize; i++) {
+        for (e = pool->htbl[i]; e != NULL; e = e->hnext) {
+            n += e->dirty;
+        }
+    }
+    return(n);
+}
+
+int
+main(int argc, char **argv)
+{
+    FILE *fp;
+    PFtrace_hdr hdr;
+    PFtrace_rec *trace;
+    long ntrace, cap, i;
+    int defaultsizes[] = { 5, 10, PF_MAX_BUFS, 50, 100, 500 };
+    int *sizes, nsizes, s, policy;
+    SIMpool pool;
+
+    if (argc < 2) {
+        fprintf(stderr,"usage: %s tracefile [nbufs ...]\n",argv[0]);
+        exit(1);
+    }
+
+    if ((fp = fopen(argv[1],"rb")) == NULL) {
+        perror(argv[1]);
+        exit(1);
+    }
+    if (fread((char *)&hdr,sizeof(hdr),1,fp) != 1 || hdr.magic != PF_TRACE_MAGIC) {
+        fprintf(stderr,"%s: not a PF trace file\n",argv[1]);
+        exit(1);
+    }
+
+    /* read the whole trace; it is replayed once per policy and size */
+    cap = 4096;
+    ntrace = 0;
+    trace = (PFtrace_rec *)malloc(cap * sizeof(PFtrace_rec));
+    while (trace != NULL) {
+        ntrace += fread((char *)(trace + ntrace),sizeof(PFtrace_rec),
+                        cap - ntrace,fp);
+        if (ntrace < cap) {
+            break;
+        }
+        cap *= 2;
+        trace = (PFtrace_rec *)realloc(trace,cap * sizeof(PFtrace_rec));
+    }
+    fclose(fp);
+    if (trace == NULL) {
+        fprintf(stderr,"pfsim: out of memory\n");
+        exit(1);
+    }
+
+    if (argc > 2) {
+        nsizes = argc - 2;
+        sizes = (int *)malloc(nsizes * sizeof(int));
+        for (s = 0; s < nsizes; s++) {
+            if ((sizes[s] = atoi(argv[s + 2])) <= 0) {
+                fprintf(stderr,"pfsim: bad pool size %s\n",argv[s + 2]);
+                exit(1);
+            }
+        }
+    } else {
+        nsizes = sizeof(defaultsizes) / sizeof(int);
+        sizes = defaultsizes;
+    }
+
+    printf("trace %s: %ld events, recorded with %d buffers\n",
+           argv[1],ntrace,hdr.maxbufs);
+    printf("policy\tnbufs\trefs\thits\thitrate\twritebk\tflushed\n");
+    for (s = 0; s < nsizes; s++) {
+        for (policy = 0; policy < SIM_NPOLICIES; policy++) {
+            SIMinit(&pool,policy,sizes[s]);
+            for (i = 0; i < ntrace; i++) {
+                SIMaccess(&pool,&trace[i]);
+            }
+            printf("%s\t%d\t%ld\t%ld\t%.4f\t%ld\t%ld\n",
+                   SIMpolicyname[policy],sizes[s],pool.refs,pool.hits,
+                   pool.refs > 0 ? (double)pool.hits / pool.refs : 0.0,
+                   pool.writebacks,SIMdirtyleft(&pool));
+            SIMfree(&pool);
+        }
+    }
+    free(trace);
+    return 0;
+}
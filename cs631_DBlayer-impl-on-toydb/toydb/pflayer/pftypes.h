@@ -23,7 +23,7 @@ typedef struct PFfpage {
 } PFfpage;
 
 /*************************** Opened File Table **********************/
-#define PF_FTAB_SIZE	20	/* size of open file table */
+#define PF_FTAB_SIZE	64	/* size of open file table */
 
 /* open file table entry */
 typedef struct PFftab_ele {
@@ -31,6 +31,10 @@ typedef struct PFftab_ele {
     int unixfd;	/* unix file descriptor*/
     PFhdr_str hdr;	/* file header */
     short hdrchanged; /* TRUE if file header has changed */
+    unsigned long dev;	/* device of the unix file */
+    unsigned long ino;	/* inode of the unix file; with dev, names the
+			file's pages in a shared buffer pool */
+    int stamp;		/* different for every open, see PF_FileStamp() */
 } PFftab_ele;
 
 /************************** Buffer Page Decls *********************/
@@ -43,9 +47,16 @@ typedef struct PFbpage {
     struct PFbpage *prevpage;	/* previous in the linked list
 					of buffer pages */
     short	dirty:1,		/* TRUE if page is dirty */
-            fixed:1;		/* TRUE if page is fixed in buffer*/
+            fixed:1,		/* TRUE if page is fixed in buffer*/
+            loading:1;		/* TRUE while the page is being read in,
+					with the latch released (see PFbufGet()) */
     int	page;			/* page number of this page */
     int	fd;			/* file desciptor of this page */
+    int	gen;			/* bumped whenever the buffer is given
+					to another page, so that old
+					PF_PageRefs to it become invalid */
+    char *ext;			/* memory attached by PF_RefExt(), or NULL */
+    int	extsize;		/* size of ext in bytes */
     PFfpage fpage; /* page data from the file */
 } PFbpage;
 
@@ -66,6 +77,27 @@ typedef struct PFhash_entry {
 /* Hash function for hash table */
 #define PFhash(fd,page) (((fd)+(page)) % PF_HASH_TBL_SIZE)
 
+/******************** Buffer Access Trace Decls *******************/
+/* A trace file is a PFtrace_hdr followed by one PFtrace_rec per
+buffer access. It is written by the buffer manager when tracing is on
+(see PF_TraceOpen()) and replayed offline by pfsim. */
+#define PF_TRACE_MAGIC	0x52545050	/* "PPTR" */
+#define PF_TRACE_GET	'g'	/* page fixed by PFbufGet() */
+#define PF_TRACE_UNFIX	'u'	/* page unfixed by PFbufUnfix() */
+#define PF_TRACE_ALLOC	'a'	/* new page allocated by PFbufAlloc() */
+
+typedef struct PFtrace_hdr {
+    int magic;		/* PF_TRACE_MAGIC */
+    int maxbufs;	/* PF_MAX_BUFS of the traced run */
+} PFtrace_hdr;
+
+typedef struct PFtrace_rec {
+    short fd;		/* file descriptor */
+    char op;		/* PF_TRACE_GET, PF_TRACE_UNFIX or PF_TRACE_ALLOC */
+    char dirty;		/* dirty flag given to PFbufUnfix() */
+    int page;		/* page number */
+} PFtrace_rec;
+
 /******************* Interface functions from Hash Table ****************/
 extern void PFhashInit();
 extern PFbpage *PFhashFind();
@@ -0,0 +1,966 @@
+/* shmbuf.c: buffer pool kept in a POSIX shared-memory segment, so that
+several processes reading the same paged files share one cache.
+The interface routines are PF_AttachShared(), PF_DetachShared() and
+PF_DestroyShared(), plus PFshmGet(), PFshmUnfix(), PFshmAlloc(),
+PFshmReleaseFile(), PFshmUsed(), PFshmInvalidate() and PFshmPrint(),
+which buf.c calls in place of its own routines while a segment is
+attached.
+
+The segment holds a header, the hash buckets and the frames. Processes
+map it at different addresses, so everything inside it is linked by
+frame index, never by pointer. Pages are identified by the (device,
+inode) of their unix file rather than by PF file descriptor, which is
+only meaningful inside one process. A single process-shared mutex
+(the latch) guards the hash table, the LRU list and the frame headers;
+a process-shared condition variable lets a process wait for a page
+another process is still reading in. The reader also holds a robust
+mutex of the frame while it reads: if it dies, the waiters find that
+mutex abandoned when they next check and free the frame, as does the
+next process to take the latch after one died holding it. Page data
+itself is not latched:
+the shared pool is meant for concurrent readers with at most one
+writer.
+
+Writes go straight through to disk when a dirty page is unfixed, so
+frames in the segment are always clean. Any process can then evict any
+unfixed frame without needing the file open. The cost is one write per
+dirty unfix instead of one per eviction.
+
+Each process also keeps a private list of the pages it has fixed, so
+fixing a page twice from the same process still gives PFE_PAGEFIXED as
+it does with the private pool.
+
+An attached process holds a slot of the header, which records its pid,
+and each frame counts its pins per slot as well as in total. A process
+that dies with pages fixed would otherwise keep their frames from ever
+being evicted: when no frame is free, the victim scan looks for slots
+whose process no longer exists, takes their pins off every frame and
+frees the slots, then scans again. Attaching does the same when no
+slot is free. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pf.h"
+#include "pftypes.h"
+#include "pfinternals.h"
+
+#define PF_SHM_MAGIC	0x32485350	/* "PSH2" */
+#define PF_SHM_NULL	-1		/* end of a frame list */
+#define PF_SHM_WAITS	5000		/* 1ms polls for a segment being set up */
+#define PF_SHM_LOADWAIT	100		/* ms between checks that a page reader lives */
+#define PF_SHM_MAXPROCS	64		/* # of processes attached at once */
+
+/* a frame in the shared segment */
+typedef struct PFshm_frame {
+    int nextframe;	/* next (less recently used) frame in the used list,
+			   or next frame in the free list */
+    int prevframe;	/* previous (more recently used) frame */
+    int hashnext;	/* next frame in the same hash bucket */
+    int pincount;	/* # of fixes on this page, from all processes */
+    unsigned short pins[PF_SHM_MAXPROCS];	/* of them, by the process of each slot */
+    short valid;	/* TRUE if the frame holds a page */
+    short loading;	/* TRUE while a process reads the page in */
+    pthread_mutex_t reading;	/* held by that process meanwhile */
+    unsigned long dev;	/* device of the file the page belongs to */
+    unsigned long ino;	/* inode of the file the page belongs to */
+    int page;		/* page number */
+    PFfpage fpage;	/* page data from the file */
+} PFshm_frame;
+
+/* header at the start of the shared segment */
+typedef struct PFshm_hdr {
+    int magic;		/* PF_SHM_MAGIC once the segment is set up */
+    int nbufs;		/* # of frames */
+    int hsize;		/* # of hash buckets */
+    int frameoff;	/* byte offset of the first frame */
+    int firstframe;	/* most recently used frame */
+    int lastframe;	/* least recently used frame */
+    int freeframe;	/* list of never used or invalidated frames */
+    pid_t procs[PF_SHM_MAXPROCS];	/* pid of the process in each slot, 0 if free */
+    pthread_mutex_t latch;	/* guards everything except page data */
+    pthread_cond_t loaded;	/* signalled when a page has been read in */
+} PFshm_hdr;
+
+/* a page fixed by this process */
+typedef struct PFshm_fix {
+    int fd;		/* PF file descriptor used to fix it */
+    int page;		/* page number */
+    int frame;		/* frame holding it */
+    int dirty;		/* TRUE if it must be written when unfixed */
+} PFshm_fix;
+
+int PFshmActive = FALSE;	/* TRUE while a segment is attached */
+
+static PFshm_hdr *PFshmhdr = NULL;	/* attached segment */
+static size_t PFshmsize;		/* bytes mapped */
+static PFshm_fix *PFshmfix = NULL;	/* pages fixed by this process */
+static int PFshmnfix = 0;
+static int PFshmmaxfix = 0;
+static int PFshmslot = -1;		/* slot of this process in the header */
+static pid_t PFshmpid = 0;		/* pid the slot was taken for */
+
+#define PFshmBucket(hdr) ((int *)((char *)(hdr) + sizeof(PFshm_hdr)))
+#define PFshmFrame(hdr,i) ((PFshm_frame *)((char *)(hdr) + (hdr)->frameoff) + (i))
+#define PFshmHash(hdr,dev,ino,page) \
+	((unsigned long)((dev) * 31 + (ino) * 17 + (page)) % (hdr)->hsize)
+
+
+/****************** Internal Support Functions *****************************/
+static size_t PFshmSegSize(int nbufs, int *hsize, int *frameoff)
+/****************************************************************************
+SPECIFICATIONS:
+	Compute the layout of a segment with "nbufs" frames.
+
+RETURN VALUE: size of the segment in bytes.
+*****************************************************************************/
+{
+    *hsize = 2 * nbufs + 1;
+    *frameoff = sizeof(PFshm_hdr) + *hsize * sizeof(int);
+    *frameoff = (*frameoff + 15) & ~15;
+    return(*frameoff + (size_t)nbufs * sizeof(PFshm_frame));
+}
+
+static void PFshmReclaim();
+static int PFshmReapDead();
+
+static void PFshmOwnerDied()
+{
+    /* a process died holding the latch. Every update made under the
+    latch leaves the lists consistent, so carry on, but free the
+    frames of pages it may have been reading in, and its pins. */
+    pthread_mutex_consistent(&PFshmhdr->latch);
+    PFshmReclaim();
+    PFshmReapDead();
+}
+
+static int PFshmTakeSlot();
+
+static void PFshmLock()
+{
+    if (pthread_mutex_lock(&PFshmhdr->latch) == EOWNERDEAD) {
+        PFshmOwnerDied();
+    }
+    if (PFshmpid != getpid()) {
+        /* a child forked after the attach: the slot and the pages
+        fixed are its parent's */
+        PFshmnfix = 0;
+        PFshmTakeSlot();
+    }
+}
+
+static void PFshmUnlock()
+{
+    pthread_mutex_unlock(&PFshmhdr->latch);
+}
+
+static int PFshmHashFind(unsigned long dev, unsigned long ino, int page)
+{
+    int f;
+    PFshm_frame *frame;
+
+    for (f = PFshmBucket(PFshmhdr)[PFshmHash(PFshmhdr,dev,ino,page)];
+            f != PF_SHM_NULL; f = frame->hashnext) {
+        frame = PFshmFrame(PFshmhdr,f);
+        if (frame->page == page && frame->ino == ino && frame->dev == dev) {
+            return(f);
+        }
+    }
+    return(PF_SHM_NULL);
+}
+
+static void PFshmHashInsert(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+    int *bucket = &PFshmBucket(PFshmhdr)[PFshmHash(PFshmhdr,frame->dev,
+                                         frame->ino,frame->page)];
+
+    frame->hashnext = *bucket;
+    *bucket = f;
+}
+
+static void PFshmHashDelete(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+    int *link = &PFshmBucket(PFshmhdr)[PFshmHash(PFshmhdr,frame->dev,
+                                       frame->ino,frame->page)];
+
+    while (*link != f) {
+        link = &PFshmFrame(PFshmhdr,*link)->hashnext;
+    }
+    *link = frame->hashnext;
+}
+
+static void PFshmLinkHead(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+
+    frame->nextframe = PFshmhdr->firstframe;
+    frame->prevframe = PF_SHM_NULL;
+    if (PFshmhdr->firstframe != PF_SHM_NULL) {
+        PFshmFrame(PFshmhdr,PFshmhdr->firstframe)->prevframe = f;
+    }
+    PFshmhdr->firstframe = f;
+    if (PFshmhdr->lastframe == PF_SHM_NULL) {
+        PFshmhdr->lastframe = f;
+    }
+}
+
+static void PFshmUnlink(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+
+    if (PFshmhdr->firstframe == f) {
+        PFshmhdr->firstframe = frame->nextframe;
+    }
+    if (PFshmhdr->lastframe == f) {
+        PFshmhdr->lastframe = frame->prevframe;
+    }
+    if (frame->nextframe != PF_SHM_NULL) {
+        PFshmFrame(PFshmhdr,frame->nextframe)->prevframe = frame->prevframe;
+    }
+    if (frame->prevframe != PF_SHM_NULL) {
+        PFshmFrame(PFshmhdr,frame->prevframe)->nextframe = frame->nextframe;
+    }
+    frame->nextframe = frame->prevframe = PF_SHM_NULL;
+}
+
+/* take frame f out of the used list and the hash table, onto the free list */
+static void PFshmDrop(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+
+    PFshmHashDelete(f);
+    PFshmUnlink(f);
+    frame->valid = FALSE;
+    frame->pincount = 0;
+    memset(frame->pins,0,sizeof(frame->pins));
+    frame->nextframe = PFshmhdr->freeframe;
+    PFshmhdr->freeframe = f;
+}
+
+static int PFshmLoaderDied(int f)
+/****************************************************************************
+SPECIFICATIONS:
+	With the latch held: if frame f is being read in by a process that
+	no longer exists, clear its loading state and the reader's pin, and
+	wake the processes waiting for it. The page data is not valid.
+
+RETURN VALUE: TRUE if the reader had died, else FALSE.
+*****************************************************************************/
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+    int error;
+
+    if (!frame->loading || (error = pthread_mutex_trylock(&frame->reading)) == EBUSY) {
+        return(FALSE);
+    }
+    if (error == EOWNERDEAD) {
+        pthread_mutex_consistent(&frame->reading);
+    }
+    pthread_mutex_unlock(&frame->reading);
+    frame->loading = FALSE;
+    frame->pincount = 0;
+    memset(frame->pins,0,sizeof(frame->pins));
+    pthread_cond_broadcast(&PFshmhdr->loaded);
+    return(TRUE);
+}
+
+/* with the latch held: free every frame left loading by a dead process */
+static void PFshmReclaim()
+{
+    int f;
+
+    for (f = 0; f < PFshmhdr->nbufs; f++) {
+        if (PFshmFrame(PFshmhdr,f)->valid && PFshmLoaderDied(f)) {
+            PFshmDrop(f);
+        }
+    }
+}
+
+static int PFshmReapDead()
+/****************************************************************************
+SPECIFICATIONS:
+	With the latch held: free the slot of every process that no longer
+	exists, taking its pins off the frames. A pid reused by another
+	process keeps the slot taken; its pins are then kept, never lost.
+
+RETURN VALUE: # of slots freed.
+*****************************************************************************/
+{
+    PFshm_frame *frame;
+    int slot, f, nfreed = 0;
+
+    for (slot = 0; slot < PF_SHM_MAXPROCS; slot++) {
+        if (PFshmhdr->procs[slot] == 0 || slot == PFshmslot
+                || kill(PFshmhdr->procs[slot],0) == 0 || errno != ESRCH) {
+            continue;
+        }
+        for (f = 0; f < PFshmhdr->nbufs; f++) {
+            frame = PFshmFrame(PFshmhdr,f);
+            frame->pincount -= frame->pins[slot];
+            frame->pins[slot] = 0;
+        }
+        PFshmhdr->procs[slot] = 0;
+        nfreed++;
+    }
+    return(nfreed);
+}
+
+static int PFshmTakeSlot()
+/****************************************************************************
+SPECIFICATIONS:
+	With the latch held: take a free slot of the header for this
+	process, freeing those of dead processes if none is free.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_NOBUF if PF_SHM_MAXPROCS live processes are attached.
+*****************************************************************************/
+{
+    int slot, pass;
+
+    PFshmslot = -1;
+    PFshmpid = getpid();
+    for (pass = 0; pass < 2; pass++) {
+        for (slot = 0; slot < PF_SHM_MAXPROCS; slot++) {
+            if (PFshmhdr->procs[slot] == 0) {
+                PFshmhdr->procs[slot] = PFshmpid;
+                PFshmslot = slot;
+                return(PFE_OK);
+            }
+        }
+        if (PFshmReapDead() == 0) {
+            break;
+        }
+    }
+    PFerrno = PFE_NOBUF;
+    return(PFerrno);
+}
+
+/* with the latch held: pin frame f for this process */
+static void PFshmPin(int f)
+{
+    PFshm_frame *frame = PFshmFrame(PFshmhdr,f);
+
+    frame->pincount++;
+    if (PFshmslot >= 0) {
+        frame->pins[PFshmslot]++;
+    }
+}
+
+static int PFshmVictim(int *f)
+/****************************************************************************
+SPECIFICATIONS:
+	Find a frame for a new page, with the latch held: a free frame if
+	there is one, else the least recently used frame nobody has fixed
+	(or whose reader died). If every frame is fixed, the pins of dead
+	processes are reclaimed (see PFshmReapDead()) and the frames looked
+	at again. The frame is returned out of every list. Frames are never
+	dirty, so nothing has to be written.
+
+RETURN VALUE:
+	PFE_OK	if a frame was found.
+	PFE_NOBUF if every frame is fixed or being read.
+*****************************************************************************/
+{
+    PFshm_frame *frame;
+    int pass;
+
+    if ((*f = PFshmhdr->freeframe) != PF_SHM_NULL) {
+        PFshmhdr->freeframe = PFshmFrame(PFshmhdr,*f)->nextframe;
+        return(PFE_OK);
+    }
+
+    for (pass = 0; pass < 2; pass++) {
+        for (*f = PFshmhdr->lastframe; *f != PF_SHM_NULL; *f = frame->prevframe) {
+            frame = PFshmFrame(PFshmhdr,*f);
+            if ((frame->pincount == 0 && !frame->loading) || PFshmLoaderDied(*f)) {
+                PFshmHashDelete(*f);
+                PFshmUnlink(*f);
+                frame->valid = FALSE;
+                memset(frame->pins,0,sizeof(frame->pins));
+                return(PFE_OK);
+            }
+        }
+        if (PFshmReapDead() == 0) {
+            break;
+        }
+    }
+
+    PFerrno = PFE_NOBUF;
+    return(PFerrno);
+}
+
+static PFshm_fix *PFshmFindFix(int fd, int page)
+{
+    int i;
+
+    for (i = 0; i < PFshmnfix; i++) {
+        if (PFshmfix[i].fd == fd && PFshmfix[i].page == page) {
+            return(&PFshmfix[i]);
+        }
+    }
+    return(NULL);
+}
+
+static int PFshmAddFix(int fd, int page, int f)
+{
+    PFshm_fix *newfix;
+
+    if (PFshmnfix == PFshmmaxfix) {
+        newfix = (PFshm_fix *)realloc(PFshmfix,
+                                      (PFshmmaxfix + PF_MAX_BUFS) * sizeof(PFshm_fix));
+        if (newfix == NULL) {
+            PFerrno = PFE_NOMEM;
+            return(PFerrno);
+        }
+        PFshmfix = newfix;
+        PFshmmaxfix += PF_MAX_BUFS;
+    }
+    PFshmfix[PFshmnfix].fd = fd;
+    PFshmfix[PFshmnfix].page = page;
+    PFshmfix[PFshmnfix].frame = f;
+    PFshmfix[PFshmnfix].dirty = FALSE;
+    PFshmnfix++;
+    return(PFE_OK);
+}
+
+static void PFshmRemoveFix(PFshm_fix *fix)
+{
+    *fix = PFshmfix[--PFshmnfix];
+}
+
+/* release a pin taken by this process, with the latch not held */
+static void PFshmUnpin(int f)
+{
+    PFshmLock();
+    PFshmFrame(PFshmhdr,f)->pincount--;
+    if (PFshmslot >= 0) {
+        PFshmFrame(PFshmhdr,f)->pins[PFshmslot]--;
+    }
+    PFshmUnlink(f);
+    PFshmLinkHead(f);
+    PFshmUnlock();
+}
+
+/* error to report for a page this process has not fixed */
+static int PFshmNotFixed(int fd, int pagenum)
+{
+    unsigned long dev, ino;
+    int f;
+
+    PFftabIdent(fd,&dev,&ino);
+    PFshmLock();
+    f = PFshmHashFind(dev,ino,pagenum);
+    PFshmUnlock();
+    PFerrno = (f == PF_SHM_NULL) ? PFE_PAGENOTINBUF : PFE_PAGEUNFIXED;
+    return(PFerrno);
+}
+
+
+/****************** Interface to buf.c ************************************/
+
+int
+PFshmGet(
+    int fd,	/* file descriptor */
+    int pagenum,	/* page number */
+    PFfpage **fpage,	/* pointer to pointer to file page */
+    int (*readfcn)(),	/* function to read a page */
+    int (*writefcn)()	/* function to write a page */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Shared-pool version of PFbufGet(). If another process is reading
+	the page in, wait for it instead of reading it a second time.
+	writefcn is not needed because frames are never dirty.
+
+RETURN VALUE:
+	PFE_OK	if no error.
+	PFE_PAGEFIXED if this process has already fixed the page;
+	*fpage still points to the page.
+	PF error code if error.
+*****************************************************************************/
+{
+    PFshm_fix *fix;
+    PFshm_frame *frame;
+    struct timespec until;
+    unsigned long dev, ino;
+    int f, error;
+
+    if ((fix = PFshmFindFix(fd,pagenum)) != NULL) {
+        *fpage = &PFshmFrame(PFshmhdr,fix->frame)->fpage;
+        PFerrno = PFE_PAGEFIXED;
+        return(PFerrno);
+    }
+
+    PFftabIdent(fd,&dev,&ino);
+    PFshmLock();
+    while ((f = PFshmHashFind(dev,ino,pagenum)) != PF_SHM_NULL) {
+        frame = PFshmFrame(PFshmhdr,f);
+        if (!frame->loading) {
+            /* warm hit, possibly on a page read by another process */
+            PFshmPin(f);
+            PFshmUnlink(f);
+            PFshmLinkHead(f);
+            PFshmUnlock();
+            if ((error = PFshmAddFix(fd,pagenum,f)) != PFE_OK) {
+                PFshmUnpin(f);
+                *fpage = NULL;
+                return(error);
+            }
+            *fpage = &frame->fpage;
+            return(PFE_OK);
+        }
+        /* wait for the reader, checking now and then that it lives */
+        clock_gettime(CLOCK_REALTIME,&until);
+        until.tv_nsec += PF_SHM_LOADWAIT * 1000000L;
+        until.tv_sec += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        error = pthread_cond_timedwait(&PFshmhdr->loaded,&PFshmhdr->latch,&until);
+        if (error == EOWNERDEAD) {
+            PFshmOwnerDied();
+        } else if (error == ETIMEDOUT && PFshmLoaderDied(f)) {
+            PFshmDrop(f);
+        }
+    }
+
+    /* not in the pool: claim a frame, publish it as loading and read
+    the page in without holding the latch */
+    if ((error = PFshmVictim(&f)) != PFE_OK) {
+        PFshmUnlock();
+        *fpage = NULL;
+        return(error);
+    }
+    frame = PFshmFrame(PFshmhdr,f);
+    frame->dev = dev;
+    frame->ino = ino;
+    frame->page = pagenum;
+    frame->valid = TRUE;
+    if (pthread_mutex_lock(&frame->reading) == EOWNERDEAD) {
+        pthread_mutex_consistent(&frame->reading); /* a reader died, see PFshmLoaderDied() */
+    }
+    frame->loading = TRUE;
+    frame->pincount = 0;
+    PFshmPin(f);
+    PFshmHashInsert(f);
+    PFshmLinkHead(f);
+    PFshmUnlock();
+
+    error = (*readfcn)(fd,pagenum,&frame->fpage);
+
+    PFshmLock();
+    frame->loading = FALSE;
+    pthread_mutex_unlock(&frame->reading);
+    if (error != PFE_OK) {
+        PFshmDrop(f);
+    }
+    pthread_cond_broadcast(&PFshmhdr->loaded);
+    PFshmUnlock();
+
+    if (error == PFE_OK && (error = PFshmAddFix(fd,pagenum,f)) != PFE_OK) {
+        PFshmUnpin(f);
+    }
+    if (error != PFE_OK) {
+        *fpage = NULL;
+        return(error);
+    }
+    *fpage = &frame->fpage;
+    return(PFE_OK);
+}
+
+int
+PFshmUnfix(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    int dirty,	/* TRUE if page is dirty */
+    int (*writefcn)()	/* function to write a page */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Shared-pool version of PFbufUnfix(). A dirty page is written to
+	the file before its pin is released, so the frame stays clean.
+
+RETURN VALUE:
+	PFE_OK if no error.
+	PF error codes if error occurs.
+*****************************************************************************/
+{
+    PFshm_fix *fix;
+    int f, error;
+
+    if ((fix = PFshmFindFix(fd,pagenum)) == NULL) {
+        return(PFshmNotFixed(fd,pagenum));
+    }
+
+    f = fix->frame;
+    if ((dirty || fix->dirty) &&
+            (error = (*writefcn)(fd,pagenum,&PFshmFrame(PFshmhdr,f)->fpage)) != PFE_OK) {
+        /* keep the page fixed and dirty so the caller can retry */
+        fix->dirty = TRUE;
+        return(error);
+    }
+
+    PFshmRemoveFix(fix);
+    PFshmUnpin(f);
+    return(PFE_OK);
+}
+
+int
+PFshmAlloc(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    PFfpage **fpage	/* pointer to file page */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Shared-pool version of PFbufAlloc(). A stale unfixed copy of the
+	page (left by a file that was destroyed and recreated on the same
+	inode) is dropped first.
+
+RETURN VALUE:
+	PFE_OK if successful.
+	PF error codes if unsuccessful
+*****************************************************************************/
+{
+    PFshm_frame *frame;
+    unsigned long dev, ino;
+    int f, error;
+
+    *fpage = NULL;
+
+    if (PFshmFindFix(fd,pagenum) != NULL) {
+        PFerrno = PFE_PAGEINBUF;
+        return(PFerrno);
+    }
+
+    PFftabIdent(fd,&dev,&ino);
+    PFshmLock();
+    if ((f = PFshmHashFind(dev,ino,pagenum)) != PF_SHM_NULL) {
+        frame = PFshmFrame(PFshmhdr,f);
+        if ((frame->pincount > 0 || frame->loading) && !PFshmLoaderDied(f)) {
+            PFshmUnlock();
+            PFerrno = PFE_PAGEINBUF;
+            return(PFerrno);
+        }
+        PFshmDrop(f);
+    }
+
+    if ((error = PFshmVictim(&f)) != PFE_OK) {
+        PFshmUnlock();
+        return(error);
+    }
+    frame = PFshmFrame(PFshmhdr,f);
+    frame->dev = dev;
+    frame->ino = ino;
+    frame->page = pagenum;
+    frame->valid = TRUE;
+    frame->loading = FALSE;
+    frame->pincount = 0;
+    PFshmPin(f);
+    PFshmHashInsert(f);
+    PFshmLinkHead(f);
+    PFshmUnlock();
+
+    if ((error = PFshmAddFix(fd,pagenum,f)) != PFE_OK) {
+        PFshmUnpin(f);
+        return(error);
+    }
+    *fpage = &frame->fpage;
+    return(PFE_OK);
+}
+
+int
+PFshmReleaseFile(int fd /* file descriptor */)
+/****************************************************************************
+SPECIFICATIONS:
+	Shared-pool version of PFbufReleaseFile(). Frames are clean, so
+	nothing needs writing, and the pages stay cached for the other
+	processes.
+
+RETURN VALUE:
+	PFE_OK if no error.
+	PFE_PAGEFIXED if this process still has a page of the file fixed.
+*****************************************************************************/
+{
+    int i;
+
+    for (i = 0; i < PFshmnfix; i++) {
+        if (PFshmfix[i].fd == fd) {
+            PFerrno = PFE_PAGEFIXED;
+            return(PFerrno);
+        }
+    }
+    return(PFE_OK);
+}
+
+int
+PFshmUsed(
+    int fd,		/* file descriptor */
+    int pagenum	/* page number */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Shared-pool version of PFbufUsed(): the page, which must be fixed
+	by this process, will be written when it is unfixed.
+
+RETURN VALUE: PF error codes.
+*****************************************************************************/
+{
+    PFshm_fix *fix;
+
+    if ((fix = PFshmFindFix(fd,pagenum)) == NULL) {
+        return(PFshmNotFixed(fd,pagenum));
+    }
+    fix->dirty = TRUE;
+    return(PFE_OK);
+}
+
+void
+PFshmInvalidate(
+    unsigned long dev,	/* device of the file */
+    unsigned long ino	/* inode of the file */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Drop every unfixed page of a file that is being destroyed, so a
+	new file that reuses the inode does not see its pages.
+
+RETURN VALUE: none
+*****************************************************************************/
+{
+    PFshm_frame *frame;
+    int f, prev;
+
+    PFshmLock();
+    for (f = PFshmhdr->lastframe; f != PF_SHM_NULL; f = prev) {
+        frame = PFshmFrame(PFshmhdr,f);
+        prev = frame->prevframe;
+        if (frame->dev == dev && frame->ino == ino
+                && ((frame->pincount == 0 && !frame->loading) || PFshmLoaderDied(f))) {
+            PFshmDrop(f);
+        }
+    }
+    PFshmUnlock();
+}
+
+void
+PFshmPrint()
+/****************************************************************************
+SPECIFICATIONS:
+	Print the frames of the shared pool.
+*****************************************************************************/
+{
+    PFshm_frame *frame;
+    int f;
+
+    printf("shared buffer content (%d frames):\n",PFshmhdr->nbufs);
+    PFshmLock();
+    if (PFshmhdr->firstframe == PF_SHM_NULL) {
+        printf("empty\n");
+    } else {
+        printf("dev\tino\tpage\tpins\n");
+        for (f = PFshmhdr->firstframe; f != PF_SHM_NULL; f = frame->nextframe) {
+            frame = PFshmFrame(PFshmhdr,f);
+            printf("%lu\t%lu\t%d\t%d\n",frame->dev,frame->ino,
+                   frame->page,frame->pincount);
+        }
+    }
+    PFshmUnlock();
+}
+
+
+/************************* Interface Routines ****************************/
+
+int
+PF_AttachShared(
+    char *segname,	/* name of the POSIX shared-memory segment */
+    int nbufs		/* # of frames, or <= 0 for PF_MAX_BUFS */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Attach to the shared buffer pool "segname", creating it with
+	"nbufs" frames if it does not exist yet. If it exists, its own
+	size is used. From now on every buffer operation of this process
+	goes through the shared pool. Call it right after PF_Init(), before
+	any page is fixed.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the segment cannot be created or mapped.
+	PFE_NOMEM if the segment was not set up in time by its creator.
+	PFE_NOBUF if PF_SHM_MAXPROCS live processes are attached already.
+*****************************************************************************/
+{
+    PFshm_hdr *hdr;
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+    struct stat st;
+    int shmfd, hsize, frameoff, i;
+    size_t size;
+
+    if (PFshmActive && PF_DetachShared() != PFE_OK) {
+        return(PFerrno);
+    }
+    if (nbufs <= 0) {
+        nbufs = PF_MAX_BUFS;
+    }
+
+    if ((shmfd = shm_open(segname,O_RDWR|O_CREAT|O_EXCL,0666)) >= 0) {
+        /* we are the creator: size, map and set up the segment */
+        size = PFshmSegSize(nbufs,&hsize,&frameoff);
+        if (ftruncate(shmfd,size) == -1 ||
+                (hdr = (PFshm_hdr *)mmap(NULL,size,PROT_READ|PROT_WRITE,
+                                         MAP_SHARED,shmfd,0)) == MAP_FAILED) {
+            close(shmfd);
+            shm_unlink(segname);
+            PFerrno = PFE_UNIX;
+            return(PFerrno);
+        }
+        hdr->nbufs = nbufs;
+        hdr->hsize = hsize;
+        hdr->frameoff = frameoff;
+        hdr->firstframe = hdr->lastframe = PF_SHM_NULL;
+        memset(hdr->procs,0,sizeof(hdr->procs));
+        for (i = 0; i < hsize; i++) {
+            PFshmBucket(hdr)[i] = PF_SHM_NULL;
+        }
+        pthread_mutexattr_init(&mattr);
+        pthread_mutexattr_setpshared(&mattr,PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mattr,PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&hdr->latch,&mattr);
+        for (i = 0; i < nbufs; i++) {
+            PFshmFrame(hdr,i)->valid = FALSE;
+            PFshmFrame(hdr,i)->loading = FALSE;
+            PFshmFrame(hdr,i)->pincount = 0;
+            memset(PFshmFrame(hdr,i)->pins,0,sizeof(PFshmFrame(hdr,i)->pins));
+            PFshmFrame(hdr,i)->nextframe = (i + 1 < nbufs) ? i + 1 : PF_SHM_NULL;
+            pthread_mutex_init(&PFshmFrame(hdr,i)->reading,&mattr);
+        }
+        hdr->freeframe = 0;
+        pthread_mutexattr_destroy(&mattr);
+        pthread_condattr_init(&cattr);
+        pthread_condattr_setpshared(&cattr,PTHREAD_PROCESS_SHARED);
+        pthread_cond_init(&hdr->loaded,&cattr);
+        pthread_condattr_destroy(&cattr);
+
+        /* publish the segment only once it is fully set up */
+        __sync_synchronize();
+        hdr->magic = PF_SHM_MAGIC;
+    } else if (errno == EEXIST && (shmfd = shm_open(segname,O_RDWR,0)) >= 0) {
+        /* attach: wait for the creator to size and set up the segment,
+        then map it at the size it was created with */
+        for (i = 0; ; i++) {
+            if (fstat(shmfd,&st) == -1) {
+                close(shmfd);
+                PFerrno = PFE_UNIX;
+                return(PFerrno);
+            }
+            if (st.st_size >= sizeof(PFshm_hdr)) {
+                break;
+            }
+            if (i == PF_SHM_WAITS) {
+                close(shmfd);
+                PFerrno = PFE_NOMEM;
+                return(PFerrno);
+            }
+            usleep(1000);
+        }
+        size = st.st_size;
+        if ((hdr = (PFshm_hdr *)mmap(NULL,size,PROT_READ|PROT_WRITE,
+                                     MAP_SHARED,shmfd,0)) == MAP_FAILED) {
+            close(shmfd);
+            PFerrno = PFE_UNIX;
+            return(PFerrno);
+        }
+        for (i = 0; *(volatile int *)&hdr->magic != PF_SHM_MAGIC; i++) {
+            if (i == PF_SHM_WAITS) {
+                munmap((char *)hdr,size);
+                close(shmfd);
+                PFerrno = PFE_NOMEM;
+                return(PFerrno);
+            }
+            usleep(1000);
+        }
+        __sync_synchronize();
+    } else {
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+
+    close(shmfd);
+    PFshmhdr = hdr;
+    PFshmsize = size;
+    PFshmnfix = 0;
+
+    /* take a slot for the pins of this process */
+    if (pthread_mutex_lock(&hdr->latch) == EOWNERDEAD) {
+        PFshmOwnerDied();
+    }
+    i = PFshmTakeSlot();
+    PFshmUnlock();
+    if (i != PFE_OK) {
+        munmap((char *)hdr,size);
+        PFshmhdr = NULL;
+        return(i);
+    }
+    PFshmActive = TRUE;
+    return(PFE_OK);
+}
+
+int
+PF_DetachShared()
+/****************************************************************************
+SPECIFICATIONS:
+	Detach from the shared pool and go back to the private pool.
+	The segment and the pages cached in it stay for other processes.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_PAGEFIXED if this process still has pages fixed.
+*****************************************************************************/
+{
+    if (!PFshmActive) {
+        return(PFE_OK);
+    }
+    if (PFshmnfix > 0 && PFshmpid == getpid()) {
+        PFerrno = PFE_PAGEFIXED;
+        return(PFerrno);
+    }
+    PFshmLock();
+    if (PFshmslot >= 0) {
+        PFshmhdr->procs[PFshmslot] = 0;
+    }
+    PFshmUnlock();
+    PFshmslot = -1;
+    munmap((char *)PFshmhdr,PFshmsize);
+    PFshmhdr = NULL;
+    PFshmActive = FALSE;
+    return(PFE_OK);
+}
+
+int
+PF_DestroyShared(char *segname /* name of the segment */)
+/****************************************************************************
+SPECIFICATIONS:
+	Remove the shared pool "segname". Processes still attached keep
+	using it until they detach.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the segment does not exist.
+*****************************************************************************/
+{
+    if (shm_unlink(segname) == -1) {
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+    return(PFE_OK);
+}
@@ -0,0 +1,158 @@
+/* testshm.c: tests the shared buffer pool. Several processes read pages
+of one file through the pool at once, then a process is killed while it
+has every frame fixed: the others must still get frames. Prints
+"testshm done: OK" and exits with 0 if all went well. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "pf.h"
+#include "pftypes.h"
+
+#define FILE1	"shmfile"
+#define NUMPAGES 40	/* # of pages of the file */
+#define NUMBUFS	8	/* # of frames of the pool */
+#define NUMPROCS 4	/* # of readers at once */
+#define NUMREADS 2000	/* # of pages each reader reads */
+
+/* fixes and unfixes NUMREADS random pages, checking that each holds its
+own number; returns the # of pages that did not */
+static int
+readpages(int fd, int seed)
+{
+    int i, pagenum, bad;
+    char *buf;
+
+    srand(seed);
+    bad = 0;
+    for (i = 0; i < NUMREADS; i++) {
+        pagenum = rand() % NUMPAGES;
+        if (PF_GetThisPage(fd,pagenum,&buf) != PFE_OK) {
+            PF_PrintError("get page");
+            bad++;
+            continue;
+        }
+        if (*(int *)buf != pagenum)
+            bad++;
+        if (PF_UnfixPage(fd,pagenum,FALSE) != PFE_OK) {
+            PF_PrintError("unfix page");
+            bad++;
+        }
+    }
+    return(bad);
+}
+
+/* fixes NUMBUFS pages at once, which needs every frame of the pool, and
+unfixes them; returns the # of pages that could not be fixed */
+static int
+fixall(int fd)
+{
+    int pagenum, bad;
+    char *buf;
+
+    bad = 0;
+    for (pagenum = 0; pagenum < NUMBUFS; pagenum++) {
+        if (PF_GetThisPage(fd,pagenum,&buf) != PFE_OK) {
+            PF_PrintError("fix all pages");
+            bad++;
+        }
+    }
+    for (pagenum = 0; pagenum < NUMBUFS; pagenum++)
+        PF_UnfixPage(fd,pagenum,FALSE);
+    return(bad);
+}
+
+int
+main()
+{
+    char segname[40];	/* name of the shared-memory segment */
+    int fd, i, pagenum, status, failed;
+    int ready[2];	/* the killed process says it has fixed its pages */
+    pid_t pid;
+    char *buf;
+
+    PF_Init();
+    sprintf(segname,"/testshm.%d",(int)getpid());
+    failed = 0;
+
+    /* a file whose every page holds its own number */
+    unlink(FILE1);
+    if (PF_CreateFile(FILE1) != PFE_OK || (fd = PF_OpenFile(FILE1)) < 0) {
+        PF_PrintError(FILE1);
+        exit(1);
+    }
+    for (i = 0; i < NUMPAGES; i++) {
+        if (PF_AllocPage(fd,&pagenum,&buf) != PFE_OK) {
+            PF_PrintError("alloc page");
+            exit(1);
+        }
+        *(int *)buf = pagenum;
+        PF_UnfixPage(fd,pagenum,TRUE);
+    }
+    PF_CloseFile(fd);
+
+    if (PF_AttachShared(segname,NUMBUFS) != PFE_OK) {
+        PF_PrintError("attach");
+        exit(1);
+    }
+    if ((fd = PF_OpenFile(FILE1)) < 0) {
+        PF_PrintError(FILE1);
+        PF_DestroyShared(segname);
+        exit(1);
+    }
+
+    /* readers at once, each exiting with the # of bad pages it read */
+    for (i = 0; i < NUMPROCS; i++) {
+        if ((pid = fork()) == 0)
+            exit(readpages(fd,i + 1) != 0);
+    }
+    for (i = 0; i < NUMPROCS; i++) {
+        if (wait(&status) == -1 || !WIFEXITED(status)
+                || WEXITSTATUS(status) != 0) {
+            printf("reader %d failed\n",i);
+            failed++;
+        }
+    }
+    printf("%d readers done\n",NUMPROCS);
+    if (fixall(fd) != 0) {
+        printf("readers left pages fixed\n");
+        failed++;
+    }
+
+    /* a process killed with every frame fixed */
+    if (pipe(ready) == -1) {
+        perror("pipe");
+        PF_DestroyShared(segname);
+        exit(1);
+    }
+    if ((pid = fork()) == 0) {
+        close(ready[0]);
+        for (pagenum = 0; pagenum < NUMBUFS; pagenum++)
+            PF_GetThisPage(fd,NUMPAGES - 1 - pagenum,&buf);
+        write(ready[1],"x",1);
+        pause();
+        exit(0);
+    }
+    close(ready[1]);
+    if (read(ready[0],&status,1) != 1) {
+        printf("pinning process did not start\n");
+        failed++;
+    }
+    close(ready[0]);
+    kill(pid,SIGKILL);
+    waitpid(pid,&status,0);
+    printf("killed a process with %d pages fixed\n",NUMBUFS);
+    if (fixall(fd) != 0 || readpages(fd,NUMPROCS + 1) != 0) {
+        printf("pages of the killed process stayed fixed\n");
+        failed++;
+    }
+
+    PF_CloseFile(fd);
+    PF_DetachShared();
+    PF_DestroyShared(segname);
+    unlink(FILE1);
+    printf("testshm done: %s\n",failed ? "FAILED" : "OK");
+    return(failed != 0);
+}
@@ -0,0 +1,177 @@
+/* testsim.c: replays known traces with pfsim and checks what it reports
+for every policy. Must be run where pfsim was built. Prints
+"testsim done: OK" and exits with 0 if all went well. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pf.h"
+#include "pftypes.h"
+
+#define TRACEFILE "simtrace"
+#define MAXRECS	1000	/* max # of records of a trace */
+#define LOOPPAGES 5	/* # of pages of the loop trace */
+#define LOOPS	10	/* # of passes over them */
+#define HOTPAGES 2	/* # of pages of the hot set */
+#define SCANSTEPS 50	/* # of references to hot pages */
+
+/* what pfsim should report for one policy and pool size */
+typedef struct simresult {
+    char *policy;
+    int nbufs;
+    long refs, hits, writebk, flushed;
+} simresult;
+
+/* LOOPS passes over LOOPPAGES pages, page 0 written in the first, then
+a page allocated and written. In a pool of LOOPPAGES every policy misses
+only the first pass and the allocation pushes out page 0, written back.
+In a pool one page smaller, LRU and CLOCK miss every reference, and so
+does ARC, which never sees a page twice before pushing it out of T1
+without a ghost; only 2Q gets hits, from pages remembered in A1out. */
+static simresult loopresults[] = {
+    { "LRU", 4, 50, 0, 1, 1 },
+    { "CLOCK", 4, 50, 0, 1, 1 },
+    { "2Q", 4, 50, 18, 1, 1 },
+    { "ARC", 4, 50, 0, 1, 1 },
+    { "LRU", 5, 50, 45, 1, 1 },
+    { "CLOCK", 5, 50, 45, 1, 1 },
+    { "2Q", 5, 50, 45, 1, 1 },
+    { "ARC", 5, 50, 45, 1, 1 },
+};
+
+/* HOTPAGES pages read in turn, each time after two pages read only once.
+Five other pages come between two references of a hot page, so the hot
+pages fall out of a 4-page pool under LRU, CLOCK and ARC; 2Q moves them
+to Am on their second reference and keeps them. In an 8-page pool LRU
+and ARC hit every hot reference but the first two, and 2Q every one but
+the first four; CLOCK hits fewer, as its hand clears hot pages' bits. */
+static simresult scanresults[] = {
+    { "LRU", 4, 150, 0, 0, 0 },
+    { "CLOCK", 4, 150, 0, 0, 0 },
+    { "2Q", 4, 150, 46, 0, 0 },
+    { "ARC", 4, 150, 0, 0, 0 },
+    { "LRU", 8, 150, 48, 0, 0 },
+    { "CLOCK", 8, 150, 34, 0, 0 },
+    { "2Q", 8, 150, 46, 0, 0 },
+    { "ARC", 8, 150, 48, 0, 0 },
+};
+
+static PFtrace_rec trace[MAXRECS];
+static int ntrace;
+
+/* adds a record to the trace */
+static void
+addrec(int op, int page, int dirty)
+{
+    trace[ntrace].fd = 0;
+    trace[ntrace].op = op;
+    trace[ntrace].dirty = dirty;
+    trace[ntrace].page = page;
+    ntrace++;
+}
+
+/* writes the trace to TRACEFILE; returns 0 if OK */
+static int
+writetrace()
+{
+    FILE *fp;
+    PFtrace_hdr hdr;
+
+    if ((fp = fopen(TRACEFILE,"wb")) == NULL) {
+        perror(TRACEFILE);
+        return(-1);
+    }
+    hdr.magic = PF_TRACE_MAGIC;
+    hdr.maxbufs = PF_MAX_BUFS;
+    fwrite((char *)&hdr,sizeof(hdr),1,fp);
+    fwrite((char *)trace,sizeof(PFtrace_rec),ntrace,fp);
+    return(fclose(fp));
+}
+
+/* runs pfsim on TRACEFILE with the pool sizes "sizes" and checks its
+rows against the n results expected; returns the # of mismatches */
+static int
+checksim(char *name, char *sizes, simresult *expected, int n)
+{
+    char cmd[100], line[200], policy[20];
+    FILE *fp;
+    simresult got;
+    double hitrate;
+    int i, nrows, failed;
+
+    sprintf(cmd,"./pfsim %s %s",TRACEFILE,sizes);
+    if ((fp = popen(cmd,"r")) == NULL) {
+        perror("pfsim");
+        return(1);
+    }
+    nrows = failed = 0;
+    while (fgets(line,sizeof(line),fp) != NULL) {
+        if (sscanf(line,"%19s %d %ld %ld %lf %ld %ld",policy,&got.nbufs,
+                   &got.refs,&got.hits,&hitrate,&got.writebk,&got.flushed) != 7)
+            continue;	/* the heading lines */
+        if (nrows == n) {
+            printf("%s: extra row %s",name,line);
+            failed++;
+            continue;
+        }
+        i = nrows++;
+        if (strcmp(policy,expected[i].policy) != 0
+                || got.nbufs != expected[i].nbufs
+                || got.refs != expected[i].refs
+                || got.hits != expected[i].hits
+                || got.writebk != expected[i].writebk
+                || got.flushed != expected[i].flushed) {
+            printf("%s: got %s",name,line);
+            printf("%s: expected %s\t%d\t%ld\t%ld\t-\t%ld\t%ld\n",name,
+                   expected[i].policy,expected[i].nbufs,expected[i].refs,
+                   expected[i].hits,expected[i].writebk,expected[i].flushed);
+            failed++;
+        }
+    }
+    if (pclose(fp) != 0 || nrows != n) {
+        printf("%s: pfsim failed or gave %d rows of %d\n",name,nrows,n);
+        failed++;
+    }
+    printf("%s trace: %d rows checked, %d wrong\n",name,nrows,failed);
+    return(failed);
+}
+
+int
+main()
+{
+    int i, j, failed;
+
+    failed = 0;
+
+    ntrace = 0;
+    for (i = 0; i < LOOPS; i++) {
+        for (j = 0; j < LOOPPAGES; j++) {
+            addrec(PF_TRACE_GET,j,FALSE);
+            addrec(PF_TRACE_UNFIX,j,i == 0 && j == 0);
+        }
+    }
+    addrec(PF_TRACE_ALLOC,LOOPPAGES,FALSE);
+    addrec(PF_TRACE_UNFIX,LOOPPAGES,TRUE);
+    if (writetrace() != 0)
+        exit(1);
+    failed += checksim("loop","4 5",loopresults,
+                       sizeof(loopresults) / sizeof(simresult));
+
+    ntrace = 0;
+    for (i = 0; i < SCANSTEPS; i++) {
+        addrec(PF_TRACE_GET,i % HOTPAGES,FALSE);
+        addrec(PF_TRACE_UNFIX,i % HOTPAGES,FALSE);
+        for (j = 0; j < 2; j++) {
+            addrec(PF_TRACE_GET,HOTPAGES + 2 * i + j,FALSE);
+            addrec(PF_TRACE_UNFIX,HOTPAGES + 2 * i + j,FALSE);
+        }
+    }
+    if (writetrace() != 0)
+        exit(1);
+    failed += checksim("scan","4 8",scanresults,
+                       sizeof(scanresults) / sizeof(simresult));
+
+    unlink(TRACEFILE);
+    printf("testsim done: %s\n",failed ? "FAILED" : "OK");
+    return(failed != 0);
+}
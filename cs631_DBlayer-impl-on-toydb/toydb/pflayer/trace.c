@@ -0,0 +1,102 @@
+/* trace.c: buffer access trace recorder. The interface routines are:
+PF_TraceOpen(), PF_TraceClose() and PFtraceRecord() */
+#include <stdio.h>
+#include <stdlib.h>
+#include "pf.h"
+#include "pftypes.h"
+#include "pfinternals.h"
+
+FILE *PFtracefp = NULL;	/* open trace file, or NULL if not tracing */
+
+
+void
+PFtraceRecord(
+    int fd,		/* file descriptor */
+    int pagenum,	/* page number */
+    int op,		/* PF_TRACE_GET, PF_TRACE_UNFIX or PF_TRACE_ALLOC */
+    int dirty	/* dirty flag, only meaningful for PF_TRACE_UNFIX */
+)
+/****************************************************************************
+SPECIFICATIONS:
+	Append one access record to the trace file. The buffer manager
+	only calls this when PFtracefp is not NULL, so an untraced run
+	pays a single test per buffer operation.
+	Records go through stdio, so they are written in large blocks.
+
+RETURN VALUE: none
+*****************************************************************************/
+{
+    PFtrace_rec rec;
+
+    rec.fd = fd;
+    rec.op = op;
+    rec.dirty = (dirty != FALSE);
+    rec.page = pagenum;
+    if (fwrite((char *)&rec,sizeof(rec),1,PFtracefp) != 1) {
+        /* stop tracing rather than fail the buffer operation */
+        fclose(PFtracefp);
+        PFtracefp = NULL;
+    }
+}
+
+
+int
+PF_TraceOpen(char *fname /* name of the trace file to write */)
+/****************************************************************************
+SPECIFICATIONS:
+	Start recording every PFbufGet(), PFbufUnfix() and PFbufAlloc()
+	into the binary trace file "fname", which is created or truncated.
+	A trace already being recorded is closed first.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the trace file cannot be created.
+*****************************************************************************/
+{
+    PFtrace_hdr hdr;
+
+    PF_TraceClose();
+
+    if ((PFtracefp = fopen(fname,"wb")) == NULL) {
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+
+    hdr.magic = PF_TRACE_MAGIC;
+    hdr.maxbufs = PF_MAX_BUFS;
+    if (fwrite((char *)&hdr,sizeof(hdr),1,PFtracefp) != 1) {
+        fclose(PFtracefp);
+        PFtracefp = NULL;
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+    return(PFE_OK);
+}
+
+
+int
+PF_TraceClose()
+/****************************************************************************
+SPECIFICATIONS:
+	Stop recording and flush the trace file. Does nothing if no
+	trace is being recorded.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_UNIX if the trace could not be flushed.
+*****************************************************************************/
+{
+    int error;
+
+    if (PFtracefp == NULL) {
+        return(PFE_OK);
+    }
+
+    error = fclose(PFtracefp);
+    PFtracefp = NULL;
+    if (error != 0) {
+        PFerrno = PFE_UNIX;
+        return(PFerrno);
+    }
+    return(PFE_OK);
+}